@@ -32,8 +32,14 @@ else
 endif
 
 OPENCL_SDK_SRC_FILES := \
+    src/util/bfloat16.cpp \
     src/util/cl_wrapper.cpp \
     src/util/half_float.cpp \
+    src/util/kernel_timings.cpp \
+    src/util/mapped_file.cpp \
+    src/util/priority_scheduler.cpp \
+    src/util/program_cache.cpp \
+    src/util/trace.cpp \
     src/util/util.cpp
 
 #########################
@@ -468,6 +474,22 @@ LOCAL_C_INCLUDES       := $(OPENCL_SDK_COMMON_INCLUDES)
 
 include $(BUILD_EXECUTABLE)
 
+#########################################
+# buffer_matrix_multiplication_bfloat16 #
+#########################################
+include $(CLEAR_VARS)
+LOCAL_MODULE := buffer_matrix_multiplication_bfloat16
+
+LOCAL_SRC_FILES := \
+    $(OPENCL_SDK_SRC_FILES) \
+    src/examples/linear_algebra/buffer_matrix_multiplication_bfloat16.cpp
+
+LOCAL_CPPFLAGS         := $(OPENCL_SDK_CPPFLAGS)
+LOCAL_SHARED_LIBRARIES := $(OPENCL_SDK_SHARED_LIBS)
+LOCAL_C_INCLUDES       := $(OPENCL_SDK_COMMON_INCLUDES)
+
+include $(BUILD_EXECUTABLE)
+
 #############
 # fft_image #
 #############
@@ -546,4 +568,228 @@ LOCAL_CPPFLAGS         := $(OPENCL_SDK_CPPFLAGS)
 LOCAL_SHARED_LIBRARIES := $(OPENCL_SDK_SHARED_LIBS)
 LOCAL_C_INCLUDES       := $(OPENCL_SDK_COMMON_INCLUDES)
 
+include $(BUILD_EXECUTABLE)
+
+######################
+# plane_io_benchmark #
+######################
+include $(CLEAR_VARS)
+LOCAL_MODULE := plane_io_benchmark
+
+LOCAL_SRC_FILES := \
+    $(OPENCL_SDK_SRC_FILES) \
+    src/examples/benchmarks/plane_io_benchmark.cpp
+
+LOCAL_CPPFLAGS         := $(OPENCL_SDK_CPPFLAGS)
+LOCAL_SHARED_LIBRARIES := $(OPENCL_SDK_SHARED_LIBS)
+LOCAL_C_INCLUDES       := $(OPENCL_SDK_COMMON_INCLUDES)
+
+include $(BUILD_EXECUTABLE)
+
+###########################
+# matrix_format_converter #
+###########################
+include $(CLEAR_VARS)
+LOCAL_MODULE := matrix_format_converter
+
+LOCAL_SRC_FILES := \
+    $(OPENCL_SDK_SRC_FILES) \
+    src/examples/linear_algebra/matrix_format_converter.cpp
+
+LOCAL_CPPFLAGS         := $(OPENCL_SDK_CPPFLAGS)
+LOCAL_SHARED_LIBRARIES := $(OPENCL_SDK_SHARED_LIBS)
+LOCAL_C_INCLUDES       := $(OPENCL_SDK_COMMON_INCLUDES)
+
+include $(BUILD_EXECUTABLE)
+
+##########################
+# nv12_to_rgba_streaming #
+##########################
+include $(CLEAR_VARS)
+LOCAL_MODULE := nv12_to_rgba_streaming
+
+LOCAL_SRC_FILES := \
+    $(OPENCL_SDK_SRC_FILES) \
+    src/examples/conversions/nv12_to_rgba_streaming.cpp
+
+LOCAL_CPPFLAGS         := $(OPENCL_SDK_CPPFLAGS)
+LOCAL_SHARED_LIBRARIES := $(OPENCL_SDK_SHARED_LIBS)
+LOCAL_C_INCLUDES       := $(OPENCL_SDK_COMMON_INCLUDES)
+
+include $(BUILD_EXECUTABLE)
+
+########################
+# frame_container_tool #
+########################
+include $(CLEAR_VARS)
+LOCAL_MODULE := frame_container_tool
+
+LOCAL_SRC_FILES := \
+    $(OPENCL_SDK_SRC_FILES) \
+    src/examples/conversions/frame_container_tool.cpp
+
+LOCAL_CPPFLAGS         := $(OPENCL_SDK_CPPFLAGS)
+LOCAL_SHARED_LIBRARIES := $(OPENCL_SDK_SHARED_LIBS)
+LOCAL_C_INCLUDES       := $(OPENCL_SDK_COMMON_INCLUDES)
+
+include $(BUILD_EXECUTABLE)
+
+##########################
+# async_loader_benchmark #
+##########################
+include $(CLEAR_VARS)
+LOCAL_MODULE := async_loader_benchmark
+
+LOCAL_SRC_FILES := \
+    $(OPENCL_SDK_SRC_FILES) \
+    src/examples/benchmarks/async_loader_benchmark.cpp
+
+LOCAL_CPPFLAGS         := $(OPENCL_SDK_CPPFLAGS)
+LOCAL_SHARED_LIBRARIES := $(OPENCL_SDK_SHARED_LIBS)
+LOCAL_C_INCLUDES       := $(OPENCL_SDK_COMMON_INCLUDES)
+
+include $(BUILD_EXECUTABLE)
+
+####################
+# image_data_codec #
+####################
+include $(CLEAR_VARS)
+LOCAL_MODULE := image_data_codec
+
+LOCAL_SRC_FILES := \
+    $(OPENCL_SDK_SRC_FILES) \
+    src/examples/conversions/image_data_codec.cpp
+
+LOCAL_CPPFLAGS         := $(OPENCL_SDK_CPPFLAGS)
+LOCAL_SHARED_LIBRARIES := $(OPENCL_SDK_SHARED_LIBS)
+LOCAL_C_INCLUDES       := $(OPENCL_SDK_COMMON_INCLUDES)
+
+include $(BUILD_EXECUTABLE)
+
+#############################
+# half_conversion_benchmark #
+#############################
+include $(CLEAR_VARS)
+LOCAL_MODULE := half_conversion_benchmark
+
+LOCAL_SRC_FILES := \
+    $(OPENCL_SDK_SRC_FILES) \
+    src/examples/benchmarks/half_conversion_benchmark.cpp
+
+LOCAL_CPPFLAGS         := $(OPENCL_SDK_CPPFLAGS)
+LOCAL_SHARED_LIBRARIES := $(OPENCL_SDK_SHARED_LIBS)
+LOCAL_C_INCLUDES       := $(OPENCL_SDK_COMMON_INCLUDES)
+
+include $(BUILD_EXECUTABLE)
+
+###########################
+# program_cache_benchmark #
+###########################
+include $(CLEAR_VARS)
+LOCAL_MODULE := program_cache_benchmark
+
+LOCAL_SRC_FILES := \
+    $(OPENCL_SDK_SRC_FILES) \
+    src/examples/benchmarks/program_cache_benchmark.cpp
+
+LOCAL_CPPFLAGS         := $(OPENCL_SDK_CPPFLAGS)
+LOCAL_SHARED_LIBRARIES := $(OPENCL_SDK_SHARED_LIBS)
+LOCAL_C_INCLUDES       := $(OPENCL_SDK_COMMON_INCLUDES)
+
+include $(BUILD_EXECUTABLE)
+
+############################
+# specialization_benchmark #
+############################
+include $(CLEAR_VARS)
+LOCAL_MODULE := specialization_benchmark
+
+LOCAL_SRC_FILES := \
+    $(OPENCL_SDK_SRC_FILES) \
+    src/examples/benchmarks/specialization_benchmark.cpp
+
+LOCAL_CPPFLAGS         := $(OPENCL_SDK_CPPFLAGS)
+LOCAL_SHARED_LIBRARIES := $(OPENCL_SDK_SHARED_LIBS)
+LOCAL_C_INCLUDES       := $(OPENCL_SDK_COMMON_INCLUDES)
+
+include $(BUILD_EXECUTABLE)
+
+#############################
+# kernel_registry_benchmark #
+#############################
+include $(CLEAR_VARS)
+LOCAL_MODULE := kernel_registry_benchmark
+
+LOCAL_SRC_FILES := \
+    $(OPENCL_SDK_SRC_FILES) \
+    src/examples/benchmarks/kernel_registry_benchmark.cpp
+
+LOCAL_CPPFLAGS         := $(OPENCL_SDK_CPPFLAGS)
+LOCAL_SHARED_LIBRARIES := $(OPENCL_SDK_SHARED_LIBS)
+LOCAL_C_INCLUDES       := $(OPENCL_SDK_COMMON_INCLUDES)
+
+include $(BUILD_EXECUTABLE)
+
+######################
+# ion_pool_benchmark #
+######################
+include $(CLEAR_VARS)
+LOCAL_MODULE := ion_pool_benchmark
+
+LOCAL_SRC_FILES := \
+    $(OPENCL_SDK_SRC_FILES) \
+    src/examples/benchmarks/ion_pool_benchmark.cpp
+
+LOCAL_CPPFLAGS         := $(OPENCL_SDK_CPPFLAGS)
+LOCAL_SHARED_LIBRARIES := $(OPENCL_SDK_SHARED_LIBS)
+LOCAL_C_INCLUDES       := $(OPENCL_SDK_COMMON_INCLUDES)
+
+include $(BUILD_EXECUTABLE)
+
+#######################
+# perf_hint_benchmark #
+#######################
+include $(CLEAR_VARS)
+LOCAL_MODULE := perf_hint_benchmark
+
+LOCAL_SRC_FILES := \
+    $(OPENCL_SDK_SRC_FILES) \
+    src/examples/benchmarks/perf_hint_benchmark.cpp
+
+LOCAL_CPPFLAGS         := $(OPENCL_SDK_CPPFLAGS)
+LOCAL_SHARED_LIBRARIES := $(OPENCL_SDK_SHARED_LIBS)
+LOCAL_C_INCLUDES       := $(OPENCL_SDK_COMMON_INCLUDES)
+
+include $(BUILD_EXECUTABLE)
+
+################################
+# priority_scheduler_benchmark #
+################################
+include $(CLEAR_VARS)
+LOCAL_MODULE := priority_scheduler_benchmark
+
+LOCAL_SRC_FILES := \
+    $(OPENCL_SDK_SRC_FILES) \
+    src/examples/benchmarks/priority_scheduler_benchmark.cpp
+
+LOCAL_CPPFLAGS         := $(OPENCL_SDK_CPPFLAGS)
+LOCAL_SHARED_LIBRARIES := $(OPENCL_SDK_SHARED_LIBS)
+LOCAL_C_INCLUDES       := $(OPENCL_SDK_COMMON_INCLUDES)
+
+include $(BUILD_EXECUTABLE)
+
+##########################
+# matrix_parse_benchmark #
+##########################
+include $(CLEAR_VARS)
+LOCAL_MODULE := matrix_parse_benchmark
+
+LOCAL_SRC_FILES := \
+    $(OPENCL_SDK_SRC_FILES) \
+    src/examples/benchmarks/matrix_parse_benchmark.cpp
+
+LOCAL_CPPFLAGS         := $(OPENCL_SDK_CPPFLAGS)
+LOCAL_SHARED_LIBRARIES := $(OPENCL_SDK_SHARED_LIBS)
+LOCAL_C_INCLUDES       := $(OPENCL_SDK_COMMON_INCLUDES)
+
 include $(BUILD_EXECUTABLE)
\ No newline at end of file
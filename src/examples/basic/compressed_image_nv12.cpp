@@ -17,6 +17,7 @@
 #include <tuple>
 
 // Project includes
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 #include "util/util.h"
 
@@ -69,7 +70,7 @@ int main(int argc, char** argv)
 
     cl_wrapper   wrapper;
     cl_program   program             = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
-    cl_kernel    blit_kernel         = wrapper.make_kernel("blit", program);
+    cl_kernel    blit_kernel         = wrapper.get_kernel("blit", program);
     cl_context   context             = wrapper.get_context();
     nv12_image_t src_nv12_image_info = load_nv12_image_data(src_image_filename);
 
@@ -142,15 +143,15 @@ int main(int argc, char** argv)
     src_nv12_desc.image_height = src_nv12_image_info.y_height;
 
     cl_int err = 0;
-    cl_mem_ion_host_ptr src_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_nv12_format, src_nv12_desc);
-    cl_mem src_nv12_image = clCreateImage(
+    ion_allocation src_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_nv12_format, src_nv12_desc);
+    cl_mem_handle src_nv12_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &src_nv12_format,
             &src_nv12_desc,
-            &src_nv12_ion_mem,
+            src_nv12_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image." << "\n";
@@ -167,16 +168,16 @@ int main(int argc, char** argv)
     compressed_nv12_desc.image_width  = src_nv12_image_info.y_width;
     compressed_nv12_desc.image_height = src_nv12_image_info.y_height;
 
-    cl_mem_ion_host_ptr compressed_nv12_ion_mem = wrapper.make_ion_buffer_for_compressed_image(compressed_nv12_format,
-                                                                                               compressed_nv12_desc);
-    cl_mem compressed_nv12_image = clCreateImage(
+    ion_allocation compressed_nv12_ion_mem = wrapper.make_ion_buffer_for_compressed_image(compressed_nv12_format,
+                                                                                          compressed_nv12_desc);
+    cl_mem_handle compressed_nv12_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &compressed_nv12_format,
             &compressed_nv12_desc,
-            &compressed_nv12_ion_mem,
+            compressed_nv12_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for compressed image." << "\n";
@@ -193,15 +194,15 @@ int main(int argc, char** argv)
     out_nv12_desc.image_width  = src_nv12_image_info.y_width;
     out_nv12_desc.image_height = src_nv12_image_info.y_height;
 
-    cl_mem_ion_host_ptr out_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(out_nv12_format, out_nv12_desc);
-    cl_mem out_nv12_image = clCreateImage(
+    ion_allocation out_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(out_nv12_format, out_nv12_desc);
+    cl_mem_handle out_nv12_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &out_nv12_format,
             &out_nv12_desc,
-            &out_nv12_ion_mem,
+            out_nv12_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for output image." << "\n";
@@ -221,16 +222,16 @@ int main(int argc, char** argv)
     src_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     src_y_plane_desc.image_width  = src_nv12_image_info.y_width;
     src_y_plane_desc.image_height = src_nv12_image_info.y_height;
-    src_y_plane_desc.mem_object   = src_nv12_image;
+    src_y_plane_desc.mem_object   = src_nv12_image.get();
 
-    cl_mem src_y_plane = clCreateImage(
+    cl_mem_handle src_y_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_y_plane_format,
             &src_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image y plane." << "\n";
@@ -248,16 +249,16 @@ int main(int argc, char** argv)
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
     src_uv_plane_desc.image_width  = src_nv12_image_info.y_width;
     src_uv_plane_desc.image_height = src_nv12_image_info.y_height;
-    src_uv_plane_desc.mem_object   = src_nv12_image;
+    src_uv_plane_desc.mem_object   = src_nv12_image.get();
 
-    cl_mem src_uv_plane = clCreateImage(
+    cl_mem_handle src_uv_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_uv_plane_format,
             &src_uv_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image uv plane." << "\n";
@@ -273,16 +274,16 @@ int main(int argc, char** argv)
     compressed_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     compressed_y_plane_desc.image_width  = compressed_nv12_desc.image_width;
     compressed_y_plane_desc.image_height = compressed_nv12_desc.image_height;
-    compressed_y_plane_desc.mem_object   = compressed_nv12_image;
+    compressed_y_plane_desc.mem_object   = compressed_nv12_image.get();
 
-    cl_mem compressed_y_plane = clCreateImage(
+    cl_mem_handle compressed_y_plane(clCreateImage(
             context,
             CL_MEM_READ_WRITE,
             &compressed_y_plane_format,
             &compressed_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for compressed image y plane." << "\n";
@@ -300,16 +301,16 @@ int main(int argc, char** argv)
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
     compressed_uv_plane_desc.image_width  = compressed_nv12_desc.image_width;
     compressed_uv_plane_desc.image_height = compressed_nv12_desc.image_height;
-    compressed_uv_plane_desc.mem_object   = compressed_nv12_image;
+    compressed_uv_plane_desc.mem_object   = compressed_nv12_image.get();
 
-    cl_mem compressed_uv_plane = clCreateImage(
+    cl_mem_handle compressed_uv_plane(clCreateImage(
             context,
             CL_MEM_READ_WRITE,
             &compressed_uv_plane_format,
             &compressed_uv_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for compressed image uv plane." << "\n";
@@ -325,16 +326,16 @@ int main(int argc, char** argv)
     out_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     out_y_plane_desc.image_width  = out_nv12_desc.image_width;
     out_y_plane_desc.image_height = out_nv12_desc.image_height;
-    out_y_plane_desc.mem_object   = out_nv12_image;
+    out_y_plane_desc.mem_object   = out_nv12_image.get();
 
-    cl_mem out_y_plane = clCreateImage(
+    cl_mem_handle out_y_plane(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY,
             &out_y_plane_format,
             &out_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for destination image y plane." << "\n";
@@ -352,16 +353,16 @@ int main(int argc, char** argv)
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
     out_uv_plane_desc.image_width  = out_nv12_desc.image_width;
     out_uv_plane_desc.image_height = out_nv12_desc.image_height;
-    out_uv_plane_desc.mem_object   = out_nv12_image;
+    out_uv_plane_desc.mem_object   = out_nv12_image.get();
 
-    cl_mem out_uv_plane = clCreateImage(
+    cl_mem_handle out_uv_plane(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY,
             &out_uv_plane_format,
             &out_uv_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for destination image uv plane." << "\n";
@@ -380,7 +381,7 @@ int main(int argc, char** argv)
     size_t           row_pitch      = 0;
     unsigned char   *image_ptr      = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            src_y_plane,
+            src_y_plane.get(),
             CL_TRUE,
             CL_MAP_WRITE,
             origin,
@@ -408,7 +409,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, src_y_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, src_y_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping source image y-plane data buffer." << "\n";
@@ -420,7 +421,7 @@ int main(int argc, char** argv)
     row_pitch                    = 0;
     image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            src_uv_plane,
+            src_uv_plane.get(),
             CL_TRUE,
             CL_MAP_WRITE,
             origin,
@@ -448,7 +449,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, src_uv_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, src_uv_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping source image uv-plane data buffer." << "\n";
@@ -459,13 +460,13 @@ int main(int argc, char** argv)
      * Step 4: Set up other kernel arguments
      */
 
-    cl_sampler sampler = clCreateSampler(
+    cl_sampler_handle sampler(clCreateSampler(
             context,
             CL_FALSE,
             CL_ADDRESS_CLAMP_TO_EDGE,
             CL_FILTER_NEAREST,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateSampler." << "\n";
@@ -479,10 +480,10 @@ int main(int argc, char** argv)
     // Impromptu data structure to cut down on code duplication to enqueue kernels.
     std::array<std::tuple<cl_mem, cl_mem, size_t, size_t>, 4> kernel_args{
         /*              source plane,        destination plane,   image width,                      image height*/
-        std::make_tuple(src_y_plane,         compressed_y_plane,  out_y_plane_desc.image_width,     out_y_plane_desc.image_height),
-        std::make_tuple(src_uv_plane,        compressed_uv_plane, out_y_plane_desc.image_width / 2, out_y_plane_desc.image_height / 2),
-        std::make_tuple(compressed_y_plane,  out_y_plane,         out_y_plane_desc.image_width,     out_y_plane_desc.image_height),
-        std::make_tuple(compressed_uv_plane, out_uv_plane,        out_y_plane_desc.image_width / 2, out_y_plane_desc.image_height / 2)
+        std::make_tuple(src_y_plane.get(),         compressed_y_plane.get(),  out_y_plane_desc.image_width,     out_y_plane_desc.image_height),
+        std::make_tuple(src_uv_plane.get(),        compressed_uv_plane.get(), out_y_plane_desc.image_width / 2, out_y_plane_desc.image_height / 2),
+        std::make_tuple(compressed_y_plane.get(),  out_y_plane.get(),         out_y_plane_desc.image_width,     out_y_plane_desc.image_height),
+        std::make_tuple(compressed_uv_plane.get(), out_uv_plane.get(),        out_y_plane_desc.image_width / 2, out_y_plane_desc.image_height / 2)
     };
 
     for (size_t i = 0; i < kernel_args.size(); ++i)
@@ -506,8 +507,7 @@ int main(int argc, char** argv)
             std::exit(err);
         }
 
-
-        err = clSetKernelArg(blit_kernel, 2, sizeof(sampler), &sampler);
+        err = clSetKernelArg(blit_kernel, 2, sizeof(cl_sampler), sampler.address());
         if (err != CL_SUCCESS)
         {
             std::cerr << "On iteration " << i << ":\n";
@@ -516,23 +516,7 @@ int main(int argc, char** argv)
         }
 
         const size_t work_size[] = {WIDTH(kernel_args[i]), HEIGHT(kernel_args[i])};
-        err = clEnqueueNDRangeKernel(
-                command_queue,
-                blit_kernel,
-                2,
-                NULL,
-                work_size,
-                NULL,
-                0,
-                NULL,
-                NULL
-        );
-        if (err != CL_SUCCESS)
-        {
-            std::cerr << "On iteration " << i << ":\n";
-            std::cerr << "\tError " << err << " with clEnqueueNDRangeKernel for blit kernel." << "\n";
-            std::exit(err);
-        }
+        wrapper.enqueue_kernel(blit_kernel, 2, work_size, NULL);
     }
 
     clFinish(command_queue); // Note the blocking read below will flush/finish the queue, but this is included for clarity.
@@ -551,7 +535,7 @@ int main(int argc, char** argv)
     row_pitch                   = 0;
     image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            out_y_plane,
+            out_y_plane.get(),
             CL_TRUE,
             CL_MAP_READ,
             origin,
@@ -579,7 +563,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, out_y_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, out_y_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping dest image y-plane buffer." << "\n";
@@ -590,7 +574,7 @@ int main(int argc, char** argv)
     row_pitch                    = 0;
     image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            out_uv_plane,
+            out_uv_plane.get(),
             CL_TRUE,
             CL_MAP_READ,
             origin,
@@ -618,7 +602,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, out_uv_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, out_uv_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping dest image uv-plane buffer." << "\n";
@@ -629,17 +613,5 @@ int main(int argc, char** argv)
 
     save_nv12_image_data(out_image_filename, out_nv12_image_info);
 
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseSampler(sampler);
-    clReleaseMemObject(src_uv_plane);
-    clReleaseMemObject(src_y_plane);
-    clReleaseMemObject(src_nv12_image);
-    clReleaseMemObject(compressed_uv_plane);
-    clReleaseMemObject(compressed_y_plane);
-    clReleaseMemObject(compressed_nv12_image);
-    clReleaseMemObject(out_uv_plane);
-    clReleaseMemObject(out_y_plane);
-    clReleaseMemObject(out_nv12_image);
-
     return 0;
 }
@@ -17,6 +17,7 @@
 #include <tuple>
 
 // Project includes
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 #include "util/util.h"
 
@@ -69,7 +70,7 @@ int main(int argc, char** argv)
 
     cl_wrapper   wrapper;
     cl_program   program             = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
-    cl_kernel    blit_kernel         = wrapper.make_kernel("blit", program);
+    cl_kernel    blit_kernel         = wrapper.get_kernel("blit", program);
     cl_context   context             = wrapper.get_context();
     rgba_image_t src_rgba_image_info = load_rgba_image_data(src_image_filename);
     cl_int       err                 = 0;
@@ -121,15 +122,15 @@ int main(int argc, char** argv)
     src_rgba_desc.image_height    = src_rgba_image_info.height;
     src_rgba_desc.image_row_pitch = wrapper.get_ion_image_row_pitch(src_rgba_format, src_rgba_desc);
 
-    cl_mem_ion_host_ptr src_rgba_ion_mem = wrapper.make_ion_buffer_for_nonplanar_image(src_rgba_format, src_rgba_desc);
-    cl_mem src_rgba_image = clCreateImage(
+    ion_allocation src_rgba_ion_mem = wrapper.make_ion_buffer_for_nonplanar_image(src_rgba_format, src_rgba_desc);
+    cl_mem_handle src_rgba_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &src_rgba_format,
             &src_rgba_desc,
-            &src_rgba_ion_mem,
+            src_rgba_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image." << "\n";
@@ -146,16 +147,16 @@ int main(int argc, char** argv)
     compressed_rgba_desc.image_width  = src_rgba_image_info.width;
     compressed_rgba_desc.image_height = src_rgba_image_info.height;
 
-    cl_mem_ion_host_ptr compressed_rgba_ion_mem = wrapper.make_ion_buffer_for_compressed_image(compressed_rgba_format,
-                                                                                               compressed_rgba_desc);
-    cl_mem compressed_rgba_image = clCreateImage(
+    ion_allocation compressed_rgba_ion_mem = wrapper.make_ion_buffer_for_compressed_image(compressed_rgba_format,
+                                                                                          compressed_rgba_desc);
+    cl_mem_handle compressed_rgba_image(clCreateImage(
             context,
             CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &compressed_rgba_format,
             &compressed_rgba_desc,
-            &compressed_rgba_ion_mem,
+            compressed_rgba_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for compressed image." << "\n";
@@ -173,15 +174,15 @@ int main(int argc, char** argv)
     out_rgba_desc.image_height    = src_rgba_image_info.height;
     out_rgba_desc.image_row_pitch = wrapper.get_ion_image_row_pitch(out_rgba_format, out_rgba_desc);
 
-    cl_mem_ion_host_ptr out_rgba_ion_mem = wrapper.make_ion_buffer_for_nonplanar_image(out_rgba_format, out_rgba_desc);
-    cl_mem out_rgba_image = clCreateImage(
+    ion_allocation out_rgba_ion_mem = wrapper.make_ion_buffer_for_nonplanar_image(out_rgba_format, out_rgba_desc);
+    cl_mem_handle out_rgba_image(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &out_rgba_format,
             &out_rgba_desc,
-            &out_rgba_ion_mem,
+            out_rgba_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for output image." << "\n";
@@ -198,7 +199,7 @@ int main(int argc, char** argv)
     size_t           row_pitch     = 0;
     unsigned char   *image_ptr     = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            src_rgba_image,
+            src_rgba_image.get(),
             CL_TRUE,
             CL_MAP_WRITE,
             origin,
@@ -226,7 +227,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, src_rgba_image, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, src_rgba_image.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping source image." << "\n";
@@ -237,13 +238,13 @@ int main(int argc, char** argv)
      * Step 3: Set up other kernel arguments
      */
 
-    cl_sampler sampler = clCreateSampler(
+    cl_sampler_handle sampler(clCreateSampler(
             context,
             CL_FALSE,
             CL_ADDRESS_CLAMP_TO_EDGE,
             CL_FILTER_NEAREST,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateSampler." << "\n";
@@ -257,8 +258,8 @@ int main(int argc, char** argv)
     // Impromptu data structure to cut down on code duplication to enqueue kernels.
     std::array<std::tuple<cl_mem, cl_mem, size_t, size_t>, 2> kernel_args{
         /*              source plane,          destination plane,     image width,               image height*/
-        std::make_tuple(src_rgba_image,        compressed_rgba_image, src_rgba_desc.image_width, src_rgba_desc.image_height),
-        std::make_tuple(compressed_rgba_image, out_rgba_image,        src_rgba_desc.image_width, src_rgba_desc.image_height),
+        std::make_tuple(src_rgba_image.get(),        compressed_rgba_image.get(), src_rgba_desc.image_width, src_rgba_desc.image_height),
+        std::make_tuple(compressed_rgba_image.get(), out_rgba_image.get(),        src_rgba_desc.image_width, src_rgba_desc.image_height),
     };
 
     for (size_t i = 0; i < kernel_args.size(); ++i)
@@ -282,8 +283,7 @@ int main(int argc, char** argv)
             std::exit(err);
         }
 
-
-        err = clSetKernelArg(blit_kernel, 2, sizeof(sampler), &sampler);
+        err = clSetKernelArg(blit_kernel, 2, sizeof(cl_sampler), sampler.address());
         if (err != CL_SUCCESS)
         {
             std::cerr << "On iteration " << i << ":\n";
@@ -292,23 +292,7 @@ int main(int argc, char** argv)
         }
 
         const size_t work_size[] = {WIDTH(kernel_args[i]), HEIGHT(kernel_args[i])};
-        err = clEnqueueNDRangeKernel(
-                command_queue,
-                blit_kernel,
-                2,
-                NULL,
-                work_size,
-                NULL,
-                0,
-                NULL,
-                NULL
-        );
-        if (err != CL_SUCCESS)
-        {
-            std::cerr << "On iteration " << i << ":\n";
-            std::cerr << "\tError " << err << " with clEnqueueNDRangeKernel for blit kernel." << "\n";
-            std::exit(err);
-        }
+        wrapper.enqueue_kernel(blit_kernel, 2, work_size, NULL);
     }
 
     /*
@@ -324,7 +308,7 @@ int main(int argc, char** argv)
     row_pitch                 = 0;
     image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            out_rgba_image,
+            out_rgba_image.get(),
             CL_TRUE,
             CL_MAP_READ,
             origin,
@@ -352,7 +336,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, out_rgba_image, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, out_rgba_image.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping dest image." << "\n";
@@ -363,11 +347,5 @@ int main(int argc, char** argv)
 
     save_rgba_image_data(out_image_filename, out_rgba_image_info);
 
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseSampler(sampler);
-    clReleaseMemObject(src_rgba_image);
-    clReleaseMemObject(compressed_rgba_image);
-    clReleaseMemObject(out_rgba_image);
-
     return 0;
 }
@@ -15,6 +15,7 @@
 #include <iostream>
 
 // Project includes
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 
 // Library includes
@@ -51,7 +52,7 @@ int main(int argc, char** argv)
 
     cl_wrapper       wrapper;
     cl_program       program         = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
-    cl_kernel        kernel          = wrapper.make_kernel("copy", program);
+    cl_kernel        kernel          = wrapper.get_kernel("copy", program);
     cl_context       context         = wrapper.get_context();
     cl_command_queue command_queue   = wrapper.get_command_queue();
     cl_int           err             = CL_SUCCESS;
@@ -77,26 +78,26 @@ int main(int argc, char** argv)
     fin.seekg(0, std::ios::beg);
     fin.read(buf.data(), buf_size);
 
-    cl_mem src_buffer = clCreateBuffer(
+    cl_mem_handle src_buffer(clCreateBuffer(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
             buf_size,
             buf.data(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer for source file." << "\n";
         std::exit(err);
     }
 
-    cl_mem out_buffer = clCreateBuffer(
+    cl_mem_handle out_buffer(clCreateBuffer(
             context,
             CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR,
             buf_size,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer for output file." << "\n";
@@ -107,36 +108,21 @@ int main(int argc, char** argv)
      * Step 1: Set up kernel arguments and run the kernel.
      */
 
-    err = clSetKernelArg(kernel, 0, sizeof(src_buffer), &src_buffer);
+    err = clSetKernelArg(kernel, 0, sizeof(cl_mem), src_buffer.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel, 1, sizeof(out_buffer), &out_buffer);
+    err = clSetKernelArg(kernel, 1, sizeof(cl_mem), out_buffer.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1." << "\n";
         std::exit(err);
     }
 
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            kernel,
-            1,
-            NULL,
-            &buf_size,
-            NULL,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " with clEnqueueNDRangeKernel." << "\n";
-        std::exit(err);
-    }
+    wrapper.enqueue_kernel(kernel, 1, &buf_size, NULL);
 
     /*
      * Step 2: Copy the data out of the ion buffer for each plane.
@@ -144,7 +130,7 @@ int main(int argc, char** argv)
 
     char *mapped_ptr = static_cast<char *>(clEnqueueMapBuffer(
             command_queue,
-            out_buffer,
+            out_buffer.get(),
             CL_TRUE,
             CL_MAP_READ,
             0,
@@ -169,7 +155,7 @@ int main(int argc, char** argv)
     fout.write(mapped_ptr, buf_size);
     fout.close();
 
-    err = clEnqueueUnmapMemObject(command_queue, out_buffer, mapped_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, out_buffer.get(), mapped_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping output buffer." << "\n";
@@ -178,9 +164,5 @@ int main(int argc, char** argv)
 
     clFinish(command_queue);
 
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseMemObject(src_buffer);
-    clReleaseMemObject(out_buffer);
-
     return 0;
 }
@@ -17,6 +17,7 @@
 #include <string>
 
 // Project includes
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 #include "util/util.h"
 
@@ -137,16 +138,16 @@ int main(int argc, char** argv)
     src_nv12_desc.image_width  = src_nv12_image_info.y_width;
     src_nv12_desc.image_height = src_nv12_image_info.y_height;
 
-    cl_mem_ion_host_ptr src_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_nv12_format, src_nv12_desc);
+    ion_allocation src_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_nv12_format, src_nv12_desc);
     cl_int err;
-    cl_mem src_nv12_image = clCreateImage(
+    cl_mem_handle src_nv12_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &src_nv12_format,
             &src_nv12_desc,
-            &src_nv12_ion_mem,
+            src_nv12_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image." << "\n";
@@ -163,15 +164,15 @@ int main(int argc, char** argv)
     out_nv12_desc.image_width  = src_nv12_image_info.y_width;
     out_nv12_desc.image_height = src_nv12_image_info.y_height;
 
-    cl_mem_ion_host_ptr out_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(out_nv12_format, out_nv12_desc);
-    cl_mem out_nv12_image = clCreateImage(
+    ion_allocation out_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(out_nv12_format, out_nv12_desc);
+    cl_mem_handle out_nv12_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &out_nv12_format,
             &out_nv12_desc,
-            &out_nv12_ion_mem,
+            out_nv12_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for downscaled image." << "\n";
@@ -191,16 +192,16 @@ int main(int argc, char** argv)
     src_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     src_y_plane_desc.image_width  = src_nv12_image_info.y_width;
     src_y_plane_desc.image_height = src_nv12_image_info.y_height;
-    src_y_plane_desc.mem_object   = src_nv12_image;
+    src_y_plane_desc.mem_object   = src_nv12_image.get();
 
-    cl_mem src_y_plane = clCreateImage(
+    cl_mem_handle src_y_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_y_plane_format,
             &src_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image y plane." << "\n";
@@ -218,16 +219,16 @@ int main(int argc, char** argv)
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
     src_uv_plane_desc.image_width  = src_nv12_image_info.y_width;
     src_uv_plane_desc.image_height = src_nv12_image_info.y_height;
-    src_uv_plane_desc.mem_object   = src_nv12_image;
+    src_uv_plane_desc.mem_object   = src_nv12_image.get();
 
-    cl_mem src_uv_plane = clCreateImage(
+    cl_mem_handle src_uv_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_uv_plane_format,
             &src_uv_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image uv plane." << "\n";
@@ -243,16 +244,16 @@ int main(int argc, char** argv)
     out_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     out_y_plane_desc.image_width  = out_nv12_desc.image_width;
     out_y_plane_desc.image_height = out_nv12_desc.image_height;
-    out_y_plane_desc.mem_object   = out_nv12_image;
+    out_y_plane_desc.mem_object   = out_nv12_image.get();
 
-    cl_mem out_y_plane = clCreateImage(
+    cl_mem_handle out_y_plane(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY,
             &out_y_plane_format,
             &out_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for destination image y plane." << "\n";
@@ -270,16 +271,16 @@ int main(int argc, char** argv)
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
     out_uv_plane_desc.image_width  = out_nv12_desc.image_width;
     out_uv_plane_desc.image_height = out_nv12_desc.image_height;
-    out_uv_plane_desc.mem_object   = out_nv12_image;
+    out_uv_plane_desc.mem_object   = out_nv12_image.get();
 
-    cl_mem out_uv_plane = clCreateImage(
+    cl_mem_handle out_uv_plane(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY,
             &out_uv_plane_format,
             &out_uv_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for destination image uv plane." << "\n";
@@ -298,7 +299,7 @@ int main(int argc, char** argv)
     size_t           row_pitch      = 0;
     unsigned char   *image_ptr      = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            src_y_plane,
+            src_y_plane.get(),
             CL_TRUE,
             CL_MAP_WRITE,
             origin,
@@ -326,7 +327,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, src_y_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, src_y_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping source image y-plane data buffer." << "\n";
@@ -338,7 +339,7 @@ int main(int argc, char** argv)
     row_pitch                    = 0;
     image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            src_uv_plane,
+            src_uv_plane.get(),
             CL_TRUE,
             CL_MAP_WRITE,
             origin,
@@ -366,7 +367,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, src_uv_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, src_uv_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping source image uv-plane data buffer." << "\n";
@@ -377,13 +378,13 @@ int main(int argc, char** argv)
      * Step 4: Set up other kernel arguments
      */
 
-    cl_sampler sampler = clCreateSampler(
+    cl_sampler_handle sampler(clCreateSampler(
             context,
             CL_FALSE,
             CL_ADDRESS_CLAMP_TO_EDGE,
             CL_FILTER_NEAREST,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateSampler." << "\n";
@@ -397,21 +398,21 @@ int main(int argc, char** argv)
      * Step 5: Run the kernel separately for y- and uv-planes
      */
 
-    err = clSetKernelArg(y_plane_kernel, 0, sizeof(src_y_plane), &src_y_plane);
+    err = clSetKernelArg(y_plane_kernel, 0, sizeof(cl_mem), src_y_plane.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0 for y-plane kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(y_plane_kernel, 1, sizeof(out_y_plane), &out_y_plane);
+    err = clSetKernelArg(y_plane_kernel, 1, sizeof(cl_mem), out_y_plane.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1 for y-plane kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(y_plane_kernel, 2, sizeof(sampler), &sampler);
+    err = clSetKernelArg(y_plane_kernel, 2, sizeof(cl_sampler), sampler.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 2 for y-plane kernel." << "\n";
@@ -425,21 +426,21 @@ int main(int argc, char** argv)
         std::exit(err);
     }
 
-    err = clSetKernelArg(uv_plane_kernel, 0, sizeof(src_uv_plane), &src_uv_plane);
+    err = clSetKernelArg(uv_plane_kernel, 0, sizeof(cl_mem), src_uv_plane.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0 for uv-plane kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(uv_plane_kernel, 1, sizeof(out_uv_plane), &out_uv_plane);
+    err = clSetKernelArg(uv_plane_kernel, 1, sizeof(cl_mem), out_uv_plane.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1 for uv-plane kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(uv_plane_kernel, 2, sizeof(sampler), &sampler);
+    err = clSetKernelArg(uv_plane_kernel, 2, sizeof(cl_sampler), sampler.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 2 for uv-plane kernel." << "\n";
@@ -454,40 +455,10 @@ int main(int argc, char** argv)
     }
 
     const size_t y_plane_work_size[] = {out_y_plane_desc.image_width, out_y_plane_desc.image_height};
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            y_plane_kernel,
-            2,
-            NULL,
-            y_plane_work_size,
-            NULL,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " with clEnqueueNDRangeKernel for y-plane kernel." << "\n";
-        std::exit(err);
-    }
+    wrapper.enqueue_kernel(y_plane_kernel, 2, y_plane_work_size, NULL);
 
     const size_t uv_plane_work_size[] = {out_uv_plane_desc.image_width / 2, out_uv_plane_desc.image_height / 2};
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            uv_plane_kernel,
-            2,
-            NULL,
-            uv_plane_work_size,
-            NULL,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " with clEnqueueNDRangeKernel for uv-plane kernel." << "\n";
-        std::exit(err);
-    }
+    wrapper.enqueue_kernel(uv_plane_kernel, 2, uv_plane_work_size, NULL);
 
     clFinish(command_queue);
 
@@ -505,7 +476,7 @@ int main(int argc, char** argv)
     row_pitch                   = 0;
     image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            out_y_plane,
+            out_y_plane.get(),
             CL_TRUE,
             CL_MAP_READ,
             origin,
@@ -533,7 +504,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, out_y_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, out_y_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping dest image y-plane buffer." << "\n";
@@ -544,7 +515,7 @@ int main(int argc, char** argv)
     row_pitch                    = 0;
     image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            out_uv_plane,
+            out_uv_plane.get(),
             CL_TRUE,
             CL_MAP_READ,
             origin,
@@ -572,7 +543,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, out_uv_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, out_uv_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping dest image uv-plane buffer." << "\n";
@@ -583,14 +554,5 @@ int main(int argc, char** argv)
 
     save_nv12_image_data(out_image_filename, out_nv12_image_info);
 
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseSampler(sampler);
-    clReleaseMemObject(src_uv_plane);
-    clReleaseMemObject(src_y_plane);
-    clReleaseMemObject(src_nv12_image);
-    clReleaseMemObject(out_uv_plane);
-    clReleaseMemObject(out_y_plane);
-    clReleaseMemObject(out_nv12_image);
-
     return 0;
 }
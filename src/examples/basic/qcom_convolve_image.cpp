@@ -15,6 +15,7 @@
 #include <iostream>
 
 // Project includes
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 #include "util/half_float.h"
 #include "util/util.h"
@@ -48,10 +49,10 @@ static const cl_uint PROGRAM_SOURCE_LEN = sizeof(PROGRAM_SOURCE) / sizeof(const
 static const cl_uint  CONV_KERNEL_WIDTH  = 5;
 static const cl_uint  CONV_KERNEL_HEIGHT = 5;
 
-static const cl_half zero = to_half(0.f);
-static const cl_half neg1 = to_half(-1.f);
-static const cl_half neg2 = to_half(-2.f);
-static const cl_half sxtn = to_half(16.f);
+static constexpr cl_half zero = to_half_constexpr(0.f);
+static constexpr cl_half neg1 = to_half_constexpr(-1.f);
+static constexpr cl_half neg2 = to_half_constexpr(-2.f);
+static constexpr cl_half sxtn = to_half_constexpr(16.f);
 
 static cl_half CONVOLUTION_KERNEL[CONV_KERNEL_HEIGHT * CONV_KERNEL_WIDTH] = {
     zero,   zero,  neg1,   zero,   zero,
@@ -122,16 +123,16 @@ int main(int argc, char** argv)
     src_nv12_desc.image_width  = src_nv12_image_info.y_width;
     src_nv12_desc.image_height = src_nv12_image_info.y_height;
 
-    cl_mem_ion_host_ptr src_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_nv12_format, src_nv12_desc);
+    ion_allocation src_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_nv12_format, src_nv12_desc);
     cl_int err;
-    cl_mem src_nv12_image = clCreateImage(
+    cl_mem_handle src_nv12_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &src_nv12_format,
             &src_nv12_desc,
-            &src_nv12_ion_mem,
+            src_nv12_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image." << "\n";
@@ -148,15 +149,15 @@ int main(int argc, char** argv)
     out_nv12_desc.image_width  = src_nv12_image_info.y_width;
     out_nv12_desc.image_height = src_nv12_image_info.y_height;
 
-    cl_mem_ion_host_ptr out_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(out_nv12_format, out_nv12_desc);
-    cl_mem out_nv12_image = clCreateImage(
+    ion_allocation out_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(out_nv12_format, out_nv12_desc);
+    cl_mem_handle out_nv12_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &out_nv12_format,
             &out_nv12_desc,
-            &out_nv12_ion_mem,
+            out_nv12_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for downscaled image." << "\n";
@@ -176,16 +177,16 @@ int main(int argc, char** argv)
     src_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     src_y_plane_desc.image_width  = src_nv12_image_info.y_width;
     src_y_plane_desc.image_height = src_nv12_image_info.y_height;
-    src_y_plane_desc.mem_object   = src_nv12_image;
+    src_y_plane_desc.mem_object   = src_nv12_image.get();
 
-    cl_mem src_y_plane = clCreateImage(
+    cl_mem_handle src_y_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_y_plane_format,
             &src_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image y plane." << "\n";
@@ -203,16 +204,16 @@ int main(int argc, char** argv)
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
     src_uv_plane_desc.image_width  = src_nv12_image_info.y_width;
     src_uv_plane_desc.image_height = src_nv12_image_info.y_height;
-    src_uv_plane_desc.mem_object   = src_nv12_image;
+    src_uv_plane_desc.mem_object   = src_nv12_image.get();
 
-    cl_mem src_uv_plane = clCreateImage(
+    cl_mem_handle src_uv_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_uv_plane_format,
             &src_uv_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image uv plane." << "\n";
@@ -228,16 +229,16 @@ int main(int argc, char** argv)
     out_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     out_y_plane_desc.image_width  = out_nv12_desc.image_width;
     out_y_plane_desc.image_height = out_nv12_desc.image_height;
-    out_y_plane_desc.mem_object   = out_nv12_image;
+    out_y_plane_desc.mem_object   = out_nv12_image.get();
 
-    cl_mem out_y_plane = clCreateImage(
+    cl_mem_handle out_y_plane(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY,
             &out_y_plane_format,
             &out_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for destination image y plane." << "\n";
@@ -255,16 +256,16 @@ int main(int argc, char** argv)
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
     out_uv_plane_desc.image_width  = out_nv12_desc.image_width;
     out_uv_plane_desc.image_height = out_nv12_desc.image_height;
-    out_uv_plane_desc.mem_object   = out_nv12_image;
+    out_uv_plane_desc.mem_object   = out_nv12_image.get();
 
-    cl_mem out_uv_plane = clCreateImage(
+    cl_mem_handle out_uv_plane(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY,
             &out_uv_plane_format,
             &out_uv_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for destination image uv plane." << "\n";
@@ -283,7 +284,7 @@ int main(int argc, char** argv)
     size_t           row_pitch      = 0;
     unsigned char   *image_ptr      = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            src_y_plane,
+            src_y_plane.get(),
             CL_TRUE,
             CL_MAP_WRITE,
             origin,
@@ -311,7 +312,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, src_y_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, src_y_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping source image y-plane data buffer." << "\n";
@@ -323,7 +324,7 @@ int main(int argc, char** argv)
     row_pitch                    = 0;
     image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            src_uv_plane,
+            src_uv_plane.get(),
             CL_TRUE,
             CL_MAP_WRITE,
             origin,
@@ -351,7 +352,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, src_uv_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, src_uv_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping source image uv-plane data buffer." << "\n";
@@ -362,13 +363,13 @@ int main(int argc, char** argv)
      * Step 4: Set up other kernel arguments
      */
 
-    cl_sampler sampler = clCreateSampler(
+    cl_sampler_handle sampler(clCreateSampler(
             context,
             CL_FALSE,
             CL_ADDRESS_CLAMP_TO_EDGE,
             CL_FILTER_NEAREST,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateSampler." << "\n";
@@ -392,14 +393,14 @@ int main(int argc, char** argv)
     weight_image_desc.weight_desc.center_coord_y = 2;
     weight_image_desc.weight_desc.flags          = 0;
 
-    cl_mem weight_image = clCreateImage(
+    cl_mem_handle weight_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
             &weight_image_format,
             reinterpret_cast<cl_image_desc *>(&weight_image_desc),
             static_cast<void *>(CONVOLUTION_KERNEL),
             &err
-    );
+    ));
     if (err != CL_SUCCESS) {
         std::cerr << "Error " << err << " with clCreateImage for weight image." << "\n";
         std::exit(err);
@@ -409,56 +410,56 @@ int main(int argc, char** argv)
      * Step 5: Run the kernel separately for y- and uv-planes
      */
 
-    err = clSetKernelArg(y_plane_kernel, 0, sizeof(src_y_plane), &src_y_plane);
+    err = clSetKernelArg(y_plane_kernel, 0, sizeof(cl_mem), src_y_plane.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0 for y-plane kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(y_plane_kernel, 1, sizeof(out_y_plane), &out_y_plane);
+    err = clSetKernelArg(y_plane_kernel, 1, sizeof(cl_mem), out_y_plane.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1 for y-plane kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(y_plane_kernel, 2, sizeof(sampler), &sampler);
+    err = clSetKernelArg(y_plane_kernel, 2, sizeof(cl_sampler), sampler.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 2 for y-plane kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(y_plane_kernel, 3, sizeof(weight_image), &weight_image);
+    err = clSetKernelArg(y_plane_kernel, 3, sizeof(cl_mem), weight_image.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 3 for y-plane kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(uv_plane_kernel, 0, sizeof(src_uv_plane), &src_uv_plane);
+    err = clSetKernelArg(uv_plane_kernel, 0, sizeof(cl_mem), src_uv_plane.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0 for uv-plane kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(uv_plane_kernel, 1, sizeof(out_uv_plane), &out_uv_plane);
+    err = clSetKernelArg(uv_plane_kernel, 1, sizeof(cl_mem), out_uv_plane.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1 for uv-plane kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(uv_plane_kernel, 2, sizeof(sampler), &sampler);
+    err = clSetKernelArg(uv_plane_kernel, 2, sizeof(cl_sampler), sampler.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 2 for uv-plane kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(uv_plane_kernel, 3, sizeof(weight_image), &weight_image);
+    err = clSetKernelArg(uv_plane_kernel, 3, sizeof(cl_mem), weight_image.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 3 for uv-plane kernel." << "\n";
@@ -466,40 +467,10 @@ int main(int argc, char** argv)
     }
 
     const size_t y_plane_work_size[] = {out_y_plane_desc.image_width, out_y_plane_desc.image_height};
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            y_plane_kernel,
-            2,
-            NULL,
-            y_plane_work_size,
-            NULL,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " with clEnqueueNDRangeKernel for y-plane kernel." << "\n";
-        std::exit(err);
-    }
+    wrapper.enqueue_kernel(y_plane_kernel, 2, y_plane_work_size, NULL);
 
     const size_t uv_plane_work_size[] = {out_uv_plane_desc.image_width / 2, out_uv_plane_desc.image_height / 2};
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            uv_plane_kernel,
-            2,
-            NULL,
-            uv_plane_work_size,
-            NULL,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " with clEnqueueNDRangeKernel for uv-plane kernel." << "\n";
-        std::exit(err);
-    }
+    wrapper.enqueue_kernel(uv_plane_kernel, 2, uv_plane_work_size, NULL);
 
     clFinish(command_queue);
 
@@ -517,7 +488,7 @@ int main(int argc, char** argv)
     row_pitch                   = 0;
     image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            out_y_plane,
+            out_y_plane.get(),
             CL_TRUE,
             CL_MAP_READ,
             origin,
@@ -545,7 +516,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, out_y_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, out_y_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping dest image y-plane buffer." << "\n";
@@ -556,7 +527,7 @@ int main(int argc, char** argv)
     row_pitch                    = 0;
     image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            out_uv_plane,
+            out_uv_plane.get(),
             CL_TRUE,
             CL_MAP_READ,
             origin,
@@ -584,7 +555,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, out_uv_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, out_uv_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping dest image uv-plane buffer." << "\n";
@@ -595,15 +566,5 @@ int main(int argc, char** argv)
 
     save_nv12_image_data(out_image_filename, out_nv12_image_info);
 
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseMemObject(weight_image);
-    clReleaseSampler(sampler);
-    clReleaseMemObject(src_uv_plane);
-    clReleaseMemObject(src_y_plane);
-    clReleaseMemObject(src_nv12_image);
-    clReleaseMemObject(out_uv_plane);
-    clReleaseMemObject(out_y_plane);
-    clReleaseMemObject(out_nv12_image);
-
     return 0;
 }
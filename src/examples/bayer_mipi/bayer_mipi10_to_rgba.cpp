@@ -15,6 +15,7 @@
 #include <iostream>
 
 // Project includes
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 #include "util/util.h"
 
@@ -73,10 +74,11 @@ int main(int argc, char** argv)
 
     cl_wrapper wrapper;
     cl_program           program              = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
-    cl_kernel            kernel               = wrapper.make_kernel("bayer_to_rgba", program);
+    cl_kernel            kernel               = wrapper.get_kernel("bayer_to_rgba", program);
     cl_context           context              = wrapper.get_context();
     cl_command_queue     command_queue        = wrapper.get_command_queue();
-    bayer_mipi10_image_t src_bayer_image_info = load_bayer_mipi_10_image_data(src_image_filename);
+    // The source is mapped rather than loaded, so it is copied only once: from the page cache into ION memory.
+    mapped_image_view    src_bayer_image_view(src_image_filename, CL_QCOM_UNORM_MIPI10, CL_QCOM_BAYER);
 
     /*
      * Step 0: Confirm the required OpenCL extensions are supported.
@@ -111,20 +113,20 @@ int main(int argc, char** argv)
     cl_image_desc src_desc;
     std::memset(&src_desc, 0, sizeof(src_desc));
     src_desc.image_type      = CL_MEM_OBJECT_IMAGE2D;
-    src_desc.image_width     = src_bayer_image_info.width;
-    src_desc.image_height    = src_bayer_image_info.height;
+    src_desc.image_width     = src_bayer_image_view.width();
+    src_desc.image_height    = src_bayer_image_view.height();
     src_desc.image_row_pitch = wrapper.get_ion_image_row_pitch(src_format, src_desc);
 
-    cl_mem_ion_host_ptr src_ion_mem = wrapper.make_ion_buffer_for_nonplanar_image(src_format, src_desc);
-    cl_int              err         = 0;
-    cl_mem              src_image   = clCreateImage(
+    ion_allocation src_ion_mem = wrapper.make_ion_buffer_for_nonplanar_image(src_format, src_desc);
+    cl_int         err         = 0;
+    cl_mem_handle src_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &src_format,
             &src_desc,
-            &src_ion_mem,
+            src_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image." << "\n";
@@ -136,7 +138,7 @@ int main(int argc, char** argv)
     const size_t   src_region[] = {src_desc.image_width, src_desc.image_height, 1};
     unsigned char *image_ptr    = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            src_image,
+            src_image.get(),
             CL_BLOCKING,
             CL_MAP_WRITE,
             origin,
@@ -154,17 +156,18 @@ int main(int argc, char** argv)
         std::exit(err);
     }
 
-    // Copies image data from the host to the ION buffer
+    // Copies image data from the mapped file to the ION buffer
+    const size_t src_row_bytes = src_bayer_image_view.layout().row_bytes[0];
     for (uint32_t i = 0; i < src_desc.image_height; ++i)
     {
         std::memcpy(
                 image_ptr                          + i * src_desc.image_row_pitch,
-                src_bayer_image_info.pixels.data() + i * src_desc.image_width / 4 * 5,
-                src_desc.image_width / 4 * 5
+                src_bayer_image_view.plane_data(0) + i * src_row_bytes,
+                src_row_bytes
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, src_image, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, src_image.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping source image." << "\n";
@@ -178,19 +181,19 @@ int main(int argc, char** argv)
     cl_image_desc out_desc;
     std::memset(&out_desc, 0, sizeof(out_desc));
     out_desc.image_type      = CL_MEM_OBJECT_IMAGE2D;
-    out_desc.image_width     = src_bayer_image_info.width;
-    out_desc.image_height    = src_bayer_image_info.height;
+    out_desc.image_width     = src_bayer_image_view.width();
+    out_desc.image_height    = src_bayer_image_view.height();
     out_desc.image_row_pitch = wrapper.get_ion_image_row_pitch(out_format, out_desc);
 
-    cl_mem_ion_host_ptr out_ion_mem = wrapper.make_ion_buffer_for_nonplanar_image(out_format, out_desc);
-    cl_mem out_image = clCreateImage(
+    ion_allocation out_ion_mem = wrapper.make_ion_buffer_for_nonplanar_image(out_format, out_desc);
+    cl_mem_handle out_image(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &out_format,
             &out_desc,
-            &out_ion_mem,
+            out_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for output image." << "\n";
@@ -201,34 +204,34 @@ int main(int argc, char** argv)
      * Step 2: Set up kernel arguments and run the kernel.
      */
 
-    cl_sampler sampler = clCreateSampler(
+    cl_sampler_handle sampler(clCreateSampler(
             context,
             CL_FALSE,
             CL_ADDRESS_CLAMP_TO_EDGE,
             CL_FILTER_LINEAR,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateSampler." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel, 0, sizeof(src_image), &src_image);
+    err = clSetKernelArg(kernel, 0, sizeof(cl_mem), src_image.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "\tError " << err << " with clSetKernelArg for argument 0." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel, 1, sizeof(out_image), &out_image);
+    err = clSetKernelArg(kernel, 1, sizeof(cl_mem), out_image.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "\tError " << err << " with clSetKernelArg for argument 1." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel, 2, sizeof(sampler), &sampler);
+    err = clSetKernelArg(kernel, 2, sizeof(cl_sampler), sampler.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "\tError " << err << " with clSetKernelArg for argument 2." << "\n";
@@ -236,22 +239,7 @@ int main(int argc, char** argv)
     }
 
     const size_t global_work_size[] = {out_desc.image_width / 2, out_desc.image_height / 2};
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            kernel,
-            2,
-            NULL,
-            global_work_size,
-            NULL,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "\tError " << err << " with clEnqueueNDRangeKernel." << "\n";
-        std::exit(err);
-    }
+    wrapper.enqueue_kernel(kernel, 2, global_work_size, NULL);
 
     /*
      * Step 3: Copy the data out of the ion buffer.
@@ -266,7 +254,7 @@ int main(int argc, char** argv)
     row_pitch                 = 0;
     image_ptr                 = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            out_image,
+            out_image.get(),
             CL_TRUE,
             CL_MAP_READ,
             origin,
@@ -294,7 +282,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, out_image, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, out_image.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping dest image." << "\n";
@@ -305,10 +293,5 @@ int main(int argc, char** argv)
 
     save_rgba_image_data(out_image_filename, out_image_info);
 
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseSampler(sampler);
-    clReleaseMemObject(src_image);
-    clReleaseMemObject(out_image);
-
     return 0;
 }
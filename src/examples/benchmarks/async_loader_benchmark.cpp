@@ -0,0 +1,154 @@
+//--------------------------------------------------------------------------------------
+// File: async_loader_benchmark.cpp
+// Desc: Measures how well async_image_loader overlaps file loading with GPU work
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+// Std includes
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Project includes
+#include "util/async_image_loader.h"
+#include "util/util.h"
+
+static const char *HELP_MESSAGE = "\n"
+"Usage: async_loader_benchmark <scratch directory> [<frames> [<gpu ms per frame> [<threads> [<queue capacity>]]]]\n"
+"Writes <frames> synthetic 4K NV12 image data files (default 16) to the scratch\n"
+"directory, then processes them once serially, loading each file and then\n"
+"waiting for its GPU work, and once with async_image_loader loading ahead.\n"
+"GPU work is stood in for by waiting <gpu ms per frame>, as the host does in\n"
+"clFinish; by default this is the measured time to load one frame, which is\n"
+"where overlapping helps most. Loading uses 2 threads and a queue of 4 frames\n"
+"unless specified otherwise.\n"
+"\n"
+"Overlap efficiency is the fraction of the shorter of total load time and\n"
+"total GPU time that was hidden behind the other: 100% means the pipelined run\n"
+"took only as long as the longer of the two.\n";
+
+static const uint32_t FRAME_WIDTH  = 3840;
+static const uint32_t FRAME_HEIGHT = 2160;
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void fill_synthetic(nv12_image_t &image, size_t seed)
+{
+    image.y_width  = FRAME_WIDTH;
+    image.y_height = FRAME_HEIGHT;
+    image.y_plane.resize(FRAME_WIDTH * FRAME_HEIGHT);
+    image.uv_plane.resize(image.y_plane.size() / 2);
+    for (size_t i = 0; i < image.y_plane.size(); ++i)
+    {
+        image.y_plane[i] = static_cast<unsigned char>(i * 7 + seed);
+    }
+    for (size_t i = 0; i < image.uv_plane.size(); ++i)
+    {
+        image.uv_plane[i] = static_cast<unsigned char>(i * 13 + seed);
+    }
+}
+
+static void run_gpu_work(const nv12_image_t &image, std::chrono::microseconds gpu_time)
+{
+    if (image.y_width != FRAME_WIDTH)
+    {
+        std::cerr << "Loaded frame has the wrong size\n";
+        std::exit(EXIT_FAILURE);
+    }
+    std::this_thread::sleep_for(gpu_time);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Please specify a scratch directory.\n";
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_SUCCESS);
+    }
+
+    const std::string scratch_dir(argv[1]);
+    const size_t      num_frames     = argc >= 3 ? std::strtoul(argv[2], NULL, 10) : 16;
+    const double      gpu_ms_arg     = argc >= 4 ? std::strtod(argv[3], NULL) : 0;
+    const size_t      num_threads    = argc >= 5 ? std::strtoul(argv[4], NULL, 10) : 2;
+    const size_t      queue_capacity = argc >= 6 ? std::strtoul(argv[5], NULL, 10) : 4;
+    if (num_frames == 0 || num_threads == 0 || queue_capacity == 0)
+    {
+        std::cerr << "Frames, threads and queue capacity must be positive.\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::vector<std::string> filenames;
+    for (size_t i = 0; i < num_frames; ++i)
+    {
+        nv12_image_t synthetic;
+        fill_synthetic(synthetic, i);
+        filenames.push_back(scratch_dir + "/async_loader_benchmark_" + std::to_string(i) + ".dat");
+        save_nv12_image_data(filenames.back(), synthetic);
+    }
+
+    // Load time alone, which also warms the page cache for the runs below
+    nv12_image_t frame;
+    auto         start = std::chrono::steady_clock::now();
+    for (const auto &filename : filenames)
+    {
+        load_nv12_image_data(filename, frame);
+    }
+    const double load_s = seconds_since(start);
+
+    const double                    gpu_ms   = gpu_ms_arg > 0 ? gpu_ms_arg : load_s * 1000 / num_frames;
+    const std::chrono::microseconds gpu_time(static_cast<long long>(gpu_ms * 1000));
+    const double                    gpu_s    = gpu_ms * num_frames / 1000;
+
+    start = std::chrono::steady_clock::now();
+    for (const auto &filename : filenames)
+    {
+        load_nv12_image_data(filename, frame);
+        run_gpu_work(frame, gpu_time);
+    }
+    const double serial_s = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    double loader_wait_s = 0;
+    {
+        async_image_loader<nv12_image_t> loader(filenames, load_nv12_image_data, num_threads, queue_capacity);
+        while (loader.next(frame))
+        {
+            run_gpu_work(frame, gpu_time);
+        }
+        loader_wait_s = loader.wait_seconds();
+    }
+    const double pipelined_s = seconds_since(start);
+
+    const double hidden_s   = std::max(0.0, serial_s - pipelined_s);
+    const double efficiency = 100 * std::min(1.0, hidden_s / std::min(load_s, gpu_s));
+
+    std::cout << num_frames << " frames of " << FRAME_WIDTH << "x" << FRAME_HEIGHT << " NV12, "
+              << num_threads << " loading threads, queue of " << queue_capacity << "\n";
+    std::cout << "load only:        " << load_s * 1000 << " ms\n";
+    std::cout << "gpu only:         " << gpu_s * 1000 << " ms\n";
+    std::cout << "serial:           " << serial_s * 1000 << " ms\n";
+    std::cout << "pipelined:        " << pipelined_s * 1000 << " ms (waited " << loader_wait_s * 1000
+              << " ms for frames)\n";
+    std::cout << "overlap efficiency: " << efficiency << "%\n";
+
+    for (const auto &filename : filenames)
+    {
+        std::remove(filename.c_str());
+    }
+
+    return 0;
+}
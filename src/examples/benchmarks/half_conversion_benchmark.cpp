@@ -0,0 +1,258 @@
+//--------------------------------------------------------------------------------------
+// File: half_conversion_benchmark.cpp
+// Desc: Compares the scalar and batch half-float conversions
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+// Std includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Project includes
+#include "util/half_float.h"
+#include "util/util.h"
+
+static const char *HELP_MESSAGE = "\n"
+"Usage: half_conversion_benchmark [<values>]\n"
+"       half_conversion_benchmark --verify\n"
+"Converts <values> random floats (default 16777216) to half floats and back,\n"
+"once a value at a time with to_half and to_float and once with the batch\n"
+"functions to_half_n and to_float_n, in every rounding and to_float mode,\n"
+"checks that both give identical results and reports conversions per second.\n"
+"\n"
+"--verify instead checks every one of the 2^32 floats and 2^16 halves: the\n"
+"scalar and batch functions must agree in every mode, and rounding to nearest\n"
+"even must match an independent reference and to_half_constexpr. This takes a\n"
+"few minutes.\n";
+
+static const size_t VERIFY_CHUNK = 1 << 20;
+
+/**
+ * \brief An independent reference for rounding to nearest even: the half
+ *        nearest to f, as a float, using double arithmetic and the default
+ *        floating-point rounding mode.
+ */
+static uint32_t nearest_half_as_float_bits(float f)
+{
+    uint32_t bits = 0;
+    std::memcpy(&bits, &f, sizeof(bits));
+    const uint32_t sign = bits & 0x80000000;
+    if (std::isnan(f))
+    {
+        return 0x7FC00000; // to_float gives the positive quiet NaN
+    }
+    if (std::fabs(f) >= 65520.f)
+    {
+        return sign | 0x7F800000;
+    }
+
+    // Halves are multiples of 2^(e - 10) in [2^e, 2^(e+1)), and of 2^-24 below 2^-14
+    int exponent = 0;
+    std::frexp(std::fabs(f), &exponent);
+    const double ulp     = std::ldexp(1.0, std::max(exponent - 1, -14) - 10);
+    const float  nearest = static_cast<float>(std::nearbyint(std::fabs(f) / ulp) * ulp);
+    std::memcpy(&bits, &nearest, sizeof(bits));
+    return sign | bits;
+}
+
+/**
+ * \brief Checks every float and every half, in parallel, and returns the number of mismatches.
+ */
+static size_t verify_all()
+{
+    std::atomic<size_t> mismatches(0);
+    for (half_rounding_t rounding : {half_rounding_t::TOWARD_ZERO, half_rounding_t::TO_NEAREST_EVEN})
+    {
+        set_half_rounding(rounding);
+        const bool nearest_even = rounding == half_rounding_t::TO_NEAREST_EVEN;
+        parallel_for((size_t(1) << 32) / VERIFY_CHUNK, [&](size_t chunk)
+        {
+            std::vector<cl_float> floats(VERIFY_CHUNK);
+            std::vector<cl_half>  halves(VERIFY_CHUNK);
+            for (size_t i = 0; i < VERIFY_CHUNK; ++i)
+            {
+                const uint32_t bits = static_cast<uint32_t>(chunk * VERIFY_CHUNK + i);
+                std::memcpy(&floats[i], &bits, sizeof(bits));
+            }
+            to_half_n(floats.data(), halves.data(), VERIFY_CHUNK);
+
+            size_t chunk_mismatches = 0;
+            for (size_t i = 0; i < VERIFY_CHUNK; ++i)
+            {
+                const cl_half half = to_half(floats[i]);
+                chunk_mismatches += half != halves[i];
+                if (nearest_even)
+                {
+                    const cl_float value = to_float(half);
+                    uint32_t       bits  = 0;
+                    std::memcpy(&bits, &value, sizeof(bits));
+                    chunk_mismatches += bits != nearest_half_as_float_bits(floats[i]);
+                    // to_half_constexpr can't see NaN payloads or the sign of zero
+                    chunk_mismatches += !std::isnan(floats[i]) && floats[i] != 0.f
+                                        && to_half_constexpr(floats[i]) != half;
+                    // NaNs stay NaNs and keep their sign
+                    chunk_mismatches += std::isnan(floats[i])
+                                        && ((half & 0x7E00) != 0x7E00 || (half >> 15) != std::signbit(floats[i]));
+                }
+            }
+            mismatches += chunk_mismatches;
+        });
+        std::cout << "to_half, " << (nearest_even ? "nearest even" : "toward zero") << ": checked 2^32 floats\n";
+    }
+
+    std::vector<cl_half> halves(1 << 16);
+    for (size_t h = 0; h < halves.size(); ++h)
+    {
+        halves[h] = static_cast<cl_half>(h);
+    }
+    std::vector<cl_float> table(halves.size()), computed(halves.size()), batch(halves.size());
+    set_half_to_float_method(half_to_float_method_t::COMPUTED);
+    for (size_t h = 0; h < halves.size(); ++h)
+    {
+        computed[h] = to_float(halves[h]);
+    }
+    to_float_n(halves.data(), batch.data(), halves.size());
+    set_half_to_float_method(half_to_float_method_t::TABLE);
+    for (size_t h = 0; h < halves.size(); ++h)
+    {
+        table[h] = to_float(halves[h]);
+    }
+    for (size_t h = 0; h < halves.size(); ++h)
+    {
+        mismatches += std::memcmp(&table[h], &computed[h], sizeof(cl_float)) != 0;
+        mismatches += std::memcmp(&batch[h], &computed[h], sizeof(cl_float)) != 0;
+    }
+    std::cout << "to_float: checked 2^16 halves\n";
+
+    return mismatches;
+}
+
+/**
+ * \brief Runs fn a few times and returns the fastest time in seconds.
+ */
+static double best_seconds(const std::function<void()> &fn)
+{
+    double best = 0;
+    for (int i = 0; i < 5; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = i == 0 ? elapsed : std::min(best, elapsed);
+    }
+    return best;
+}
+
+static void report(const char *name, size_t count, double seconds)
+{
+    std::cout << name << count / seconds / 1e6 << " million conversions/s\n";
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 2 && std::strcmp(argv[1], "--help") == 0)
+    {
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_SUCCESS);
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "--verify") == 0)
+    {
+        const size_t mismatches = verify_all();
+        if (mismatches != 0)
+        {
+            std::cerr << mismatches << " conversions are wrong\n";
+            std::exit(EXIT_FAILURE);
+        }
+        std::cout << "All conversions are correct\n";
+        return 0;
+    }
+    const size_t count = argc >= 2 ? std::strtoul(argv[1], NULL, 10) : 16777216;
+
+    // Values of either sign across the range of a half, including subnormals
+    std::mt19937                          rng(1);
+    std::uniform_real_distribution<float> exponent(-26.f, 15.f);
+    std::vector<cl_float>                 floats(count);
+    for (auto &f : floats)
+    {
+        f = ((rng() & 1) ? 1.f : -1.f) * std::exp2(exponent(rng));
+    }
+
+    std::vector<cl_half>  scalar_halves(count), batch_halves(count);
+    std::vector<cl_float> scalar_floats(count), batch_floats(count);
+
+    const struct
+    {
+        half_rounding_t rounding;
+        const char     *scalar_name;
+        const char     *batch_name;
+    } roundings[] = {
+        {half_rounding_t::TOWARD_ZERO,     "to_half, toward zero:     ", "to_half_n, toward zero:   "},
+        {half_rounding_t::TO_NEAREST_EVEN, "to_half, nearest even:    ", "to_half_n, nearest even:  "},
+    };
+    for (const auto &mode : roundings)
+    {
+        set_half_rounding(mode.rounding);
+        const double to_half_s = best_seconds([&]()
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                scalar_halves[i] = to_half(floats[i]);
+            }
+        });
+        const double to_half_n_s = best_seconds([&]() { to_half_n(floats.data(), batch_halves.data(), count); });
+        if (scalar_halves != batch_halves)
+        {
+            std::cerr << "The batch conversions to half differ from the scalar ones\n";
+            std::exit(EXIT_FAILURE);
+        }
+        report(mode.scalar_name, count, to_half_s);
+        report(mode.batch_name, count, to_half_n_s);
+    }
+
+    const struct
+    {
+        half_to_float_method_t method;
+        const char            *scalar_name;
+        const char            *batch_name;
+    } methods[] = {
+        {half_to_float_method_t::COMPUTED, "to_float, computed:       ", "to_float_n, computed:     "},
+        {half_to_float_method_t::TABLE,    "to_float, table:          ", "to_float_n, table:        "},
+    };
+    for (const auto &mode : methods)
+    {
+        set_half_to_float_method(mode.method);
+        const double to_float_s = best_seconds([&]()
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                scalar_floats[i] = to_float(scalar_halves[i]);
+            }
+        });
+        const double to_float_n_s = best_seconds([&]()
+        {
+            to_float_n(scalar_halves.data(), batch_floats.data(), count);
+        });
+        if (std::memcmp(scalar_floats.data(), batch_floats.data(), count * sizeof(cl_float)) != 0)
+        {
+            std::cerr << "The batch conversions to float differ from the scalar ones\n";
+            std::exit(EXIT_FAILURE);
+        }
+        report(mode.scalar_name, count, to_float_s);
+        report(mode.batch_name, count, to_float_n_s);
+    }
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+//--------------------------------------------------------------------------------------
+// File: ion_pool_benchmark.cpp
+// Desc: Compares ion buffer allocation latency with and without the buffer pool
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+// Std includes
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Project includes
+#include "util/cl_wrapper.h"
+
+// Library includes
+#include <CL/cl.h>
+#include <CL/cl_ext_qcom.h>
+
+static const char *HELP_MESSAGE = "\n"
+"Usage: ion_pool_benchmark [<frames>]\n"
+"Simulates a per-frame pipeline that makes an input and an output ion buffer\n"
+"for every frame and releases them at the end of the frame, for <frames>\n"
+"frames (default 200) at several frame sizes. Reports the mean time to make a\n"
+"buffer with the pool disabled, so that every buffer is allocated and mapped,\n"
+"and with the pool, so that buffers are recycled, for both uncached and\n"
+"IO-coherent buffers.\n";
+
+struct frame_size_t
+{
+    const char *name;
+    size_t      bytes;
+};
+
+// NV12 frames
+static const frame_size_t FRAME_SIZES[] = {
+    {"640x480",   640  * 480  * 3 / 2},
+    {"1280x720",  1280 * 720  * 3 / 2},
+    {"1920x1080", 1920 * 1080 * 3 / 2},
+    {"3840x2160", 3840 * 2160 * 3 / 2},
+};
+
+/**
+ * \brief Runs the frames and returns the mean time to make a buffer, in microseconds.
+ */
+static double mean_make_us(cl_wrapper &wrapper, size_t bytes, bool iocoherent, size_t frames)
+{
+    double total_us = 0;
+    for (size_t frame = 0; frame < frames; ++frame)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const ion_allocation input  = iocoherent ? wrapper.make_iocoherent_ion_buffer(bytes)
+                                                 : wrapper.make_ion_buffer(bytes);
+        const ion_allocation output = iocoherent ? wrapper.make_iocoherent_ion_buffer(bytes)
+                                                 : wrapper.make_ion_buffer(bytes);
+        total_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        // Touch the buffers as a frame would, so mapping costs aren't deferred past the timing
+        std::memset(input->ion_hostptr, 0, bytes);
+        std::memset(output->ion_hostptr, 0, bytes);
+    } // The buffers go back to the pool here
+    return total_us / (2 * frames);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 2 && std::strcmp(argv[1], "--help") == 0)
+    {
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_SUCCESS);
+    }
+    const size_t frames = argc >= 2 ? std::strtoul(argv[1], NULL, 10) : 200;
+    if (frames == 0)
+    {
+        std::cerr << "The number of frames must be positive.\n";
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_FAILURE);
+    }
+
+    cl_wrapper wrapper;
+    for (const bool iocoherent : {false, true})
+    {
+        std::cout << (iocoherent ? "IO-coherent buffers:\n" : "Uncached buffers:\n");
+        for (const auto &size : FRAME_SIZES)
+        {
+            wrapper.set_ion_pool_max_idle_bytes(0);
+            const double unpooled_us = mean_make_us(wrapper, size.bytes, iocoherent, frames);
+            wrapper.set_ion_pool_max_idle_bytes(cl_wrapper::DEFAULT_ION_POOL_MAX_IDLE_BYTES);
+            const double pooled_us   = mean_make_us(wrapper, size.bytes, iocoherent, frames);
+            std::cout << "    " << size.name << ": without pool " << unpooled_us << " us, with pool " << pooled_us
+                      << " us (" << unpooled_us / pooled_us << " times as fast)\n";
+        }
+    }
+
+    const ion_pool_stats_t stats = wrapper.get_ion_pool_stats();
+    std::cout << stats.allocations << " buffers allocated, " << stats.reuses << " reused, " << stats.frees
+              << " freed, peak " << stats.peak_bytes / 1024 << " KiB\n";
+
+    return 0;
+}
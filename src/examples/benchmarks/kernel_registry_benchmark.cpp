@@ -0,0 +1,193 @@
+//--------------------------------------------------------------------------------------
+// File: kernel_registry_benchmark.cpp
+// Desc: Times repeated pipeline setup and drives one pipeline from several threads
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+// Std includes
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Project includes
+#include "util/cl_handles.h"
+#include "util/cl_wrapper.h"
+
+// Library includes
+#include <CL/cl.h>
+
+static const char *HELP_MESSAGE = "\n"
+"Usage: kernel_registry_benchmark [<threads> [<iterations>]]\n"
+"First sets up a two-kernel pipeline <iterations> times (default 1000), once\n"
+"making new kernels each time with make_kernel and once looking them up with\n"
+"get_kernel. Then runs the pipeline <iterations> times on each of <threads>\n"
+"threads (default 4) at once, each with its own kernels from get_thread_kernel\n"
+"and its own buffers, checks every thread's results and reports the runs per\n"
+"second compared with a single thread.\n";
+
+static const char *PROGRAM_SOURCE[] = {
+"__kernel void scale(__global const float *src, __global float *dst, float factor)\n",
+"{\n",
+"    const int i = get_global_id(0);\n",
+"    dst[i] = src[i] * factor;\n",
+"}\n",
+"\n",
+"__kernel void offset(__global float *data, float amount)\n",
+"{\n",
+"    const int i = get_global_id(0);\n",
+"    data[i] += amount;\n",
+"}\n",
+};
+
+static const cl_uint PROGRAM_SOURCE_LEN = sizeof(PROGRAM_SOURCE) / sizeof(const char *);
+
+static const size_t ELEMENTS = 1 << 16;
+
+static void check(cl_int err, const char *call)
+{
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with " << call << ".\n";
+        std::exit(err);
+    }
+}
+
+/**
+ * \brief Runs the pipeline iterations times from the calling thread, with its
+ *        own kernels and buffers, and returns the number of wrong results.
+ */
+static size_t run_pipeline(cl_wrapper &wrapper, cl_program program, size_t iterations, cl_float factor)
+{
+    cl_context       context       = wrapper.get_context();
+    cl_command_queue command_queue = wrapper.get_command_queue();
+    cl_kernel        scale         = wrapper.get_thread_kernel("scale", program);
+    cl_kernel        offset        = wrapper.get_thread_kernel("offset", program);
+
+    std::vector<cl_float> src(ELEMENTS), dst(ELEMENTS);
+    for (size_t i = 0; i < ELEMENTS; ++i)
+    {
+        src[i] = static_cast<cl_float>(i % 1024);
+    }
+    cl_int err = CL_SUCCESS;
+    cl_mem_handle src_mem(clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                         ELEMENTS * sizeof(cl_float), src.data(), &err));
+    check(err, "clCreateBuffer");
+    cl_mem_handle dst_mem(clCreateBuffer(context, CL_MEM_READ_WRITE, ELEMENTS * sizeof(cl_float), NULL, &err));
+    check(err, "clCreateBuffer");
+
+    const cl_float amount = 1.f;
+    check(clSetKernelArg(scale, 0, sizeof(cl_mem), src_mem.address()), "clSetKernelArg");
+    check(clSetKernelArg(scale, 1, sizeof(cl_mem), dst_mem.address()), "clSetKernelArg");
+    check(clSetKernelArg(scale, 2, sizeof(factor), &factor), "clSetKernelArg");
+    check(clSetKernelArg(offset, 0, sizeof(cl_mem), dst_mem.address()), "clSetKernelArg");
+    check(clSetKernelArg(offset, 1, sizeof(amount), &amount), "clSetKernelArg");
+
+    // The queue is shared, so each run waits on its own event rather than on clFinish
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        cl_event event = NULL;
+        check(clEnqueueNDRangeKernel(command_queue, scale, 1, NULL, &ELEMENTS, NULL, 0, NULL, NULL),
+              "clEnqueueNDRangeKernel");
+        check(clEnqueueNDRangeKernel(command_queue, offset, 1, NULL, &ELEMENTS, NULL, 0, NULL, &event),
+              "clEnqueueNDRangeKernel");
+        const cl_event_handle done(event);
+        check(clWaitForEvents(1, done.address()), "clWaitForEvents");
+    }
+    check(clEnqueueReadBuffer(command_queue, dst_mem.get(), CL_TRUE, 0, ELEMENTS * sizeof(cl_float), dst.data(), 0,
+                              NULL, NULL), "clEnqueueReadBuffer");
+
+    size_t wrong = 0;
+    for (size_t i = 0; i < ELEMENTS; ++i)
+    {
+        wrong += dst[i] != src[i] * factor + amount;
+    }
+
+    wrapper.release_thread_kernels();
+    return wrong;
+}
+
+/**
+ * \brief Runs the pipeline on num_threads threads at once.
+ * @return The runs per second over all threads.
+ */
+static double runs_per_second(cl_wrapper &wrapper, cl_program program, size_t num_threads, size_t iterations)
+{
+    std::atomic<size_t>      wrong(0);
+    std::vector<std::thread> threads;
+    const auto               start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < num_threads; ++t)
+    {
+        // Each thread scales by a different factor, so mixed-up arguments show up as wrong results
+        threads.emplace_back([&, t]()
+        {
+            wrong += run_pipeline(wrapper, program, iterations, static_cast<cl_float>(t + 2));
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    const double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (wrong != 0)
+    {
+        std::cerr << wrong << " results are wrong with " << num_threads << " threads\n";
+        std::exit(EXIT_FAILURE);
+    }
+    return num_threads * iterations / elapsed_s;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 2 && std::strcmp(argv[1], "--help") == 0)
+    {
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_SUCCESS);
+    }
+    const size_t num_threads = argc >= 2 ? std::strtoul(argv[1], NULL, 10) : 4;
+    const size_t iterations  = argc >= 3 ? std::strtoul(argv[2], NULL, 10) : 1000;
+    if (num_threads == 0 || iterations == 0)
+    {
+        std::cerr << "The numbers of threads and iterations must be positive.\n";
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_FAILURE);
+    }
+
+    cl_wrapper wrapper;
+    cl_program program = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        wrapper.make_kernel("scale", program);
+        wrapper.make_kernel("offset", program);
+    }
+    const double make_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        wrapper.get_kernel("scale", program);
+        wrapper.get_kernel("offset", program);
+    }
+    const double get_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "pipeline setup with make_kernel: " << make_us / iterations << " us, "
+              << 2 * iterations << " kernels made\n";
+    std::cout << "pipeline setup with get_kernel:  " << get_us / iterations << " us, 2 kernels made\n";
+
+    const double single = runs_per_second(wrapper, program, 1, iterations);
+    const double multi  = runs_per_second(wrapper, program, num_threads, iterations);
+    std::cout << "1 thread:   " << single << " runs/s\n";
+    std::cout << num_threads << " threads:  " << multi << " runs/s (" << multi / single << " times as many)\n";
+
+    return 0;
+}
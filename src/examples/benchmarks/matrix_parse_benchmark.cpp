@@ -0,0 +1,173 @@
+//--------------------------------------------------------------------------------------
+// File: matrix_parse_benchmark.cpp
+// Desc: Compares the iostream text matrix reader with the parser used by load_matrix
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+// Std includes
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Project includes
+#include "util/util.h"
+
+// Library includes
+#include <CL/cl.h>
+
+static const char *HELP_MESSAGE = "\n"
+"Usage: matrix_parse_benchmark <scratch directory> [<elements>] [<iterations>]\n"
+"Writes a text matrix of random floats to the scratch directory, once as\n"
+"save_matrix formats it and once with 9 significant digits, then reports how\n"
+"long it takes to load each with the original operator>> loop and with\n"
+"load_matrix. Both must give bit-identical elements. <elements> defaults to\n"
+"10000000. load_matrix uses every hardware thread; run it under e.g.\n"
+"taskset -c 0 to time a single core.\n";
+
+static const int MATRIX_WIDTH = 1000;
+
+/**
+ * \brief The reader load_matrix used before the parallel parser, kept here as
+ *        the baseline.
+ */
+static matrix_t legacy_load_matrix(const std::string &filename)
+{
+    std::ifstream fin(filename);
+    if (!fin)
+    {
+        std::cerr << "Can't open " << filename << " for reading\n";
+        std::exit(EXIT_FAILURE);
+    }
+    matrix_t res;
+    fin >> res.width >> res.height;
+    res.elements.reserve(res.width * res.height);
+    for (int i = 0; i < res.width * res.height; ++i)
+    {
+        cl_float num;
+        fin >> num;
+        res.elements.push_back(num);
+    }
+    return res;
+}
+
+/**
+ * \brief Makes finite floats across the whole exponent range, half of them
+ *        with only a few significant digits as hand-written data tends to have.
+ */
+static matrix_t make_random_matrix(size_t num_elements)
+{
+    std::mt19937                          rng(42);
+    std::uniform_int_distribution<int>    exponent(-40, 38);
+    std::uniform_real_distribution<float> mantissa(-10.f, 10.f);
+    std::uniform_int_distribution<int>    small_int(-99999, 99999);
+
+    matrix_t res;
+    res.width  = MATRIX_WIDTH;
+    res.height = static_cast<int>(work_units(num_elements, MATRIX_WIDTH));
+    res.elements.resize(static_cast<size_t>(res.width) * res.height);
+    for (size_t i = 0; i < res.elements.size(); ++i)
+    {
+        res.elements[i] = i % 2 == 0
+                          ? mantissa(rng) * std::pow(10.f, static_cast<float>(exponent(rng)))
+                          : small_int(rng) / 1000.f;
+        if (!std::isfinite(res.elements[i]))
+        {
+            res.elements[i] = 0.f;
+        }
+    }
+    return res;
+}
+
+static void save_matrix_9_digits(const std::string &filename, const matrix_t &matrix)
+{
+    FILE *fout = std::fopen(filename.c_str(), "w");
+    if (!fout)
+    {
+        std::cerr << "Can't open " << filename << " for writing.\n";
+        std::exit(EXIT_FAILURE);
+    }
+    std::fprintf(fout, "%d %d\n", matrix.width, matrix.height);
+    for (size_t i = 0; i < matrix.elements.size(); ++i)
+    {
+        std::fprintf(fout, "%.9g%c", matrix.elements[i], (i + 1) % MATRIX_WIDTH == 0 ? '\n' : ' ');
+    }
+    std::fclose(fout);
+}
+
+static void check_same(const matrix_t &a, const matrix_t &b, const std::string &filename)
+{
+    if (a.width != b.width || a.height != b.height || a.elements.size() != b.elements.size()
+        || std::memcmp(a.elements.data(), b.elements.data(), a.elements.size() * sizeof(cl_float)) != 0)
+    {
+        std::cerr << "operator>> and load_matrix disagree on " << filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+template <typename Loader>
+static double time_loads_ms(Loader load, size_t iterations)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        load();
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Please specify a scratch directory.\n";
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_SUCCESS);
+    }
+
+    const std::string scratch_dir(argv[1]);
+    const size_t      num_elements = argc >= 3 ? std::strtoul(argv[2], NULL, 10) : 10000000;
+    const size_t      iterations   = argc >= 4 ? std::strtoul(argv[3], NULL, 10) : 1;
+    if (num_elements == 0 || iterations == 0)
+    {
+        std::cerr << "Elements and iterations must be positive.\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    const matrix_t    matrix           = make_random_matrix(num_elements);
+    const std::string shortest_filename = scratch_dir + "/matrix_parse_benchmark_shortest.txt";
+    const std::string digits_filename   = scratch_dir + "/matrix_parse_benchmark_9_digits.txt";
+    save_matrix(shortest_filename, matrix);
+    save_matrix_9_digits(digits_filename, matrix);
+
+    std::cout << matrix.elements.size() << " elements, " << std::thread::hardware_concurrency()
+              << " hardware threads\n";
+    std::cout << "format    operator>>(ms)  load_matrix(ms)  speedup\n";
+    const std::string filenames[] = {shortest_filename, digits_filename};
+    const char       *names[]     = {"shortest", "9 digits"};
+    for (size_t i = 0; i < 2; ++i)
+    {
+        check_same(legacy_load_matrix(filenames[i]), load_matrix(filenames[i]), filenames[i]);
+
+        const double legacy_ms = time_loads_ms([&]() { legacy_load_matrix(filenames[i]); }, iterations);
+        const double parser_ms = time_loads_ms([&]() { load_matrix(filenames[i]); }, iterations);
+        std::cout << names[i] << "  " << legacy_ms << "  " << parser_ms << "  " << legacy_ms / parser_ms << "x\n";
+    }
+
+    std::remove(shortest_filename.c_str());
+    std::remove(digits_filename.c_str());
+
+    return 0;
+}
@@ -0,0 +1,181 @@
+//--------------------------------------------------------------------------------------
+// File: perf_hint_benchmark.cpp
+// Desc: Runs the same workload under each perf hint and each priority hint
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+// Std includes
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Project includes
+#include "util/cl_handles.h"
+#include "util/cl_wrapper.h"
+
+// Library includes
+#include <CL/cl.h>
+#include <CL/cl_ext_qcom.h>
+
+static const char *HELP_MESSAGE = "\n"
+"Usage: perf_hint_benchmark [perf|priority|all] [<iterations>]\n"
+"Runs a compute-bound kernel <iterations> times (default 200), waiting for\n"
+"each run to finish, and reports the latency of a run and the throughput.\n"
+"In perf mode the kernel runs under each of the high, normal and low perf\n"
+"hints in turn, changed with clSetPerfHintQCOM on one context. In priority\n"
+"mode it runs on a new context for each of the high, normal and low priority\n"
+"hints, since a context's priority can't be changed. The default is all.\n";
+
+static const char *PROGRAM_SOURCE[] = {
+"__kernel void fma_chain(__global float *data, int rounds)\n",
+"{\n",
+"    const int i = get_global_id(0);\n",
+"    float     x = data[i];\n",
+"    float     y = x * 0.5f;\n",
+"    for (int r = 0; r < rounds; ++r)\n",
+"    {\n",
+"        x = fma(x, 0.999f, y);\n",
+"        y = fma(y, 0.999f, x);\n",
+"    }\n",
+"    data[i] = x + y;\n",
+"}\n",
+};
+
+static const cl_uint PROGRAM_SOURCE_LEN = sizeof(PROGRAM_SOURCE) / sizeof(const char *);
+
+static const size_t ELEMENTS = 1 << 20;
+static const cl_int ROUNDS   = 256;
+
+// Runs before timing each hint, so the GPU clocks can settle at the new level
+static const size_t WARMUP_ITERATIONS = 20;
+
+struct hint_t
+{
+    const char *name;
+    cl_uint     value;
+};
+
+static const hint_t PERF_HINTS[] = {
+    {"high",   CL_PERF_HINT_HIGH_QCOM},
+    {"normal", CL_PERF_HINT_NORMAL_QCOM},
+    {"low",    CL_PERF_HINT_LOW_QCOM},
+};
+
+static const hint_t PRIORITY_HINTS[] = {
+    {"high",   CL_PRIORITY_HINT_HIGH_QCOM},
+    {"normal", CL_PRIORITY_HINT_NORMAL_QCOM},
+    {"low",    CL_PRIORITY_HINT_LOW_QCOM},
+};
+
+/**
+ * \brief Runs the kernel iterations times and prints the latency and throughput.
+ */
+static void run_workload(cl_wrapper &wrapper, const char *label, size_t iterations)
+{
+    cl_program program = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
+    cl_kernel  kernel  = wrapper.get_kernel("fma_chain", program);
+
+    const std::vector<cl_float> initial(ELEMENTS, 1.f);
+    cl_int err = CL_SUCCESS;
+    cl_mem_handle data(clCreateBuffer(wrapper.get_context(), CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                                      ELEMENTS * sizeof(cl_float), const_cast<cl_float *>(initial.data()), &err));
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clCreateBuffer.\n";
+        std::exit(err);
+    }
+    err = clSetKernelArg(kernel, 0, sizeof(cl_mem), data.address());
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clSetKernelArg for argument 0.\n";
+        std::exit(err);
+    }
+    err = clSetKernelArg(kernel, 1, sizeof(ROUNDS), &ROUNDS);
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clSetKernelArg for argument 1.\n";
+        std::exit(err);
+    }
+
+    for (size_t i = 0; i < WARMUP_ITERATIONS; ++i)
+    {
+        wrapper.enqueue_kernel(kernel, 1, &ELEMENTS, NULL, 2 * ELEMENTS * sizeof(cl_float));
+    }
+    wrapper.finish();
+
+    std::vector<double> latencies_us(iterations);
+    const auto          start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        const auto run_start = std::chrono::steady_clock::now();
+        wrapper.enqueue_kernel(kernel, 1, &ELEMENTS, NULL, 2 * ELEMENTS * sizeof(cl_float));
+        wrapper.finish();
+        latencies_us[i] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - run_start).count();
+    }
+    const double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::sort(latencies_us.begin(), latencies_us.end());
+    double total_us = 0;
+    for (const double us : latencies_us)
+    {
+        total_us += us;
+    }
+    const double flops = 4. * ROUNDS * ELEMENTS * iterations;
+    std::cout << "    " << label << ": mean " << total_us / iterations << " us, median "
+              << latencies_us[iterations / 2] << " us, p99 " << latencies_us[(iterations * 99 - 1) / 100]
+              << " us, " << iterations / elapsed_s << " runs/s, " << flops / elapsed_s / 1e9 << " GFLOP/s\n";
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 2 && std::strcmp(argv[1], "--help") == 0)
+    {
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_SUCCESS);
+    }
+    const std::string mode       = argc >= 2 ? argv[1] : "all";
+    const size_t      iterations = argc >= 3 ? std::strtoul(argv[2], NULL, 10) : 200;
+    if ((mode != "perf" && mode != "priority" && mode != "all") || iterations == 0)
+    {
+        std::cerr << "The mode must be perf, priority or all, and the number of iterations must be positive.\n";
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_FAILURE);
+    }
+
+    cl_wrapper_config_t config = cl_wrapper::get_env_config();
+    config.perf_hint           = 0;
+    config.priority_hint       = CL_PRIORITY_HINT_NONE_QCOM;
+
+    if (mode != "priority")
+    {
+        cl_wrapper wrapper(config);
+        std::cout << "Perf hints:\n";
+        for (const auto &hint : PERF_HINTS)
+        {
+            wrapper.set_perf_hint(hint.value);
+            run_workload(wrapper, hint.name, iterations);
+        }
+    }
+
+    if (mode != "perf")
+    {
+        std::cout << "Priority hints:\n";
+        for (const auto &hint : PRIORITY_HINTS)
+        {
+            config.priority_hint = hint.value;
+            cl_wrapper wrapper(config);
+            run_workload(wrapper, hint.name, iterations);
+        }
+    }
+
+    return 0;
+}
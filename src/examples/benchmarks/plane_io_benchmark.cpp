@@ -0,0 +1,266 @@
+//--------------------------------------------------------------------------------------
+// File: plane_io_benchmark.cpp
+// Desc: Compares per-byte and bulk loading of NV12 and P010 image data files, and checks TP10 round trips
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+// Std includes
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// Project includes
+#include "util/util.h"
+
+// Library includes
+#include <CL/cl.h>
+#include <CL/cl_ext_qcom.h>
+
+static const char *HELP_MESSAGE = "\n"
+"Usage: plane_io_benchmark <scratch directory> [<iterations>]\n"
+"Writes synthetic 4K and 12MP NV12 and P010 image data files to the scratch\n"
+"directory, then reports how long it takes to load them with the original\n"
+"per-byte reader and with the bulk reader used by load_*_image_data.\n"
+"It first checks that small TP10 images, including widths that aren't a\n"
+"multiple of 3, survive saving and loading, plain and compressed.\n";
+
+struct benchmark_size_t
+{
+    const char *name;
+    uint32_t    width;
+    uint32_t    height;
+};
+
+static const benchmark_size_t BENCHMARK_SIZES[] = {
+    {"4K",   3840, 2160},
+    {"12MP", 4000, 3000},
+};
+
+/**
+ * \brief The reader load_*_image_data used before bulk plane reads, kept here
+ *        as the baseline. Reads one little-endian channel at a time.
+ */
+template <typename UIntType>
+static UIntType legacy_read_le(std::istream &in)
+{
+    UIntType      val  = 0;
+    unsigned char byte = 0;
+    for (uint32_t i = 0; i < sizeof(UIntType); ++i)
+    {
+        in.get(*reinterpret_cast<char *>(&byte));
+        val |= byte << (i * 8);
+    }
+    return val;
+}
+
+static void legacy_read_plane(std::istream &in, uint32_t channel_bytes, std::vector<unsigned char> &plane)
+{
+    for (size_t i = 0; i < plane.size() / channel_bytes; ++i)
+    {
+        switch (channel_bytes)
+        {
+            case 1:
+            {
+                const uint8_t val = legacy_read_le<uint8_t>(in);
+                std::memcpy(plane.data() + i * channel_bytes, &val, sizeof(val));
+                break;
+            }
+            case 2:
+            {
+                const uint16_t val = legacy_read_le<uint16_t>(in);
+                std::memcpy(plane.data() + i * channel_bytes, &val, sizeof(val));
+                break;
+            }
+            default:
+            {
+                std::cerr << "Error, can't read " << channel_bytes << " bytes at a time.\n";
+                std::exit(EXIT_FAILURE);
+            }
+        }
+    }
+}
+
+static yuv_image_t legacy_load_yuv(const std::string &filename, uint32_t channel_bytes)
+{
+    std::ifstream fin(filename, std::ios::binary);
+    if (!fin)
+    {
+        std::cerr << "Can't open " << filename << " for reading\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    yuv_image_t result;
+    result.y_width  = legacy_read_le<uint32_t>(fin);
+    result.y_height = legacy_read_le<uint32_t>(fin);
+    legacy_read_le<uint32_t>(fin); // data type
+    legacy_read_le<uint32_t>(fin); // order
+
+    result.y_plane.resize(result.y_width * result.y_height * channel_bytes);
+    legacy_read_plane(fin, channel_bytes, result.y_plane);
+    result.uv_plane.resize(result.y_plane.size() / 2);
+    legacy_read_plane(fin, channel_bytes, result.uv_plane);
+
+    return result;
+}
+
+static void fill_synthetic(yuv_image_t &image, uint32_t width, uint32_t height, uint32_t channel_bytes)
+{
+    image.y_width  = width;
+    image.y_height = height;
+    image.y_plane.resize(width * height * channel_bytes);
+    image.uv_plane.resize(image.y_plane.size() / 2);
+    for (size_t i = 0; i < image.y_plane.size(); ++i)
+    {
+        image.y_plane[i] = static_cast<unsigned char>(i * 7 + i / width);
+    }
+    for (size_t i = 0; i < image.uv_plane.size(); ++i)
+    {
+        image.uv_plane[i] = static_cast<unsigned char>(i * 13 + i / width);
+    }
+}
+
+template <typename Loader>
+static double time_loads_ms(Loader load, size_t iterations)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        load();
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+static void check_same(const yuv_image_t &a, const yuv_image_t &b, const std::string &filename)
+{
+    if (a.y_plane != b.y_plane || a.uv_plane != b.uv_plane)
+    {
+        std::cerr << "Per-byte and bulk readers disagree on " << filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+static void check_same_planes(const yuv_image_t &expected, const unsigned char *y_plane,
+                              const unsigned char *uv_plane, const std::string &what)
+{
+    if (std::memcmp(expected.y_plane.data(), y_plane, expected.y_plane.size()) != 0
+        || std::memcmp(expected.uv_plane.data(), uv_plane, expected.uv_plane.size()) != 0)
+    {
+        std::cerr << "TP10 round trip failed for a " << expected.y_width << "x" << expected.y_height << " image "
+                  << what << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * \brief Saves small TP10 images and loads them back with the vector and the pitched loaders, plain and
+ *        compressed. Rows are padded to a whole 32-bit word, which all of them must agree on.
+ */
+static void check_tp10_round_trips(const std::string &scratch_dir)
+{
+    static const uint32_t WIDTHS[] = {96, 100, 101};
+    static const uint32_t HEIGHT   = 4;
+    const std::string     filename = scratch_dir + "/plane_io_benchmark_tp10.dat";
+    for (const uint32_t width : WIDTHS)
+    {
+        const image_layout_t layout = get_image_layout(width, HEIGHT, CL_QCOM_UNORM_INT10, CL_QCOM_TP10);
+        tp10_image_t         image;
+        image.y_width  = width;
+        image.y_height = HEIGHT;
+        image.y_plane.resize(layout.plane_bytes(0));
+        image.uv_plane.resize(layout.plane_bytes(1));
+        std::vector<unsigned char> *planes[] = {&image.y_plane, &image.uv_plane};
+        for (std::vector<unsigned char> *plane : planes)
+        {
+            // Three 10-bit samples per word, with the top two bits clear
+            for (size_t i = 0; i < plane->size() / 4; ++i)
+            {
+                const uint32_t word = (i * 7 % 1024) | ((i * 11 + 3) % 1024) << 10 | ((i * 13 + 5) % 1024) << 20;
+                std::memcpy(plane->data() + i * 4, &word, sizeof(word));
+            }
+        }
+
+        save_tp10_image_data(filename, image);
+        const tp10_image_t loaded = load_tp10_image_data(filename);
+        if (loaded.y_plane.size() != image.y_plane.size() || loaded.uv_plane.size() != image.uv_plane.size())
+        {
+            std::cerr << "TP10 planes of a " << width << "x" << HEIGHT << " image changed size when loaded\n";
+            std::exit(EXIT_FAILURE);
+        }
+        check_same_planes(image, loaded.y_plane.data(), loaded.uv_plane.data(), "loaded into vectors");
+
+        std::vector<unsigned char> y_plane(image.y_plane.size());
+        std::vector<unsigned char> uv_plane(image.uv_plane.size());
+        const pitched_planes_t     pitched = {{y_plane.data(), uv_plane.data()},
+                                              {layout.row_bytes[0], layout.row_bytes[1]}};
+        load_image_data(filename, CL_QCOM_UNORM_INT10, CL_QCOM_TP10, pitched);
+        check_same_planes(image, y_plane.data(), uv_plane.data(), "loaded into pitched memory");
+
+        const pitched_planes_t source = {{image.y_plane.data(), image.uv_plane.data()},
+                                         {layout.row_bytes[0], layout.row_bytes[1]}};
+        save_compressed_image_data(filename, width, HEIGHT, CL_QCOM_UNORM_INT10, CL_QCOM_TP10, source);
+        const tp10_image_t decompressed = load_tp10_image_data(filename);
+        check_same_planes(image, decompressed.y_plane.data(), decompressed.uv_plane.data(), "compressed");
+    }
+    std::remove(filename.c_str());
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Please specify a scratch directory.\n";
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_SUCCESS);
+    }
+
+    const std::string scratch_dir(argv[1]);
+    const size_t      iterations = argc >= 3 ? std::strtoul(argv[2], NULL, 10) : 3;
+    if (iterations == 0)
+    {
+        std::cerr << "Iterations must be positive.\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    check_tp10_round_trips(scratch_dir);
+
+    std::cout << "format size  per-byte(ms)  bulk(ms)  speedup\n";
+    for (const auto &size : BENCHMARK_SIZES)
+    {
+        nv12_image_t nv12;
+        fill_synthetic(nv12, size.width, size.height, 1);
+        const std::string nv12_filename = scratch_dir + "/plane_io_benchmark_nv12_" + size.name + ".dat";
+        save_nv12_image_data(nv12_filename, nv12);
+        check_same(legacy_load_yuv(nv12_filename, 1), load_nv12_image_data(nv12_filename), nv12_filename);
+
+        const double nv12_legacy_ms = time_loads_ms([&]() { legacy_load_yuv(nv12_filename, 1); }, iterations);
+        const double nv12_bulk_ms   = time_loads_ms([&]() { load_nv12_image_data(nv12_filename); }, iterations);
+        std::cout << "NV12   " << size.name << "  " << nv12_legacy_ms << "  " << nv12_bulk_ms << "  "
+                  << nv12_legacy_ms / nv12_bulk_ms << "x\n";
+
+        p010_image_t p010;
+        fill_synthetic(p010, size.width, size.height, 2);
+        const std::string p010_filename = scratch_dir + "/plane_io_benchmark_p010_" + size.name + ".dat";
+        save_p010_image_data(p010_filename, p010);
+        check_same(legacy_load_yuv(p010_filename, 2), load_p010_image_data(p010_filename), p010_filename);
+
+        const double p010_legacy_ms = time_loads_ms([&]() { legacy_load_yuv(p010_filename, 2); }, iterations);
+        const double p010_bulk_ms   = time_loads_ms([&]() { load_p010_image_data(p010_filename); }, iterations);
+        std::cout << "P010   " << size.name << "  " << p010_legacy_ms << "  " << p010_bulk_ms << "  "
+                  << p010_legacy_ms / p010_bulk_ms << "x\n";
+
+        std::remove(nv12_filename.c_str());
+        std::remove(p010_filename.c_str());
+    }
+
+    return 0;
+}
@@ -0,0 +1,294 @@
+//--------------------------------------------------------------------------------------
+// File: priority_scheduler_benchmark.cpp
+// Desc: Measures preview latency alongside background work, with and without the priority scheduler
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+// Std includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Project includes
+#include "util/cl_handles.h"
+#include "util/cl_wrapper.h"
+#include "util/priority_scheduler.h"
+
+// Library includes
+#include <CL/cl.h>
+#include <CL/cl_ext_qcom.h>
+
+static const char *HELP_MESSAGE = "\n"
+"Usage: priority_scheduler_benchmark [<frames>]\n"
+"Simulates a preview pipeline that downscales a 1920x1080 frame every 33 ms,\n"
+"for <frames> frames (default 150), while a background thread keeps running\n"
+"a heavy analysis kernel over the same frame. Reports the latency of each\n"
+"preview frame and the background throughput three ways: the preview alone,\n"
+"both sharing one context and in-order queue, and both submitted through\n"
+"priority_scheduler, which runs them on high- and low-priority contexts that\n"
+"share the frame's ion buffer.\n";
+
+static const char *PROGRAM_SOURCE[] = {
+"__kernel void downscale(__global const float *src, __global float *dst, int src_width)\n",
+"{\n",
+"    const int x = get_global_id(0);\n",
+"    const int y = get_global_id(1);\n",
+"    const int i = 2 * y * src_width + 2 * x;\n",
+"    dst[y * get_global_size(0) + x] = 0.25f * (src[i] + src[i + 1] + src[i + src_width] + src[i + src_width + 1]);\n",
+"}\n",
+"\n",
+"__kernel void analyze(__global const float *src, __global float *dst, int rounds)\n",
+"{\n",
+"    const int i = get_global_id(0);\n",
+"    float     x = src[i];\n",
+"    float     y = x * 0.5f;\n",
+"    for (int r = 0; r < rounds; ++r)\n",
+"    {\n",
+"        x = fma(x, 0.999f, y);\n",
+"        y = fma(y, 0.999f, x);\n",
+"    }\n",
+"    dst[i] = x + y;\n",
+"}\n",
+};
+
+static const cl_uint PROGRAM_SOURCE_LEN = sizeof(PROGRAM_SOURCE) / sizeof(const char *);
+
+static const cl_int FRAME_WIDTH         = 1920;
+static const cl_int FRAME_HEIGHT        = 1080;
+static const size_t FRAME_ELEMENTS      = FRAME_WIDTH * FRAME_HEIGHT;
+static const size_t FRAME_BYTES         = FRAME_ELEMENTS * sizeof(cl_float);
+static const cl_int ANALYSIS_ROUNDS     = 512;
+static const auto   FRAME_INTERVAL      = std::chrono::milliseconds(33);
+static const size_t PREVIEW_WORK_SIZE[] = {FRAME_WIDTH / 2, FRAME_HEIGHT / 2};
+
+struct run_result_t
+{
+    std::vector<double> preview_latencies_us; // Sorted
+    size_t              background_jobs;
+    double              elapsed_s;
+};
+
+static void check(cl_int err, const char *call)
+{
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with " << call << ".\n";
+        std::exit(err);
+    }
+}
+
+static cl_mem_handle make_device_buffer(cl_context context, size_t size)
+{
+    cl_int        err = CL_SUCCESS;
+    cl_mem_handle buffer(clCreateBuffer(context, CL_MEM_READ_WRITE, size, NULL, &err));
+    check(err, "clCreateBuffer");
+    return buffer;
+}
+
+static void set_preview_args(cl_kernel downscale, cl_mem frame, cl_mem preview)
+{
+    check(clSetKernelArg(downscale, 0, sizeof(frame), &frame), "clSetKernelArg");
+    check(clSetKernelArg(downscale, 1, sizeof(preview), &preview), "clSetKernelArg");
+    check(clSetKernelArg(downscale, 2, sizeof(FRAME_WIDTH), &FRAME_WIDTH), "clSetKernelArg");
+}
+
+static void set_analysis_args(cl_kernel analyze, cl_mem frame, cl_mem analysis)
+{
+    check(clSetKernelArg(analyze, 0, sizeof(frame), &frame), "clSetKernelArg");
+    check(clSetKernelArg(analyze, 1, sizeof(analysis), &analysis), "clSetKernelArg");
+    check(clSetKernelArg(analyze, 2, sizeof(ANALYSIS_ROUNDS), &ANALYSIS_ROUNDS), "clSetKernelArg");
+}
+
+static void fill_frame(const ion_allocation &frame)
+{
+    cl_float *pixels = static_cast<cl_float *>(frame->ion_hostptr);
+    for (size_t i = 0; i < FRAME_ELEMENTS; ++i)
+    {
+        pixels[i] = static_cast<cl_float>(i % 256) / 255.f;
+    }
+}
+
+/**
+ * \brief Calls preview_frame once per frame interval, frames times, and returns the sorted time each call took.
+ */
+template <typename PreviewFrame>
+static std::vector<double> run_preview(size_t frames, PreviewFrame preview_frame)
+{
+    std::vector<double> latencies_us;
+    auto                next_frame = std::chrono::steady_clock::now();
+    for (size_t frame = 0; frame < frames; ++frame)
+    {
+        std::this_thread::sleep_until(next_frame);
+        next_frame += FRAME_INTERVAL;
+        const auto start = std::chrono::steady_clock::now();
+        preview_frame();
+        latencies_us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(latencies_us.begin(), latencies_us.end());
+    return latencies_us;
+}
+
+/**
+ * \brief Runs the preview and, optionally, the background work on one wrapper's context and queue.
+ */
+static run_result_t run_on_one_queue(size_t frames, bool with_background)
+{
+    cl_wrapper     wrapper;
+    cl_program     program = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
+    cl_context     context = wrapper.get_context();
+    ion_allocation frame   = wrapper.make_ion_buffer(FRAME_BYTES);
+    fill_frame(frame);
+
+    cl_int        err = CL_SUCCESS;
+    cl_mem_handle frame_mem(clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
+                                           FRAME_BYTES, frame.get(), &err));
+    check(err, "clCreateBuffer");
+    cl_mem_handle preview  = make_device_buffer(context, FRAME_BYTES / 4);
+    cl_mem_handle analysis = make_device_buffer(context, FRAME_BYTES);
+
+    std::atomic<bool>   stop(false);
+    std::atomic<size_t> background_jobs(0);
+    std::thread         background;
+    if (with_background)
+    {
+        background = std::thread([&]()
+        {
+            cl_kernel analyze = wrapper.get_thread_kernel("analyze", program);
+            set_analysis_args(analyze, frame_mem.get(), analysis.get());
+            while (!stop)
+            {
+                wrapper.enqueue_kernel(analyze, 1, &FRAME_ELEMENTS, NULL);
+                wrapper.finish();
+                ++background_jobs;
+            }
+            wrapper.release_thread_kernels();
+        });
+    }
+
+    cl_kernel downscale = wrapper.get_kernel("downscale", program);
+    set_preview_args(downscale, frame_mem.get(), preview.get());
+    cl_command_queue queue = wrapper.get_command_queue();
+    const auto       start = std::chrono::steady_clock::now();
+
+    run_result_t result;
+    result.preview_latencies_us = run_preview(frames, [&]()
+    {
+        cl_event event = NULL;
+        check(clEnqueueNDRangeKernel(queue, downscale, 2, NULL, PREVIEW_WORK_SIZE, NULL, 0, NULL, &event),
+              "clEnqueueNDRangeKernel");
+        const cl_event_handle done(event);
+        check(clWaitForEvents(1, done.address()), "clWaitForEvents");
+    });
+    result.elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    stop = true;
+    if (background.joinable())
+    {
+        background.join();
+    }
+    result.background_jobs = background_jobs;
+    return result;
+}
+
+/**
+ * \brief Runs the preview as latency jobs and the background work as background jobs of a priority_scheduler.
+ */
+static run_result_t run_with_scheduler(size_t frames)
+{
+    priority_scheduler scheduler;
+    ion_allocation     frame = scheduler.make_shared_ion_buffer(FRAME_BYTES);
+    fill_frame(frame);
+
+    cl_wrapper   &latency_wrapper = scheduler.get_wrapper(job_class_t::LATENCY);
+    cl_kernel     downscale       = latency_wrapper.get_kernel(
+            "downscale", latency_wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN));
+    cl_mem_handle latency_frame   = scheduler.make_buffer(job_class_t::LATENCY, CL_MEM_READ_ONLY, frame, FRAME_BYTES);
+    cl_mem_handle preview         = make_device_buffer(latency_wrapper.get_context(), FRAME_BYTES / 4);
+    set_preview_args(downscale, latency_frame.get(), preview.get());
+
+    cl_wrapper   &background_wrapper = scheduler.get_wrapper(job_class_t::BACKGROUND);
+    cl_kernel     analyze            = background_wrapper.get_kernel(
+            "analyze", background_wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN));
+    cl_mem_handle background_frame   = scheduler.make_buffer(job_class_t::BACKGROUND, CL_MEM_READ_ONLY, frame,
+                                                             FRAME_BYTES);
+    cl_mem_handle analysis           = make_device_buffer(background_wrapper.get_context(), FRAME_BYTES);
+    set_analysis_args(analyze, background_frame.get(), analysis.get());
+
+    // Submitting blocks once enough background jobs are waiting, so this doesn't build an unbounded backlog
+    std::atomic<bool> stop(false);
+    std::thread       background([&]()
+    {
+        while (!stop)
+        {
+            scheduler.submit(job_class_t::BACKGROUND, [&](cl_wrapper &wrapper)
+            {
+                wrapper.enqueue_kernel(analyze, 1, &FRAME_ELEMENTS, NULL);
+            });
+        }
+    });
+
+    const auto   start = std::chrono::steady_clock::now();
+    run_result_t result;
+    result.preview_latencies_us = run_preview(frames, [&]()
+    {
+        scheduler.submit(job_class_t::LATENCY, [&](cl_wrapper &wrapper)
+        {
+            wrapper.enqueue_kernel(downscale, 2, PREVIEW_WORK_SIZE, NULL);
+        }).wait();
+    });
+    result.elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    stop = true;
+    background.join();
+    scheduler.wait_idle();
+    result.background_jobs = scheduler.get_stats(job_class_t::BACKGROUND).completed;
+
+    std::cout << "\npriority_scheduler stats:\n";
+    scheduler.write_stats(std::cout);
+    return result;
+}
+
+static void print_result(const char *label, const run_result_t &result)
+{
+    const std::vector<double> &latencies_us = result.preview_latencies_us;
+    std::cout << label << ": preview median " << latencies_us[latencies_us.size() / 2] << " us, p99 "
+              << latencies_us[(latencies_us.size() * 99 - 1) / 100] << " us, max " << latencies_us.back() << " us, "
+              << result.background_jobs / result.elapsed_s << " background jobs/s\n";
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 2 && std::strcmp(argv[1], "--help") == 0)
+    {
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_SUCCESS);
+    }
+    const size_t frames = argc >= 2 ? std::strtoul(argv[1], NULL, 10) : 150;
+    if (frames == 0)
+    {
+        std::cerr << "The number of frames must be positive.\n";
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_FAILURE);
+    }
+
+    const run_result_t alone     = run_on_one_queue(frames, false);
+    const run_result_t one_queue = run_on_one_queue(frames, true);
+    const run_result_t scheduled = run_with_scheduler(frames);
+
+    std::cout << "\n";
+    print_result("Preview alone        ", alone);
+    print_result("One shared queue     ", one_queue);
+    print_result("priority_scheduler   ", scheduled);
+
+    return 0;
+}
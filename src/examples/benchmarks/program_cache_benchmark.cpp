@@ -0,0 +1,139 @@
+//--------------------------------------------------------------------------------------
+// File: program_cache_benchmark.cpp
+// Desc: Compares program build times with a cold and a warm program binary cache
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+// Std includes
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+// Project includes
+#include "util/cl_wrapper.h"
+
+// Library includes
+#include <CL/cl.h>
+
+static const char *HELP_MESSAGE = "\n"
+"Usage: program_cache_benchmark <cache directory> [<kernel source file>]\n"
+"Times the start of an example: setting up OpenCL and building a program,\n"
+"either the given OpenCL C source or a built-in matrix multiplication kernel.\n"
+"This is done three ways: with the program binary cache disabled, with an\n"
+"empty (cold) cache in the given directory, which builds the source and stores\n"
+"the binary, and with the now warm cache, which loads the stored binary.\n"
+"Any cached binaries already in the directory are deleted first.\n";
+
+static const char *DEFAULT_PROGRAM_SOURCE =
+"__kernel void matmul_4x4_blocks(__global const float *matrix_a,\n"
+"                                __global const float *matrix_b,\n"
+"                                __global       float *matrix_c,\n"
+"                                               int    matrix_b_width,\n"
+"                                               int    matrix_a_width)\n"
+"{\n"
+"    const int wid_x = get_global_id(0);\n"
+"    const int wid_y = get_global_id(1);\n"
+"    float4 c[4] = {(float4)(0.0f), (float4)(0.0f), (float4)(0.0f), (float4)(0.0f)};\n"
+"    for (int j = 0; j < matrix_a_width; ++j)\n"
+"    {\n"
+"        const float4 b = vload4(0, matrix_b + j * matrix_b_width + wid_x * 4);\n"
+"#pragma unroll\n"
+"        for (int i = 0; i < 4; ++i)\n"
+"        {\n"
+"            c[i] += b * matrix_a[(wid_y * 4 + i) * matrix_a_width + j];\n"
+"        }\n"
+"    }\n"
+"#pragma unroll\n"
+"    for (int i = 0; i < 4; ++i)\n"
+"    {\n"
+"        vstore4(c[i], 0, matrix_c + (wid_y * 4 + i) * matrix_b_width + wid_x * 4);\n"
+"    }\n"
+"}\n";
+
+struct startup_time_t
+{
+    double setup_ms;
+    double build_ms;
+    size_t cache_hits;
+};
+
+/**
+ * \brief Sets up OpenCL and builds source with the given cache directory, as an example does on startup.
+ */
+static startup_time_t time_startup(const std::string &source, const std::string &cache_dir)
+{
+    cl_wrapper_config_t config = cl_wrapper::get_env_config();
+    config.cache_programs      = false; // Leaves the user's cache directory alone
+
+    const auto start = std::chrono::steady_clock::now();
+    cl_wrapper wrapper(config);
+    wrapper.set_program_cache(cache_dir, program_binary_cache::DEFAULT_MAX_BYTES);
+    const auto built = std::chrono::steady_clock::now();
+
+    const char *program_source[] = {source.c_str()};
+    wrapper.make_program(program_source, 1);
+    const auto end = std::chrono::steady_clock::now();
+
+    startup_time_t result;
+    result.setup_ms   = std::chrono::duration<double, std::milli>(built - start).count();
+    result.build_ms   = std::chrono::duration<double, std::milli>(end - built).count();
+    result.cache_hits = wrapper.get_program_cache().hits();
+    return result;
+}
+
+static void report(const char *name, const startup_time_t &time)
+{
+    std::cout << name << time.setup_ms + time.build_ms << " ms (setup " << time.setup_ms << " ms, program "
+              << time.build_ms << " ms" << (time.cache_hits ? ", loaded from cache" : "") << ")\n";
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Please specify a cache directory.\n";
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_SUCCESS);
+    }
+    const std::string cache_dir(argv[1]);
+
+    std::string source(DEFAULT_PROGRAM_SOURCE);
+    if (argc >= 3)
+    {
+        std::ifstream fin(argv[2]);
+        if (!fin)
+        {
+            std::cerr << "Can't open " << argv[2] << " for reading\n";
+            std::exit(EXIT_FAILURE);
+        }
+        source.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+    }
+
+    program_binary_cache(cache_dir, program_binary_cache::DEFAULT_MAX_BYTES).clear();
+
+    const startup_time_t uncached = time_startup(source, "");
+    const startup_time_t cold     = time_startup(source, cache_dir);
+    const startup_time_t warm     = time_startup(source, cache_dir);
+
+    report("no cache:   ", uncached);
+    report("cold cache: ", cold);
+    report("warm cache: ", warm);
+    if (warm.cache_hits == 0)
+    {
+        std::cout << "The warm run missed the cache; the driver may not support program binaries.\n";
+    }
+    else
+    {
+        std::cout << "The warm cache builds the program " << cold.build_ms / warm.build_ms << " times faster\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,313 @@
+//--------------------------------------------------------------------------------------
+// File: specialization_benchmark.cpp
+// Desc: Compares generic kernels with kernels built for fixed problem sizes
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+// Std includes
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Project includes
+#include "examples/fft/fft_matrix_kernels.h"
+#include "examples/linear_algebra/matrix_multiplication_kernels.h"
+#include "util/cl_handles.h"
+#include "util/cl_wrapper.h"
+
+// Library includes
+#include <CL/cl.h>
+
+static const char *HELP_MESSAGE = "\n"
+"Usage: specialization_benchmark [<fft size> [<matrix size> [<iterations>]]]\n"
+"Runs the kernels of fft_matrix on a random <fft size> x <fft size> matrix\n"
+"(default 1024, a power of 2) and the tiled kernel of\n"
+"buffer_matrix_multiplication on random <matrix size> x <matrix size> matrices\n"
+"(default 1024, a multiple of 8), each built twice: generically, taking the\n"
+"sizes as kernel arguments, and specialized, with the sizes passed to\n"
+"make_program as defines. Reports the build time and the mean time of\n"
+"<iterations> runs (default 20) of each, and checks that the results agree.\n"
+"The program binary cache is disabled, so both variants are compiled.\n";
+
+struct variant_time_t
+{
+    double build_ms;
+    double run_ms;
+};
+
+static void set_kernel_arg(cl_kernel kernel, cl_uint index, size_t size, const void *value)
+{
+    const cl_int err = clSetKernelArg(kernel, index, size, value);
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clSetKernelArg for argument " << index << ".\n";
+        std::exit(err);
+    }
+}
+
+static cl_mem_handle make_buffer(cl_context context, cl_mem_flags flags, size_t size, void *host_ptr)
+{
+    cl_int        err = CL_SUCCESS;
+    cl_mem_handle mem(clCreateBuffer(context, flags, size, host_ptr, &err));
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clCreateBuffer.\n";
+        std::exit(err);
+    }
+    return mem;
+}
+
+static std::vector<cl_float> read_buffer(cl_command_queue command_queue, cl_mem mem, size_t count)
+{
+    std::vector<cl_float> result(count);
+    const cl_int err = clEnqueueReadBuffer(command_queue, mem, CL_TRUE, 0, count * sizeof(cl_float), result.data(),
+                                           0, NULL, NULL);
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clEnqueueReadBuffer.\n";
+        std::exit(err);
+    }
+    return result;
+}
+
+/**
+ * \brief Runs enqueue once to warm up, then times iterations runs of it.
+ * @return The mean time of a run in milliseconds.
+ */
+static double mean_run_ms(cl_command_queue command_queue, size_t iterations, const std::function<void()> &enqueue)
+{
+    enqueue();
+    clFinish(command_queue);
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        enqueue();
+    }
+    clFinish(command_queue);
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+static double max_difference(const std::vector<cl_float> &a, const std::vector<cl_float> &b)
+{
+    double result = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        result = std::max(result, static_cast<double>(std::fabs(a[i] - b[i])));
+    }
+    return result;
+}
+
+static void report(const char *name, const variant_time_t &generic, const variant_time_t &specialized)
+{
+    std::cout << name << "\n"
+              << "    generic:     build " << generic.build_ms << " ms, run " << generic.run_ms << " ms\n"
+              << "    specialized: build " << specialized.build_ms << " ms, run " << specialized.run_ms << " ms ("
+              << generic.run_ms / specialized.run_ms << " times as fast)\n";
+}
+
+/**
+ * \brief Builds the FFT program with the given defines and times the row and column passes.
+ */
+static variant_time_t time_fft(cl_wrapper &wrapper, const program_defines_t &defines, cl_int width, cl_mem src,
+                               cl_mem row_pass_result, cl_mem real_out, cl_mem imag_out, size_t iterations)
+{
+    const auto   start   = std::chrono::steady_clock::now();
+    cl_program   program = wrapper.make_program(FFT_MATRIX_PROGRAM_SOURCE, FFT_MATRIX_PROGRAM_SOURCE_LEN, "", defines);
+    const auto   built   = std::chrono::steady_clock::now();
+    cl_kernel    row_pass = wrapper.get_kernel("fft_row_pass", program);
+    cl_kernel    col_pass = wrapper.get_kernel("fft_col_pass", program);
+    const cl_int log_w    = static_cast<cl_int>(std::log2(width));
+
+    set_kernel_arg(row_pass, 0, sizeof(src), &src);
+    set_kernel_arg(row_pass, 1, sizeof(row_pass_result), &row_pass_result);
+    set_kernel_arg(row_pass, 2, sizeof(width), &width);
+    set_kernel_arg(row_pass, 3, sizeof(log_w), &log_w);
+    set_kernel_arg(row_pass, 4, sizeof(cl_float2) * width, NULL);
+    set_kernel_arg(col_pass, 0, sizeof(row_pass_result), &row_pass_result);
+    set_kernel_arg(col_pass, 1, sizeof(real_out), &real_out);
+    set_kernel_arg(col_pass, 2, sizeof(imag_out), &imag_out);
+    set_kernel_arg(col_pass, 3, sizeof(width), &width);
+    set_kernel_arg(col_pass, 4, sizeof(log_w), &log_w);
+    set_kernel_arg(col_pass, 5, sizeof(cl_float2) * width, NULL);
+
+    const size_t global_work_size[]         = {static_cast<size_t>(width / 2), static_cast<size_t>(width)};
+    const size_t row_pass_local_work_size[] = {std::min(global_work_size[0], wrapper.get_max_workgroup_size(row_pass)), 1};
+    const size_t col_pass_local_work_size[] = {std::min(global_work_size[0], wrapper.get_max_workgroup_size(col_pass)), 1};
+
+    cl_command_queue command_queue = wrapper.get_command_queue();
+    variant_time_t   result;
+    result.build_ms = std::chrono::duration<double, std::milli>(built - start).count();
+    result.run_ms   = mean_run_ms(command_queue, iterations, [&]()
+    {
+        wrapper.enqueue_kernel(row_pass, 2, global_work_size, row_pass_local_work_size);
+        wrapper.enqueue_kernel(col_pass, 2, global_work_size, col_pass_local_work_size);
+    });
+    return result;
+}
+
+/**
+ * \brief Builds the matrix multiplication program with the given defines and times the tiled kernel.
+ */
+static variant_time_t time_matmul(cl_wrapper &wrapper, const program_defines_t &defines, cl_int width, cl_mem matrix_a,
+                                  cl_mem matrix_b, cl_mem matrix_c, size_t iterations)
+{
+    const auto start   = std::chrono::steady_clock::now();
+    cl_program program = wrapper.make_program(MATRIX_MULTIPLICATION_PROGRAM_SOURCE,
+                                              MATRIX_MULTIPLICATION_PROGRAM_SOURCE_LEN, "", defines);
+    const auto built   = std::chrono::steady_clock::now();
+    cl_kernel  kernel  = wrapper.get_kernel("matmul_8x4_blocks", program);
+
+    set_kernel_arg(kernel, 0, sizeof(matrix_a), &matrix_a);
+    set_kernel_arg(kernel, 1, sizeof(matrix_b), &matrix_b);
+    set_kernel_arg(kernel, 2, sizeof(matrix_c), &matrix_c);
+    set_kernel_arg(kernel, 3, sizeof(width), &width);
+    set_kernel_arg(kernel, 4, sizeof(width), &width);
+
+    const size_t     global_work_size[] = {static_cast<size_t>(width / 4), static_cast<size_t>(width / 8)};
+    cl_command_queue command_queue      = wrapper.get_command_queue();
+    variant_time_t   result;
+    result.build_ms = std::chrono::duration<double, std::milli>(built - start).count();
+    result.run_ms   = mean_run_ms(command_queue, iterations, [&]()
+    {
+        wrapper.enqueue_kernel(kernel, 2, global_work_size, NULL);
+    });
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 2 && std::strcmp(argv[1], "--help") == 0)
+    {
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_SUCCESS);
+    }
+    const cl_int fft_width    = argc >= 2 ? std::atoi(argv[1]) : 1024;
+    const cl_int matrix_width = argc >= 3 ? std::atoi(argv[2]) : 1024;
+    const size_t iterations   = argc >= 4 ? std::strtoul(argv[3], NULL, 10) : 20;
+    if (fft_width < 2 || (fft_width & (fft_width - 1)) != 0)
+    {
+        std::cerr << "The FFT size must be a power of 2.\n";
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_FAILURE);
+    }
+    if (matrix_width < 8 || matrix_width % 8 != 0)
+    {
+        std::cerr << "The matrix size must be a positive multiple of 8.\n";
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_FAILURE);
+    }
+    if (iterations == 0)
+    {
+        std::cerr << "The number of iterations must be positive.\n";
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::mt19937                          rng(1);
+    std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+    const auto random_values = [&](size_t count)
+    {
+        std::vector<cl_float> values(count);
+        for (auto &value : values)
+        {
+            value = distribution(rng);
+        }
+        return values;
+    };
+
+    cl_wrapper_config_t config = cl_wrapper::get_env_config();
+    config.cache_programs      = false; // So that the build times are those of compiling from source
+
+    cl_wrapper       wrapper(config);
+    cl_context       context       = wrapper.get_context();
+    cl_command_queue command_queue = wrapper.get_command_queue();
+
+    /*
+     * FFT, with the width and its log fixed.
+     */
+
+    const size_t          fft_count = static_cast<size_t>(fft_width) * fft_width;
+    std::vector<cl_float> fft_src   = random_values(fft_count);
+    cl_mem_handle fft_src_mem  = make_buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                             fft_count * sizeof(cl_float), fft_src.data());
+    cl_mem_handle row_pass_mem = make_buffer(context, CL_MEM_READ_WRITE, fft_count * sizeof(cl_float2), NULL);
+    cl_mem_handle real_mem     = make_buffer(context, CL_MEM_WRITE_ONLY, fft_count * sizeof(cl_float), NULL);
+    cl_mem_handle imag_mem     = make_buffer(context, CL_MEM_WRITE_ONLY, fft_count * sizeof(cl_float), NULL);
+
+    const program_defines_t fft_defines = {
+        {"FFT_WIDTH", std::to_string(fft_width)},
+        {"FFT_LOG_W", std::to_string(static_cast<int>(std::log2(fft_width)))},
+    };
+    const variant_time_t fft_generic = time_fft(wrapper, program_defines_t(), fft_width, fft_src_mem.get(),
+                                                row_pass_mem.get(), real_mem.get(), imag_mem.get(), iterations);
+    const std::vector<cl_float> generic_real = read_buffer(command_queue, real_mem.get(), fft_count);
+    const std::vector<cl_float> generic_imag = read_buffer(command_queue, imag_mem.get(), fft_count);
+    const variant_time_t fft_specialized = time_fft(wrapper, fft_defines, fft_width, fft_src_mem.get(),
+                                                    row_pass_mem.get(), real_mem.get(), imag_mem.get(), iterations);
+    const std::vector<cl_float> specialized_real = read_buffer(command_queue, real_mem.get(), fft_count);
+    const std::vector<cl_float> specialized_imag = read_buffer(command_queue, imag_mem.get(), fft_count);
+    const double fft_difference = std::max(max_difference(generic_real, specialized_real),
+                                           max_difference(generic_imag, specialized_imag));
+
+    /*
+     * Matrix multiplication, with the widths of both matrices fixed.
+     */
+
+    const size_t          matrix_count = static_cast<size_t>(matrix_width) * matrix_width;
+    std::vector<cl_float> matrix_a     = random_values(matrix_count);
+    std::vector<cl_float> matrix_b     = random_values(matrix_count);
+    cl_mem_handle matrix_a_mem = make_buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                             matrix_count * sizeof(cl_float), matrix_a.data());
+    cl_mem_handle matrix_b_mem = make_buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                             matrix_count * sizeof(cl_float), matrix_b.data());
+    cl_mem_handle matrix_c_mem = make_buffer(context, CL_MEM_WRITE_ONLY, matrix_count * sizeof(cl_float), NULL);
+
+    const program_defines_t matrix_defines = {
+        {"FIXED_MATRIX_A_WIDTH", std::to_string(matrix_width)},
+        {"FIXED_MATRIX_B_WIDTH", std::to_string(matrix_width)},
+    };
+    const variant_time_t matmul_generic = time_matmul(wrapper, program_defines_t(), matrix_width, matrix_a_mem.get(),
+                                                      matrix_b_mem.get(), matrix_c_mem.get(), iterations);
+    const std::vector<cl_float> generic_c = read_buffer(command_queue, matrix_c_mem.get(), matrix_count);
+    const variant_time_t matmul_specialized = time_matmul(wrapper, matrix_defines, matrix_width, matrix_a_mem.get(),
+                                                          matrix_b_mem.get(), matrix_c_mem.get(), iterations);
+    const std::vector<cl_float> specialized_c = read_buffer(command_queue, matrix_c_mem.get(), matrix_count);
+    const double matmul_difference = max_difference(generic_c, specialized_c);
+
+    report("fft_matrix:", fft_generic, fft_specialized);
+    std::cout << "    largest difference in the results: " << fft_difference << "\n";
+    report("buffer_matrix_multiplication:", matmul_generic, matmul_specialized);
+    std::cout << "    largest difference in the results: " << matmul_difference << "\n";
+
+    // Building again with the same defines must reuse the program rather than compile it again
+    const cl_program first  = wrapper.make_program(MATRIX_MULTIPLICATION_PROGRAM_SOURCE,
+                                                   MATRIX_MULTIPLICATION_PROGRAM_SOURCE_LEN, "", matrix_defines);
+    const cl_program second = wrapper.make_program(MATRIX_MULTIPLICATION_PROGRAM_SOURCE,
+                                                   MATRIX_MULTIPLICATION_PROGRAM_SOURCE_LEN, "", matrix_defines);
+    if (first != second)
+    {
+        std::cerr << "make_program built the same specialization twice\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    // Both variants do the same arithmetic in the same order, up to contraction into FMAs
+    if (fft_difference > 1e-3 * fft_width || matmul_difference > 1e-3 * matrix_width)
+    {
+        std::cerr << "The specialized kernels give different results from the generic ones\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    return 0;
+}
@@ -0,0 +1,122 @@
+//--------------------------------------------------------------------------------------
+// File: frame_container_tool.cpp
+// Desc: Packs single-frame image data files into a frame container and back
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+// Std includes
+#include <cstdlib>
+#include <iostream>
+
+// Project includes
+#include "util/util.h"
+
+// Library includes
+#include <CL/cl.h>
+#include <CL/cl_ext_qcom.h>
+
+static const char *HELP_MESSAGE = "\n"
+"Usage: frame_container_tool pack <format> <container> <frame file> [<frame file> ...]\n"
+"       frame_container_tool unpack <format> <container> <output prefix>\n"
+"       frame_container_tool info <container>\n"
+"pack appends image data files to a frame container, creating it if needed.\n"
+"unpack writes each frame of a container to <output prefix><index>.dat.\n"
+"info prints the size, format and frame count of a container.\n"
+"<format> is one of nv12, p010 or tp10. See README.md for the container format.\n";
+
+struct frame_format_t
+{
+    const char      *name;
+    cl_channel_type  data_type;
+    cl_channel_order order;
+};
+
+static const frame_format_t FRAME_FORMATS[] = {
+    {"nv12", CL_UNORM_INT8,       CL_QCOM_NV12},
+    {"p010", CL_QCOM_UNORM_INT10, CL_QCOM_P010},
+    {"tp10", CL_QCOM_UNORM_INT10, CL_QCOM_TP10},
+};
+
+static const frame_format_t &find_format(const std::string &name)
+{
+    for (const auto &format : FRAME_FORMATS)
+    {
+        if (name == format.name)
+        {
+            return format;
+        }
+    }
+    std::cerr << "Unknown format \"" << name << "\".\n";
+    std::cerr << HELP_MESSAGE;
+    std::exit(EXIT_FAILURE);
+}
+
+static yuv_image_t load_frame_file(const frame_format_t &format, const std::string &filename)
+{
+    switch (format.order)
+    {
+        case CL_QCOM_NV12: return load_nv12_image_data(filename);
+        case CL_QCOM_P010: return load_p010_image_data(filename);
+        default:           return load_tp10_image_data(filename);
+    }
+}
+
+static void save_frame_file(const frame_format_t &format, const frame_container &container, size_t index,
+                            const std::string &filename)
+{
+    switch (format.order)
+    {
+        case CL_QCOM_NV12: save_nv12_image_data(filename, load_nv12_frame(container, index)); break;
+        case CL_QCOM_P010: save_p010_image_data(filename, load_p010_frame(container, index)); break;
+        default:           save_tp10_image_data(filename, load_tp10_frame(container, index)); break;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::string command(argc >= 2 ? argv[1] : "");
+    if (command == "info" && argc >= 3)
+    {
+        const frame_container container(argv[2]);
+        std::cout << container.width() << "x" << container.height()
+                  << ", order 0x" << std::hex << container.order()
+                  << ", data type 0x" << container.data_type() << std::dec
+                  << ", " << container.num_frames() << " frames\n";
+    }
+    else if (command == "pack" && argc >= 5)
+    {
+        const frame_format_t   &format = find_format(argv[2]);
+        const yuv_image_t       first  = load_frame_file(format, argv[4]);
+        frame_container_writer  writer(argv[3], first.y_width, first.y_height, format.data_type, format.order);
+        writer.append_frame(first);
+        for (int i = 5; i < argc; ++i)
+        {
+            writer.append_frame(load_frame_file(format, argv[i]));
+        }
+        writer.close();
+        std::cout << argv[3] << " now holds " << writer.num_frames() << " frames\n";
+    }
+    else if (command == "unpack" && argc >= 5)
+    {
+        const frame_format_t &format = find_format(argv[2]);
+        const frame_container container(argv[3]);
+        const std::string     prefix(argv[4]);
+        for (size_t i = 0; i < container.num_frames(); ++i)
+        {
+            save_frame_file(format, container, i, prefix + std::to_string(i) + ".dat");
+        }
+    }
+    else
+    {
+        std::cerr << "Please specify a command and its arguments.\n";
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_SUCCESS);
+    }
+
+    return 0;
+}
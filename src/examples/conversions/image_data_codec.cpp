@@ -0,0 +1,128 @@
+//--------------------------------------------------------------------------------------
+// File: image_data_codec.cpp
+// Desc: Compresses and decompresses image data files
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+// Std includes
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// Project includes
+#include "util/util.h"
+
+// Library includes
+#include <CL/cl.h>
+#include <CL/cl_ext_qcom.h>
+
+static const char *HELP_MESSAGE = "\n"
+"Usage: image_data_codec compress <format> <input image data> <output image data>\n"
+"       image_data_codec decompress <format> <input image data> <output image data>\n"
+"compress losslessly compresses an image data file as described in README.md,\n"
+"then reports the compression ratio and how fast the output decompresses.\n"
+"decompress writes the plain image data file back. Either command accepts a\n"
+"compressed or a plain input file.\n"
+"<format> is one of nv12, p010, tp10 or mipi10.\n";
+
+struct image_format_t
+{
+    const char      *name;
+    cl_channel_type  data_type;
+    cl_channel_order order;
+};
+
+static const image_format_t IMAGE_FORMATS[] = {
+    {"nv12",   CL_UNORM_INT8,         CL_QCOM_NV12},
+    {"p010",   CL_QCOM_UNORM_INT10,   CL_QCOM_P010},
+    {"tp10",   CL_QCOM_UNORM_INT10,   CL_QCOM_TP10},
+    {"mipi10", CL_QCOM_UNORM_MIPI10,  CL_QCOM_BAYER},
+};
+
+static const image_format_t &find_format(const std::string &name)
+{
+    for (const auto &format : IMAGE_FORMATS)
+    {
+        if (name == format.name)
+        {
+            return format;
+        }
+    }
+    std::cerr << "Unknown format \"" << name << "\".\n";
+    std::cerr << HELP_MESSAGE;
+    std::exit(EXIT_FAILURE);
+}
+
+static size_t get_file_size(const std::string &filename)
+{
+    std::ifstream fin(filename, std::ios::binary | std::ios::ate);
+    return fin ? static_cast<size_t>(fin.tellg()) : 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 5)
+    {
+        std::cerr << "Please specify a command, the format and input and output files.\n";
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_SUCCESS);
+    }
+
+    const std::string     command(argv[1]);
+    const image_format_t &format = find_format(argv[2]);
+    const std::string     input_filename(argv[3]);
+    const std::string     output_filename(argv[4]);
+    if (command != "compress" && command != "decompress")
+    {
+        std::cerr << "Unknown command \"" << command << "\".\n";
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_FAILURE);
+    }
+
+    const image_layout_t       layout = read_image_data_layout(input_filename, format.data_type, format.order);
+    std::vector<unsigned char> planes[2];
+    pitched_planes_t           pitched = {{NULL, NULL}, {0, 0}};
+    for (uint32_t plane = 0; plane < layout.num_planes; ++plane)
+    {
+        planes[plane].resize(layout.plane_bytes(plane));
+        pitched.data[plane]      = planes[plane].data();
+        pitched.row_pitch[plane] = layout.row_bytes[plane];
+    }
+    load_image_data(input_filename, format.data_type, format.order, pitched);
+
+    if (command == "decompress")
+    {
+        save_image_data(output_filename, layout.width, layout.height, format.data_type, format.order, pitched);
+        return 0;
+    }
+
+    save_compressed_image_data(output_filename, layout.width, layout.height, format.data_type, format.order,
+                               pitched);
+
+    // Best of a few runs, with the file in the page cache, so only decoding is measured
+    double best_s = 0;
+    for (int i = 0; i < 5; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        load_image_data(output_filename, format.data_type, format.order, pitched);
+        const double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best_s = i == 0 ? elapsed_s : std::min(best_s, elapsed_s);
+    }
+
+    const size_t pixel_bytes      = layout.plane_bytes(0) + layout.plane_bytes(1);
+    const size_t compressed_bytes = get_file_size(output_filename);
+    std::cout << input_filename << ": " << get_file_size(input_filename) << " bytes\n";
+    std::cout << output_filename << ": " << compressed_bytes << " bytes, ratio "
+              << static_cast<double>(pixel_bytes) / compressed_bytes << "\n";
+    std::cout << "decompresses at " << pixel_bytes / best_s / 1e6 << " MB/s of pixel data\n";
+
+    return 0;
+}
@@ -14,7 +14,11 @@
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <string>
+#include <vector>
 // Project includes
+#include "util/async_image_loader.h"
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 #include "util/util.h"
 // Library includes
@@ -48,22 +52,31 @@ static const cl_uint PROGRAM_SOURCE_LEN = sizeof(PROGRAM_SOURCE) / sizeof(const
 
 int main(int argc, char** argv)
 {
-    if (argc < 3)
+    if (argc < 3 || argc % 2 == 0)
     {
-        std::cerr << "Usage: " << argv[0] << " <img data file> <out img data file> \n"
+        std::cerr << "Usage: " << argv[0] << " <img data file> <out img data file> [<img data file> <out img data file> ...]\n"
                   << "Input image file data should be in format CL_QCOM_NV12 / CL_UNORM_INT8\n"
-                  << "Demonstrates conversions from NV12 to RGBA8888\n";
+                  << "Demonstrates conversions from NV12 to RGBA8888. Given several pairs of files, which must all be\n"
+                  << "the same size, the next input is loaded in the background while the GPU converts the current one.\n";
         return 0;
     }
 
-    const std::string src_image_filename(argv[1]);
-    const std::string out_image_filename(argv[2]);
+    std::vector<std::string> src_image_filenames;
+    std::vector<std::string> out_image_filenames;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        src_image_filenames.push_back(argv[i]);
+        out_image_filenames.push_back(argv[i + 1]);
+    }
 
     cl_wrapper wrapper;
     cl_program   program             = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
-    cl_kernel    nv12_to_rgb_kernel  = wrapper.make_kernel("nv12_to_rgb", program);
+    cl_kernel    nv12_to_rgb_kernel  = wrapper.get_kernel("nv12_to_rgb", program);
     cl_context   context             = wrapper.get_context();
-    nv12_image_t src_nv12_image_info = load_nv12_image_data(src_image_filename);
+    nv12_image_t src_nv12_image_info;
+    // Later inputs are loaded in the background while the GPU converts earlier ones
+    async_image_loader<nv12_image_t> src_loader(src_image_filenames, load_nv12_image_data);
+    src_loader.next(src_nv12_image_info);
     /*
      * Step 0: Confirm the required OpenCL extensions are supported.
      */
@@ -112,15 +125,15 @@ int main(int argc, char** argv)
     src_nv12_desc.image_height = src_nv12_image_info.y_height;
 
     cl_int err = 0;
-    cl_mem_ion_host_ptr src_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_nv12_format, src_nv12_desc);
-    cl_mem src_nv12_image = clCreateImage(
+    ion_allocation src_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_nv12_format, src_nv12_desc);
+    cl_mem_handle src_nv12_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &src_nv12_format,
             &src_nv12_desc,
-            &src_nv12_ion_mem,
+            src_nv12_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image." << "\n";
@@ -138,15 +151,15 @@ int main(int argc, char** argv)
     out_rgba_desc.image_height           = src_nv12_image_info.y_height;
     const size_t img_row_pitch           = wrapper.get_ion_image_row_pitch(out_rgba_format, out_rgba_desc);
     out_rgba_desc.image_row_pitch        = img_row_pitch;
-    cl_mem_ion_host_ptr out_rgba_ion_mem = wrapper.make_ion_buffer_for_nonplanar_image(out_rgba_format, out_rgba_desc);
-    cl_mem out_rgba_image = clCreateImage(
+    ion_allocation out_rgba_ion_mem = wrapper.make_ion_buffer_for_nonplanar_image(out_rgba_format, out_rgba_desc);
+    cl_mem_handle out_rgba_image(clCreateImage(
             context,
             CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &out_rgba_format,
             &out_rgba_desc,
-            &out_rgba_ion_mem,
+            out_rgba_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for output RGB image." << "\n";
@@ -164,16 +177,16 @@ int main(int argc, char** argv)
     src_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     src_y_plane_desc.image_width  = src_nv12_desc.image_width;
     src_y_plane_desc.image_height = src_nv12_desc.image_height;
-    src_y_plane_desc.mem_object   = src_nv12_image;
+    src_y_plane_desc.mem_object   = src_nv12_image.get();
 
-    cl_mem src_y_plane = clCreateImage(
+    cl_mem_handle src_y_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_y_plane_format,
             &src_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image y plane." << "\n";
@@ -191,215 +204,209 @@ int main(int argc, char** argv)
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
     src_uv_plane_desc.image_width  = src_nv12_image_info.y_width;
     src_uv_plane_desc.image_height = src_nv12_image_info.y_height;
-    src_uv_plane_desc.mem_object   = src_nv12_image;
+    src_uv_plane_desc.mem_object   = src_nv12_image.get();
 
-    cl_mem src_uv_plane = clCreateImage(
+    cl_mem_handle src_uv_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_uv_plane_format,
             &src_uv_plane_desc,
             NULL,
             &err
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " with clCreateImage for source image uv plane." << "\n";
-        std::exit(err);
-    }
-    /*
-     * Step 3: Copy data to input image planes. Note that for linear NV12 images you must observe row alignment
-     * restrictions. (You may also write to the ion buffer directly if you prefer, however using clEnqueueMapImage for
-     * a child planar image will return the correct host pointer for the desired plane.)
-     */
-    cl_command_queue command_queue  = wrapper.get_command_queue();
-    const size_t     origin[]       = {0, 0, 0};
-    const size_t     src_y_region[] = {src_y_plane_desc.image_width, src_y_plane_desc.image_height, 1};
-    size_t           row_pitch      = 0;
-    unsigned char   *image_ptr      = reinterpret_cast<unsigned char *>(clEnqueueMapImage(
-            command_queue,
-            src_y_plane,
-            CL_TRUE,
-            CL_MAP_WRITE,
-            origin,
-            src_y_region,
-            &row_pitch,
-            NULL,
-            0,
-            NULL,
-            NULL,
-            &err
     ));
     if (err != CL_SUCCESS)
     {
-        std::cerr << "Error " << err << " mapping source image y-plane buffer for writing." << "\n";
-        std::exit(err);
-    }
-    // Copies image data to the ION buffer from the host
-    for (uint32_t i = 0; i < src_y_plane_desc.image_height; ++i)
-    {
-        std::memcpy(
-                image_ptr                          + i * row_pitch,
-                src_nv12_image_info.y_plane.data() + i * src_y_plane_desc.image_width,
-                src_y_plane_desc.image_width
-        );
-    }
-
-    err = clEnqueueUnmapMemObject(command_queue, src_y_plane, image_ptr, 0, NULL, NULL);
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " unmapping source image y-plane data buffer." << "\n";
-        std::exit(err);
-    }
-    // Note the discrepancy between the child plane image descriptor and the size required by clEnqueueMapImage.
-    const size_t src_uv_region[] = {src_uv_plane_desc.image_width / 2, src_uv_plane_desc.image_height / 2, 1};
-    row_pitch                    = 0;
-    image_ptr = reinterpret_cast<unsigned char *>(clEnqueueMapImage(
-            command_queue,
-            src_uv_plane,
-            CL_TRUE,
-            CL_MAP_WRITE,
-            origin,
-            src_uv_region,
-            &row_pitch,
-            NULL,
-            0,
-            NULL,
-            NULL,
-            &err
-    ));
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " mapping source image uv-plane buffer for writing." << "\n";
-        std::exit(err);
-    }
-    // Copies image data to the ION buffer from the host
-    for (uint32_t i = 0; i < src_uv_plane_desc.image_height / 2; ++i)
-    {
-        std::memcpy(
-                image_ptr                           + i * row_pitch,
-                src_nv12_image_info.uv_plane.data() + i * src_uv_plane_desc.image_width,
-                src_uv_plane_desc.image_width
-        );
-    }
-
-    err = clEnqueueUnmapMemObject(command_queue, src_uv_plane, image_ptr, 0, NULL, NULL);
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " unmapping source image uv-plane data buffer." << "\n";
+        std::cerr << "Error " << err << " with clCreateImage for source image uv plane." << "\n";
         std::exit(err);
     }
     /*
-     * Step 4: Set up other kernel arguments
+     * Step 3: Set up the kernel arguments, which are the same for every frame
      */
-    cl_sampler sampler = clCreateSampler(
+    cl_sampler_handle sampler(clCreateSampler(
             context,
             CL_FALSE,
             CL_ADDRESS_CLAMP_TO_EDGE,
             CL_FILTER_NEAREST,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateSampler." << "\n";
         std::exit(err);
     }
-    /*
-     * Step 5: Run the kernel for both y- and uv-planes
-     */
-    err = clSetKernelArg(nv12_to_rgb_kernel, 0, sizeof(src_nv12_image), &src_nv12_image);
+
+    err = clSetKernelArg(nv12_to_rgb_kernel, 0, sizeof(cl_mem), src_nv12_image.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "\tError " << err << " with clSetKernelArg for argument 0 for nv12_to_rgb_kernel kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(nv12_to_rgb_kernel, 1, sizeof(out_rgba_image), &out_rgba_image);
+    err = clSetKernelArg(nv12_to_rgb_kernel, 1, sizeof(cl_mem), out_rgba_image.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "\tError " << err << " with clSetKernelArg for argument 1 for nv12_to_rgb_kernel kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(nv12_to_rgb_kernel, 2, sizeof(sampler), &sampler);
+    err = clSetKernelArg(nv12_to_rgb_kernel, 2, sizeof(cl_sampler), sampler.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "\tError " << err << " with clSetKernelArg for argument 2 for nv12_to_rgb_kernel kernel." << "\n";
         std::exit(err);
     }
 
-    const size_t work_size[] = {out_rgba_desc.image_width,out_rgba_desc.image_height};
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            nv12_to_rgb_kernel,
-            2,
-            NULL,
-            work_size,
-            NULL,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
+    cl_command_queue command_queue = wrapper.get_command_queue();
+    const size_t     origin[]      = {0, 0, 0};
+    size_t           frame         = 0;
+    do
     {
-        std::cerr << "\tError " << err << " with clEnqueueNDRangeKernel for nv12_to_rgb_kernel kernel." << "\n";
-        std::exit(err);
-    }
+        if (src_nv12_image_info.y_width != src_nv12_desc.image_width
+            || src_nv12_image_info.y_height != src_nv12_desc.image_height)
+        {
+            std::cerr << src_image_filenames[frame] << " is " << src_nv12_image_info.y_width << "x"
+                      << src_nv12_image_info.y_height << ", but every input must be the same size as the first, "
+                      << src_nv12_desc.image_width << "x" << src_nv12_desc.image_height << ".\n";
+            std::exit(EXIT_FAILURE);
+        }
 
-    clFinish(command_queue);
-    /*
-     * Step 6: Copy the data out of the ion buffer for each plane.
-     */
-    rgba_image_t out_rgba_image_info;
-    out_rgba_image_info.width  = out_rgba_desc.image_width;
-    out_rgba_image_info.height = out_rgba_desc.image_height;
-    out_rgba_image_info.pixels.resize(out_rgba_desc.image_width * out_rgba_image_info.height * 4);
+        /*
+         * Step 4: Copy data to input image planes. Note that for linear NV12 images you must observe row
+         * alignment restrictions. (You may also write to the ion buffer directly if you prefer, however using
+         * clEnqueueMapImage for a child planar image will return the correct host pointer for the desired plane.)
+         */
+        const size_t   src_y_region[] = {src_y_plane_desc.image_width, src_y_plane_desc.image_height, 1};
+        size_t         row_pitch      = 0;
+        unsigned char *image_ptr      = reinterpret_cast<unsigned char *>(clEnqueueMapImage(
+                command_queue,
+                src_y_plane.get(),
+                CL_TRUE,
+                CL_MAP_WRITE,
+                origin,
+                src_y_region,
+                &row_pitch,
+                NULL,
+                0,
+                NULL,
+                NULL,
+                &err
+        ));
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error " << err << " mapping source image y-plane buffer for writing." << "\n";
+            std::exit(err);
+        }
+        // Copies image data to the ION buffer from the host
+        for (uint32_t i = 0; i < src_y_plane_desc.image_height; ++i)
+        {
+            std::memcpy(
+                    image_ptr                          + i * row_pitch,
+                    src_nv12_image_info.y_plane.data() + i * src_y_plane_desc.image_width,
+                    src_y_plane_desc.image_width
+            );
+        }
 
-    const size_t out_rgb_region[] = {out_rgba_desc.image_width, out_rgba_desc.image_height, 1};
-    row_pitch                     = 0;
-    image_ptr = reinterpret_cast<unsigned char *>(clEnqueueMapImage(
-            command_queue,
-            out_rgba_image,
-            CL_TRUE,
-            CL_MAP_READ,
-            origin,
-            out_rgb_region,
-            &row_pitch,
-            NULL,
-            0,
-            NULL,
-            NULL,
-            &err
-    ));
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " mapping dest image y-plane buffer for reading." << "\n";
-        std::exit(err);
-    }
-    // Copies image data from the ION buffer to the host
-    for (uint32_t i = 0; i < out_rgba_desc.image_height; ++i)
-    {
-        std::memcpy(
-                out_rgba_image_info.pixels.data() + i * out_rgba_desc.image_width * 4,
-                image_ptr                         + i * row_pitch,
-                out_rgba_desc.image_width * 4
-        );
-    }
+        err = clEnqueueUnmapMemObject(command_queue, src_y_plane.get(), image_ptr, 0, NULL, NULL);
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error " << err << " unmapping source image y-plane data buffer." << "\n";
+            std::exit(err);
+        }
+        // Note the discrepancy between the child plane image descriptor and the size required by clEnqueueMapImage.
+        const size_t src_uv_region[] = {src_uv_plane_desc.image_width / 2, src_uv_plane_desc.image_height / 2, 1};
+        row_pitch                    = 0;
+        image_ptr = reinterpret_cast<unsigned char *>(clEnqueueMapImage(
+                command_queue,
+                src_uv_plane.get(),
+                CL_TRUE,
+                CL_MAP_WRITE,
+                origin,
+                src_uv_region,
+                &row_pitch,
+                NULL,
+                0,
+                NULL,
+                NULL,
+                &err
+        ));
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error " << err << " mapping source image uv-plane buffer for writing." << "\n";
+            std::exit(err);
+        }
+        // Copies image data to the ION buffer from the host
+        for (uint32_t i = 0; i < src_uv_plane_desc.image_height / 2; ++i)
+        {
+            std::memcpy(
+                    image_ptr                           + i * row_pitch,
+                    src_nv12_image_info.uv_plane.data() + i * src_uv_plane_desc.image_width,
+                    src_uv_plane_desc.image_width
+            );
+        }
 
-    err = clEnqueueUnmapMemObject(command_queue, out_rgba_image, image_ptr, 0, NULL, NULL);
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " unmapping dest image out_rgba_image buffer." << "\n";
-        std::exit(err);
-    }
+        err = clEnqueueUnmapMemObject(command_queue, src_uv_plane.get(), image_ptr, 0, NULL, NULL);
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error " << err << " unmapping source image uv-plane data buffer." << "\n";
+            std::exit(err);
+        }
+        /*
+         * Step 5: Run the kernel for both y- and uv-planes
+         */
+        const size_t work_size[] = {out_rgba_desc.image_width,out_rgba_desc.image_height};
+        wrapper.enqueue_kernel(nv12_to_rgb_kernel, 2, work_size, NULL);
+
+        clFinish(command_queue);
+        /*
+         * Step 6: Copy the data out of the ion buffer for each plane.
+         */
+        rgba_image_t out_rgba_image_info;
+        out_rgba_image_info.width  = out_rgba_desc.image_width;
+        out_rgba_image_info.height = out_rgba_desc.image_height;
+        out_rgba_image_info.pixels.resize(out_rgba_desc.image_width * out_rgba_image_info.height * 4);
+
+        const size_t out_rgb_region[] = {out_rgba_desc.image_width, out_rgba_desc.image_height, 1};
+        row_pitch                     = 0;
+        image_ptr = reinterpret_cast<unsigned char *>(clEnqueueMapImage(
+                command_queue,
+                out_rgba_image.get(),
+                CL_TRUE,
+                CL_MAP_READ,
+                origin,
+                out_rgb_region,
+                &row_pitch,
+                NULL,
+                0,
+                NULL,
+                NULL,
+                &err
+        ));
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error " << err << " mapping dest image y-plane buffer for reading." << "\n";
+            std::exit(err);
+        }
+        // Copies image data from the ION buffer to the host
+        for (uint32_t i = 0; i < out_rgba_desc.image_height; ++i)
+        {
+            std::memcpy(
+                    out_rgba_image_info.pixels.data() + i * out_rgba_desc.image_width * 4,
+                    image_ptr                         + i * row_pitch,
+                    out_rgba_desc.image_width * 4
+            );
+        }
+
+        err = clEnqueueUnmapMemObject(command_queue, out_rgba_image.get(), image_ptr, 0, NULL, NULL);
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error " << err << " unmapping dest image out_rgba_image buffer." << "\n";
+            std::exit(err);
+        }
 
-    clFinish(command_queue);
-    save_rgba_image_data(out_image_filename, out_rgba_image_info);
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseSampler(sampler);
-    clReleaseMemObject(src_uv_plane);
-    clReleaseMemObject(src_y_plane);
-    clReleaseMemObject(src_nv12_image);
-    clReleaseMemObject(out_rgba_image);
+        clFinish(command_queue);
+        save_rgba_image_data(out_image_filenames[frame], out_rgba_image_info);
+        ++frame;
+    } while (src_loader.next(src_nv12_image_info));
 
     return 0;
 }
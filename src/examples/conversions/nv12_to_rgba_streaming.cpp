@@ -0,0 +1,377 @@
+//--------------------------------------------------------------------------------------
+// File: nv12_to_rgba_streaming.cpp
+// Desc:
+// This program converts nv12 to RGBA8888 one band of rows at a time, so that
+// images larger than the host memory budget can be converted
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+// Std includes
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+// Project includes
+#include "util/cl_handles.h"
+#include "util/cl_wrapper.h"
+#include "util/util.h"
+// Library includes
+#include <CL/cl.h>
+#include <CL/cl_ext_qcom.h>
+
+static const char *PROGRAM_SOURCE[] = {
+    "__kernel void                                                                                          \n"
+    " nv12_to_rgb(__read_only image2d_t input_nv12,                                                         \n"
+    "             __write_only image2d_t out_rgba, sampler_t sampler)                                       \n"
+    "{                                                                                                      \n"
+    "    int2   coord;                                                                                      \n"
+    "    float4 yuv;                                                                                        \n"
+    "    float4 rgba;                                                                                       \n"
+    "                                                                                                       \n"
+    "    coord.x = get_global_id(0);                                                                        \n"
+    "    coord.y = get_global_id(1);                                                                        \n"
+    "                                                                                                       \n"
+    "    yuv = read_imagef(input_nv12, sampler, coord);                                                     \n"
+    "    yuv.y = (yuv.y - 0.5f) * 0.872f;                                                                   \n"
+    "    yuv.z = (yuv.z - 0.5f) * 1.23f;                                                                    \n"
+    "    rgba.x = yuv.x + (1.140f * yuv.z);                                                                 \n"
+    "    rgba.y = yuv.x - (0.395f * yuv.y) - (0.581f * yuv.z);                                              \n"
+    "    rgba.z = yuv.x + (2.032f * yuv.y);                                                                 \n"
+    "    rgba.w = 1.0f;                                                                                     \n"
+    "    write_imagef(out_rgba, coord, rgba);                                                               \n"
+    "}                                                                                                      \n"
+};
+
+static const cl_uint PROGRAM_SOURCE_LEN = sizeof(PROGRAM_SOURCE) / sizeof(const char *);
+
+static const uint32_t DEFAULT_BAND_ROWS = 256;
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <img data file> <out img data file> [<band rows>]\n"
+                  << "Input image file data should be in format CL_QCOM_NV12 / CL_UNORM_INT8\n"
+                  << "Demonstrates conversions from NV12 to RGBA8888 using a fixed amount of memory. The input\n"
+                  << "is read in bands of <band rows> rows (default " << DEFAULT_BAND_ROWS << ", must be even);\n"
+                  << "the next band is read from disk while the GPU converts the current one.\n";
+        return 0;
+    }
+
+    const std::string src_image_filename(argv[1]);
+    const std::string out_image_filename(argv[2]);
+    const uint32_t    band_rows = argc >= 4 ? std::strtoul(argv[3], NULL, 10) : DEFAULT_BAND_ROWS;
+
+    cl_wrapper        wrapper;
+    cl_program        program            = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
+    cl_kernel         nv12_to_rgb_kernel = wrapper.get_kernel("nv12_to_rgb", program);
+    cl_context        context            = wrapper.get_context();
+    image_band_reader src_reader(src_image_filename, CL_UNORM_INT8, CL_QCOM_NV12, band_rows);
+    /*
+     * Step 0: Confirm the required OpenCL extensions are supported.
+     */
+    if (!wrapper.check_extension_support("cl_qcom_other_image"))
+    {
+        std::cerr << "Extension cl_qcom_other_image needed for NV12 image format is not supported.\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (!wrapper.check_extension_support("cl_qcom_ext_host_ptr"))
+    {
+        std::cerr << "Extension cl_qcom_ext_host_ptr needed for ION-backed images is not supported.\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (!wrapper.check_extension_support("cl_qcom_ion_host_ptr"))
+    {
+        std::cerr << "Extension cl_qcom_ion_host_ptr needed for ION-backed images is not supported.\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::vector<cl_image_format> formats;
+    formats = get_image_formats(context, CL_MEM_READ_WRITE);
+    const bool rw_formats_supported =
+            is_format_supported(formats, cl_image_format{CL_RGBA,  CL_UNORM_INT8});
+    if (!rw_formats_supported)
+    {
+        std::cerr << "For this example your device must support read-write CL_RGBA"
+                     "with CL_UNORM_INT8 image format, but it does not.\n";
+        std::cerr << "Supported read-write formats include:\n";
+        print_formats(formats);
+        std::exit(EXIT_FAILURE);
+    }
+    /*
+     * Step 1: Create ion buffer-backed CL images that are one band high. They are reused for every band.
+     */
+    cl_image_format src_nv12_format;
+    src_nv12_format.image_channel_order     = CL_QCOM_NV12;
+    src_nv12_format.image_channel_data_type = CL_UNORM_INT8;
+
+    cl_image_desc src_nv12_desc;
+    std::memset(&src_nv12_desc, 0, sizeof(src_nv12_desc));
+    src_nv12_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
+    src_nv12_desc.image_width  = src_reader.width();
+    src_nv12_desc.image_height = band_rows;
+
+    cl_int err = 0;
+    ion_allocation src_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_nv12_format, src_nv12_desc);
+    cl_mem_handle src_nv12_image(clCreateImage(
+            context,
+            CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
+            &src_nv12_format,
+            &src_nv12_desc,
+            src_nv12_ion_mem.get(),
+            &err
+    ));
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clCreateImage for source image." << "\n";
+        std::exit(err);
+    }
+
+    cl_image_format out_rgba_format;
+    out_rgba_format.image_channel_order     = CL_RGBA;
+    out_rgba_format.image_channel_data_type = CL_UNORM_INT8;
+
+    cl_image_desc out_rgba_desc;
+    std::memset(&out_rgba_desc, 0, sizeof(out_rgba_desc));
+    out_rgba_desc.image_type             = CL_MEM_OBJECT_IMAGE2D;
+    out_rgba_desc.image_width            = src_reader.width();
+    out_rgba_desc.image_height           = band_rows;
+    const size_t img_row_pitch           = wrapper.get_ion_image_row_pitch(out_rgba_format, out_rgba_desc);
+    out_rgba_desc.image_row_pitch        = img_row_pitch;
+    ion_allocation out_rgba_ion_mem = wrapper.make_ion_buffer_for_nonplanar_image(out_rgba_format, out_rgba_desc);
+    cl_mem_handle out_rgba_image(clCreateImage(
+            context,
+            CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
+            &out_rgba_format,
+            &out_rgba_desc,
+            out_rgba_ion_mem.get(),
+            &err
+    ));
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clCreateImage for output RGB image." << "\n";
+        std::exit(err);
+    }
+    /*
+     * Step 2: Separate planar NV12 images into their component planes.
+     */
+    cl_image_format src_y_plane_format;
+    src_y_plane_format.image_channel_order     = CL_QCOM_NV12_Y;
+    src_y_plane_format.image_channel_data_type = CL_UNORM_INT8;
+
+    cl_image_desc src_y_plane_desc;
+    std::memset(&src_y_plane_desc, 0, sizeof(src_y_plane_desc));
+    src_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
+    src_y_plane_desc.image_width  = src_nv12_desc.image_width;
+    src_y_plane_desc.image_height = src_nv12_desc.image_height;
+    src_y_plane_desc.mem_object   = src_nv12_image.get();
+
+    cl_mem_handle src_y_plane(clCreateImage(
+            context,
+            CL_MEM_READ_ONLY,
+            &src_y_plane_format,
+            &src_y_plane_desc,
+            NULL,
+            &err
+    ));
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clCreateImage for source image y plane." << "\n";
+        std::exit(err);
+    }
+
+    cl_image_format src_uv_plane_format;
+    src_uv_plane_format.image_channel_order     = CL_QCOM_NV12_UV;
+    src_uv_plane_format.image_channel_data_type = CL_UNORM_INT8;
+
+    cl_image_desc src_uv_plane_desc;
+    std::memset(&src_uv_plane_desc, 0, sizeof(src_uv_plane_desc));
+    src_uv_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
+    // The image dimensions for the uv-plane derived image must be the same as the parent image, even though the
+    // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
+    src_uv_plane_desc.image_width  = src_nv12_desc.image_width;
+    src_uv_plane_desc.image_height = src_nv12_desc.image_height;
+    src_uv_plane_desc.mem_object   = src_nv12_image.get();
+
+    cl_mem_handle src_uv_plane(clCreateImage(
+            context,
+            CL_MEM_READ_ONLY,
+            &src_uv_plane_format,
+            &src_uv_plane_desc,
+            NULL,
+            &err
+    ));
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clCreateImage for source image uv plane." << "\n";
+        std::exit(err);
+    }
+    /*
+     * Step 3: Set up kernel arguments, which are the same for every band.
+     */
+    cl_sampler_handle sampler(clCreateSampler(
+            context,
+            CL_FALSE,
+            CL_ADDRESS_CLAMP_TO_EDGE,
+            CL_FILTER_NEAREST,
+            &err
+    ));
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clCreateSampler." << "\n";
+        std::exit(err);
+    }
+
+    err = clSetKernelArg(nv12_to_rgb_kernel, 0, sizeof(cl_mem), src_nv12_image.address());
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "\tError " << err << " with clSetKernelArg for argument 0 for nv12_to_rgb_kernel kernel." << "\n";
+        std::exit(err);
+    }
+
+    err = clSetKernelArg(nv12_to_rgb_kernel, 1, sizeof(cl_mem), out_rgba_image.address());
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "\tError " << err << " with clSetKernelArg for argument 1 for nv12_to_rgb_kernel kernel." << "\n";
+        std::exit(err);
+    }
+
+    err = clSetKernelArg(nv12_to_rgb_kernel, 2, sizeof(cl_sampler), sampler.address());
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "\tError " << err << " with clSetKernelArg for argument 2 for nv12_to_rgb_kernel kernel." << "\n";
+        std::exit(err);
+    }
+    /*
+     * Step 4: The output is written as it is produced, starting with the header.
+     */
+    std::ofstream fout(out_image_filename, std::ios::binary);
+    if (!fout)
+    {
+        std::cerr << "Can't open " << out_image_filename << " for writing.\n";
+        std::exit(EXIT_FAILURE);
+    }
+    write_image_data_header(fout, src_reader.width(), src_reader.height(), CL_UNORM_INT8, CL_RGBA);
+    /*
+     * Step 5: For each band, copy it to the input image planes, run the kernel and append the result to the output.
+     * next_band() starts reading the following band from disk, which overlaps with the rest of the loop body.
+     */
+    cl_command_queue command_queue = wrapper.get_command_queue();
+    const size_t     origin[]      = {0, 0, 0};
+    image_band_t     band;
+    while (src_reader.next_band(band))
+    {
+        const size_t   src_y_region[] = {src_y_plane_desc.image_width, band.num_rows[0], 1};
+        size_t         row_pitch      = 0;
+        unsigned char *image_ptr      = reinterpret_cast<unsigned char *>(clEnqueueMapImage(
+                command_queue,
+                src_y_plane.get(),
+                CL_TRUE,
+                CL_MAP_WRITE,
+                origin,
+                src_y_region,
+                &row_pitch,
+                NULL,
+                0,
+                NULL,
+                NULL,
+                &err
+        ));
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error " << err << " mapping source image y-plane buffer for writing." << "\n";
+            std::exit(err);
+        }
+        copy_band_plane(band, 0, image_ptr, row_pitch);
+
+        err = clEnqueueUnmapMemObject(command_queue, src_y_plane.get(), image_ptr, 0, NULL, NULL);
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error " << err << " unmapping source image y-plane data buffer." << "\n";
+            std::exit(err);
+        }
+        // Note the discrepancy between the child plane image descriptor and the size required by clEnqueueMapImage.
+        const size_t src_uv_region[] = {src_uv_plane_desc.image_width / 2, band.num_rows[1], 1};
+        row_pitch                    = 0;
+        image_ptr = reinterpret_cast<unsigned char *>(clEnqueueMapImage(
+                command_queue,
+                src_uv_plane.get(),
+                CL_TRUE,
+                CL_MAP_WRITE,
+                origin,
+                src_uv_region,
+                &row_pitch,
+                NULL,
+                0,
+                NULL,
+                NULL,
+                &err
+        ));
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error " << err << " mapping source image uv-plane buffer for writing." << "\n";
+            std::exit(err);
+        }
+        copy_band_plane(band, 1, image_ptr, row_pitch);
+
+        err = clEnqueueUnmapMemObject(command_queue, src_uv_plane.get(), image_ptr, 0, NULL, NULL);
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error " << err << " unmapping source image uv-plane data buffer." << "\n";
+            std::exit(err);
+        }
+
+        // The last band may be shorter than the images; rows past it are left over from the previous band
+        const size_t work_size[] = {out_rgba_desc.image_width, band.num_rows[0]};
+        wrapper.enqueue_kernel(nv12_to_rgb_kernel, 2, work_size, NULL);
+
+        const size_t out_rgb_region[] = {out_rgba_desc.image_width, band.num_rows[0], 1};
+        row_pitch                     = 0;
+        image_ptr = reinterpret_cast<unsigned char *>(clEnqueueMapImage(
+                command_queue,
+                out_rgba_image.get(),
+                CL_TRUE,
+                CL_MAP_READ,
+                origin,
+                out_rgb_region,
+                &row_pitch,
+                NULL,
+                0,
+                NULL,
+                NULL,
+                &err
+        ));
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error " << err << " mapping dest image buffer for reading." << "\n";
+            std::exit(err);
+        }
+        // Appends the band's RGBA rows to the output file
+        for (uint32_t i = 0; i < band.num_rows[0]; ++i)
+        {
+            fout.write(reinterpret_cast<const char *>(image_ptr + i * row_pitch), out_rgba_desc.image_width * 4);
+        }
+
+        err = clEnqueueUnmapMemObject(command_queue, out_rgba_image.get(), image_ptr, 0, NULL, NULL);
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error " << err << " unmapping dest image out_rgba_image buffer." << "\n";
+            std::exit(err);
+        }
+    }
+
+    clFinish(command_queue);
+    if (!fout)
+    {
+        std::cerr << "Error writing " << out_image_filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    return 0;
+}
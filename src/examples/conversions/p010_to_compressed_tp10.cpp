@@ -15,6 +15,7 @@
 #include <iostream>
 
 // Project includes
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 #include "util/util.h"
 
@@ -131,8 +132,8 @@ int main(int argc, char** argv)
 
     cl_wrapper wrapper;
     cl_program   program             = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
-    cl_kernel    p010_to_tp10_kernel = wrapper.make_kernel("p010_to_tp10", program);
-    cl_kernel    tp10_to_p010_kernel = wrapper.make_kernel("tp10_to_p010", program);
+    cl_kernel    p010_to_tp10_kernel = wrapper.get_kernel("p010_to_tp10", program);
+    cl_kernel    tp10_to_p010_kernel = wrapper.get_kernel("tp10_to_p010", program);
     cl_context   context             = wrapper.get_context();
     p010_image_t src_p010_image_info = load_p010_image_data(src_image_filename);
 
@@ -186,15 +187,15 @@ int main(int argc, char** argv)
     src_desc.image_height = src_p010_image_info.y_height;
 
     cl_int err = 0;
-    cl_mem_ion_host_ptr src_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_format, src_desc);
-    cl_mem src_image = clCreateImage(
+    ion_allocation src_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_format, src_desc);
+    cl_mem_handle src_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &src_format,
             &src_desc,
-            &src_ion_mem,
+            src_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image." << "\n";
@@ -211,16 +212,16 @@ int main(int argc, char** argv)
     compressed_desc.image_width  = src_p010_image_info.y_width;
     compressed_desc.image_height = src_p010_image_info.y_height;
 
-    cl_mem_ion_host_ptr compressed_ion_mem = wrapper.make_ion_buffer_for_compressed_image(compressed_format,
-                                                                                          compressed_desc);
-    cl_mem compressed_image = clCreateImage(
+    ion_allocation compressed_ion_mem = wrapper.make_ion_buffer_for_compressed_image(compressed_format,
+                                                                                     compressed_desc);
+    cl_mem_handle compressed_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &compressed_format,
             &compressed_desc,
-            &compressed_ion_mem,
+            compressed_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for compressed image." << "\n";
@@ -237,15 +238,15 @@ int main(int argc, char** argv)
     out_desc.image_width  = src_p010_image_info.y_width;
     out_desc.image_height = src_p010_image_info.y_height;
 
-    cl_mem_ion_host_ptr out_ion_mem = wrapper.make_ion_buffer_for_yuv_image(out_format, out_desc);
-    cl_mem out_image = clCreateImage(
+    ion_allocation out_ion_mem = wrapper.make_ion_buffer_for_yuv_image(out_format, out_desc);
+    cl_mem_handle out_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &out_format,
             &out_desc,
-            &out_ion_mem,
+            out_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for output image." << "\n";
@@ -265,16 +266,16 @@ int main(int argc, char** argv)
     src_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     src_y_plane_desc.image_width  = src_p010_image_info.y_width;
     src_y_plane_desc.image_height = src_p010_image_info.y_height;
-    src_y_plane_desc.mem_object   = src_image;
+    src_y_plane_desc.mem_object   = src_image.get();
 
-    cl_mem src_y_plane = clCreateImage(
+    cl_mem_handle src_y_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_y_plane_format,
             &src_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image y plane." << "\n";
@@ -292,16 +293,16 @@ int main(int argc, char** argv)
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
     src_uv_plane_desc.image_width  = src_p010_image_info.y_width;
     src_uv_plane_desc.image_height = src_p010_image_info.y_height;
-    src_uv_plane_desc.mem_object   = src_image;
+    src_uv_plane_desc.mem_object   = src_image.get();
 
-    cl_mem src_uv_plane = clCreateImage(
+    cl_mem_handle src_uv_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_uv_plane_format,
             &src_uv_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image uv plane." << "\n";
@@ -317,16 +318,16 @@ int main(int argc, char** argv)
     compressed_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     compressed_y_plane_desc.image_width  = compressed_desc.image_width;
     compressed_y_plane_desc.image_height = compressed_desc.image_height;
-    compressed_y_plane_desc.mem_object   = compressed_image;
+    compressed_y_plane_desc.mem_object   = compressed_image.get();
 
-    cl_mem compressed_y_plane = clCreateImage(
+    cl_mem_handle compressed_y_plane(clCreateImage(
             context,
             CL_MEM_READ_WRITE,
             &compressed_y_plane_format,
             &compressed_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for compressed image y plane." << "\n";
@@ -344,16 +345,16 @@ int main(int argc, char** argv)
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
     compressed_uv_plane_desc.image_width  = compressed_desc.image_width;
     compressed_uv_plane_desc.image_height = compressed_desc.image_height;
-    compressed_uv_plane_desc.mem_object   = compressed_image;
+    compressed_uv_plane_desc.mem_object   = compressed_image.get();
 
-    cl_mem compressed_uv_plane = clCreateImage(
+    cl_mem_handle compressed_uv_plane(clCreateImage(
             context,
             CL_MEM_READ_WRITE,
             &compressed_uv_plane_format,
             &compressed_uv_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for compressed image uv plane." << "\n";
@@ -369,16 +370,16 @@ int main(int argc, char** argv)
     out_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     out_y_plane_desc.image_width  = out_desc.image_width;
     out_y_plane_desc.image_height = out_desc.image_height;
-    out_y_plane_desc.mem_object   = out_image;
+    out_y_plane_desc.mem_object   = out_image.get();
 
-    cl_mem out_y_plane = clCreateImage(
+    cl_mem_handle out_y_plane(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY,
             &out_y_plane_format,
             &out_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for destination image y plane." << "\n";
@@ -396,16 +397,16 @@ int main(int argc, char** argv)
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
     out_uv_plane_desc.image_width  = out_desc.image_width;
     out_uv_plane_desc.image_height = out_desc.image_height;
-    out_uv_plane_desc.mem_object   = out_image;
+    out_uv_plane_desc.mem_object   = out_image.get();
 
-    cl_mem out_uv_plane = clCreateImage(
+    cl_mem_handle out_uv_plane(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY,
             &out_uv_plane_format,
             &out_uv_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for destination image uv plane." << "\n";
@@ -424,7 +425,7 @@ int main(int argc, char** argv)
     size_t           row_pitch      = 0;
     unsigned char   *image_ptr      = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            src_y_plane,
+            src_y_plane.get(),
             CL_TRUE,
             CL_MAP_WRITE,
             origin,
@@ -452,7 +453,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, src_y_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, src_y_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping source image y-plane data buffer." << "\n";
@@ -464,7 +465,7 @@ int main(int argc, char** argv)
     row_pitch                    = 0;
     image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            src_uv_plane,
+            src_uv_plane.get(),
             CL_TRUE,
             CL_MAP_WRITE,
             origin,
@@ -492,7 +493,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, src_uv_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, src_uv_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping source image uv-plane data buffer." << "\n";
@@ -503,13 +504,13 @@ int main(int argc, char** argv)
      * Step 4: Run the kernels
      */
 
-    cl_sampler sampler = clCreateSampler(
+    cl_sampler_handle sampler(clCreateSampler(
             context,
             CL_FALSE,
             CL_ADDRESS_CLAMP_TO_EDGE,
             CL_FILTER_NEAREST,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateSampler." << "\n";
@@ -520,28 +521,28 @@ int main(int argc, char** argv)
      * Step 5: Run the kernels
      */
 
-    err = clSetKernelArg(p010_to_tp10_kernel, 0, sizeof(src_image), &src_image);
+    err = clSetKernelArg(p010_to_tp10_kernel, 0, sizeof(cl_mem), src_image.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "\tError " << err << " with clSetKernelArg for argument 0 for p010_to_tp10_kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(p010_to_tp10_kernel, 1, sizeof(compressed_y_plane), &compressed_y_plane);
+    err = clSetKernelArg(p010_to_tp10_kernel, 1, sizeof(cl_mem), compressed_y_plane.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "\tError " << err << " with clSetKernelArg for argument 1 for p010_to_tp10_kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(p010_to_tp10_kernel, 2, sizeof(compressed_uv_plane), &compressed_uv_plane);
+    err = clSetKernelArg(p010_to_tp10_kernel, 2, sizeof(cl_mem), compressed_uv_plane.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "\tError " << err << " with clSetKernelArg for argument 2 for p010_to_tp10_kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(p010_to_tp10_kernel, 3, sizeof(sampler), &sampler);
+    err = clSetKernelArg(p010_to_tp10_kernel, 3, sizeof(cl_sampler), sampler.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "\tError " << err << " with clSetKernelArg for argument 3 for p010_to_tp10_kernel." << "\n";
@@ -549,45 +550,30 @@ int main(int argc, char** argv)
     }
 
     const size_t p010_to_tp10_work_size[] = {work_units(src_desc.image_width, 6), src_desc.image_height};
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            p010_to_tp10_kernel,
-            2,
-            NULL,
-            p010_to_tp10_work_size,
-            NULL,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "\tError " << err << " with clEnqueueNDRangeKernel for p010_to_tp10_kernel." << "\n";
-        std::exit(err);
-    }
+    wrapper.enqueue_kernel(p010_to_tp10_kernel, 2, p010_to_tp10_work_size, NULL);
 
-    err = clSetKernelArg(tp10_to_p010_kernel, 0, sizeof(compressed_image), &compressed_image);
+    err = clSetKernelArg(tp10_to_p010_kernel, 0, sizeof(cl_mem), compressed_image.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "\tError " << err << " with clSetKernelArg for argument 0 for tp10_to_p010_kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(tp10_to_p010_kernel, 1, sizeof(out_y_plane), &out_y_plane);
+    err = clSetKernelArg(tp10_to_p010_kernel, 1, sizeof(cl_mem), out_y_plane.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "\tError " << err << " with clSetKernelArg for argument 1 for tp10_to_p010_kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(tp10_to_p010_kernel, 2, sizeof(out_uv_plane), &out_uv_plane);
+    err = clSetKernelArg(tp10_to_p010_kernel, 2, sizeof(cl_mem), out_uv_plane.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "\tError " << err << " with clSetKernelArg for argument 2 for tp10_to_p010_kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(tp10_to_p010_kernel, 3, sizeof(sampler), &sampler);
+    err = clSetKernelArg(tp10_to_p010_kernel, 3, sizeof(cl_sampler), sampler.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "\tError " << err << " with clSetKernelArg for argument 3 for tp10_to_p010_kernel." << "\n";
@@ -595,22 +581,7 @@ int main(int argc, char** argv)
     }
 
     const size_t tp10_to_p010_work_size[] = {work_units(src_desc.image_width, 4), work_units(src_desc.image_height, 4)};
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            tp10_to_p010_kernel,
-            2,
-            NULL,
-            tp10_to_p010_work_size,
-            NULL,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "\tError " << err << " with clEnqueueNDRangeKernel for tp10_to_p010_kernel." << "\n";
-        std::exit(err);
-    }
+    wrapper.enqueue_kernel(tp10_to_p010_kernel, 2, tp10_to_p010_work_size, NULL);
 
     /*
      * Step 6: Copy the data out of the ion buffer for each plane.
@@ -626,7 +597,7 @@ int main(int argc, char** argv)
     row_pitch                   = 0;
     image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            out_y_plane,
+            out_y_plane.get(),
             CL_TRUE,
             CL_MAP_READ,
             origin,
@@ -654,7 +625,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, out_y_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, out_y_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping dest image y-plane buffer." << "\n";
@@ -665,7 +636,7 @@ int main(int argc, char** argv)
     row_pitch                    = 0;
     image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            out_uv_plane,
+            out_uv_plane.get(),
             CL_TRUE,
             CL_MAP_READ,
             origin,
@@ -693,7 +664,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, out_uv_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, out_uv_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping dest image uv-plane buffer." << "\n";
@@ -704,17 +675,5 @@ int main(int argc, char** argv)
 
     save_p010_image_data(out_image_filename, out_image_info);
 
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseSampler(sampler);
-    clReleaseMemObject(src_uv_plane);
-    clReleaseMemObject(src_y_plane);
-    clReleaseMemObject(src_image);
-    clReleaseMemObject(compressed_uv_plane);
-    clReleaseMemObject(compressed_y_plane);
-    clReleaseMemObject(compressed_image);
-    clReleaseMemObject(out_uv_plane);
-    clReleaseMemObject(out_y_plane);
-    clReleaseMemObject(out_image);
-
     return 0;
 }
@@ -15,6 +15,7 @@
 #include <iostream>
 
 // Project includes
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 #include "util/half_float.h"
 #include "util/util.h"
@@ -57,9 +58,9 @@ static const cl_uint PROGRAM_SOURCE_LEN = sizeof(PROGRAM_SOURCE) / sizeof(const
 static const cl_uint  CONV_FILTER_WIDTH  = 3;
 static const cl_uint  CONV_FILTER_HEIGHT = 3;
 
-static const cl_half sixteenth = to_half(1.f / 16.f);
-static const cl_half eighth    = to_half(1.f / 8.f);
-static const cl_half fourth    = to_half(1.f / 4.f);
+static constexpr cl_half sixteenth = to_half_constexpr(1.f / 16.f);
+static constexpr cl_half eighth    = to_half_constexpr(1.f / 8.f);
+static constexpr cl_half fourth    = to_half_constexpr(1.f / 4.f);
 
 // This filter corresponds to a 3x3 Gaussian blur.
 static cl_half CONVOLUTION_FILTER[CONV_FILTER_HEIGHT * CONV_FILTER_WIDTH] = {
@@ -81,7 +82,7 @@ int main(int argc, char** argv)
 
     cl_wrapper wrapper;
     cl_program   program             = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
-    cl_kernel    y_plane_kernel      = wrapper.make_kernel("accelerated_convolution", program);
+    cl_kernel    y_plane_kernel      = wrapper.get_kernel("accelerated_convolution", program);
     cl_context   context             = wrapper.get_context();
     nv12_image_t src_nv12_image_info = load_nv12_image_data(src_image_filename);
 
@@ -128,16 +129,16 @@ int main(int argc, char** argv)
     src_nv12_desc.image_width  = src_nv12_image_info.y_width;
     src_nv12_desc.image_height = src_nv12_image_info.y_height;
 
-    cl_mem_ion_host_ptr src_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_nv12_format, src_nv12_desc);
+    ion_allocation src_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_nv12_format, src_nv12_desc);
     cl_int err;
-    cl_mem src_nv12_image = clCreateImage(
+    cl_mem_handle src_nv12_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &src_nv12_format,
             &src_nv12_desc,
-            &src_nv12_ion_mem,
+            src_nv12_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image." << "\n";
@@ -154,15 +155,15 @@ int main(int argc, char** argv)
     out_nv12_desc.image_width  = src_nv12_image_info.y_width;
     out_nv12_desc.image_height = src_nv12_image_info.y_height;
 
-    cl_mem_ion_host_ptr out_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(out_nv12_format, out_nv12_desc);
-    cl_mem out_nv12_image = clCreateImage(
+    ion_allocation out_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(out_nv12_format, out_nv12_desc);
+    cl_mem_handle out_nv12_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &out_nv12_format,
             &out_nv12_desc,
-            &out_nv12_ion_mem,
+            out_nv12_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for output image." << "\n";
@@ -171,13 +172,13 @@ int main(int argc, char** argv)
 
     // Note: images and buffers can be backed by the same underlying ION memory.
     const int out_img_row_pitch = static_cast<int>(wrapper.get_ion_image_row_pitch(out_nv12_format, out_nv12_desc));
-    cl_mem out_nv12_buffer = clCreateBuffer(
+    cl_mem_handle out_nv12_buffer(clCreateBuffer(
             context,
             CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             out_img_row_pitch * out_nv12_desc.image_height,
-            &out_nv12_ion_mem,
+            out_nv12_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer." << "\n";
@@ -197,16 +198,16 @@ int main(int argc, char** argv)
     src_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     src_y_plane_desc.image_width  = src_nv12_image_info.y_width;
     src_y_plane_desc.image_height = src_nv12_image_info.y_height;
-    src_y_plane_desc.mem_object   = src_nv12_image;
+    src_y_plane_desc.mem_object   = src_nv12_image.get();
 
-    cl_mem src_y_plane = clCreateImage(
+    cl_mem_handle src_y_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_y_plane_format,
             &src_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image y plane." << "\n";
@@ -222,16 +223,16 @@ int main(int argc, char** argv)
     out_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     out_y_plane_desc.image_width  = out_nv12_desc.image_width;
     out_y_plane_desc.image_height = out_nv12_desc.image_height;
-    out_y_plane_desc.mem_object   = out_nv12_image;
+    out_y_plane_desc.mem_object   = out_nv12_image.get();
 
-    cl_mem out_y_plane = clCreateImage(
+    cl_mem_handle out_y_plane(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY,
             &out_y_plane_format,
             &out_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for destination image y plane." << "\n";
@@ -250,7 +251,7 @@ int main(int argc, char** argv)
     size_t           row_pitch      = 0;
     unsigned char   *image_ptr      = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            src_y_plane,
+            src_y_plane.get(),
             CL_TRUE,
             CL_MAP_WRITE,
             origin,
@@ -278,7 +279,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, src_y_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, src_y_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping source image y-plane data buffer." << "\n";
@@ -289,13 +290,13 @@ int main(int argc, char** argv)
      * Step 4: Set up other kernel arguments
      */
 
-    cl_sampler sampler = clCreateSampler(
+    cl_sampler_handle sampler(clCreateSampler(
             context,
             CL_FALSE,
             CL_ADDRESS_CLAMP_TO_EDGE,
             CL_FILTER_NEAREST,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateSampler." << "\n";
@@ -319,14 +320,14 @@ int main(int argc, char** argv)
     weight_image_desc.weight_desc.center_coord_y = 1;
     weight_image_desc.weight_desc.flags          = 0;
 
-    cl_mem weight_image = clCreateImage(
+    cl_mem_handle weight_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
             &weight_image_format,
             reinterpret_cast<cl_image_desc *>(&weight_image_desc),
             static_cast<void *>(CONVOLUTION_FILTER),
             &err
-    );
+    ));
     if (err != CL_SUCCESS) {
         std::cerr << "Error " << err << " with clCreateImage for weight image." << "\n";
         std::exit(err);
@@ -336,14 +337,14 @@ int main(int argc, char** argv)
      * Step 5: Run the kernel separately for y-plane only
      */
 
-    err = clSetKernelArg(y_plane_kernel, 0, sizeof(src_y_plane), &src_y_plane);
+    err = clSetKernelArg(y_plane_kernel, 0, sizeof(cl_mem), src_y_plane.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0 for y-plane kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(y_plane_kernel, 1, sizeof(out_nv12_buffer), &out_nv12_buffer);
+    err = clSetKernelArg(y_plane_kernel, 1, sizeof(cl_mem), out_nv12_buffer.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1 for y-plane kernel." << "\n";
@@ -357,14 +358,14 @@ int main(int argc, char** argv)
         std::exit(err);
     }
 
-    err = clSetKernelArg(y_plane_kernel, 3, sizeof(sampler), &sampler);
+    err = clSetKernelArg(y_plane_kernel, 3, sizeof(cl_sampler), sampler.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 3 for y-plane kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(y_plane_kernel, 4, sizeof(weight_image), &weight_image);
+    err = clSetKernelArg(y_plane_kernel, 4, sizeof(cl_mem), weight_image.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 4 for y-plane kernel." << "\n";
@@ -372,22 +373,7 @@ int main(int argc, char** argv)
     }
 
     const size_t y_plane_work_size[] = {out_y_plane_desc.image_width / 2, out_y_plane_desc.image_height / 2};
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            y_plane_kernel,
-            2,
-            NULL,
-            y_plane_work_size,
-            NULL,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " with clEnqueueNDRangeKernel for y-plane kernel." << "\n";
-        std::exit(err);
-    }
+    wrapper.enqueue_kernel(y_plane_kernel, 2, y_plane_work_size, NULL);
 
     clFinish(command_queue);
 
@@ -405,7 +391,7 @@ int main(int argc, char** argv)
     row_pitch                   = 0;
     image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            out_y_plane,
+            out_y_plane.get(),
             CL_TRUE,
             CL_MAP_READ,
             origin,
@@ -433,7 +419,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, out_y_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, out_y_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping dest image y-plane buffer." << "\n";
@@ -444,14 +430,5 @@ int main(int argc, char** argv)
 
     save_nv12_image_data(out_image_filename, out_nv12_image_info);
 
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseMemObject(weight_image);
-    clReleaseSampler(sampler);
-    clReleaseMemObject(src_y_plane);
-    clReleaseMemObject(src_nv12_image);
-    clReleaseMemObject(out_nv12_buffer);
-    clReleaseMemObject(out_y_plane);
-    clReleaseMemObject(out_nv12_image);
-
     return 0;
 }
@@ -13,8 +13,12 @@
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <string>
+#include <vector>
 
 // Project includes
+#include "util/async_image_loader.h"
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 #include "util/half_float.h"
 #include "util/util.h"
@@ -24,11 +28,13 @@
 #include <CL/cl_ext_qcom.h>
 
 static const char *HELP_MESSAGE = "\n"
-"Usage: convolution <source image data file> <output image data file>\n"
+"Usage: convolution <source image data file> <output image data file> [<source image data file> <output image data file> ...]\n"
 "Runs a kernel demonstrating Gaussian blur with runtime constant promotion.\n"
 "Additionally demonstrates that images and buffers can use the same underlying\n"
 "ION memory, by writing to an OpenCL buffer and reading results from an image\n"
-"that share the same ION buffer.\n";
+"that share the same ION buffer.\n"
+"Given several pairs of files, which must all be the same size, the next source\n"
+"is loaded in the background while the GPU filters the current one.\n";
 
 static const char *PROGRAM_SOURCE[] = {
 "__kernel void convolution(__read_only image2d_t      src_image,\n",
@@ -86,20 +92,28 @@ static cl_float CONVOLUTION_FILTER[CONV_FILTER_HEIGHT * CONV_FILTER_WIDTH] = {
 
 int main(int argc, char** argv)
 {
-    if (argc < 3)
+    if (argc < 3 || argc % 2 == 0)
     {
-        std::cerr << "Please specify source and output images.\n";
+        std::cerr << "Please specify pairs of source and output images.\n";
         std::cerr << HELP_MESSAGE;
         std::exit(EXIT_SUCCESS);
     }
-    const std::string src_image_filename(argv[1]);
-    const std::string out_image_filename(argv[2]);
+    std::vector<std::string> src_image_filenames;
+    std::vector<std::string> out_image_filenames;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        src_image_filenames.push_back(argv[i]);
+        out_image_filenames.push_back(argv[i + 1]);
+    }
 
     cl_wrapper wrapper;
     cl_program   program             = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
-    cl_kernel    y_plane_kernel      = wrapper.make_kernel("convolution", program);
+    cl_kernel    y_plane_kernel      = wrapper.get_kernel("convolution", program);
     cl_context   context             = wrapper.get_context();
-    nv12_image_t src_nv12_image_info = load_nv12_image_data(src_image_filename);
+    nv12_image_t src_nv12_image_info;
+    // Later sources are loaded in the background while the GPU filters earlier ones
+    async_image_loader<nv12_image_t> src_loader(src_image_filenames, load_nv12_image_data);
+    src_loader.next(src_nv12_image_info);
 
     /*
      * Step 0: Confirm the required OpenCL extensions are supported.
@@ -138,16 +152,16 @@ int main(int argc, char** argv)
     src_nv12_desc.image_width  = src_nv12_image_info.y_width;
     src_nv12_desc.image_height = src_nv12_image_info.y_height;
 
-    cl_mem_ion_host_ptr src_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_nv12_format, src_nv12_desc);
+    ion_allocation src_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_nv12_format, src_nv12_desc);
     cl_int err;
-    cl_mem src_nv12_image = clCreateImage(
+    cl_mem_handle src_nv12_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &src_nv12_format,
             &src_nv12_desc,
-            &src_nv12_ion_mem,
+            src_nv12_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image." << "\n";
@@ -164,15 +178,15 @@ int main(int argc, char** argv)
     out_nv12_desc.image_width  = src_nv12_image_info.y_width;
     out_nv12_desc.image_height = src_nv12_image_info.y_height;
 
-    cl_mem_ion_host_ptr out_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(out_nv12_format, out_nv12_desc);
-    cl_mem out_nv12_image = clCreateImage(
+    ion_allocation out_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(out_nv12_format, out_nv12_desc);
+    cl_mem_handle out_nv12_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &out_nv12_format,
             &out_nv12_desc,
-            &out_nv12_ion_mem,
+            out_nv12_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for output image." << "\n";
@@ -181,13 +195,13 @@ int main(int argc, char** argv)
 
     // Note: images and buffers can be backed by the same underlying ION memory.
     const int out_img_row_pitch = static_cast<int>(wrapper.get_ion_image_row_pitch(out_nv12_format, out_nv12_desc));
-    cl_mem out_nv12_buffer = clCreateBuffer(
+    cl_mem_handle out_nv12_buffer(clCreateBuffer(
             context,
             CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             out_img_row_pitch * out_nv12_desc.image_height,
-            &out_nv12_ion_mem,
+            out_nv12_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer." << "\n";
@@ -207,16 +221,16 @@ int main(int argc, char** argv)
     src_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     src_y_plane_desc.image_width  = src_nv12_image_info.y_width;
     src_y_plane_desc.image_height = src_nv12_image_info.y_height;
-    src_y_plane_desc.mem_object   = src_nv12_image;
+    src_y_plane_desc.mem_object   = src_nv12_image.get();
 
-    cl_mem src_y_plane = clCreateImage(
+    cl_mem_handle src_y_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_y_plane_format,
             &src_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image y plane." << "\n";
@@ -232,80 +246,33 @@ int main(int argc, char** argv)
     out_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     out_y_plane_desc.image_width  = out_nv12_desc.image_width;
     out_y_plane_desc.image_height = out_nv12_desc.image_height;
-    out_y_plane_desc.mem_object   = out_nv12_image;
+    out_y_plane_desc.mem_object   = out_nv12_image.get();
 
-    cl_mem out_y_plane = clCreateImage(
+    cl_mem_handle out_y_plane(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY,
             &out_y_plane_format,
             &out_y_plane_desc,
             NULL,
             &err
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " with clCreateImage for destination image y plane." << "\n";
-        std::exit(err);
-    }
-
-    /*
-     * Step 3: Copy data to input image planes. Note that for linear NV12 images you must observe row alignment
-     * restrictions. (You may also write to the ion buffer directly if you prefer, however using clEnqueueMapImage for
-     * a child planar image will return the correct host pointer for the desired plane.)
-     */
-
-    cl_command_queue command_queue  = wrapper.get_command_queue();
-    const size_t     origin[]       = {0, 0, 0};
-    const size_t     src_y_region[] = {src_y_plane_desc.image_width, src_y_plane_desc.image_height, 1};
-    size_t           row_pitch      = 0;
-    unsigned char   *image_ptr      = static_cast<unsigned char *>(clEnqueueMapImage(
-            command_queue,
-            src_y_plane,
-            CL_TRUE,
-            CL_MAP_WRITE,
-            origin,
-            src_y_region,
-            &row_pitch,
-            NULL,
-            0,
-            NULL,
-            NULL,
-            &err
     ));
     if (err != CL_SUCCESS)
     {
-        std::cerr << "Error " << err << " mapping source image y-plane buffer for writing." << "\n";
-        std::exit(err);
-    }
-
-    // Copies image data to the ION buffer from the host
-    for (uint32_t i = 0; i < src_y_plane_desc.image_height; ++i)
-    {
-        std::memcpy(
-                image_ptr                          + i * row_pitch,
-                src_nv12_image_info.y_plane.data() + i * src_y_plane_desc.image_width,
-                src_y_plane_desc.image_width
-        );
-    }
-
-    err = clEnqueueUnmapMemObject(command_queue, src_y_plane, image_ptr, 0, NULL, NULL);
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " unmapping source image y-plane data buffer." << "\n";
+        std::cerr << "Error " << err << " with clCreateImage for destination image y plane." << "\n";
         std::exit(err);
     }
 
     /*
-     * Step 4: Set up other kernel arguments
+     * Step 3: Set up the kernel arguments, which are the same for every frame
      */
 
-    cl_sampler sampler = clCreateSampler(
+    cl_sampler_handle sampler(clCreateSampler(
             context,
             CL_FALSE,
             CL_ADDRESS_CLAMP_TO_EDGE,
             CL_FILTER_NEAREST,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateSampler." << "\n";
@@ -325,18 +292,14 @@ int main(int argc, char** argv)
         std::exit(err);
     }
 
-    /*
-     * Step 5: Run the kernel separately for y-plane only
-     */
-
-    err = clSetKernelArg(y_plane_kernel, 0, sizeof(src_y_plane), &src_y_plane);
+    err = clSetKernelArg(y_plane_kernel, 0, sizeof(cl_mem), src_y_plane.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0 for y-plane kernel." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(y_plane_kernel, 1, sizeof(out_nv12_buffer), &out_nv12_buffer);
+    err = clSetKernelArg(y_plane_kernel, 1, sizeof(cl_mem), out_nv12_buffer.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1 for y-plane kernel." << "\n";
@@ -350,7 +313,7 @@ int main(int argc, char** argv)
         std::exit(err);
     }
 
-    err = clSetKernelArg(y_plane_kernel, 3, sizeof(sampler), &sampler);
+    err = clSetKernelArg(y_plane_kernel, 3, sizeof(cl_sampler), sampler.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 3 for y-plane kernel." << "\n";
@@ -364,86 +327,128 @@ int main(int argc, char** argv)
         std::exit(err);
     }
 
-    const size_t y_plane_work_size[] = {out_y_plane_desc.image_width / 2, out_y_plane_desc.image_height / 2};
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            y_plane_kernel,
-            2,
-            NULL,
-            y_plane_work_size,
-            NULL,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
+    cl_command_queue command_queue = wrapper.get_command_queue();
+    const size_t     origin[]      = {0, 0, 0};
+    size_t           frame         = 0;
+    do
     {
-        std::cerr << "Error " << err << " with clEnqueueNDRangeKernel for y-plane kernel." << "\n";
-        std::exit(err);
-    }
-
-    clFinish(command_queue);
-
-    /*
-     * Step 6: Copy the data out of the ion buffer for each plane.
-     */
-
-    nv12_image_t out_nv12_image_info;
-    out_nv12_image_info.y_width  = out_nv12_desc.image_width;
-    out_nv12_image_info.y_height = out_nv12_desc.image_height;
-    out_nv12_image_info.y_plane.resize(out_nv12_image_info.y_width * out_nv12_image_info.y_height);
-    out_nv12_image_info.uv_plane = src_nv12_image_info.uv_plane;
-
-    const size_t out_y_region[] = {out_y_plane_desc.image_width, out_y_plane_desc.image_height, 1};
-    row_pitch                   = 0;
-    image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
-            command_queue,
-            out_y_plane,
-            CL_TRUE,
-            CL_MAP_READ,
-            origin,
-            out_y_region,
-            &row_pitch,
-            NULL,
-            0,
-            NULL,
-            NULL,
-            &err
-    ));
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " mapping dest image y-plane buffer for reading." << "\n";
-        std::exit(err);
-    }
-
-    // Copies image data from the ION buffer to the host
-    for (uint32_t i = 0; i < out_y_plane_desc.image_height; ++i)
-    {
-        std::memcpy(
-                out_nv12_image_info.y_plane.data() + i * out_y_plane_desc.image_width,
-                image_ptr                          + i * row_pitch,
-                out_y_plane_desc.image_width
-        );
-    }
-
-    err = clEnqueueUnmapMemObject(command_queue, out_y_plane, image_ptr, 0, NULL, NULL);
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " unmapping dest image y-plane buffer." << "\n";
-        std::exit(err);
-    }
-
-    clFinish(command_queue);
-
-    save_nv12_image_data(out_image_filename, out_nv12_image_info);
-
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseSampler(sampler);
-    clReleaseMemObject(src_y_plane);
-    clReleaseMemObject(src_nv12_image);
-    clReleaseMemObject(out_nv12_buffer);
-    clReleaseMemObject(out_y_plane);
-    clReleaseMemObject(out_nv12_image);
+        if (src_nv12_image_info.y_width != src_nv12_desc.image_width
+            || src_nv12_image_info.y_height != src_nv12_desc.image_height)
+        {
+            std::cerr << src_image_filenames[frame] << " is " << src_nv12_image_info.y_width << "x"
+                      << src_nv12_image_info.y_height << ", but every source must be the same size as the first, "
+                      << src_nv12_desc.image_width << "x" << src_nv12_desc.image_height << ".\n";
+            std::exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Step 4: Copy data to input image planes. Note that for linear NV12 images you must observe row
+         * alignment restrictions. (You may also write to the ion buffer directly if you prefer, however using
+         * clEnqueueMapImage for a child planar image will return the correct host pointer for the desired plane.)
+         */
+
+        const size_t   src_y_region[] = {src_y_plane_desc.image_width, src_y_plane_desc.image_height, 1};
+        size_t         row_pitch      = 0;
+        unsigned char *image_ptr      = static_cast<unsigned char *>(clEnqueueMapImage(
+                command_queue,
+                src_y_plane.get(),
+                CL_TRUE,
+                CL_MAP_WRITE,
+                origin,
+                src_y_region,
+                &row_pitch,
+                NULL,
+                0,
+                NULL,
+                NULL,
+                &err
+        ));
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error " << err << " mapping source image y-plane buffer for writing." << "\n";
+            std::exit(err);
+        }
+
+        // Copies image data to the ION buffer from the host
+        for (uint32_t i = 0; i < src_y_plane_desc.image_height; ++i)
+        {
+            std::memcpy(
+                    image_ptr                          + i * row_pitch,
+                    src_nv12_image_info.y_plane.data() + i * src_y_plane_desc.image_width,
+                    src_y_plane_desc.image_width
+            );
+        }
+
+        err = clEnqueueUnmapMemObject(command_queue, src_y_plane.get(), image_ptr, 0, NULL, NULL);
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error " << err << " unmapping source image y-plane data buffer." << "\n";
+            std::exit(err);
+        }
+
+        /*
+         * Step 5: Run the kernel separately for y-plane only
+         */
+
+        const size_t y_plane_work_size[] = {out_y_plane_desc.image_width / 2, out_y_plane_desc.image_height / 2};
+        wrapper.enqueue_kernel(y_plane_kernel, 2, y_plane_work_size, NULL);
+
+        clFinish(command_queue);
+
+        /*
+         * Step 6: Copy the data out of the ion buffer for each plane.
+         */
+
+        nv12_image_t out_nv12_image_info;
+        out_nv12_image_info.y_width  = out_nv12_desc.image_width;
+        out_nv12_image_info.y_height = out_nv12_desc.image_height;
+        out_nv12_image_info.y_plane.resize(out_nv12_image_info.y_width * out_nv12_image_info.y_height);
+        out_nv12_image_info.uv_plane = src_nv12_image_info.uv_plane;
+
+        const size_t out_y_region[] = {out_y_plane_desc.image_width, out_y_plane_desc.image_height, 1};
+        row_pitch                   = 0;
+        image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
+                command_queue,
+                out_y_plane.get(),
+                CL_TRUE,
+                CL_MAP_READ,
+                origin,
+                out_y_region,
+                &row_pitch,
+                NULL,
+                0,
+                NULL,
+                NULL,
+                &err
+        ));
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error " << err << " mapping dest image y-plane buffer for reading." << "\n";
+            std::exit(err);
+        }
+
+        // Copies image data from the ION buffer to the host
+        for (uint32_t i = 0; i < out_y_plane_desc.image_height; ++i)
+        {
+            std::memcpy(
+                    out_nv12_image_info.y_plane.data() + i * out_y_plane_desc.image_width,
+                    image_ptr                          + i * row_pitch,
+                    out_y_plane_desc.image_width
+            );
+        }
+
+        err = clEnqueueUnmapMemObject(command_queue, out_y_plane.get(), image_ptr, 0, NULL, NULL);
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error " << err << " unmapping dest image y-plane buffer." << "\n";
+            std::exit(err);
+        }
+
+        clFinish(command_queue);
+
+        save_nv12_image_data(out_image_filenames[frame], out_nv12_image_info);
+        ++frame;
+    } while (src_loader.next(src_nv12_image_info));
 
     return 0;
 }
@@ -16,6 +16,7 @@
 #include <iostream>
 
 // Project includes
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 #include "util/util.h"
 
@@ -190,8 +191,8 @@ int main(int argc, char** argv)
 
     cl_wrapper   wrapper;
     cl_program   program             = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
-    cl_kernel    kernel_row_pass     = wrapper.make_kernel("fft_row_pass", program);
-    cl_kernel    kernel_col_pass     = wrapper.make_kernel("fft_col_pass", program);
+    cl_kernel    kernel_row_pass     = wrapper.get_kernel("fft_row_pass", program);
+    cl_kernel    kernel_col_pass     = wrapper.get_kernel("fft_col_pass", program);
     cl_context   context             = wrapper.get_context();
     nv12_image_t src_nv12_image_info = load_nv12_image_data(src_image_filename);
 
@@ -246,32 +247,32 @@ int main(int argc, char** argv)
     src_nv12_desc.image_width  = src_nv12_image_info.y_width;
     src_nv12_desc.image_height = src_nv12_image_info.y_height;
 
-    cl_mem_ion_host_ptr src_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_nv12_format, src_nv12_desc);
+    ion_allocation src_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_nv12_format, src_nv12_desc);
     cl_int err;
-    cl_mem src_nv12_image = clCreateImage(
+    cl_mem_handle src_nv12_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &src_nv12_format,
             &src_nv12_desc,
-            &src_nv12_ion_mem,
+            src_nv12_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image." << "\n";
         std::exit(err);
     }
 
-    const size_t        row_pass_result_buffer_size = src_nv12_desc.image_width * src_nv12_desc.image_height
-                                                      * sizeof(cl_float2);
-    cl_mem_ion_host_ptr row_pass_result_ion_mem     = wrapper.make_ion_buffer(row_pass_result_buffer_size);
-    cl_mem row_pass_result                          = clCreateBuffer(
+    const size_t   row_pass_result_buffer_size = src_nv12_desc.image_width * src_nv12_desc.image_height
+                                                 * sizeof(cl_float2);
+    ion_allocation row_pass_result_ion_mem     = wrapper.make_ion_buffer(row_pass_result_buffer_size);
+    cl_mem_handle row_pass_result(clCreateBuffer(
             context,
             CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             row_pass_result_buffer_size,
-            &row_pass_result_ion_mem,
+            row_pass_result_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer." << "\n";
@@ -289,15 +290,15 @@ int main(int argc, char** argv)
     real_out_desc.image_height    = src_nv12_image_info.y_height;
     real_out_desc.image_row_pitch = wrapper.get_ion_image_row_pitch(real_out_format, real_out_desc);
 
-    cl_mem_ion_host_ptr real_out_ion_mem = wrapper.make_ion_buffer_for_nonplanar_image(real_out_format, real_out_desc);
-    cl_mem real_out_image = clCreateImage(
+    ion_allocation real_out_ion_mem = wrapper.make_ion_buffer_for_nonplanar_image(real_out_format, real_out_desc);
+    cl_mem_handle real_out_image(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &real_out_format,
             &real_out_desc,
-            &real_out_ion_mem,
+            real_out_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for output image, real part." << "\n";
@@ -315,15 +316,15 @@ int main(int argc, char** argv)
     imag_out_desc.image_height    = src_nv12_image_info.y_height;
     imag_out_desc.image_row_pitch = wrapper.get_ion_image_row_pitch(imag_out_format, imag_out_desc);
 
-    cl_mem_ion_host_ptr imag_out_ion_mem = wrapper.make_ion_buffer_for_nonplanar_image(imag_out_format, imag_out_desc);
-    cl_mem imag_out_image = clCreateImage(
+    ion_allocation imag_out_ion_mem = wrapper.make_ion_buffer_for_nonplanar_image(imag_out_format, imag_out_desc);
+    cl_mem_handle imag_out_image(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &imag_out_format,
             &imag_out_desc,
-            &imag_out_ion_mem,
+            imag_out_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for output image, imaginary part." << "\n";
@@ -343,16 +344,16 @@ int main(int argc, char** argv)
     src_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     src_y_plane_desc.image_width  = src_nv12_image_info.y_width;
     src_y_plane_desc.image_height = src_nv12_image_info.y_height;
-    src_y_plane_desc.mem_object   = src_nv12_image;
+    src_y_plane_desc.mem_object   = src_nv12_image.get();
 
-    cl_mem src_y_plane = clCreateImage(
+    cl_mem_handle src_y_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_y_plane_format,
             &src_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image y plane." << "\n";
@@ -371,7 +372,7 @@ int main(int argc, char** argv)
     size_t           row_pitch      = 0;
     unsigned char   *image_ptr      = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            src_y_plane,
+            src_y_plane.get(),
             CL_TRUE,
             CL_MAP_WRITE,
             origin,
@@ -399,7 +400,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, src_y_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, src_y_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping source image y-plane data buffer." << "\n";
@@ -410,13 +411,13 @@ int main(int argc, char** argv)
      * Step 4: Set up other kernel arguments
      */
 
-    cl_sampler sampler = clCreateSampler(
+    cl_sampler_handle sampler(clCreateSampler(
             context,
             CL_FALSE,
             CL_ADDRESS_NONE,
             CL_FILTER_NEAREST,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateSampler." << "\n";
@@ -427,14 +428,14 @@ int main(int argc, char** argv)
      * Step 5: Set up and run the row- and column-pass kernels.
      */
 
-    err = clSetKernelArg(kernel_row_pass, 0, sizeof(src_y_plane), &src_y_plane);
+    err = clSetKernelArg(kernel_row_pass, 0, sizeof(cl_mem), src_y_plane.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel_row_pass, 1, sizeof(row_pass_result), &row_pass_result);
+    err = clSetKernelArg(kernel_row_pass, 1, sizeof(cl_mem), row_pass_result.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1." << "\n";
@@ -457,7 +458,7 @@ int main(int argc, char** argv)
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel_row_pass, 4, sizeof(sampler), &sampler);
+    err = clSetKernelArg(kernel_row_pass, 4, sizeof(cl_sampler), sampler.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 4." << "\n";
@@ -474,38 +475,23 @@ int main(int argc, char** argv)
     const size_t row_pass_wg_size           = wrapper.get_max_workgroup_size(kernel_row_pass);
     const size_t global_work_size[]         = {src_nv12_desc.image_width / 2, src_nv12_desc.image_height};
     const size_t row_pass_local_work_size[] = {std::min(src_nv12_desc.image_width / 2, row_pass_wg_size), 1};
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            kernel_row_pass,
-            2,
-            NULL,
-            global_work_size,
-            row_pass_local_work_size,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " with clEnqueueNDRangeKernel." << "\n";
-        std::exit(err);
-    }
+    wrapper.enqueue_kernel(kernel_row_pass, 2, global_work_size, row_pass_local_work_size);
 
-    err = clSetKernelArg(kernel_col_pass, 0, sizeof(row_pass_result), &row_pass_result);
+    err = clSetKernelArg(kernel_col_pass, 0, sizeof(cl_mem), row_pass_result.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel_col_pass, 1, sizeof(real_out_image), &real_out_image);
+    err = clSetKernelArg(kernel_col_pass, 1, sizeof(cl_mem), real_out_image.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel_col_pass, 2, sizeof(imag_out_image), &imag_out_image);
+    err = clSetKernelArg(kernel_col_pass, 2, sizeof(cl_mem), imag_out_image.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 2." << "\n";
@@ -535,22 +521,7 @@ int main(int argc, char** argv)
 
     const size_t col_pass_wg_size           = wrapper.get_max_workgroup_size(kernel_col_pass);
     const size_t col_pass_local_work_size[] = {std::min(src_nv12_desc.image_width / 2, col_pass_wg_size), 1};
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            kernel_col_pass,
-            2,
-            NULL,
-            global_work_size,
-            col_pass_local_work_size,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " with clEnqueueNDRangeKernel." << "\n";
-        std::exit(err);
-    }
+    wrapper.enqueue_kernel(kernel_col_pass, 2, global_work_size, col_pass_local_work_size);
 
     clFinish(command_queue);
 
@@ -567,7 +538,7 @@ int main(int argc, char** argv)
     row_pitch                 = 0;
     image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            real_out_image,
+            real_out_image.get(),
             CL_TRUE,
             CL_MAP_READ,
             origin,
@@ -595,7 +566,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, real_out_image, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, real_out_image.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping real part output image." << "\n";
@@ -609,7 +580,7 @@ int main(int argc, char** argv)
 
     image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            imag_out_image,
+            imag_out_image.get(),
             CL_TRUE,
             CL_MAP_READ,
             origin,
@@ -637,7 +608,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, imag_out_image, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, imag_out_image.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping imaginary part output image." << "\n";
@@ -649,14 +620,6 @@ int main(int argc, char** argv)
     save_single_channel_image_data(real_out_filename, real_out_info);
     save_single_channel_image_data(imag_out_filename, imag_out_info);
 
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseSampler(sampler);
-    clReleaseMemObject(src_y_plane);
-    clReleaseMemObject(src_nv12_image);
-    clReleaseMemObject(real_out_image);
-    clReleaseMemObject(imag_out_image);
-    clReleaseMemObject(row_pass_result);
-
     return 0;
 }
 
@@ -14,8 +14,11 @@
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <string>
 
 // Project includes
+#include "fft_matrix_kernels.h"
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 #include "util/util.h"
 
@@ -29,149 +32,8 @@ static const char *HELP_MESSAGE = "\n"
 "<source>, and writes the real and imaginary parts of the output to the matrices\n"
 "<real output> and <imaginary output>, respectively. We use the well-known\n"
 "Cooley-Tukey algorithm.\n"
-"The matrix must have width = height = a power of 2.\n";
-
-static const char *PROGRAM_SOURCE[] = {
-// Forward declaration
-"uint bit_reverse(uint n, int num_bits);\n",
-// Each work group will find the FFT of one row.
-// Writes the result of this pass into a buffer, already transposed so that
-// it can be used optimally in the next pass.
-"__kernel void fft_row_pass(__global const float *src_matrix,\n",
-"                           __global float2      *result,\n",
-"                                    int          width,\n",
-"                                    int          log_w,\n",
-"                           __local  float2      *scratch)\n",
-"{\n",
-"    const int local_id   = get_local_id(0);\n",
-"    const int local_size = get_local_size(0);\n",
-"    const int y_coord    = get_group_id(1);\n",
-"\n",
-"    for (int i = local_id; i < (width / 2); i += local_size)\n",
-"    {\n",
-"        const int    idx0    = bit_reverse(2 * i,     log_w);\n",
-"        const int    idx1    = bit_reverse(2 * i + 1, log_w);\n",
-"        const int    coords0 = idx0 + width * y_coord;\n",
-"        const int    coords1 = idx1 + width * y_coord;\n",
-"        const float  x0      = src_matrix[coords0];\n",
-"        const float  x1      = src_matrix[coords1];\n",
-"        const float2 res0    = (float2)(x0 + x1, 0.f);\n",
-"        const float2 res1    = (float2)(x0 - x1, 0.f);\n",
-"        scratch[2 * i]       = res0;\n",
-"        scratch[2 * i + 1]   = res1;\n",
-"    }\n",
-"    barrier(CLK_LOCAL_MEM_FENCE);\n",
-"\n",
-"    for (int working_size = 2; working_size < (width / 2); working_size *= 2)\n",
-"    {\n",
-"        const int offset = (local_id / working_size) * working_size;\n",
-"        for (int i = local_id; i < (width / 2); i += local_size)\n",
-"        {\n",
-"            const int    idx            = offset + i;\n",
-"            const float2 temp0          = scratch[idx];\n",
-"            const float2 temp1          = scratch[idx + working_size];\n",
-"            const float  coeff_r        = native_cos(-1.f * M_PI_F * (i % working_size) * native_recip(working_size));\n",
-"            const float  coeff_i        = native_sin(-1.f * M_PI_F * (i % working_size) * native_recip(working_size));\n",
-"            const float2 product        = (float2)(coeff_r * temp1.x - coeff_i * temp1.y,\n",
-"                                                   coeff_r * temp1.y + coeff_i * temp1.x);\n",
-"            scratch[idx]                = temp0 + product;\n",
-"            scratch[idx + working_size] = temp0 - product;\n",
-"        }\n",
-"        barrier(CLK_LOCAL_MEM_FENCE);\n",
-"    }\n",
-"\n",
-"    for (int i = local_id; i < (width / 2); i += local_size)\n",
-"    {\n",
-"        const int    idx0    = i               * width + y_coord;\n",
-"        const int    idx1    = (i + width / 2) * width + y_coord;\n",
-"        const float2 temp0   = scratch[i];\n",
-"        const float2 temp1   = scratch[i + width / 2];\n",
-"        const float  coeff_r = native_cos(-2.f * M_PI_F * i * native_recip(width));\n",
-"        const float  coeff_i = native_sin(-2.f * M_PI_F * i * native_recip(width));\n",
-"        const float2 product = (float2)(coeff_r * temp1.x - coeff_i * temp1.y,\n",
-"                                        coeff_r * temp1.y + coeff_i * temp1.x);\n",
-"        result[idx0]         = temp0 + product;\n",
-"        result[idx1]         = temp0 - product;\n",
-"    }\n",
-"}\n",
-"\n",
-// Does the column pass on the transposed result of the row pass.
-// Each work group will find the FFT of one column.
-"__kernel void fft_col_pass(__global const float2 *data,\n",
-"                           __global float        *real_part,\n",
-"                           __global float        *imag_part,\n",
-"                                    int           width,\n",
-"                                    int           log_w,\n",
-"                           __local  float2       *scratch)\n",
-"{\n",
-"    const int local_id   = get_local_id(0);\n",
-"    const int local_size = get_local_size(0);\n",
-"    const int y_coord    = get_group_id(1);\n",
-"\n",
-"    for (int i = local_id; i < (width / 2); i += local_size)\n",
-"    {\n",
-"        const int    idx0    = bit_reverse(2 * i,     log_w) + width * y_coord;\n",
-"        const int    idx1    = bit_reverse(2 * i + 1, log_w) + width * y_coord;\n",
-"        const int2   coords0 = (int2)(idx0, y_coord);\n",
-"        const int2   coords1 = (int2)(idx1, y_coord);\n",
-"        const float2 x0      = data[idx0];\n",
-"        const float2 x1      = data[idx1];\n",
-"        const float2 res0    = x0 + x1;\n",
-"        const float2 res1    = x0 - x1;\n",
-"        scratch[2 * i]       = res0;\n",
-"        scratch[2 * i + 1]   = res1;\n",
-"    }\n",
-"    barrier(CLK_LOCAL_MEM_FENCE);\n",
-"\n",
-"    for (int working_size = 2; working_size < (width / 2); working_size *= 2)\n",
-"    {\n",
-"        const int offset = (local_id / working_size) * working_size;\n",
-"        for (int i = local_id; i < (width / 2); i += local_size)\n",
-"        {\n",
-"            const int    idx            = offset + i;\n",
-"            const float2 temp0          = scratch[idx];\n",
-"            const float2 temp1          = scratch[idx + working_size];\n",
-"            const float  coeff_r        = native_cos(-1.f * M_PI_F * (i % working_size) * native_recip(working_size));\n",
-"            const float  coeff_i        = native_sin(-1.f * M_PI_F * (i % working_size) * native_recip(working_size));\n",
-"            const float2 product        = (float2)(coeff_r * temp1.x - coeff_i * temp1.y,\n",
-"                                                   coeff_r * temp1.y + coeff_i * temp1.x);\n",
-"            scratch[idx]                = temp0 + product;\n",
-"            scratch[idx + working_size] = temp0 - product;\n",
-"        }\n",
-"        barrier(CLK_LOCAL_MEM_FENCE);\n",
-"    }\n",
-"\n",
-"    for (int i = local_id; i < (width / 2); i += local_size)\n",
-"    {\n",
-"        const int idx0       = y_coord + width * i;\n",
-"        const int idx1       = y_coord + width * (i + width / 2);\n",
-"        const float2 temp0   = scratch[i];\n",
-"        const float2 temp1   = scratch[i + width / 2];\n",
-"        const float  coeff_r = native_cos(-2.f * M_PI_F * i * native_recip(width));\n",
-"        const float  coeff_i = native_sin(-2.f * M_PI_F * i * native_recip(width));\n",
-"        const float2 product = (float2)(coeff_r * temp1.x - coeff_i * temp1.y,\n",
-"                                        coeff_r * temp1.y + coeff_i * temp1.x);\n",
-"        const float2 res0    = temp0 + product;\n",
-"        const float2 res1    = temp0 - product;\n",
-"        real_part[idx0]      = res0.x;\n",
-"        real_part[idx1]      = res1.x;\n",
-"        imag_part[idx0]      = res0.y;\n",
-"        imag_part[idx1]      = res1.y;\n",
-"    }\n",
-"}\n",
-"\n",
-"uint bit_reverse(uint n, int num_bits)\n",
-"{\n",
-"    uint res = 0;\n",
-"    for (int i = 0; i < num_bits; ++i)\n",
-"    {\n",
-"        res |= (((1 << i) & n) >> i) << (num_bits - 1 - i);\n",
-"    }\n",
-"    return res;\n",
-"}\n",
-};
-
-static const cl_uint PROGRAM_SOURCE_LEN = sizeof(PROGRAM_SOURCE) / sizeof(const char *);
+"The matrix must have width = height = a power of 2. The kernels are built\n"
+"specialized for that size.\n";
 
 static bool is_power_of_2(size_t n);
 
@@ -187,13 +49,7 @@ int main(int argc, char** argv)
     const std::string real_out_filename(argv[2]);
     const std::string imag_out_filename(argv[3]);
 
-    cl_wrapper wrapper;
-    cl_program program         = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
-    cl_kernel  kernel_row_pass = wrapper.make_kernel("fft_row_pass", program);
-    cl_kernel  kernel_col_pass = wrapper.make_kernel("fft_col_pass", program);
-    cl_context context         = wrapper.get_context();
-    matrix_t   src_matrix      = load_matrix(src_matrix_filename);
-
+    const matrix_t src_matrix = load_matrix(src_matrix_filename);
     if ((src_matrix.width != src_matrix.height)
         || !is_power_of_2(src_matrix.width))
     {
@@ -203,6 +59,19 @@ int main(int argc, char** argv)
         std::exit(EXIT_FAILURE);
     }
 
+    // The size is fixed for the whole run, so the kernels can be compiled for it
+    const program_defines_t fft_size_defines = {
+        {"FFT_WIDTH", std::to_string(src_matrix.width)},
+        {"FFT_LOG_W", std::to_string(static_cast<int>(std::log2(src_matrix.width)))},
+    };
+
+    cl_wrapper wrapper;
+    cl_program program         = wrapper.make_program(FFT_MATRIX_PROGRAM_SOURCE, FFT_MATRIX_PROGRAM_SOURCE_LEN, "",
+                                                      fft_size_defines);
+    cl_kernel  kernel_row_pass = wrapper.get_kernel("fft_row_pass", program);
+    cl_kernel  kernel_col_pass = wrapper.get_kernel("fft_col_pass", program);
+    cl_context context         = wrapper.get_context();
+
     /*
      * Step 0: Confirm the required OpenCL extensions are supported.
      */
@@ -223,60 +92,63 @@ int main(int argc, char** argv)
      * Step 1: Create suitable ion buffer-backed CL images.
      */
 
-    const size_t        src_matrix_bytes = src_matrix.width * src_matrix.height * sizeof(cl_float);
-    cl_mem_ion_host_ptr src_ion_mem      = wrapper.make_ion_buffer(src_matrix_bytes);
-    std::memcpy(src_ion_mem.ion_hostptr, src_matrix.elements.data(), src_matrix_bytes);
+    const size_t   src_matrix_bytes = src_matrix.width * src_matrix.height * sizeof(cl_float);
+    ion_allocation src_ion_mem      = wrapper.make_ion_buffer(src_matrix_bytes);
+    {
+        TRACE_SCOPE("memcpy to ion");
+        std::memcpy(src_ion_mem->ion_hostptr, src_matrix.elements.data(), src_matrix_bytes);
+    }
     cl_int err;
-    cl_mem src_matrix_mem = clCreateBuffer(
+    cl_mem_handle src_matrix_mem(clCreateBuffer(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             src_matrix_bytes,
-            &src_ion_mem,
+            src_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer for source image." << "\n";
         std::exit(err);
     }
 
-    const size_t        row_pass_result_buffer_size = src_matrix.width * src_matrix.height * sizeof(cl_float2);
-    cl_mem_ion_host_ptr row_pass_result_ion_mem     = wrapper.make_ion_buffer(row_pass_result_buffer_size);
-    cl_mem row_pass_result_mem                      = clCreateBuffer(
+    const size_t   row_pass_result_buffer_size = src_matrix.width * src_matrix.height * sizeof(cl_float2);
+    ion_allocation row_pass_result_ion_mem     = wrapper.make_ion_buffer(row_pass_result_buffer_size);
+    cl_mem_handle row_pass_result_mem(clCreateBuffer(
             context,
             CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             row_pass_result_buffer_size,
-            &row_pass_result_ion_mem,
+            row_pass_result_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer." << "\n";
         std::exit(err);
     }
 
-    cl_mem_ion_host_ptr real_out_ion_mem = wrapper.make_ion_buffer(src_matrix_bytes);
-    cl_mem real_out_matrix_mem = clCreateBuffer(
+    ion_allocation real_out_ion_mem = wrapper.make_ion_buffer(src_matrix_bytes);
+    cl_mem_handle real_out_matrix_mem(clCreateBuffer(
             context,
             CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             src_matrix_bytes,
-            &real_out_ion_mem,
+            real_out_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer for real output matrix." << "\n";
         std::exit(err);
     }
 
-    cl_mem_ion_host_ptr imag_out_ion_mem = wrapper.make_ion_buffer(src_matrix_bytes);
-    cl_mem imag_out_matrix_mem = clCreateBuffer(
+    ion_allocation imag_out_ion_mem = wrapper.make_ion_buffer(src_matrix_bytes);
+    cl_mem_handle imag_out_matrix_mem(clCreateBuffer(
             context,
             CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             src_matrix_bytes,
-            &imag_out_ion_mem,
+            imag_out_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer for imaginary output matrix." << "\n";
@@ -287,14 +159,14 @@ int main(int argc, char** argv)
      * Step 2: Set up and run the row- and column-pass kernels.
      */
 
-    err = clSetKernelArg(kernel_row_pass, 0, sizeof(src_matrix_mem), &src_matrix_mem);
+    err = clSetKernelArg(kernel_row_pass, 0, sizeof(cl_mem), src_matrix_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel_row_pass, 1, sizeof(row_pass_result_mem), &row_pass_result_mem);
+    err = clSetKernelArg(kernel_row_pass, 1, sizeof(cl_mem), row_pass_result_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1." << "\n";
@@ -324,43 +196,28 @@ int main(int argc, char** argv)
         std::exit(err);
     }
 
-
-    cl_command_queue command_queue          = wrapper.get_command_queue();
     const size_t row_pass_wg_size           = wrapper.get_max_workgroup_size(kernel_row_pass);
     const size_t global_work_size[]         = {static_cast<size_t>(src_matrix.width / 2), static_cast<size_t>(src_matrix.height)};
     const size_t row_pass_local_work_size[] = {std::min(global_work_size[0], row_pass_wg_size), 1};
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            kernel_row_pass,
-            2,
-            NULL,
-            global_work_size,
-            row_pass_local_work_size,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " with clEnqueueNDRangeKernel." << "\n";
-        std::exit(err);
-    }
+    // Reads the real input and writes the complex row-pass result
+    wrapper.enqueue_kernel(kernel_row_pass, 2, global_work_size, row_pass_local_work_size,
+                           src_matrix_bytes + row_pass_result_buffer_size);
 
-    err = clSetKernelArg(kernel_col_pass, 0, sizeof(row_pass_result_mem), &row_pass_result_mem);
+    err = clSetKernelArg(kernel_col_pass, 0, sizeof(cl_mem), row_pass_result_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel_col_pass, 1, sizeof(real_out_matrix_mem), &real_out_matrix_mem);
+    err = clSetKernelArg(kernel_col_pass, 1, sizeof(cl_mem), real_out_matrix_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel_col_pass, 2, sizeof(imag_out_matrix_mem), &imag_out_matrix_mem);
+    err = clSetKernelArg(kernel_col_pass, 2, sizeof(cl_mem), imag_out_matrix_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 2." << "\n";
@@ -390,22 +247,9 @@ int main(int argc, char** argv)
 
     const size_t col_pass_wg_size           = wrapper.get_max_workgroup_size(kernel_col_pass);
     const size_t col_pass_local_work_size[] = {std::min<size_t>(src_matrix.width / 2, col_pass_wg_size), 1};
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            kernel_col_pass,
-            2,
-            NULL,
-            global_work_size,
-            col_pass_local_work_size,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " with clEnqueueNDRangeKernel." << "\n";
-        std::exit(err);
-    }
+    // Reads the complex row-pass result and writes the real and imaginary outputs
+    wrapper.enqueue_kernel(kernel_col_pass, 2, global_work_size, col_pass_local_work_size,
+                           row_pass_result_buffer_size + 2 * src_matrix_bytes);
 
     /*
      * Step 3: Copy the data out of the ion buffer for each plane.
@@ -416,75 +260,31 @@ int main(int argc, char** argv)
     real_out_info.height = src_matrix.height;
     real_out_info.elements.resize(real_out_info.width * real_out_info.height);
     cl_float *mat_ptr    = NULL;
-    mat_ptr = static_cast<cl_float *>(clEnqueueMapBuffer(
-            command_queue,
-            real_out_matrix_mem,
-            CL_BLOCKING,
-            CL_MAP_READ,
-            0,
-            src_matrix_bytes,
-            0,
-            NULL,
-            NULL,
-            &err
-    ));
-    if (err != CL_SUCCESS)
+    mat_ptr = static_cast<cl_float *>(wrapper.enqueue_map_buffer(real_out_matrix_mem.get(), CL_MAP_READ, 0,
+                                                                 src_matrix_bytes));
     {
-        std::cerr << "Error " << err << " mapping real part output matrix for reading." << "\n";
-        std::exit(err);
-    }
-
-    std::memcpy(real_out_info.elements.data(), mat_ptr, src_matrix_bytes);
-
-    err = clEnqueueUnmapMemObject(command_queue, real_out_matrix_mem, mat_ptr, 0, NULL, NULL);
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " unmapping real part output matrix." << "\n";
-        std::exit(err);
+        TRACE_SCOPE("memcpy from ion");
+        std::memcpy(real_out_info.elements.data(), mat_ptr, src_matrix_bytes);
     }
+    wrapper.enqueue_unmap_mem_object(real_out_matrix_mem.get(), mat_ptr);
 
     matrix_t imag_out_info;
     imag_out_info.width  = src_matrix.width;
     imag_out_info.height = src_matrix.height;
     imag_out_info.elements.resize(imag_out_info.width * imag_out_info.height);
-    mat_ptr = static_cast<cl_float *>(clEnqueueMapBuffer(
-            command_queue,
-            imag_out_matrix_mem,
-            CL_BLOCKING,
-            CL_MAP_READ,
-            0,
-            src_matrix_bytes,
-            0,
-            NULL,
-            NULL,
-            &err
-    ));
-    if (err != CL_SUCCESS)
+    mat_ptr = static_cast<cl_float *>(wrapper.enqueue_map_buffer(imag_out_matrix_mem.get(), CL_MAP_READ, 0,
+                                                                 src_matrix_bytes));
     {
-        std::cerr << "Error " << err << " mapping imaginary part output matrix for reading." << "\n";
-        std::exit(err);
+        TRACE_SCOPE("memcpy from ion");
+        std::memcpy(imag_out_info.elements.data(), mat_ptr, src_matrix_bytes);
     }
+    wrapper.enqueue_unmap_mem_object(imag_out_matrix_mem.get(), mat_ptr);
 
-    std::memcpy(imag_out_info.elements.data(), mat_ptr, src_matrix_bytes);
-
-    err = clEnqueueUnmapMemObject(command_queue, imag_out_matrix_mem, mat_ptr, 0, NULL, NULL);
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " unmapping imaginary part output matrix." << "\n";
-        std::exit(err);
-    }
-
-    clFinish(command_queue);
+    wrapper.finish();
 
     save_matrix(real_out_filename, real_out_info);
     save_matrix(imag_out_filename, imag_out_info);
 
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseMemObject(src_matrix_mem);
-    clReleaseMemObject(row_pass_result_mem);
-    clReleaseMemObject(real_out_matrix_mem);
-    clReleaseMemObject(imag_out_matrix_mem);
-
     return 0;
 }
 
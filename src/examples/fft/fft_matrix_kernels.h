@@ -0,0 +1,171 @@
+//--------------------------------------------------------------------------------------
+// File: fft_matrix_kernels.h
+// Desc: The kernels of fft_matrix.cpp, shared with the specialization benchmark
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+#ifndef SDK_EXAMPLES_FFT_MATRIX_KERNELS_H
+#define SDK_EXAMPLES_FFT_MATRIX_KERNELS_H
+
+#include <CL/cl.h>
+
+static const char *FFT_MATRIX_PROGRAM_SOURCE[] = {
+// Built with -D FFT_WIDTH=<width> -D FFT_LOG_W=<log2(width)>, the kernels use
+// these constants in place of their width and log_w arguments, so the compiler
+// can unroll the loops over a row and the bit reversal. Without them the
+// kernels work for any width.
+"#ifdef FFT_WIDTH\n",
+"#define WIDTH FFT_WIDTH\n",
+"#define LOG_W FFT_LOG_W\n",
+"#else\n",
+"#define WIDTH width\n",
+"#define LOG_W log_w\n",
+"#endif\n",
+"\n",
+// Forward declaration
+"uint bit_reverse(uint n, int num_bits);\n",
+// Each work group will find the FFT of one row.
+// Writes the result of this pass into a buffer, already transposed so that
+// it can be used optimally in the next pass.
+"__kernel void fft_row_pass(__global const float *src_matrix,\n",
+"                           __global float2      *result,\n",
+"                                    int          width,\n",
+"                                    int          log_w,\n",
+"                           __local  float2      *scratch)\n",
+"{\n",
+"    const int local_id   = get_local_id(0);\n",
+"    const int local_size = get_local_size(0);\n",
+"    const int y_coord    = get_group_id(1);\n",
+"\n",
+"    for (int i = local_id; i < (WIDTH / 2); i += local_size)\n",
+"    {\n",
+"        const int    idx0    = bit_reverse(2 * i,     LOG_W);\n",
+"        const int    idx1    = bit_reverse(2 * i + 1, LOG_W);\n",
+"        const int    coords0 = idx0 + WIDTH * y_coord;\n",
+"        const int    coords1 = idx1 + WIDTH * y_coord;\n",
+"        const float  x0      = src_matrix[coords0];\n",
+"        const float  x1      = src_matrix[coords1];\n",
+"        const float2 res0    = (float2)(x0 + x1, 0.f);\n",
+"        const float2 res1    = (float2)(x0 - x1, 0.f);\n",
+"        scratch[2 * i]       = res0;\n",
+"        scratch[2 * i + 1]   = res1;\n",
+"    }\n",
+"    barrier(CLK_LOCAL_MEM_FENCE);\n",
+"\n",
+"    for (int working_size = 2; working_size < (WIDTH / 2); working_size *= 2)\n",
+"    {\n",
+"        const int offset = (local_id / working_size) * working_size;\n",
+"        for (int i = local_id; i < (WIDTH / 2); i += local_size)\n",
+"        {\n",
+"            const int    idx            = offset + i;\n",
+"            const float2 temp0          = scratch[idx];\n",
+"            const float2 temp1          = scratch[idx + working_size];\n",
+"            const float  coeff_r        = native_cos(-1.f * M_PI_F * (i % working_size) * native_recip(working_size));\n",
+"            const float  coeff_i        = native_sin(-1.f * M_PI_F * (i % working_size) * native_recip(working_size));\n",
+"            const float2 product        = (float2)(coeff_r * temp1.x - coeff_i * temp1.y,\n",
+"                                                   coeff_r * temp1.y + coeff_i * temp1.x);\n",
+"            scratch[idx]                = temp0 + product;\n",
+"            scratch[idx + working_size] = temp0 - product;\n",
+"        }\n",
+"        barrier(CLK_LOCAL_MEM_FENCE);\n",
+"    }\n",
+"\n",
+"    for (int i = local_id; i < (WIDTH / 2); i += local_size)\n",
+"    {\n",
+"        const int    idx0    = i               * WIDTH + y_coord;\n",
+"        const int    idx1    = (i + WIDTH / 2) * WIDTH + y_coord;\n",
+"        const float2 temp0   = scratch[i];\n",
+"        const float2 temp1   = scratch[i + WIDTH / 2];\n",
+"        const float  coeff_r = native_cos(-2.f * M_PI_F * i * native_recip(WIDTH));\n",
+"        const float  coeff_i = native_sin(-2.f * M_PI_F * i * native_recip(WIDTH));\n",
+"        const float2 product = (float2)(coeff_r * temp1.x - coeff_i * temp1.y,\n",
+"                                        coeff_r * temp1.y + coeff_i * temp1.x);\n",
+"        result[idx0]         = temp0 + product;\n",
+"        result[idx1]         = temp0 - product;\n",
+"    }\n",
+"}\n",
+"\n",
+// Does the column pass on the transposed result of the row pass.
+// Each work group will find the FFT of one column.
+"__kernel void fft_col_pass(__global const float2 *data,\n",
+"                           __global float        *real_part,\n",
+"                           __global float        *imag_part,\n",
+"                                    int           width,\n",
+"                                    int           log_w,\n",
+"                           __local  float2       *scratch)\n",
+"{\n",
+"    const int local_id   = get_local_id(0);\n",
+"    const int local_size = get_local_size(0);\n",
+"    const int y_coord    = get_group_id(1);\n",
+"\n",
+"    for (int i = local_id; i < (WIDTH / 2); i += local_size)\n",
+"    {\n",
+"        const int    idx0    = bit_reverse(2 * i,     LOG_W) + WIDTH * y_coord;\n",
+"        const int    idx1    = bit_reverse(2 * i + 1, LOG_W) + WIDTH * y_coord;\n",
+"        const int2   coords0 = (int2)(idx0, y_coord);\n",
+"        const int2   coords1 = (int2)(idx1, y_coord);\n",
+"        const float2 x0      = data[idx0];\n",
+"        const float2 x1      = data[idx1];\n",
+"        const float2 res0    = x0 + x1;\n",
+"        const float2 res1    = x0 - x1;\n",
+"        scratch[2 * i]       = res0;\n",
+"        scratch[2 * i + 1]   = res1;\n",
+"    }\n",
+"    barrier(CLK_LOCAL_MEM_FENCE);\n",
+"\n",
+"    for (int working_size = 2; working_size < (WIDTH / 2); working_size *= 2)\n",
+"    {\n",
+"        const int offset = (local_id / working_size) * working_size;\n",
+"        for (int i = local_id; i < (WIDTH / 2); i += local_size)\n",
+"        {\n",
+"            const int    idx            = offset + i;\n",
+"            const float2 temp0          = scratch[idx];\n",
+"            const float2 temp1          = scratch[idx + working_size];\n",
+"            const float  coeff_r        = native_cos(-1.f * M_PI_F * (i % working_size) * native_recip(working_size));\n",
+"            const float  coeff_i        = native_sin(-1.f * M_PI_F * (i % working_size) * native_recip(working_size));\n",
+"            const float2 product        = (float2)(coeff_r * temp1.x - coeff_i * temp1.y,\n",
+"                                                   coeff_r * temp1.y + coeff_i * temp1.x);\n",
+"            scratch[idx]                = temp0 + product;\n",
+"            scratch[idx + working_size] = temp0 - product;\n",
+"        }\n",
+"        barrier(CLK_LOCAL_MEM_FENCE);\n",
+"    }\n",
+"\n",
+"    for (int i = local_id; i < (WIDTH / 2); i += local_size)\n",
+"    {\n",
+"        const int idx0       = y_coord + WIDTH * i;\n",
+"        const int idx1       = y_coord + WIDTH * (i + WIDTH / 2);\n",
+"        const float2 temp0   = scratch[i];\n",
+"        const float2 temp1   = scratch[i + WIDTH / 2];\n",
+"        const float  coeff_r = native_cos(-2.f * M_PI_F * i * native_recip(WIDTH));\n",
+"        const float  coeff_i = native_sin(-2.f * M_PI_F * i * native_recip(WIDTH));\n",
+"        const float2 product = (float2)(coeff_r * temp1.x - coeff_i * temp1.y,\n",
+"                                        coeff_r * temp1.y + coeff_i * temp1.x);\n",
+"        const float2 res0    = temp0 + product;\n",
+"        const float2 res1    = temp0 - product;\n",
+"        real_part[idx0]      = res0.x;\n",
+"        real_part[idx1]      = res1.x;\n",
+"        imag_part[idx0]      = res0.y;\n",
+"        imag_part[idx1]      = res1.y;\n",
+"    }\n",
+"}\n",
+"\n",
+"uint bit_reverse(uint n, int num_bits)\n",
+"{\n",
+"    uint res = 0;\n",
+"    for (int i = 0; i < num_bits; ++i)\n",
+"    {\n",
+"        res |= (((1 << i) & n) >> i) << (num_bits - 1 - i);\n",
+"    }\n",
+"    return res;\n",
+"}\n",
+};
+
+static const cl_uint FFT_MATRIX_PROGRAM_SOURCE_LEN = sizeof(FFT_MATRIX_PROGRAM_SOURCE) / sizeof(const char *);
+
+#endif //SDK_EXAMPLES_FFT_MATRIX_KERNELS_H
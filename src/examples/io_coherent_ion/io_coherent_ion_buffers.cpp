@@ -15,6 +15,7 @@
 #include <iostream>
 
 // Project includes
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 
 // Library includes
@@ -51,7 +52,7 @@ int main(int argc, char** argv)
 
     cl_wrapper       wrapper;
     cl_program       program         = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
-    cl_kernel        kernel          = wrapper.make_kernel("copy", program);
+    cl_kernel        kernel          = wrapper.get_kernel("copy", program);
     cl_context       context         = wrapper.get_context();
     cl_command_queue command_queue   = wrapper.get_command_queue();
     cl_int           err             = CL_SUCCESS;
@@ -67,20 +68,20 @@ int main(int argc, char** argv)
         std::exit(EXIT_FAILURE);
     }
 
-    const auto          fin_begin   = fin.tellg();
+    const auto     fin_begin   = fin.tellg();
 
     fin.seekg(0, std::ios::end);
-    const auto          fin_end     = fin.tellg();
-    const size_t        buf_size    = static_cast<size_t>(fin_end - fin_begin);
-    cl_mem_ion_host_ptr src_buf_ion = wrapper.make_iocoherent_ion_buffer(buf_size);
+    const auto     fin_end     = fin.tellg();
+    const size_t   buf_size    = static_cast<size_t>(fin_end - fin_begin);
+    ion_allocation src_buf_ion = wrapper.make_iocoherent_ion_buffer(buf_size);
 
-    cl_mem src_buffer = clCreateBuffer(
+    cl_mem_handle src_buffer(clCreateBuffer(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             buf_size,
-            &src_buf_ion,
+            src_buf_ion.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer for source file." << "\n";
@@ -89,7 +90,7 @@ int main(int argc, char** argv)
 
     char *buf_ptr = static_cast<char *>(clEnqueueMapBuffer(
             command_queue,
-            src_buffer,
+            src_buffer.get(),
             CL_BLOCKING,
             CL_MAP_WRITE,
             0,
@@ -109,21 +110,21 @@ int main(int argc, char** argv)
     fin.read(buf_ptr, buf_size);
     fin.close();
 
-    err = clEnqueueUnmapMemObject(command_queue, src_buffer, buf_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, src_buffer.get(), buf_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping source buffer." << "\n";
         std::exit(err);
     }
 
-    cl_mem_ion_host_ptr out_buf_ion = wrapper.make_iocoherent_ion_buffer(buf_size);
-    cl_mem out_buffer = clCreateBuffer(
+    ion_allocation out_buf_ion = wrapper.make_iocoherent_ion_buffer(buf_size);
+    cl_mem_handle out_buffer(clCreateBuffer(
             context,
             CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             buf_size,
-            &out_buf_ion,
+            out_buf_ion.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer for output file." << "\n";
@@ -134,36 +135,21 @@ int main(int argc, char** argv)
      * Step 1: Set up kernel arguments and run the kernel.
      */
 
-    err = clSetKernelArg(kernel, 0, sizeof(src_buffer), &src_buffer);
+    err = clSetKernelArg(kernel, 0, sizeof(cl_mem), src_buffer.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel, 1, sizeof(out_buffer), &out_buffer);
+    err = clSetKernelArg(kernel, 1, sizeof(cl_mem), out_buffer.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1." << "\n";
         std::exit(err);
     }
 
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            kernel,
-            1,
-            NULL,
-            &buf_size,
-            NULL,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " with clEnqueueNDRangeKernel." << "\n";
-        std::exit(err);
-    }
+    wrapper.enqueue_kernel(kernel, 1, &buf_size, NULL);
     /*
      * Step 2: Copy the data out of the ion buffer.
      */
@@ -177,7 +163,7 @@ int main(int argc, char** argv)
 
     buf_ptr = static_cast<char *>(clEnqueueMapBuffer(
             command_queue,
-            out_buffer,
+            out_buffer.get(),
             CL_BLOCKING,
             CL_MAP_READ,
             0,
@@ -196,16 +182,12 @@ int main(int argc, char** argv)
     fout.write(buf_ptr, buf_size);
     fout.close();
 
-    err = clEnqueueUnmapMemObject(command_queue, out_buffer, buf_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, out_buffer.get(), buf_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping output buffer." << "\n";
         std::exit(err);
     }
 
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseMemObject(src_buffer);
-    clReleaseMemObject(out_buffer);
-
     return 0;
 }
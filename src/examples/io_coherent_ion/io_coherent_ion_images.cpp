@@ -15,6 +15,7 @@
 #include <iostream>
 
 // Project includes
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 
 // Library includes
@@ -53,10 +54,10 @@ int main(int argc, char** argv)
 
     cl_wrapper       wrapper;
     cl_program       program             = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
-    cl_kernel        kernel              = wrapper.make_kernel("copy_plane", program);
+    cl_kernel        kernel              = wrapper.get_kernel("copy_plane", program);
     cl_context       context             = wrapper.get_context();
     cl_command_queue command_queue       = wrapper.get_command_queue();
-    nv12_image_t     src_nv12_image_info = load_nv12_image_data(src_image_filename);
+    image_layout_t   src_nv12_layout     = read_image_data_layout(src_image_filename, CL_UNORM_INT8, CL_QCOM_NV12);
     cl_int           err                 = CL_SUCCESS;
 
     /*
@@ -93,18 +94,18 @@ int main(int argc, char** argv)
     cl_image_desc src_nv12_desc;
     std::memset(&src_nv12_desc, 0, sizeof(src_nv12_desc));
     src_nv12_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
-    src_nv12_desc.image_width  = src_nv12_image_info.y_width;
-    src_nv12_desc.image_height = src_nv12_image_info.y_height;
+    src_nv12_desc.image_width  = src_nv12_layout.width;
+    src_nv12_desc.image_height = src_nv12_layout.height;
 
-    cl_mem_ion_host_ptr src_nv12_ion_mem = wrapper.make_iocoherent_ion_buffer_for_yuv_image(src_nv12_format, src_nv12_desc);
-    cl_mem src_nv12_image = clCreateImage(
+    ion_allocation src_nv12_ion_mem = wrapper.make_iocoherent_ion_buffer_for_yuv_image(src_nv12_format, src_nv12_desc);
+    cl_mem_handle src_nv12_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &src_nv12_format,
             &src_nv12_desc,
-            &src_nv12_ion_mem,
+            src_nv12_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image." << "\n";
@@ -118,18 +119,18 @@ int main(int argc, char** argv)
     cl_image_desc out_nv12_desc;
     std::memset(&out_nv12_desc, 0, sizeof(out_nv12_desc));
     out_nv12_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
-    out_nv12_desc.image_width  = src_nv12_image_info.y_width;
-    out_nv12_desc.image_height = src_nv12_image_info.y_height;
+    out_nv12_desc.image_width  = src_nv12_layout.width;
+    out_nv12_desc.image_height = src_nv12_layout.height;
 
-    cl_mem_ion_host_ptr out_nv12_ion_mem = wrapper.make_iocoherent_ion_buffer_for_yuv_image(out_nv12_format, out_nv12_desc);
-    cl_mem out_nv12_image = clCreateImage(
+    ion_allocation out_nv12_ion_mem = wrapper.make_iocoherent_ion_buffer_for_yuv_image(out_nv12_format, out_nv12_desc);
+    cl_mem_handle out_nv12_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &out_nv12_format,
             &out_nv12_desc,
-            &out_nv12_ion_mem,
+            out_nv12_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for downscaled image." << "\n";
@@ -147,18 +148,18 @@ int main(int argc, char** argv)
     cl_image_desc src_y_plane_desc;
     std::memset(&src_y_plane_desc, 0, sizeof(src_y_plane_desc));
     src_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
-    src_y_plane_desc.image_width  = src_nv12_image_info.y_width;
-    src_y_plane_desc.image_height = src_nv12_image_info.y_height;
-    src_y_plane_desc.mem_object   = src_nv12_image;
+    src_y_plane_desc.image_width  = src_nv12_layout.width;
+    src_y_plane_desc.image_height = src_nv12_layout.height;
+    src_y_plane_desc.mem_object   = src_nv12_image.get();
 
-    cl_mem src_y_plane = clCreateImage(
+    cl_mem_handle src_y_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_y_plane_format,
             &src_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image y plane." << "\n";
@@ -174,18 +175,18 @@ int main(int argc, char** argv)
     src_uv_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     // The image dimensions for the uv-plane derived image must be the same as the parent image, even though the
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
-    src_uv_plane_desc.image_width  = src_nv12_image_info.y_width;
-    src_uv_plane_desc.image_height = src_nv12_image_info.y_height;
-    src_uv_plane_desc.mem_object   = src_nv12_image;
+    src_uv_plane_desc.image_width  = src_nv12_layout.width;
+    src_uv_plane_desc.image_height = src_nv12_layout.height;
+    src_uv_plane_desc.mem_object   = src_nv12_image.get();
 
-    cl_mem src_uv_plane = clCreateImage(
+    cl_mem_handle src_uv_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_uv_plane_format,
             &src_uv_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image uv plane." << "\n";
@@ -201,16 +202,16 @@ int main(int argc, char** argv)
     out_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     out_y_plane_desc.image_width  = out_nv12_desc.image_width;
     out_y_plane_desc.image_height = out_nv12_desc.image_height;
-    out_y_plane_desc.mem_object   = out_nv12_image;
+    out_y_plane_desc.mem_object   = out_nv12_image.get();
 
-    cl_mem out_y_plane = clCreateImage(
+    cl_mem_handle out_y_plane(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY,
             &out_y_plane_format,
             &out_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for destination image y plane." << "\n";
@@ -228,16 +229,16 @@ int main(int argc, char** argv)
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
     out_uv_plane_desc.image_width  = out_nv12_desc.image_width;
     out_uv_plane_desc.image_height = out_nv12_desc.image_height;
-    out_uv_plane_desc.mem_object   = out_nv12_image;
+    out_uv_plane_desc.mem_object   = out_nv12_image.get();
 
-    cl_mem out_uv_plane = clCreateImage(
+    cl_mem_handle out_uv_plane(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY,
             &out_uv_plane_format,
             &out_uv_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for destination image uv plane." << "\n";
@@ -245,103 +246,27 @@ int main(int argc, char** argv)
     }
 
     /*
-     * Step 3: Copy data to input image planes. Note that for linear NV12 images you must observe row alignment
-     * restrictions. (You may also write to the ion buffer directly if you prefer, however using clEnqueueMapImage for
-     * a child planar image will return the correct host pointer for the desired plane.)
+     * Step 3: Load the input image straight into its ion buffer. Note that for linear NV12 images you must observe
+     * row alignment restrictions, so the rows are placed at the buffer's row pitch, and the uv-plane follows the
+     * y-plane's padded height. This saves staging the image in host memory and copying it again.
      */
 
-    const size_t     origin[]       = {0, 0, 0};
-    const size_t     src_y_region[] = {src_y_plane_desc.image_width, src_y_plane_desc.image_height, 1};
-    size_t           row_pitch      = 0;
-    unsigned char   *image_ptr      = static_cast<unsigned char *>(clEnqueueMapImage(
-            command_queue,
-            src_y_plane,
-            CL_BLOCKING,
-            CL_MAP_WRITE,
-            origin,
-            src_y_region,
-            &row_pitch,
-            NULL,
-            0,
-            NULL,
-            NULL,
-            &err
-    ));
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " mapping source image y-plane buffer for writing." << "\n";
-        std::exit(err);
-    }
-
-    // Copies image data to the ION buffer from the host
-    for (uint32_t i = 0; i < src_y_plane_desc.image_height; ++i)
-    {
-        std::memcpy(
-                image_ptr                          + i * row_pitch,
-                src_nv12_image_info.y_plane.data() + i * src_y_plane_desc.image_width,
-                src_y_plane_desc.image_width
-        );
-    }
-
-    err = clEnqueueUnmapMemObject(command_queue, src_y_plane, image_ptr, 0, NULL, NULL);
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " unmapping source image y-plane data buffer." << "\n";
-        std::exit(err);
-    }
-
-    // Note the discrepancy between the child plane image descriptor and the size required by clEnqueueMapImage.
-    const size_t src_uv_region[] = {src_uv_plane_desc.image_width / 2, src_uv_plane_desc.image_height / 2, 1};
-    row_pitch                    = 0;
-    image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
-            command_queue,
-            src_uv_plane,
-            CL_BLOCKING,
-            CL_MAP_WRITE,
-            origin,
-            src_uv_region,
-            &row_pitch,
-            NULL,
-            0,
-            NULL,
-            NULL,
-            &err
-    ));
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " mapping source image uv-plane buffer for writing." << "\n";
-        std::exit(err);
-    }
-
-    // Copies image data to the ION buffer from the host
-    for (uint32_t i = 0; i < src_uv_plane_desc.image_height / 2; ++i)
-    {
-        std::memcpy(
-                image_ptr                           + i * row_pitch,
-                src_nv12_image_info.uv_plane.data() + i * src_uv_plane_desc.image_width,
-                src_uv_plane_desc.image_width
-        );
-    }
-
-    err = clEnqueueUnmapMemObject(command_queue, src_uv_plane, image_ptr, 0, NULL, NULL);
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " unmapping source image uv-plane data buffer." << "\n";
-        std::exit(err);
-    }
+    const size_t src_row_pitch = wrapper.get_ion_image_row_pitch(src_nv12_format, src_nv12_desc);
+    load_nv12_image_data(src_image_filename, *src_nv12_ion_mem, src_row_pitch,
+                         wrapper.get_ion_yuv_image_padded_height(src_nv12_desc));
 
     /*
      * Step 4: Set up kernel arguments and run the kernel.
      */
 
-    err = clSetKernelArg(kernel, 0, sizeof(src_y_plane), &src_y_plane);
+    err = clSetKernelArg(kernel, 0, sizeof(cl_mem), src_y_plane.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel, 1, sizeof(out_y_plane), &out_y_plane);
+    err = clSetKernelArg(kernel, 1, sizeof(cl_mem), out_y_plane.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1." << "\n";
@@ -349,31 +274,16 @@ int main(int argc, char** argv)
     }
 
     const size_t y_plane_global_work_size[] = {src_y_plane_desc.image_width, src_y_plane_desc.image_height};
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            kernel,
-            2,
-            NULL,
-            y_plane_global_work_size,
-            NULL,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " with clEnqueueNDRangeKernel." << "\n";
-        std::exit(err);
-    }
+    wrapper.enqueue_kernel(kernel, 2, y_plane_global_work_size, NULL);
 
-    err = clSetKernelArg(kernel, 0, sizeof(src_uv_plane), &src_uv_plane);
+    err = clSetKernelArg(kernel, 0, sizeof(cl_mem), src_uv_plane.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel, 1, sizeof(out_uv_plane), &out_uv_plane);
+    err = clSetKernelArg(kernel, 1, sizeof(cl_mem), out_uv_plane.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1." << "\n";
@@ -381,122 +291,17 @@ int main(int argc, char** argv)
     }
 
     const size_t uv_plane_global_work_size[] = {src_y_plane_desc.image_width / 2, src_y_plane_desc.image_height / 2};
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            kernel,
-            2,
-            NULL,
-            uv_plane_global_work_size,
-            NULL,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " with clEnqueueNDRangeKernel." << "\n";
-        std::exit(err);
-    }
+    wrapper.enqueue_kernel(kernel, 2, uv_plane_global_work_size, NULL);
 
     /*
-     * Step 5: Copy the data out of the ion buffer for each plane.
+     * Step 5: Save the output image straight from its ion buffer once the kernels have finished.
      */
 
-    nv12_image_t out_nv12_image_info;
-    out_nv12_image_info.y_width  = out_nv12_desc.image_width;
-    out_nv12_image_info.y_height = out_nv12_desc.image_height;
-    out_nv12_image_info.y_plane.resize(out_nv12_image_info.y_width * out_nv12_image_info.y_height);
-    out_nv12_image_info.uv_plane.resize(out_nv12_image_info.y_width * out_nv12_image_info.y_height / 2);
-
-    const size_t out_y_region[] = {out_y_plane_desc.image_width, out_y_plane_desc.image_height, 1};
-    row_pitch                   = 0;
-    image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
-            command_queue,
-            out_y_plane,
-            CL_TRUE,
-            CL_MAP_READ,
-            origin,
-            out_y_region,
-            &row_pitch,
-            NULL,
-            0,
-            NULL,
-            NULL,
-            &err
-    ));
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " mapping dest image y-plane buffer for reading." << "\n";
-        std::exit(err);
-    }
-
-    // Copies image data from the ION buffer to the host
-    for (uint32_t i = 0; i < out_y_plane_desc.image_height; ++i)
-    {
-        std::memcpy(
-                out_nv12_image_info.y_plane.data() + i * out_y_plane_desc.image_width,
-                image_ptr                          + i * row_pitch,
-                out_y_plane_desc.image_width
-        );
-    }
-
-    err = clEnqueueUnmapMemObject(command_queue, out_y_plane, image_ptr, 0, NULL, NULL);
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " unmapping dest image y-plane buffer." << "\n";
-        std::exit(err);
-    }
-
-    const size_t out_uv_region[] = {out_uv_plane_desc.image_width / 2, out_uv_plane_desc.image_height / 2, 1};
-    row_pitch                    = 0;
-    image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
-            command_queue,
-            out_uv_plane,
-            CL_TRUE,
-            CL_MAP_READ,
-            origin,
-            out_uv_region,
-            &row_pitch,
-            NULL,
-            0,
-            NULL,
-            NULL,
-            &err
-    ));
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " mapping dest image uv-plane buffer for reading." << "\n";
-        std::exit(err);
-    }
-
-    // Copies image data from the ION buffer to the host
-    for (uint32_t i = 0; i < out_uv_plane_desc.image_height / 2; ++i)
-    {
-        std::memcpy(
-                out_nv12_image_info.uv_plane.data() + i * out_uv_plane_desc.image_width,
-                image_ptr                           + i * row_pitch,
-                out_uv_plane_desc.image_width
-        );
-    }
-
-    err = clEnqueueUnmapMemObject(command_queue, out_uv_plane, image_ptr, 0, NULL, NULL);
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " unmapping dest image uv-plane buffer." << "\n";
-        std::exit(err);
-    }
-
     clFinish(command_queue);
 
-    save_nv12_image_data(out_image_filename, out_nv12_image_info);
-
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseMemObject(src_uv_plane);
-    clReleaseMemObject(src_y_plane);
-    clReleaseMemObject(src_nv12_image);
-    clReleaseMemObject(out_uv_plane);
-    clReleaseMemObject(out_y_plane);
-    clReleaseMemObject(out_nv12_image);
+    const size_t out_row_pitch = wrapper.get_ion_image_row_pitch(out_nv12_format, out_nv12_desc);
+    save_nv12_image_data(out_image_filename, out_nv12_desc.image_width, out_nv12_desc.image_height, *out_nv12_ion_mem,
+                         out_row_pitch, wrapper.get_ion_yuv_image_padded_height(out_nv12_desc));
 
     return 0;
 }
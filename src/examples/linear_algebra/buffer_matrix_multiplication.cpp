@@ -13,8 +13,11 @@
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <string>
 
 // Project includes
+#include "matrix_multiplication_kernels.h"
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 #include "util/util.h"
 
@@ -28,90 +31,10 @@ static const char *HELP_MESSAGE = "\n"
 "There is no size restriction for the matrices. To the extent possible it\n"
 "calculates the result using an efficient tiled algorithm. For the portion of\n"
 "the result matrix not covered by tiles it uses a less efficient naive\n"
-"implementation.\n"
+"implementation. The kernels are built specialized for the sizes of the\n"
+"matrices.\n"
 "If no file is specified for the output, then it is written to stdout.\n";
 
-static const char *PROGRAM_SOURCE[] = {
-// Each work item computes a 4-column by 8-row (8x4) section of the output matrix.
-// The inner loops read in a 1x4 section of matrix B, a 8x1 section of matrix A,
-// and accumulate the partial results for the corresponding 8x4 section of
-// matrix C.
-// The outer loop iterates over the width of matrix A and the height of matrix B
-// to get the complete result.
-"__kernel void matmul_8x4_blocks(__global const float *matrix_a,\n",
-"                                __global const float *matrix_b,\n",
-"                                __global       float *matrix_c,\n",
-"                                               int    matrix_b_width,\n",
-"                                               int    matrix_a_width)\n",
-"{\n",
-"    const int wid_x = get_global_id(0);\n",
-"    const int wid_y = get_global_id(1);\n",
-"\n",
-"    float  a[8];\n",
-"    float4 b;\n",
-"    float4 c[8];\n",
-"\n",
-"    for (int i = 0; i < 8; ++i)\n",
-"    {\n",
-"        c[i] = (float4)(0.0f);\n",
-"    }\n",
-"\n",
-"    for (int j = 0; j < matrix_a_width; ++j)\n",
-"    {\n",
-"        b = vload4(0, matrix_b + j * matrix_b_width + (wid_x * 4));\n",
-"\n",
-"#pragma unroll\n",
-"        for (int i = 0; i < 8; ++i)\n",
-"        {\n",
-"            a[i] = matrix_a[((wid_y * 8) + i) * matrix_a_width + j];\n",
-"        }\n",
-"\n",
-"#pragma unroll\n",
-"        for (int i = 0; i < 8; ++i)\n",
-"        {\n",
-"            c[i] += a[i] * b;\n",
-"        }\n",
-"    }\n",
-"\n",
-"#pragma unroll\n",
-"    for (int i = 0; i < 8; ++i)\n",
-"    {\n",
-"        vstore4(c[i], 0, matrix_c + ((wid_y * 8) + i) * matrix_b_width + (wid_x * 4));\n",
-"    }\n",
-"}\n",
-"\n",
-// The "remainder" version calculates a single element of the output matrix per
-// work item.
-"__kernel void matmul_remainder(__global const  float *matrix_a,\n",
-"                               __global const  float *matrix_b,\n",
-"                               __global        float *matrix_c,\n",
-"                                               int    x_rem_start,\n",
-"                                               int    y_rem_start,\n",
-"                                               int    matrix_b_width,\n",
-"                                               int    matrix_a_width)\n",
-"{\n",
-"    const int wid_x = get_global_id(0) + x_rem_start;\n",
-"    const int wid_y = get_global_id(1) + y_rem_start;\n",
-"\n",
-"    float c     = 0.0f;\n",
-"    int   a_idx = matrix_a_width * wid_y;\n",
-"    int   b_idx = wid_x;\n",
-"\n",
-"#pragma unroll 8\n",
-"    for (int i = 0; i < matrix_a_width; ++i)\n",
-"    {\n",
-"        c += matrix_a[a_idx] * matrix_b[b_idx];\n",
-"        ++a_idx;\n",
-"        b_idx += matrix_b_width;\n",
-"    }\n",
-"\n",
-"    const int c_idx = wid_x + matrix_b_width * wid_y;\n",
-"    matrix_c[c_idx] = c;\n",
-"}\n"
-};
-
-static const cl_uint PROGRAM_SOURCE_LEN = sizeof(PROGRAM_SOURCE) / sizeof(const char *);
-
 int main(int argc, char** argv)
 {
     if (argc < 3)
@@ -148,12 +71,19 @@ int main(int argc, char** argv)
     const size_t matrix_c_bytes = matrix_c_size * sizeof(cl_float);
     matrix_c.elements.resize(matrix_c_size);
 
+    // The sizes are fixed for the whole run, so the kernels can be compiled for them
+    const program_defines_t matrix_size_defines = {
+        {"FIXED_MATRIX_A_WIDTH", std::to_string(matrix_a.width)},
+        {"FIXED_MATRIX_B_WIDTH", std::to_string(matrix_b.width)},
+    };
+
     cl_wrapper       wrapper;
-    cl_program       program       = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
-    cl_kernel        kernel_8x4    = wrapper.make_kernel("matmul_8x4_blocks", program);
-    cl_kernel        kernel_rem    = wrapper.make_kernel("matmul_remainder", program);
+    cl_program       program       = wrapper.make_program(MATRIX_MULTIPLICATION_PROGRAM_SOURCE,
+                                                          MATRIX_MULTIPLICATION_PROGRAM_SOURCE_LEN, "",
+                                                          matrix_size_defines);
+    cl_kernel        kernel_8x4    = wrapper.get_kernel("matmul_8x4_blocks", program);
+    cl_kernel        kernel_rem    = wrapper.get_kernel("matmul_remainder", program);
     cl_context       context       = wrapper.get_context();
-    cl_command_queue command_queue = wrapper.get_command_queue();
 
     /*
      * Step 0: Confirm the required OpenCL extensions are supported.
@@ -181,15 +111,18 @@ int main(int argc, char** argv)
      * Matrix A
      */
 
-    cl_mem_ion_host_ptr matrix_a_ion_buf = wrapper.make_ion_buffer(matrix_a_bytes);
-    std::memcpy(matrix_a_ion_buf.ion_hostptr, matrix_a.elements.data(), matrix_a_bytes);
-    cl_mem              matrix_a_mem     = clCreateBuffer(
+    ion_allocation matrix_a_ion_buf = wrapper.make_ion_buffer(matrix_a_bytes);
+    {
+        TRACE_SCOPE("memcpy to ion");
+        std::memcpy(matrix_a_ion_buf->ion_hostptr, matrix_a.elements.data(), matrix_a_bytes);
+    }
+    cl_mem_handle matrix_a_mem(clCreateBuffer(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             matrix_a_bytes,
-            &matrix_a_ion_buf,
+            matrix_a_ion_buf.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer for matrix A." << "\n";
@@ -200,15 +133,18 @@ int main(int argc, char** argv)
      * Matrix B
      */
 
-    cl_mem_ion_host_ptr matrix_b_ion_buf = wrapper.make_ion_buffer(matrix_b_bytes);
-    std::memcpy(matrix_b_ion_buf.ion_hostptr, matrix_b.elements.data(), matrix_b_bytes);
-    cl_mem              matrix_b_mem     = clCreateBuffer(
+    ion_allocation matrix_b_ion_buf = wrapper.make_ion_buffer(matrix_b_bytes);
+    {
+        TRACE_SCOPE("memcpy to ion");
+        std::memcpy(matrix_b_ion_buf->ion_hostptr, matrix_b.elements.data(), matrix_b_bytes);
+    }
+    cl_mem_handle matrix_b_mem(clCreateBuffer(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             matrix_b_bytes,
-            &matrix_b_ion_buf,
+            matrix_b_ion_buf.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer for matrix B." << "\n";
@@ -219,14 +155,14 @@ int main(int argc, char** argv)
      * Matrix C
      */
 
-    cl_mem_ion_host_ptr matrix_c_ion_buf = wrapper.make_ion_buffer(matrix_c_bytes);
-    cl_mem              matrix_c_mem     = clCreateBuffer(
+    ion_allocation matrix_c_ion_buf = wrapper.make_ion_buffer(matrix_c_bytes);
+    cl_mem_handle matrix_c_mem(clCreateBuffer(
             context,
             CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             matrix_c_bytes,
-            &matrix_c_ion_buf,
+            matrix_c_ion_buf.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer for matrix C." << "\n";
@@ -237,24 +173,24 @@ int main(int argc, char** argv)
      * Step 2: Set up the kernel arguments for tiled kernel.
      */
 
-    err = clSetKernelArg(kernel_8x4, 0, sizeof(matrix_a_mem), &matrix_a_mem);
+    err = clSetKernelArg(kernel_8x4, 0, sizeof(cl_mem), matrix_a_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel_8x4, 1, sizeof(matrix_b_mem), &matrix_b_mem);
+    err = clSetKernelArg(kernel_8x4, 1, sizeof(cl_mem), matrix_b_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel_8x4, 2, sizeof(matrix_c_mem), &matrix_c_mem);
+    err = clSetKernelArg(kernel_8x4, 2, sizeof(cl_mem), matrix_c_mem.address());
     if (err != CL_SUCCESS)
     {
-        std::cerr << "Error " << err << " with clSetKernelArg for argument 1." << "\n";
+        std::cerr << "Error " << err << " with clSetKernelArg for argument 2." << "\n";
         std::exit(err);
     }
 
@@ -282,22 +218,10 @@ int main(int argc, char** argv)
     const size_t tiled_global_work_size[] = {static_cast<size_t>(matrix_b.width / 4), static_cast<size_t>(matrix_a.height / 8)};
     if (tiled_global_work_size[0] != 0 && tiled_global_work_size[1] != 0)
     {
-        err = clEnqueueNDRangeKernel(
-                command_queue,
-                kernel_8x4,
-                2,
-                NULL,
-                tiled_global_work_size,
-                NULL,
-                0,
-                NULL,
-                NULL
-        );
-        if (err != CL_SUCCESS)
-        {
-            std::cerr << "Error " << err << " with clEnqueueNDRangeKernel for tiled portion." << "\n";
-            std::exit(err);
-        }
+        // Each 8x4 tile reads 8 rows of A and 4 columns of B, and writes its part of C
+        const size_t tiles = tiled_global_work_size[0] * tiled_global_work_size[1];
+        wrapper.enqueue_kernel(kernel_8x4, 2, tiled_global_work_size, NULL,
+                               tiles * (8 + 4) * matrix_a.width * sizeof(cl_float) + tiles * 8 * 4 * sizeof(cl_float));
     }
 
     /*
@@ -308,21 +232,21 @@ int main(int argc, char** argv)
     const cl_int x_rem_start = (matrix_b.width / 4) * 4;
     const cl_int y_rem_start = (matrix_a.height / 8) * 8;
 
-    err = clSetKernelArg(kernel_rem, 0, sizeof(matrix_a_mem), &matrix_a_mem);
+    err = clSetKernelArg(kernel_rem, 0, sizeof(cl_mem), matrix_a_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel_rem, 1, sizeof(matrix_b_mem), &matrix_b_mem);
+    err = clSetKernelArg(kernel_rem, 1, sizeof(cl_mem), matrix_b_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel_rem, 2, sizeof(matrix_c_mem), &matrix_c_mem);
+    err = clSetKernelArg(kernel_rem, 2, sizeof(cl_mem), matrix_c_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 2." << "\n";
@@ -365,22 +289,10 @@ int main(int argc, char** argv)
     const size_t right_rem_work_size[] = {static_cast<size_t>(matrix_b.width - x_rem_start), static_cast<size_t>(matrix_a.height)};
     if (right_rem_work_size[0] != 0 && right_rem_work_size[1] != 0)
     {
-        err = clEnqueueNDRangeKernel(
-                command_queue,
-                kernel_rem,
-                2,
-                NULL,
-                right_rem_work_size,
-                NULL,
-                0,
-                NULL,
-                NULL
-        );
-        if (err != CL_SUCCESS)
-        {
-            std::cerr << "Error " << err << " with clEnqueueNDRangeKernel for right remainder." << "\n";
-            std::exit(err);
-        }
+        // Each work item reads a row of A and a column of B, and writes one element of C
+        const size_t items = right_rem_work_size[0] * right_rem_work_size[1];
+        wrapper.enqueue_kernel(kernel_rem, 2, right_rem_work_size, NULL,
+                               items * (2 * matrix_a.width + 1) * sizeof(cl_float));
     }
 
     const cl_int bottom_x_rem_start = 0;
@@ -405,56 +317,25 @@ int main(int argc, char** argv)
     const size_t bottom_rem_work_size[] = {static_cast<size_t>(x_rem_start), static_cast<size_t>(matrix_a.height - y_rem_start)};
     if (bottom_rem_work_size[0] != 0 && bottom_rem_work_size[1] != 0)
     {
-        err = clEnqueueNDRangeKernel(
-                command_queue,
-                kernel_rem,
-                2,
-                NULL,
-                bottom_rem_work_size,
-                NULL,
-                0,
-                NULL,
-                NULL
-        );
-        if (err != CL_SUCCESS)
-        {
-            std::cerr << "Error " << err << " with clEnqueueNDRangeKernel for bottom remainder." << "\n";
-            std::exit(err);
-        }
+        const size_t items = bottom_rem_work_size[0] * bottom_rem_work_size[1];
+        wrapper.enqueue_kernel(kernel_rem, 2, bottom_rem_work_size, NULL,
+                               items * (2 * matrix_a.width + 1) * sizeof(cl_float));
     }
 
     /*
      * Step 5: Copy the data out of the ION buffer.
      */
 
-    cl_float *ptr = static_cast<cl_float *>(clEnqueueMapBuffer(
-            command_queue,
-            matrix_c_mem,
-            CL_BLOCKING,
-            CL_MAP_READ,
-            0,
-            matrix_c_bytes,
-            0,
-            NULL,
-            NULL,
-            &err
-    ));
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " with clEnqueueMapBuffer." << "\n";
-        std::exit(err);
-    }
-
-    std::memcpy(matrix_c.elements.data(), ptr, matrix_c_bytes);
-
-    err = clEnqueueUnmapMemObject(command_queue, matrix_c_mem, ptr, 0, NULL, NULL);
-    if (err != CL_SUCCESS)
+    cl_float *ptr = static_cast<cl_float *>(
+            wrapper.enqueue_map_buffer(matrix_c_mem.get(), CL_MAP_READ, 0, matrix_c_bytes)
+    );
     {
-        std::cerr << "Error " << err << " with clEnqueueUnmapMemObject." << "\n";
-        std::exit(err);
+        TRACE_SCOPE("memcpy from ion");
+        std::memcpy(matrix_c.elements.data(), ptr, matrix_c_bytes);
     }
+    wrapper.enqueue_unmap_mem_object(matrix_c_mem.get(), ptr);
 
-    clFinish(command_queue);
+    wrapper.finish();
 
     if (output_to_file)
     {
@@ -465,10 +346,5 @@ int main(int argc, char** argv)
         save_matrix(std::cout, matrix_c);
     }
 
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseMemObject(matrix_a_mem);
-    clReleaseMemObject(matrix_b_mem);
-    clReleaseMemObject(matrix_c_mem);
-
     return 0;
 }
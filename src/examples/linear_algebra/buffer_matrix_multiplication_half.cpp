@@ -15,6 +15,7 @@
 #include <iostream>
 
 // Project includes
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 #include "util/half_float.h"
 #include "util/util.h"
@@ -152,8 +153,8 @@ int main(int argc, char** argv)
 
     cl_wrapper       wrapper;
     cl_program       program       = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
-    cl_kernel        kernel_8x4    = wrapper.make_kernel("matmul_8x4_blocks", program);
-    cl_kernel        kernel_rem    = wrapper.make_kernel("matmul_remainder", program);
+    cl_kernel        kernel_8x4    = wrapper.get_kernel("matmul_8x4_blocks", program);
+    cl_kernel        kernel_rem    = wrapper.get_kernel("matmul_remainder", program);
     cl_context       context       = wrapper.get_context();
     cl_command_queue command_queue = wrapper.get_command_queue();
 
@@ -183,15 +184,15 @@ int main(int argc, char** argv)
      * Matrix A
      */
 
-    cl_mem_ion_host_ptr matrix_a_ion_buf = wrapper.make_ion_buffer(matrix_a_bytes);
-    std::memcpy(matrix_a_ion_buf.ion_hostptr, matrix_a.elements.data(), matrix_a_bytes);
-    cl_mem              matrix_a_mem     = clCreateBuffer(
+    ion_allocation matrix_a_ion_buf = wrapper.make_ion_buffer(matrix_a_bytes);
+    std::memcpy(matrix_a_ion_buf->ion_hostptr, matrix_a.elements.data(), matrix_a_bytes);
+    cl_mem_handle matrix_a_mem(clCreateBuffer(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             matrix_a_bytes,
-            &matrix_a_ion_buf,
+            matrix_a_ion_buf.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer for matrix A." << "\n";
@@ -202,15 +203,15 @@ int main(int argc, char** argv)
      * Matrix B
      */
 
-    cl_mem_ion_host_ptr matrix_b_ion_buf = wrapper.make_ion_buffer(matrix_b_bytes);
-    std::memcpy(matrix_b_ion_buf.ion_hostptr, matrix_b.elements.data(), matrix_b_bytes);
-    cl_mem              matrix_b_mem     = clCreateBuffer(
+    ion_allocation matrix_b_ion_buf = wrapper.make_ion_buffer(matrix_b_bytes);
+    std::memcpy(matrix_b_ion_buf->ion_hostptr, matrix_b.elements.data(), matrix_b_bytes);
+    cl_mem_handle matrix_b_mem(clCreateBuffer(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             matrix_b_bytes,
-            &matrix_b_ion_buf,
+            matrix_b_ion_buf.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer for matrix B." << "\n";
@@ -221,14 +222,14 @@ int main(int argc, char** argv)
      * Matrix C
      */
 
-    cl_mem_ion_host_ptr matrix_c_ion_buf = wrapper.make_ion_buffer(matrix_c_bytes / 2); // Halved because we will write half-floats
-    cl_mem              matrix_c_mem     = clCreateBuffer(
+    ion_allocation matrix_c_ion_buf = wrapper.make_ion_buffer(matrix_c_bytes / 2); // Halved because we will write half-floats
+    cl_mem_handle matrix_c_mem(clCreateBuffer(
             context,
             CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             matrix_c_bytes,
-            &matrix_c_ion_buf,
+            matrix_c_ion_buf.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer for matrix C." << "\n";
@@ -239,24 +240,24 @@ int main(int argc, char** argv)
      * Step 2: Set up the kernel arguments for tiled kernel.
      */
 
-    err = clSetKernelArg(kernel_8x4, 0, sizeof(matrix_a_mem), &matrix_a_mem);
+    err = clSetKernelArg(kernel_8x4, 0, sizeof(cl_mem), matrix_a_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel_8x4, 1, sizeof(matrix_b_mem), &matrix_b_mem);
+    err = clSetKernelArg(kernel_8x4, 1, sizeof(cl_mem), matrix_b_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel_8x4, 2, sizeof(matrix_c_mem), &matrix_c_mem);
+    err = clSetKernelArg(kernel_8x4, 2, sizeof(cl_mem), matrix_c_mem.address());
     if (err != CL_SUCCESS)
     {
-        std::cerr << "Error " << err << " with clSetKernelArg for argument 1." << "\n";
+        std::cerr << "Error " << err << " with clSetKernelArg for argument 2." << "\n";
         std::exit(err);
     }
 
@@ -284,22 +285,7 @@ int main(int argc, char** argv)
     const size_t tiled_global_work_size[] = {static_cast<size_t>(matrix_b.width / 4), static_cast<size_t>(matrix_a.height / 8)};
     if (tiled_global_work_size[0] != 0 && tiled_global_work_size[1] != 0)
     {
-        err = clEnqueueNDRangeKernel(
-                command_queue,
-                kernel_8x4,
-                2,
-                NULL,
-                tiled_global_work_size,
-                NULL,
-                0,
-                NULL,
-                NULL
-        );
-        if (err != CL_SUCCESS)
-        {
-            std::cerr << "Error " << err << " with clEnqueueNDRangeKernel for tiled portion." << "\n";
-            std::exit(err);
-        }
+        wrapper.enqueue_kernel(kernel_8x4, 2, tiled_global_work_size, NULL);
     }
 
     /*
@@ -310,21 +296,21 @@ int main(int argc, char** argv)
     const cl_int x_rem_start = (matrix_b.width / 4) * 4;
     const cl_int y_rem_start = (matrix_a.height / 8) * 8;
 
-    err = clSetKernelArg(kernel_rem, 0, sizeof(matrix_a_mem), &matrix_a_mem);
+    err = clSetKernelArg(kernel_rem, 0, sizeof(cl_mem), matrix_a_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel_rem, 1, sizeof(matrix_b_mem), &matrix_b_mem);
+    err = clSetKernelArg(kernel_rem, 1, sizeof(cl_mem), matrix_b_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel_rem, 2, sizeof(matrix_c_mem), &matrix_c_mem);
+    err = clSetKernelArg(kernel_rem, 2, sizeof(cl_mem), matrix_c_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 2." << "\n";
@@ -367,22 +353,7 @@ int main(int argc, char** argv)
     const size_t right_rem_work_size[] = {static_cast<size_t>(matrix_b.width - x_rem_start), static_cast<size_t>(matrix_a.height)};
     if (right_rem_work_size[0] != 0 && right_rem_work_size[1] != 0)
     {
-        err = clEnqueueNDRangeKernel(
-                command_queue,
-                kernel_rem,
-                2,
-                NULL,
-                right_rem_work_size,
-                NULL,
-                0,
-                NULL,
-                NULL
-        );
-        if (err != CL_SUCCESS)
-        {
-            std::cerr << "Error " << err << " with clEnqueueNDRangeKernel for right remainder." << "\n";
-            std::exit(err);
-        }
+        wrapper.enqueue_kernel(kernel_rem, 2, right_rem_work_size, NULL);
     }
 
     const cl_int bottom_x_rem_start = 0;
@@ -407,22 +378,7 @@ int main(int argc, char** argv)
     const size_t bottom_rem_work_size[] = {static_cast<size_t>(x_rem_start), static_cast<size_t>(matrix_a.height - y_rem_start)};
     if (bottom_rem_work_size[0] != 0 && bottom_rem_work_size[1] != 0)
     {
-        err = clEnqueueNDRangeKernel(
-                command_queue,
-                kernel_rem,
-                2,
-                NULL,
-                bottom_rem_work_size,
-                NULL,
-                0,
-                NULL,
-                NULL
-        );
-        if (err != CL_SUCCESS)
-        {
-            std::cerr << "Error " << err << " with clEnqueueNDRangeKernel for bottom remainder." << "\n";
-            std::exit(err);
-        }
+        wrapper.enqueue_kernel(kernel_rem, 2, bottom_rem_work_size, NULL);
     }
 
     /*
@@ -431,7 +387,7 @@ int main(int argc, char** argv)
 
     cl_half *ptr = static_cast<cl_half *>(clEnqueueMapBuffer(
             command_queue,
-            matrix_c_mem,
+            matrix_c_mem.get(),
             CL_BLOCKING,
             CL_MAP_READ,
             0,
@@ -447,12 +403,9 @@ int main(int argc, char** argv)
         std::exit(err);
     }
 
-    for (size_t idx = 0; idx < static_cast<size_t>(matrix_c.width * matrix_c.height); ++idx)
-    {
-        matrix_c.elements[idx] = to_float(ptr[idx]);
-    }
+    to_float_n(ptr, matrix_c.elements.data(), static_cast<size_t>(matrix_c.width * matrix_c.height));
 
-    err = clEnqueueUnmapMemObject(command_queue, matrix_c_mem, ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, matrix_c_mem.get(), ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clEnqueueUnmapMemObject." << "\n";
@@ -470,10 +423,5 @@ int main(int argc, char** argv)
         save_matrix(std::cout, matrix_c);
     }
 
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseMemObject(matrix_a_mem);
-    clReleaseMemObject(matrix_b_mem);
-    clReleaseMemObject(matrix_c_mem);
-
     return 0;
 }
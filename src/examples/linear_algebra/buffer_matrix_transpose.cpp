@@ -15,6 +15,7 @@
 #include <iostream>
 
 // Project includes
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 #include "util/util.h"
 
@@ -88,8 +89,8 @@ int main(int argc, char** argv)
 
     cl_wrapper       wrapper;
     cl_program       program       = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
-    cl_kernel        kernel_tiled  = wrapper.make_kernel("transpose", program);
-    cl_kernel        kernel_rem    = wrapper.make_kernel("transpose_rem", program);
+    cl_kernel        kernel_tiled  = wrapper.get_kernel("transpose", program);
+    cl_kernel        kernel_rem    = wrapper.get_kernel("transpose_rem", program);
     cl_context       context       = wrapper.get_context();
     cl_command_queue command_queue = wrapper.get_command_queue();
 
@@ -119,15 +120,15 @@ int main(int argc, char** argv)
      * Matrix A
      */
 
-    cl_mem_ion_host_ptr matrix_a_ion_buf = wrapper.make_ion_buffer(matrix_bytes);
-    std::memcpy(matrix_a_ion_buf.ion_hostptr, matrix_a.elements.data(), matrix_bytes);
-    cl_mem              matrix_a_mem     = clCreateBuffer(
+    ion_allocation matrix_a_ion_buf = wrapper.make_ion_buffer(matrix_bytes);
+    std::memcpy(matrix_a_ion_buf->ion_hostptr, matrix_a.elements.data(), matrix_bytes);
+    cl_mem_handle matrix_a_mem(clCreateBuffer(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             matrix_bytes,
-            &matrix_a_ion_buf,
+            matrix_a_ion_buf.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer for matrix A." << "\n";
@@ -138,14 +139,14 @@ int main(int argc, char** argv)
      * Matrix B
      */
 
-    cl_mem_ion_host_ptr matrix_b_ion_buf = wrapper.make_ion_buffer(matrix_bytes);
-    cl_mem              matrix_b_mem     = clCreateBuffer(
+    ion_allocation matrix_b_ion_buf = wrapper.make_ion_buffer(matrix_bytes);
+    cl_mem_handle matrix_b_mem(clCreateBuffer(
             context,
             CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             matrix_bytes,
-            &matrix_b_ion_buf,
+            matrix_b_ion_buf.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer for matrix B." << "\n";
@@ -156,14 +157,14 @@ int main(int argc, char** argv)
      * Step 2: Set up the kernel arguments
      */
 
-    err = clSetKernelArg(kernel_tiled, 0, sizeof(matrix_a_mem), &matrix_a_mem);
+    err = clSetKernelArg(kernel_tiled, 0, sizeof(cl_mem), matrix_a_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel_tiled, 1, sizeof(matrix_b_mem), &matrix_b_mem);
+    err = clSetKernelArg(kernel_tiled, 1, sizeof(cl_mem), matrix_b_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1." << "\n";
@@ -194,22 +195,7 @@ int main(int argc, char** argv)
     const size_t tiled_global_work_size[] = {static_cast<size_t>(matrix_a.width / 4), static_cast<size_t>(matrix_a.height / 4)};
     if (tiled_global_work_size[0] != 0 && tiled_global_work_size[1] != 0)
     {
-        err = clEnqueueNDRangeKernel(
-                command_queue,
-                kernel_tiled,
-                2,
-                NULL,
-                tiled_global_work_size,
-                NULL,
-                0,
-                NULL,
-                NULL
-        );
-        if (err != CL_SUCCESS)
-        {
-            std::cerr << "Error " << err << " with clEnqueueNDRangeKernel." << "\n";
-            std::exit(err);
-        }
+        wrapper.enqueue_kernel(kernel_tiled, 2, tiled_global_work_size, NULL);
     }
 
     /*
@@ -220,15 +206,14 @@ int main(int argc, char** argv)
     const cl_int x_rem_start = (matrix_a.width / 4) * 4;
     const cl_int y_rem_start = (matrix_a.height / 4) * 4;
 
-
-    err = clSetKernelArg(kernel_rem, 0, sizeof(matrix_a_mem), &matrix_a_mem);
+    err = clSetKernelArg(kernel_rem, 0, sizeof(cl_mem), matrix_a_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel_rem, 1, sizeof(matrix_b_mem), &matrix_b_mem);
+    err = clSetKernelArg(kernel_rem, 1, sizeof(cl_mem), matrix_b_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1." << "\n";
@@ -271,22 +256,7 @@ int main(int argc, char** argv)
     const size_t right_rem_work_size[] = {static_cast<size_t>(matrix_a.width - x_rem_start), static_cast<size_t>(matrix_a.height)};
     if (right_rem_work_size[0] != 0 && right_rem_work_size[1] != 0)
     {
-        err = clEnqueueNDRangeKernel(
-                command_queue,
-                kernel_rem,
-                2,
-                NULL,
-                right_rem_work_size,
-                NULL,
-                0,
-                NULL,
-                NULL
-        );
-        if (err != CL_SUCCESS)
-        {
-            std::cerr << "Error " << err << " with clEnqueueNDRangeKernel for right remainder." << "\n";
-            std::exit(err);
-        }
+        wrapper.enqueue_kernel(kernel_rem, 2, right_rem_work_size, NULL);
     }
 
     const cl_int bottom_x_rem_start = 0;
@@ -311,22 +281,7 @@ int main(int argc, char** argv)
     const size_t bottom_rem_work_size[] = {static_cast<size_t>(x_rem_start), static_cast<size_t>(matrix_a.height - y_rem_start)};
     if (bottom_rem_work_size[0] != 0 && bottom_rem_work_size[1] != 0)
     {
-        err = clEnqueueNDRangeKernel(
-                command_queue,
-                kernel_rem,
-                2,
-                NULL,
-                bottom_rem_work_size,
-                NULL,
-                0,
-                NULL,
-                NULL
-        );
-        if (err != CL_SUCCESS)
-        {
-            std::cerr << "Error " << err << " with clEnqueueNDRangeKernel for right remainder." << "\n";
-            std::exit(err);
-        }
+        wrapper.enqueue_kernel(kernel_rem, 2, bottom_rem_work_size, NULL);
     }
 
     /*
@@ -341,7 +296,7 @@ int main(int argc, char** argv)
 
     cl_float *ptr = static_cast<cl_float *>(clEnqueueMapBuffer(
             command_queue,
-            matrix_b_mem,
+            matrix_b_mem.get(),
             CL_BLOCKING,
             CL_MAP_READ,
             0,
@@ -359,7 +314,7 @@ int main(int argc, char** argv)
 
     std::memcpy(matrix_b.elements.data(), ptr, matrix_bytes);
 
-    err = clEnqueueUnmapMemObject(command_queue, matrix_b_mem, ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, matrix_b_mem.get(), ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clEnqueueUnmapMemObject." << "\n";
@@ -377,9 +332,5 @@ int main(int argc, char** argv)
         save_matrix(std::cout, matrix_b);
     }
 
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseMemObject(matrix_a_mem);
-    clReleaseMemObject(matrix_b_mem);
-
     return 0;
 }
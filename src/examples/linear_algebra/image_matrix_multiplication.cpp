@@ -15,6 +15,7 @@
 #include <iostream>
 
 // Project includes
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 #include "util/util.h"
 
@@ -118,7 +119,7 @@ int main(int argc, char** argv)
 
     cl_wrapper       wrapper;
     cl_program       program       = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
-    cl_kernel        kernel        = wrapper.make_kernel("matmul_8x4_blocks", program);
+    cl_kernel        kernel        = wrapper.get_kernel("matmul_8x4_blocks", program);
     cl_context       context       = wrapper.get_context();
     cl_command_queue command_queue = wrapper.get_command_queue();
 
@@ -159,16 +160,16 @@ int main(int argc, char** argv)
     matrix_a_desc.image_height    = ((matrix_a.height + 7) / 8) * 8;
     matrix_a_desc.image_row_pitch = wrapper.get_ion_image_row_pitch(matrix_a_format, matrix_a_desc);
 
-    cl_mem_ion_host_ptr matrix_a_ion_buf = wrapper.make_ion_buffer_for_nonplanar_image(matrix_a_format,
-                                                                                       matrix_a_desc);
-    cl_mem matrix_a_mem = clCreateImage(
+    ion_allocation matrix_a_ion_buf = wrapper.make_ion_buffer_for_nonplanar_image(matrix_a_format,
+                                                                                  matrix_a_desc);
+    cl_mem_handle matrix_a_mem(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &matrix_a_format,
             &matrix_a_desc,
-            &matrix_a_ion_buf,
+            matrix_a_ion_buf.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for matrix A." << "\n";
@@ -181,7 +182,7 @@ int main(int argc, char** argv)
     size_t        row_pitch         = 0;
     image_ptr = static_cast<char *>(clEnqueueMapImage(
             command_queue,
-            matrix_a_mem,
+            matrix_a_mem.get(),
             CL_BLOCKING,
             CL_MAP_WRITE,
             origin,
@@ -218,7 +219,7 @@ int main(int argc, char** argv)
         }
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, matrix_a_mem, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, matrix_a_mem.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping matrix A image." << "\n";
@@ -240,16 +241,16 @@ int main(int argc, char** argv)
     matrix_b_desc.image_height    = ((matrix_b.height + 7) / 8) * 8;
     matrix_b_desc.image_row_pitch = wrapper.get_ion_image_row_pitch(matrix_b_format, matrix_b_desc);
 
-    cl_mem_ion_host_ptr matrix_b_ion_buf = wrapper.make_ion_buffer_for_nonplanar_image(matrix_b_format,
-                                                                                       matrix_b_desc);
-    cl_mem matrix_b_mem = clCreateImage(
+    ion_allocation matrix_b_ion_buf = wrapper.make_ion_buffer_for_nonplanar_image(matrix_b_format,
+                                                                                  matrix_b_desc);
+    cl_mem_handle matrix_b_mem(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &matrix_b_format,
             &matrix_b_desc,
-            &matrix_b_ion_buf,
+            matrix_b_ion_buf.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for matrix B." << "\n";
@@ -259,7 +260,7 @@ int main(int argc, char** argv)
     const size_t  matrix_b_region[] = {matrix_b_desc.image_width, matrix_b_desc.image_height, 1};
     image_ptr = static_cast<char *>(clEnqueueMapImage(
             command_queue,
-            matrix_b_mem,
+            matrix_b_mem.get(),
             CL_BLOCKING,
             CL_MAP_WRITE,
             origin,
@@ -296,7 +297,7 @@ int main(int argc, char** argv)
         }
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, matrix_b_mem, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, matrix_b_mem.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping matrix B image." << "\n";
@@ -318,16 +319,16 @@ int main(int argc, char** argv)
     matrix_c_desc.image_height    = ((matrix_c.height + 7) / 8) * 8;
     matrix_c_desc.image_row_pitch = wrapper.get_ion_image_row_pitch(matrix_c_format, matrix_c_desc);
 
-    cl_mem_ion_host_ptr matrix_c_ion_buf = wrapper.make_ion_buffer_for_nonplanar_image(matrix_c_format,
-                                                                                       matrix_c_desc);
-    cl_mem matrix_c_mem = clCreateImage(
+    ion_allocation matrix_c_ion_buf = wrapper.make_ion_buffer_for_nonplanar_image(matrix_c_format,
+                                                                                  matrix_c_desc);
+    cl_mem_handle matrix_c_mem(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &matrix_c_format,
             &matrix_c_desc,
-            &matrix_c_ion_buf,
+            matrix_c_ion_buf.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for matrix C." << "\n";
@@ -338,21 +339,21 @@ int main(int argc, char** argv)
      * Step 2: Set up the kernel arguments
      */
 
-    err = clSetKernelArg(kernel, 0, sizeof(matrix_a_mem), &matrix_a_mem);
+    err = clSetKernelArg(kernel, 0, sizeof(cl_mem), matrix_a_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel, 1, sizeof(matrix_b_mem), &matrix_b_mem);
+    err = clSetKernelArg(kernel, 1, sizeof(cl_mem), matrix_b_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel, 2, sizeof(matrix_c_mem), &matrix_c_mem);
+    err = clSetKernelArg(kernel, 2, sizeof(cl_mem), matrix_c_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 2." << "\n";
@@ -372,22 +373,7 @@ int main(int argc, char** argv)
      */
 
     const size_t global_work_size[] = {matrix_b_desc.image_width, matrix_a_desc.image_height / 8};
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            kernel,
-            2,
-            NULL,
-            global_work_size,
-            NULL,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " with clEnqueueNDRangeKernel." << "\n";
-        std::exit(err);
-    }
+    wrapper.enqueue_kernel(kernel, 2, global_work_size, NULL);
 
     /*
      * Step 4: Copy the data out of the ION buffer.
@@ -396,7 +382,7 @@ int main(int argc, char** argv)
     const size_t  matrix_c_region[] = {matrix_c_desc.image_width, matrix_c_desc.image_height, 1};
     image_ptr = static_cast<char *>(clEnqueueMapImage(
             command_queue,
-            matrix_c_mem,
+            matrix_c_mem.get(),
             CL_BLOCKING,
             CL_MAP_READ,
             origin,
@@ -424,7 +410,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, matrix_c_mem, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, matrix_c_mem.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clEnqueueUnmapMemObject." << "\n";
@@ -442,10 +428,5 @@ int main(int argc, char** argv)
         save_matrix(std::cout, matrix_c);
     }
 
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseMemObject(matrix_a_mem);
-    clReleaseMemObject(matrix_b_mem);
-    clReleaseMemObject(matrix_c_mem);
-
     return 0;
 }
@@ -15,6 +15,7 @@
 #include <iostream>
 
 // Project includes
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 #include "util/util.h"
 
@@ -64,7 +65,7 @@ int main(int argc, char** argv)
 
     cl_wrapper       wrapper;
     cl_program       program       = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
-    cl_kernel        kernel        = wrapper.make_kernel("buffer_addition", program);
+    cl_kernel        kernel        = wrapper.get_kernel("buffer_addition", program);
     cl_context       context       = wrapper.get_context();
     cl_command_queue command_queue = wrapper.get_command_queue();
 
@@ -90,44 +91,44 @@ int main(int argc, char** argv)
 
     cl_int err =  CL_SUCCESS;
 
-    cl_mem_ion_host_ptr matrix_a_ion_buf = wrapper.make_ion_buffer(matrix_bytes);
-    std::memcpy(matrix_a_ion_buf.ion_hostptr, matrix_a.elements.data(), matrix_bytes);
-    cl_mem              matrix_a_mem     = clCreateBuffer(
+    ion_allocation matrix_a_ion_buf = wrapper.make_ion_buffer(matrix_bytes);
+    std::memcpy(matrix_a_ion_buf->ion_hostptr, matrix_a.elements.data(), matrix_bytes);
+    cl_mem_handle matrix_a_mem(clCreateBuffer(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             matrix_bytes,
-            &matrix_a_ion_buf,
+            matrix_a_ion_buf.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer for matrix A." << "\n";
         std::exit(err);
     }
 
-    cl_mem_ion_host_ptr matrix_b_ion_buf = wrapper.make_ion_buffer(matrix_bytes);
-    std::memcpy(matrix_b_ion_buf.ion_hostptr, matrix_b.elements.data(), matrix_bytes);
-    cl_mem              matrix_b_mem     = clCreateBuffer(
+    ion_allocation matrix_b_ion_buf = wrapper.make_ion_buffer(matrix_bytes);
+    std::memcpy(matrix_b_ion_buf->ion_hostptr, matrix_b.elements.data(), matrix_bytes);
+    cl_mem_handle matrix_b_mem(clCreateBuffer(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             matrix_bytes,
-            &matrix_b_ion_buf,
+            matrix_b_ion_buf.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer for matrix B." << "\n";
         std::exit(err);
     }
 
-    cl_mem_ion_host_ptr matrix_c_ion_buf = wrapper.make_ion_buffer(matrix_bytes);
-    cl_mem              matrix_c_mem     = clCreateBuffer(
+    ion_allocation matrix_c_ion_buf = wrapper.make_ion_buffer(matrix_bytes);
+    cl_mem_handle matrix_c_mem(clCreateBuffer(
             context,
             CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             matrix_bytes,
-            &matrix_c_ion_buf,
+            matrix_c_ion_buf.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateBuffer for matrix C." << "\n";
@@ -138,21 +139,21 @@ int main(int argc, char** argv)
      * Step 2: Set up the kernel arguments
      */
 
-    err = clSetKernelArg(kernel, 0, sizeof(matrix_a_mem), &matrix_a_mem);
+    err = clSetKernelArg(kernel, 0, sizeof(cl_mem), matrix_a_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 0." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel, 1, sizeof(matrix_b_mem), &matrix_b_mem);
+    err = clSetKernelArg(kernel, 1, sizeof(cl_mem), matrix_b_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 1." << "\n";
         std::exit(err);
     }
 
-    err = clSetKernelArg(kernel, 2, sizeof(matrix_c_mem), &matrix_c_mem);
+    err = clSetKernelArg(kernel, 2, sizeof(cl_mem), matrix_c_mem.address());
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clSetKernelArg for argument 2." << "\n";
@@ -164,22 +165,7 @@ int main(int argc, char** argv)
      */
 
     const size_t global_work_size = matrix_size;
-    err = clEnqueueNDRangeKernel(
-            command_queue,
-            kernel,
-            1,
-            NULL,
-            &global_work_size,
-            NULL,
-            0,
-            NULL,
-            NULL
-    );
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " with clEnqueueNDRangeKernel." << "\n";
-        std::exit(err);
-    }
+    wrapper.enqueue_kernel(kernel, 1, &global_work_size, NULL);
 
     /*
      * Step 4: Copy the data out of the ION buffer.
@@ -187,7 +173,7 @@ int main(int argc, char** argv)
 
     cl_float *ptr = static_cast<cl_float *>(clEnqueueMapBuffer(
             command_queue,
-            matrix_c_mem,
+            matrix_c_mem.get(),
             CL_BLOCKING,
             CL_MAP_READ,
             0,
@@ -209,7 +195,7 @@ int main(int argc, char** argv)
     matrix_c.elements.resize(matrix_size);
     std::memcpy(matrix_c.elements.data(), ptr, matrix_bytes);
 
-    err = clEnqueueUnmapMemObject(command_queue, matrix_c_mem, ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, matrix_c_mem.get(), ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clEnqueueUnmapMemObject." << "\n";
@@ -227,10 +213,5 @@ int main(int argc, char** argv)
         save_matrix(std::cout, matrix_c);
     }
 
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseMemObject(matrix_a_mem);
-    clReleaseMemObject(matrix_b_mem);
-    clReleaseMemObject(matrix_c_mem);
-
     return 0;
 }
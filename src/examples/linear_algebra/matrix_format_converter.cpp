@@ -0,0 +1,60 @@
+//--------------------------------------------------------------------------------------
+// File: matrix_format_converter.cpp
+// Desc: Converts matrices between the text and binary formats
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+// Std includes
+#include <cstdlib>
+#include <iostream>
+
+// Project includes
+#include "util/util.h"
+
+static const char *HELP_MESSAGE = "\n"
+"Usage: matrix_format_converter <input matrix> <output matrix> <output format>\n"
+"Converts a matrix between the text and binary formats described in README.md.\n"
+"The input format is detected automatically. <output format> is one of:\n"
+"  text - whitespace-separated text\n"
+"  f32  - binary with 32-bit float elements\n"
+"  f16  - binary with 16-bit half-float elements\n";
+
+int main(int argc, char** argv)
+{
+    if (argc < 4)
+    {
+        std::cerr << "Please specify input and output files and the output format.\n";
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_SUCCESS);
+    }
+
+    const std::string input_filename(argv[1]);
+    const std::string output_filename(argv[2]);
+    const std::string output_format(argv[3]);
+
+    if (output_format == "text")
+    {
+        save_matrix(output_filename, load_matrix(input_filename));
+    }
+    else if (output_format == "f32")
+    {
+        save_matrix_binary(output_filename, load_matrix(input_filename));
+    }
+    else if (output_format == "f16")
+    {
+        save_half_matrix_binary(output_filename, load_half_matrix(input_filename));
+    }
+    else
+    {
+        std::cerr << "Unknown output format \"" << output_format << "\".\n";
+        std::cerr << HELP_MESSAGE;
+        std::exit(EXIT_FAILURE);
+    }
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+//--------------------------------------------------------------------------------------
+// File: matrix_multiplication_kernels.h
+// Desc: The kernels of buffer_matrix_multiplication.cpp, shared with the
+//       specialization benchmark
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+#ifndef SDK_EXAMPLES_MATRIX_MULTIPLICATION_KERNELS_H
+#define SDK_EXAMPLES_MATRIX_MULTIPLICATION_KERNELS_H
+
+#include <CL/cl.h>
+
+static const char *MATRIX_MULTIPLICATION_PROGRAM_SOURCE[] = {
+// Built with -D FIXED_MATRIX_A_WIDTH=<width of A> -D FIXED_MATRIX_B_WIDTH=<width of B>,
+// the kernels use these constants in place of their matrix_a_width and
+// matrix_b_width arguments, so the compiler can unroll the loop over a row of
+// A and fold the index arithmetic. Without them the kernels work for any size.
+"#ifdef FIXED_MATRIX_A_WIDTH\n",
+"#define MATRIX_A_WIDTH FIXED_MATRIX_A_WIDTH\n",
+"#define MATRIX_B_WIDTH FIXED_MATRIX_B_WIDTH\n",
+"#else\n",
+"#define MATRIX_A_WIDTH matrix_a_width\n",
+"#define MATRIX_B_WIDTH matrix_b_width\n",
+"#endif\n",
+"\n",
+// Each work item computes a 4-column by 8-row (8x4) section of the output matrix.
+// The inner loops read in a 1x4 section of matrix B, a 8x1 section of matrix A,
+// and accumulate the partial results for the corresponding 8x4 section of
+// matrix C.
+// The outer loop iterates over the width of matrix A and the height of matrix B
+// to get the complete result.
+"__kernel void matmul_8x4_blocks(__global const float *matrix_a,\n",
+"                                __global const float *matrix_b,\n",
+"                                __global       float *matrix_c,\n",
+"                                               int    matrix_b_width,\n",
+"                                               int    matrix_a_width)\n",
+"{\n",
+"    const int wid_x = get_global_id(0);\n",
+"    const int wid_y = get_global_id(1);\n",
+"\n",
+"    float  a[8];\n",
+"    float4 b;\n",
+"    float4 c[8];\n",
+"\n",
+"    for (int i = 0; i < 8; ++i)\n",
+"    {\n",
+"        c[i] = (float4)(0.0f);\n",
+"    }\n",
+"\n",
+"    for (int j = 0; j < MATRIX_A_WIDTH; ++j)\n",
+"    {\n",
+"        b = vload4(0, matrix_b + j * MATRIX_B_WIDTH + (wid_x * 4));\n",
+"\n",
+"#pragma unroll\n",
+"        for (int i = 0; i < 8; ++i)\n",
+"        {\n",
+"            a[i] = matrix_a[((wid_y * 8) + i) * MATRIX_A_WIDTH + j];\n",
+"        }\n",
+"\n",
+"#pragma unroll\n",
+"        for (int i = 0; i < 8; ++i)\n",
+"        {\n",
+"            c[i] += a[i] * b;\n",
+"        }\n",
+"    }\n",
+"\n",
+"#pragma unroll\n",
+"    for (int i = 0; i < 8; ++i)\n",
+"    {\n",
+"        vstore4(c[i], 0, matrix_c + ((wid_y * 8) + i) * MATRIX_B_WIDTH + (wid_x * 4));\n",
+"    }\n",
+"}\n",
+"\n",
+// The "remainder" version calculates a single element of the output matrix per
+// work item.
+"__kernel void matmul_remainder(__global const  float *matrix_a,\n",
+"                               __global const  float *matrix_b,\n",
+"                               __global        float *matrix_c,\n",
+"                                               int    x_rem_start,\n",
+"                                               int    y_rem_start,\n",
+"                                               int    matrix_b_width,\n",
+"                                               int    matrix_a_width)\n",
+"{\n",
+"    const int wid_x = get_global_id(0) + x_rem_start;\n",
+"    const int wid_y = get_global_id(1) + y_rem_start;\n",
+"\n",
+"    float c     = 0.0f;\n",
+"    int   a_idx = MATRIX_A_WIDTH * wid_y;\n",
+"    int   b_idx = wid_x;\n",
+"\n",
+"#pragma unroll 8\n",
+"    for (int i = 0; i < MATRIX_A_WIDTH; ++i)\n",
+"    {\n",
+"        c += matrix_a[a_idx] * matrix_b[b_idx];\n",
+"        ++a_idx;\n",
+"        b_idx += MATRIX_B_WIDTH;\n",
+"    }\n",
+"\n",
+"    const int c_idx = wid_x + MATRIX_B_WIDTH * wid_y;\n",
+"    matrix_c[c_idx] = c;\n",
+"}\n"
+};
+
+static const cl_uint MATRIX_MULTIPLICATION_PROGRAM_SOURCE_LEN =
+        sizeof(MATRIX_MULTIPLICATION_PROGRAM_SOURCE) / sizeof(const char *);
+
+#endif //SDK_EXAMPLES_MATRIX_MULTIPLICATION_KERNELS_H
@@ -15,6 +15,7 @@
 #include <iostream>
 
 // Project includes
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 #include "util/util.h"
 
@@ -207,16 +208,19 @@ int main(int argc, char** argv)
     cl_kernel    copy_kernels[]      = {
             wrapper.make_kernel("read_yuv_1x1_write_y_3x1",  program),
             wrapper.make_kernel("read_yuv_1x1_write_uv_3x1", program),
-            wrapper.make_kernel("read_yuv_2x2_write_y_3x1",  program),
-            wrapper.make_kernel("read_yuv_4x1_write_uv_3x1", program),
-            wrapper.make_kernel("read_yuv_4x1_write_y_3x1",  program),
-            wrapper.make_kernel("read_yuv_2x2_write_uv_3x1", program),
+            wrapper.get_kernel("read_yuv_2x2_write_y_3x1",  program),
+            wrapper.get_kernel("read_yuv_4x1_write_uv_3x1", program),
+            wrapper.get_kernel("read_yuv_4x1_write_y_3x1",  program),
+            wrapper.get_kernel("read_yuv_2x2_write_uv_3x1", program),
     };
     static const size_t copy_kernels_size = sizeof(copy_kernels) / sizeof(copy_kernels[0]);
     cl_kernel    conversion_kernel_y      = wrapper.make_kernel("read_yuv_1x1_write_y_3x1", program);
     cl_kernel    conversion_kernel_uv     = wrapper.make_kernel("read_yuv_1x1_write_uv_3x1", program);
     cl_context   context                  = wrapper.get_context();
     tp10_image_t src_tp10_image_info      = load_tp10_image_data(src_image_filename);
+    // Rows are packed three pixels to a word, so widths that aren't a multiple of 3 are padded
+    const size_t src_row_bytes = get_image_layout(src_tp10_image_info.y_width, src_tp10_image_info.y_height,
+                                                  CL_QCOM_UNORM_INT10, CL_QCOM_TP10).row_bytes[0];
 
     /*
      * Step 0: Confirm the required OpenCL extensions are supported.
@@ -262,15 +266,15 @@ int main(int argc, char** argv)
     src_tp10_desc.image_height = src_tp10_image_info.y_height;
 
     cl_int err = 0;
-    cl_mem_ion_host_ptr src_tp10_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_tp10_format, src_tp10_desc);
-    cl_mem src_tp10_image = clCreateImage(
+    ion_allocation src_tp10_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_tp10_format, src_tp10_desc);
+    cl_mem_handle src_tp10_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &src_tp10_format,
             &src_tp10_desc,
-            &src_tp10_ion_mem,
+            src_tp10_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image." << "\n";
@@ -287,15 +291,15 @@ int main(int argc, char** argv)
     out_tp10_desc.image_width  = src_tp10_image_info.y_width;
     out_tp10_desc.image_height = src_tp10_image_info.y_height;
 
-    cl_mem_ion_host_ptr out_tp10_ion_mem = wrapper.make_ion_buffer_for_yuv_image(out_tp10_format, out_tp10_desc);
-    cl_mem out_tp10_image = clCreateImage(
+    ion_allocation out_tp10_ion_mem = wrapper.make_ion_buffer_for_yuv_image(out_tp10_format, out_tp10_desc);
+    cl_mem_handle out_tp10_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &out_tp10_format,
             &out_tp10_desc,
-            &out_tp10_ion_mem,
+            out_tp10_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for output image." << "\n";
@@ -312,16 +316,16 @@ int main(int argc, char** argv)
     compressed_tp10_desc.image_width  = src_tp10_image_info.y_width;
     compressed_tp10_desc.image_height = src_tp10_image_info.y_height;
 
-    cl_mem_ion_host_ptr compressed_tp10_ion_mem = wrapper.make_ion_buffer_for_compressed_image(compressed_tp10_format,
-                                                                                               compressed_tp10_desc);
-    cl_mem compressed_tp10_image = clCreateImage(
+    ion_allocation compressed_tp10_ion_mem = wrapper.make_ion_buffer_for_compressed_image(compressed_tp10_format,
+                                                                                          compressed_tp10_desc);
+    cl_mem_handle compressed_tp10_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &compressed_tp10_format,
             &compressed_tp10_desc,
-            &compressed_tp10_ion_mem,
+            compressed_tp10_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for compressed image." << "\n";
@@ -341,16 +345,16 @@ int main(int argc, char** argv)
     src_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     src_y_plane_desc.image_width  = src_tp10_image_info.y_width;
     src_y_plane_desc.image_height = src_tp10_image_info.y_height;
-    src_y_plane_desc.mem_object   = src_tp10_image;
+    src_y_plane_desc.mem_object   = src_tp10_image.get();
 
-    cl_mem src_y_plane = clCreateImage(
+    cl_mem_handle src_y_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_y_plane_format,
             &src_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image y plane." << "\n";
@@ -368,16 +372,16 @@ int main(int argc, char** argv)
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
     src_uv_plane_desc.image_width  = src_tp10_image_info.y_width;
     src_uv_plane_desc.image_height = src_tp10_image_info.y_height;
-    src_uv_plane_desc.mem_object   = src_tp10_image;
+    src_uv_plane_desc.mem_object   = src_tp10_image.get();
 
-    cl_mem src_uv_plane = clCreateImage(
+    cl_mem_handle src_uv_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_uv_plane_format,
             &src_uv_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image uv plane." << "\n";
@@ -393,16 +397,16 @@ int main(int argc, char** argv)
     out_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     out_y_plane_desc.image_width  = out_tp10_desc.image_width;
     out_y_plane_desc.image_height = out_tp10_desc.image_height;
-    out_y_plane_desc.mem_object   = out_tp10_image;
+    out_y_plane_desc.mem_object   = out_tp10_image.get();
 
-    cl_mem out_y_plane = clCreateImage(
+    cl_mem_handle out_y_plane(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY,
             &out_y_plane_format,
             &out_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for destination image y plane." << "\n";
@@ -420,16 +424,16 @@ int main(int argc, char** argv)
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
     out_uv_plane_desc.image_width  = out_tp10_desc.image_width;
     out_uv_plane_desc.image_height = out_tp10_desc.image_height;
-    out_uv_plane_desc.mem_object   = out_tp10_image;
+    out_uv_plane_desc.mem_object   = out_tp10_image.get();
 
-    cl_mem out_uv_plane = clCreateImage(
+    cl_mem_handle out_uv_plane(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY,
             &out_uv_plane_format,
             &out_uv_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for destination image uv plane." << "\n";
@@ -445,16 +449,16 @@ int main(int argc, char** argv)
     compressed_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     compressed_y_plane_desc.image_width  = compressed_tp10_desc.image_width;
     compressed_y_plane_desc.image_height = compressed_tp10_desc.image_height;
-    compressed_y_plane_desc.mem_object   = compressed_tp10_image;
+    compressed_y_plane_desc.mem_object   = compressed_tp10_image.get();
 
-    cl_mem compressed_y_plane = clCreateImage(
+    cl_mem_handle compressed_y_plane(clCreateImage(
             context,
             CL_MEM_READ_WRITE,
             &compressed_y_plane_format,
             &compressed_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for compressed image y plane." << "\n";
@@ -472,16 +476,16 @@ int main(int argc, char** argv)
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
     compressed_uv_plane_desc.image_width  = compressed_tp10_desc.image_width;
     compressed_uv_plane_desc.image_height = compressed_tp10_desc.image_height;
-    compressed_uv_plane_desc.mem_object   = compressed_tp10_image;
+    compressed_uv_plane_desc.mem_object   = compressed_tp10_image.get();
 
-    cl_mem compressed_uv_plane = clCreateImage(
+    cl_mem_handle compressed_uv_plane(clCreateImage(
             context,
             CL_MEM_READ_WRITE,
             &compressed_uv_plane_format,
             &compressed_uv_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for compressed image uv plane." << "\n";
@@ -500,7 +504,7 @@ int main(int argc, char** argv)
     size_t           row_pitch      = 0;
     unsigned char   *image_ptr      = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            src_y_plane,
+            src_y_plane.get(),
             CL_TRUE,
             CL_MAP_WRITE,
             origin,
@@ -523,12 +527,12 @@ int main(int argc, char** argv)
     {
         std::memcpy(
                 image_ptr                          + i * row_pitch,
-                src_tp10_image_info.y_plane.data() + i * src_y_plane_desc.image_width * 4 / 3,
-                src_y_plane_desc.image_width * 4 / 3
+                src_tp10_image_info.y_plane.data() + i * src_row_bytes,
+                src_row_bytes
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, src_y_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, src_y_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping source image y-plane data buffer." << "\n";
@@ -540,7 +544,7 @@ int main(int argc, char** argv)
     row_pitch                    = 0;
     image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            src_uv_plane,
+            src_uv_plane.get(),
             CL_TRUE,
             CL_MAP_WRITE,
             origin,
@@ -563,12 +567,12 @@ int main(int argc, char** argv)
     {
         std::memcpy(
                 image_ptr                           + i * row_pitch,
-                src_tp10_image_info.uv_plane.data() + i * src_uv_plane_desc.image_width * 4 / 3,
-                src_uv_plane_desc.image_width * 4 / 3
+                src_tp10_image_info.uv_plane.data() + i * src_row_bytes,
+                src_row_bytes
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, src_uv_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, src_uv_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping source image uv-plane data buffer." << "\n";
@@ -579,13 +583,13 @@ int main(int argc, char** argv)
      * Step 4: Set up other kernel arguments
      */
 
-    cl_sampler sampler = clCreateSampler(
+    cl_sampler_handle sampler(clCreateSampler(
             context,
             CL_FALSE,
             CL_ADDRESS_CLAMP_TO_EDGE,
             CL_FILTER_NEAREST,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateSampler." << "\n";
@@ -615,12 +619,12 @@ int main(int argc, char** argv)
 
     std::array<kernel_exec_params_t, copy_kernels_size> kernel_execution_params{
             /*                   kernel,          source,         destination,         work_size[0],                              work_size[1] */
-            kernel_exec_params_t{copy_kernels[0], src_tp10_image, compressed_y_plane,  src_tp10_desc.image_width / 3,             src_tp10_desc.image_height,                comp_t::Y_ONLY},
-            kernel_exec_params_t{copy_kernels[1], src_tp10_image, compressed_uv_plane, src_tp10_desc.image_width / 6,             src_tp10_desc.image_height / 2,            comp_t::UV_ONLY},
-            kernel_exec_params_t{copy_kernels[2], src_tp10_image, compressed_y_plane,  src_tp10_desc.image_width / 6,             src_tp10_desc.image_height / 2,            comp_t::Y_ONLY},
-            kernel_exec_params_t{copy_kernels[3], src_tp10_image, compressed_uv_plane, work_units(src_tp10_desc.image_width, 12), src_tp10_desc.image_height / 2,            comp_t::UV_ONLY},
-            kernel_exec_params_t{copy_kernels[4], src_tp10_image, compressed_y_plane,  work_units(src_tp10_desc.image_width, 12), src_tp10_desc.image_height,                comp_t::Y_ONLY},
-            kernel_exec_params_t{copy_kernels[5], src_tp10_image, compressed_uv_plane, work_units(src_tp10_desc.image_width, 12), work_units(src_tp10_desc.image_height, 4), comp_t::UV_ONLY},
+            kernel_exec_params_t{copy_kernels[0], src_tp10_image.get(), compressed_y_plane.get(),  src_tp10_desc.image_width / 3,             src_tp10_desc.image_height,                comp_t::Y_ONLY},
+            kernel_exec_params_t{copy_kernels[1], src_tp10_image.get(), compressed_uv_plane.get(), src_tp10_desc.image_width / 6,             src_tp10_desc.image_height / 2,            comp_t::UV_ONLY},
+            kernel_exec_params_t{copy_kernels[2], src_tp10_image.get(), compressed_y_plane.get(),  src_tp10_desc.image_width / 6,             src_tp10_desc.image_height / 2,            comp_t::Y_ONLY},
+            kernel_exec_params_t{copy_kernels[3], src_tp10_image.get(), compressed_uv_plane.get(), work_units(src_tp10_desc.image_width, 12), src_tp10_desc.image_height / 2,            comp_t::UV_ONLY},
+            kernel_exec_params_t{copy_kernels[4], src_tp10_image.get(), compressed_y_plane.get(),  work_units(src_tp10_desc.image_width, 12), src_tp10_desc.image_height,                comp_t::Y_ONLY},
+            kernel_exec_params_t{copy_kernels[5], src_tp10_image.get(), compressed_uv_plane.get(), work_units(src_tp10_desc.image_width, 12), work_units(src_tp10_desc.image_height, 4), comp_t::UV_ONLY},
     };
 
     for (size_t i = 0; i < kernel_execution_params.size(); ++i)
@@ -645,7 +649,7 @@ int main(int argc, char** argv)
             std::exit(err);
         }
 
-        err = clSetKernelArg(copy_kernel, 2, sizeof(sampler), &sampler);
+        err = clSetKernelArg(copy_kernel, 2, sizeof(cl_sampler), sampler.address());
         if (err != CL_SUCCESS)
         {
             std::cerr << "On iteration " << i << ":\n";
@@ -654,23 +658,7 @@ int main(int argc, char** argv)
         }
 
         const size_t work_size[] = {kernel_execution_params[i].width, kernel_execution_params[i].height};
-        err = clEnqueueNDRangeKernel(
-                command_queue,
-                copy_kernel,
-                2,
-                NULL,
-                work_size,
-                NULL,
-                0,
-                NULL,
-                NULL
-        );
-        if (err != CL_SUCCESS)
-        {
-            std::cerr << "On iteration " << i << ":\n";
-            std::cerr << "\tError " << err << " with clEnqueueNDRangeKernel for copy kernel." << "\n";
-            std::exit(err);
-        }
+        wrapper.enqueue_kernel(copy_kernel, 2, work_size, NULL);
 
         size_t comparison_map_region[] = {0, 0, 1};
         size_t comparison_global_work_size[] = {0, 0};
@@ -689,8 +677,8 @@ int main(int argc, char** argv)
                 comparison_height              = src_tp10_desc.image_height;
                 comparison_global_work_size[0] = src_tp10_desc.image_width / 3;
                 comparison_global_work_size[1] = src_tp10_desc.image_height;
-                comparison_plane               = src_y_plane;
-                dst_plane                      = out_y_plane;
+                comparison_plane               = src_y_plane.get();
+                dst_plane                      = out_y_plane.get();
                 conversion_kernel = conversion_kernel_y;
                 break;
             }
@@ -702,8 +690,8 @@ int main(int argc, char** argv)
                 comparison_height              = src_tp10_desc.image_height / 2;
                 comparison_global_work_size[0] = work_units(src_tp10_desc.image_width, 6);
                 comparison_global_work_size[1] = src_tp10_desc.image_height / 2;
-                comparison_plane               = src_uv_plane;
-                dst_plane                      = out_uv_plane;
+                comparison_plane               = src_uv_plane.get();
+                dst_plane                      = out_uv_plane.get();
                 conversion_kernel = conversion_kernel_uv;
                 break;
             }
@@ -715,7 +703,7 @@ int main(int argc, char** argv)
             }
         }
 
-        err = clSetKernelArg(conversion_kernel, 0, sizeof(compressed_tp10_image), &compressed_tp10_image);
+        err = clSetKernelArg(conversion_kernel, 0, sizeof(cl_mem), compressed_tp10_image.address());
         if (err != CL_SUCCESS)
         {
             std::cerr << "On iteration " << i << ":\n";
@@ -731,7 +719,7 @@ int main(int argc, char** argv)
             std::exit(err);
         }
 
-        err = clSetKernelArg(conversion_kernel, 2, sizeof(sampler), &sampler);
+        err = clSetKernelArg(conversion_kernel, 2, sizeof(cl_sampler), sampler.address());
         if (err != CL_SUCCESS)
         {
             std::cerr << "On iteration " << i << ":\n";
@@ -739,23 +727,7 @@ int main(int argc, char** argv)
             std::exit(err);
         }
 
-        err = clEnqueueNDRangeKernel(
-                command_queue,
-                conversion_kernel,
-                2,
-                NULL,
-                comparison_global_work_size,
-                NULL,
-                0,
-                NULL,
-                NULL
-        );
-        if (err != CL_SUCCESS)
-        {
-            std::cerr << "On iteration " << i << ":\n";
-            std::cerr << "\tError " << err << " with clEnqueueNDRangeKernel for conversion kernel." << "\n";
-            std::exit(err);
-        }
+        wrapper.enqueue_kernel(conversion_kernel, 2, comparison_global_work_size, NULL);
         
         size_t         src_row_pitch = 0;
         unsigned char *src_image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
@@ -843,17 +815,5 @@ int main(int argc, char** argv)
 
     clFinish(command_queue); // Finish up the unmaps above.
 
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseSampler(sampler);
-    clReleaseMemObject(src_uv_plane);
-    clReleaseMemObject(src_y_plane);
-    clReleaseMemObject(src_tp10_image);
-    clReleaseMemObject(out_uv_plane);
-    clReleaseMemObject(out_y_plane);
-    clReleaseMemObject(out_tp10_image);
-    clReleaseMemObject(compressed_uv_plane);
-    clReleaseMemObject(compressed_y_plane);
-    clReleaseMemObject(compressed_tp10_image);
-
     return 0;
 }
@@ -15,6 +15,7 @@
 #include <iostream>
 
 // Project includes
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 #include "util/util.h"
 
@@ -165,12 +166,12 @@ int main(int argc, char** argv)
     cl_wrapper wrapper;
     cl_program   program             = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
     cl_kernel    copy_kernels[]      = {
-            wrapper.make_kernel("read_yuv_2x2_write_y_2x1",  program),
-            wrapper.make_kernel("read_yuv_2x2_write_uv_2x1",  program),
-            wrapper.make_kernel("read_yuv_4x1_write_y_4x1",  program),
-            wrapper.make_kernel("read_yuv_4x1_write_uv_2x1", program),
-            wrapper.make_kernel("read_uv_2x2_write_uv_2x1",  program),
-            wrapper.make_kernel("read_y_4x1_write_y_4x1",  program),
+            wrapper.get_kernel("read_yuv_2x2_write_y_2x1",  program),
+            wrapper.get_kernel("read_yuv_2x2_write_uv_2x1",  program),
+            wrapper.get_kernel("read_yuv_4x1_write_y_4x1",  program),
+            wrapper.get_kernel("read_yuv_4x1_write_uv_2x1", program),
+            wrapper.get_kernel("read_uv_2x2_write_uv_2x1",  program),
+            wrapper.get_kernel("read_y_4x1_write_y_4x1",  program),
     };
     cl_context   context             = wrapper.get_context();
     nv12_image_t src_nv12_image_info = load_nv12_image_data(src_image_filename);
@@ -219,15 +220,15 @@ int main(int argc, char** argv)
     src_nv12_desc.image_height = src_nv12_image_info.y_height;
 
     cl_int err = 0;
-    cl_mem_ion_host_ptr src_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_nv12_format, src_nv12_desc);
-    cl_mem src_nv12_image = clCreateImage(
+    ion_allocation src_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_nv12_format, src_nv12_desc);
+    cl_mem_handle src_nv12_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &src_nv12_format,
             &src_nv12_desc,
-            &src_nv12_ion_mem,
+            src_nv12_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image." << "\n";
@@ -244,15 +245,15 @@ int main(int argc, char** argv)
     out_nv12_desc.image_width  = src_nv12_image_info.y_width;
     out_nv12_desc.image_height = src_nv12_image_info.y_height;
 
-    cl_mem_ion_host_ptr out_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(out_nv12_format, out_nv12_desc);
-    cl_mem out_nv12_image = clCreateImage(
+    ion_allocation out_nv12_ion_mem = wrapper.make_ion_buffer_for_yuv_image(out_nv12_format, out_nv12_desc);
+    cl_mem_handle out_nv12_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &out_nv12_format,
             &out_nv12_desc,
-            &out_nv12_ion_mem,
+            out_nv12_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for output image." << "\n";
@@ -272,16 +273,16 @@ int main(int argc, char** argv)
     src_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     src_y_plane_desc.image_width  = src_nv12_image_info.y_width;
     src_y_plane_desc.image_height = src_nv12_image_info.y_height;
-    src_y_plane_desc.mem_object   = src_nv12_image;
+    src_y_plane_desc.mem_object   = src_nv12_image.get();
 
-    cl_mem src_y_plane = clCreateImage(
+    cl_mem_handle src_y_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_y_plane_format,
             &src_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image y plane." << "\n";
@@ -299,16 +300,16 @@ int main(int argc, char** argv)
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
     src_uv_plane_desc.image_width  = src_nv12_image_info.y_width;
     src_uv_plane_desc.image_height = src_nv12_image_info.y_height;
-    src_uv_plane_desc.mem_object   = src_nv12_image;
+    src_uv_plane_desc.mem_object   = src_nv12_image.get();
 
-    cl_mem src_uv_plane = clCreateImage(
+    cl_mem_handle src_uv_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_uv_plane_format,
             &src_uv_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image uv plane." << "\n";
@@ -324,16 +325,16 @@ int main(int argc, char** argv)
     out_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     out_y_plane_desc.image_width  = out_nv12_desc.image_width;
     out_y_plane_desc.image_height = out_nv12_desc.image_height;
-    out_y_plane_desc.mem_object   = out_nv12_image;
+    out_y_plane_desc.mem_object   = out_nv12_image.get();
 
-    cl_mem out_y_plane = clCreateImage(
+    cl_mem_handle out_y_plane(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY,
             &out_y_plane_format,
             &out_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for destination image y plane." << "\n";
@@ -351,16 +352,16 @@ int main(int argc, char** argv)
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
     out_uv_plane_desc.image_width  = out_nv12_desc.image_width;
     out_uv_plane_desc.image_height = out_nv12_desc.image_height;
-    out_uv_plane_desc.mem_object   = out_nv12_image;
+    out_uv_plane_desc.mem_object   = out_nv12_image.get();
 
-    cl_mem out_uv_plane = clCreateImage(
+    cl_mem_handle out_uv_plane(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY,
             &out_uv_plane_format,
             &out_uv_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for destination image uv plane." << "\n";
@@ -379,7 +380,7 @@ int main(int argc, char** argv)
     size_t           row_pitch      = 0;
     unsigned char   *image_ptr      = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            src_y_plane,
+            src_y_plane.get(),
             CL_TRUE,
             CL_MAP_WRITE,
             origin,
@@ -407,7 +408,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, src_y_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, src_y_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping source image y-plane data buffer." << "\n";
@@ -419,7 +420,7 @@ int main(int argc, char** argv)
     row_pitch                    = 0;
     image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
             command_queue,
-            src_uv_plane,
+            src_uv_plane.get(),
             CL_TRUE,
             CL_MAP_WRITE,
             origin,
@@ -447,7 +448,7 @@ int main(int argc, char** argv)
         );
     }
 
-    err = clEnqueueUnmapMemObject(command_queue, src_uv_plane, image_ptr, 0, NULL, NULL);
+    err = clEnqueueUnmapMemObject(command_queue, src_uv_plane.get(), image_ptr, 0, NULL, NULL);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " unmapping source image uv-plane data buffer." << "\n";
@@ -458,13 +459,13 @@ int main(int argc, char** argv)
      * Step 4: Set up other kernel arguments
      */
 
-    cl_sampler sampler = clCreateSampler(
+    cl_sampler_handle sampler(clCreateSampler(
             context,
             CL_FALSE,
             CL_ADDRESS_CLAMP_TO_EDGE,
             CL_FILTER_NEAREST,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateSampler." << "\n";
@@ -494,12 +495,12 @@ int main(int argc, char** argv)
 
     std::array<kernel_exec_params_t, 6> kernel_execution_params{
             /*                   kernel,          source,         destination,  work_size[0],                             work_size[1] */
-            kernel_exec_params_t{copy_kernels[0], src_nv12_image, out_y_plane,  src_nv12_desc.image_width / 2,            src_nv12_desc.image_height / 2,            comp_t::Y_ONLY},
-            kernel_exec_params_t{copy_kernels[1], src_nv12_image, out_uv_plane, work_units(src_nv12_desc.image_width, 4), work_units(src_nv12_desc.image_height, 4), comp_t::UV_ONLY},
-            kernel_exec_params_t{copy_kernels[2], src_nv12_image, out_y_plane,  work_units(src_nv12_desc.image_width, 4), src_nv12_desc.image_height,                comp_t::Y_ONLY},
-            kernel_exec_params_t{copy_kernels[3], src_nv12_image, out_uv_plane, work_units(src_nv12_desc.image_width, 4), src_nv12_desc.image_height / 2,            comp_t::UV_ONLY},
-            kernel_exec_params_t{copy_kernels[4], src_uv_plane,   out_uv_plane, work_units(src_nv12_desc.image_width, 4), work_units(src_nv12_desc.image_height, 4), comp_t::UV_ONLY},
-            kernel_exec_params_t{copy_kernels[5], src_y_plane,    out_y_plane,  work_units(src_nv12_desc.image_width, 4), src_nv12_desc.image_height,                comp_t::Y_ONLY},
+            kernel_exec_params_t{copy_kernels[0], src_nv12_image.get(), out_y_plane.get(),  src_nv12_desc.image_width / 2,            src_nv12_desc.image_height / 2,            comp_t::Y_ONLY},
+            kernel_exec_params_t{copy_kernels[1], src_nv12_image.get(), out_uv_plane.get(), work_units(src_nv12_desc.image_width, 4), work_units(src_nv12_desc.image_height, 4), comp_t::UV_ONLY},
+            kernel_exec_params_t{copy_kernels[2], src_nv12_image.get(), out_y_plane.get(),  work_units(src_nv12_desc.image_width, 4), src_nv12_desc.image_height,                comp_t::Y_ONLY},
+            kernel_exec_params_t{copy_kernels[3], src_nv12_image.get(), out_uv_plane.get(), work_units(src_nv12_desc.image_width, 4), src_nv12_desc.image_height / 2,            comp_t::UV_ONLY},
+            kernel_exec_params_t{copy_kernels[4], src_uv_plane.get(),   out_uv_plane.get(), work_units(src_nv12_desc.image_width, 4), work_units(src_nv12_desc.image_height, 4), comp_t::UV_ONLY},
+            kernel_exec_params_t{copy_kernels[5], src_y_plane.get(),    out_y_plane.get(),  work_units(src_nv12_desc.image_width, 4), src_nv12_desc.image_height,                comp_t::Y_ONLY},
     };
 
     for (size_t i = 0; i < kernel_execution_params.size(); ++i)
@@ -524,7 +525,7 @@ int main(int argc, char** argv)
             std::exit(err);
         }
 
-        err = clSetKernelArg(copy_kernel, 2, sizeof(sampler), &sampler);
+        err = clSetKernelArg(copy_kernel, 2, sizeof(cl_sampler), sampler.address());
         if (err != CL_SUCCESS)
         {
             std::cerr << "On iteration " << i << ":\n";
@@ -533,23 +534,7 @@ int main(int argc, char** argv)
         }
 
         const size_t work_size[] = {kernel_execution_params[i].width, kernel_execution_params[i].height};
-        err = clEnqueueNDRangeKernel(
-                command_queue,
-                copy_kernel,
-                2,
-                NULL,
-                work_size,
-                NULL,
-                0,
-                NULL,
-                NULL
-        );
-        if (err != CL_SUCCESS)
-        {
-            std::cerr << "On iteration " << i << ":\n";
-            std::cerr << "\tError " << err << " with clEnqueueNDRangeKernel for copy kernel." << "\n";
-            std::exit(err);
-        }
+        wrapper.enqueue_kernel(copy_kernel, 2, work_size, NULL);
 
         size_t comparison_map_region[] = {0, 0, 1};
         cl_mem comparison_plane;
@@ -562,7 +547,7 @@ int main(int argc, char** argv)
             {
                 comparison_map_region[0] = src_nv12_desc.image_width;
                 comparison_map_region[1] = src_nv12_desc.image_height;
-                comparison_plane         = src_y_plane;
+                comparison_plane         = src_y_plane.get();
                 comparison_width         = src_nv12_desc.image_width;
                 comparison_height        = src_nv12_desc.image_height;
                 break;
@@ -571,7 +556,7 @@ int main(int argc, char** argv)
             {
                 comparison_map_region[0] = src_nv12_desc.image_width / 2;
                 comparison_map_region[1] = src_nv12_desc.image_height / 2;
-                comparison_plane         = src_uv_plane;
+                comparison_plane         = src_uv_plane.get();
                 comparison_width         = src_nv12_desc.image_width;
                 comparison_height        = src_nv12_desc.image_height / 2;
                 break;
@@ -670,14 +655,5 @@ int main(int argc, char** argv)
 
     clFinish(command_queue); // Finish up the unmaps above.
 
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseSampler(sampler);
-    clReleaseMemObject(src_uv_plane);
-    clReleaseMemObject(src_y_plane);
-    clReleaseMemObject(src_nv12_image);
-    clReleaseMemObject(out_uv_plane);
-    clReleaseMemObject(out_y_plane);
-    clReleaseMemObject(out_nv12_image);
-
     return 0;
 }
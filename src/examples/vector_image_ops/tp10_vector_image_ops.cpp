@@ -15,6 +15,7 @@
 #include <iostream>
 
 // Project includes
+#include "util/cl_handles.h"
 #include "util/cl_wrapper.h"
 #include "util/util.h"
 
@@ -205,16 +206,16 @@ int main(int argc, char** argv)
     cl_wrapper wrapper;
     cl_program   program             = wrapper.make_program(PROGRAM_SOURCE, PROGRAM_SOURCE_LEN);
     cl_kernel    copy_kernels[]      = {
-            wrapper.make_kernel("read_yuv_1x1_write_y_3x1",  program),
-            wrapper.make_kernel("read_yuv_1x1_write_uv_3x1", program),
-            wrapper.make_kernel("read_yuv_2x2_write_y_3x1",  program),
-            wrapper.make_kernel("read_yuv_4x1_write_uv_3x1", program),
-            wrapper.make_kernel("read_yuv_4x1_write_y_3x1",  program),
-            wrapper.make_kernel("read_yuv_2x2_write_uv_3x1", program),
+            wrapper.get_kernel("read_yuv_1x1_write_y_3x1",  program),
+            wrapper.get_kernel("read_yuv_1x1_write_uv_3x1", program),
+            wrapper.get_kernel("read_yuv_2x2_write_y_3x1",  program),
+            wrapper.get_kernel("read_yuv_4x1_write_uv_3x1", program),
+            wrapper.get_kernel("read_yuv_4x1_write_y_3x1",  program),
+            wrapper.get_kernel("read_yuv_2x2_write_uv_3x1", program),
     };
     static const size_t copy_kernels_size = sizeof(copy_kernels) / sizeof(copy_kernels[0]);
     cl_context   context             = wrapper.get_context();
-    tp10_image_t src_tp10_image_info = load_tp10_image_data(src_image_filename);
+    image_layout_t src_tp10_layout   = read_image_data_layout(src_image_filename, CL_QCOM_UNORM_INT10, CL_QCOM_TP10);
 
     /*
      * Step 0: Confirm the required OpenCL extensions are supported.
@@ -256,19 +257,19 @@ int main(int argc, char** argv)
     cl_image_desc src_tp10_desc;
     std::memset(&src_tp10_desc, 0, sizeof(src_tp10_desc));
     src_tp10_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
-    src_tp10_desc.image_width  = src_tp10_image_info.y_width;
-    src_tp10_desc.image_height = src_tp10_image_info.y_height;
+    src_tp10_desc.image_width  = src_tp10_layout.width;
+    src_tp10_desc.image_height = src_tp10_layout.height;
 
     cl_int err = 0;
-    cl_mem_ion_host_ptr src_tp10_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_tp10_format, src_tp10_desc);
-    cl_mem src_tp10_image = clCreateImage(
+    ion_allocation src_tp10_ion_mem = wrapper.make_ion_buffer_for_yuv_image(src_tp10_format, src_tp10_desc);
+    cl_mem_handle src_tp10_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &src_tp10_format,
             &src_tp10_desc,
-            &src_tp10_ion_mem,
+            src_tp10_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image." << "\n";
@@ -282,18 +283,18 @@ int main(int argc, char** argv)
     cl_image_desc out_tp10_desc;
     std::memset(&out_tp10_desc, 0, sizeof(out_tp10_desc));
     out_tp10_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
-    out_tp10_desc.image_width  = src_tp10_image_info.y_width;
-    out_tp10_desc.image_height = src_tp10_image_info.y_height;
+    out_tp10_desc.image_width  = src_tp10_layout.width;
+    out_tp10_desc.image_height = src_tp10_layout.height;
 
-    cl_mem_ion_host_ptr out_tp10_ion_mem = wrapper.make_ion_buffer_for_yuv_image(out_tp10_format, out_tp10_desc);
-    cl_mem out_tp10_image = clCreateImage(
+    ion_allocation out_tp10_ion_mem = wrapper.make_ion_buffer_for_yuv_image(out_tp10_format, out_tp10_desc);
+    cl_mem_handle out_tp10_image(clCreateImage(
             context,
             CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM,
             &out_tp10_format,
             &out_tp10_desc,
-            &out_tp10_ion_mem,
+            out_tp10_ion_mem.get(),
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for output image." << "\n";
@@ -311,18 +312,18 @@ int main(int argc, char** argv)
     cl_image_desc src_y_plane_desc;
     std::memset(&src_y_plane_desc, 0, sizeof(src_y_plane_desc));
     src_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
-    src_y_plane_desc.image_width  = src_tp10_image_info.y_width;
-    src_y_plane_desc.image_height = src_tp10_image_info.y_height;
-    src_y_plane_desc.mem_object   = src_tp10_image;
+    src_y_plane_desc.image_width  = src_tp10_layout.width;
+    src_y_plane_desc.image_height = src_tp10_layout.height;
+    src_y_plane_desc.mem_object   = src_tp10_image.get();
 
-    cl_mem src_y_plane = clCreateImage(
+    cl_mem_handle src_y_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_y_plane_format,
             &src_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image y plane." << "\n";
@@ -338,18 +339,18 @@ int main(int argc, char** argv)
     src_uv_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     // The image dimensions for the uv-plane derived image must be the same as the parent image, even though the
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
-    src_uv_plane_desc.image_width  = src_tp10_image_info.y_width;
-    src_uv_plane_desc.image_height = src_tp10_image_info.y_height;
-    src_uv_plane_desc.mem_object   = src_tp10_image;
+    src_uv_plane_desc.image_width  = src_tp10_layout.width;
+    src_uv_plane_desc.image_height = src_tp10_layout.height;
+    src_uv_plane_desc.mem_object   = src_tp10_image.get();
 
-    cl_mem src_uv_plane = clCreateImage(
+    cl_mem_handle src_uv_plane(clCreateImage(
             context,
             CL_MEM_READ_ONLY,
             &src_uv_plane_format,
             &src_uv_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for source image uv plane." << "\n";
@@ -365,16 +366,16 @@ int main(int argc, char** argv)
     out_y_plane_desc.image_type   = CL_MEM_OBJECT_IMAGE2D;
     out_y_plane_desc.image_width  = out_tp10_desc.image_width;
     out_y_plane_desc.image_height = out_tp10_desc.image_height;
-    out_y_plane_desc.mem_object   = out_tp10_image;
+    out_y_plane_desc.mem_object   = out_tp10_image.get();
 
-    cl_mem out_y_plane = clCreateImage(
+    cl_mem_handle out_y_plane(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY,
             &out_y_plane_format,
             &out_y_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for destination image y plane." << "\n";
@@ -392,16 +393,16 @@ int main(int argc, char** argv)
     // actual dimensions of the uv-plane differ by a factor of 2 in each dimension.
     out_uv_plane_desc.image_width  = out_tp10_desc.image_width;
     out_uv_plane_desc.image_height = out_tp10_desc.image_height;
-    out_uv_plane_desc.mem_object   = out_tp10_image;
+    out_uv_plane_desc.mem_object   = out_tp10_image.get();
 
-    cl_mem out_uv_plane = clCreateImage(
+    cl_mem_handle out_uv_plane(clCreateImage(
             context,
             CL_MEM_WRITE_ONLY,
             &out_uv_plane_format,
             &out_uv_plane_desc,
             NULL,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateImage for destination image uv plane." << "\n";
@@ -409,103 +410,29 @@ int main(int argc, char** argv)
     }
 
     /*
-     * Step 3: Copy data to input image planes. Note that for linear TP10 images you must observe row alignment
-     * restrictions. (You may also write to the ion buffer directly if you prefer, however using clEnqueueMapImage for
-     * a child planar image will return the correct host pointer for the desired plane.)
+     * Step 3: Load the input image straight into its ion buffer. Note that for linear TP10 images you must observe
+     * row alignment restrictions, so the rows are placed at the row pitch reported for the image format, and the
+     * uv-plane follows the y-plane's padded height. This saves staging the image in host memory and copying it again.
      */
 
-    cl_command_queue command_queue  = wrapper.get_command_queue();
-    const size_t     origin[]       = {0, 0, 0};
-    const size_t     src_y_region[] = {src_y_plane_desc.image_width, src_y_plane_desc.image_height, 1};
-    size_t           row_pitch      = 0;
-    unsigned char   *image_ptr      = static_cast<unsigned char *>(clEnqueueMapImage(
-            command_queue,
-            src_y_plane,
-            CL_TRUE,
-            CL_MAP_WRITE,
-            origin,
-            src_y_region,
-            &row_pitch,
-            NULL,
-            0,
-            NULL,
-            NULL,
-            &err
-    ));
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " mapping source image y-plane buffer for writing." << "\n";
-        std::exit(err);
-    }
-
-    // Copies image data to the ION buffer from the host
-    for (uint32_t i = 0; i < src_y_plane_desc.image_height; ++i)
-    {
-        std::memcpy(
-                image_ptr                          + i * row_pitch,
-                src_tp10_image_info.y_plane.data() + i * src_y_plane_desc.image_width * 4 / 3,
-                src_y_plane_desc.image_width * 4 / 3
-        );
-    }
-
-    err = clEnqueueUnmapMemObject(command_queue, src_y_plane, image_ptr, 0, NULL, NULL);
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " unmapping source image y-plane data buffer." << "\n";
-        std::exit(err);
-    }
-
-    // Note the discrepancy between the child plane image descriptor and the size required by clEnqueueMapImage.
-    const size_t src_uv_region[] = {src_uv_plane_desc.image_width / 2, src_uv_plane_desc.image_height / 2, 1};
-    row_pitch                    = 0;
-    image_ptr = static_cast<unsigned char *>(clEnqueueMapImage(
-            command_queue,
-            src_uv_plane,
-            CL_TRUE,
-            CL_MAP_WRITE,
-            origin,
-            src_uv_region,
-            &row_pitch,
-            NULL,
-            0,
-            NULL,
-            NULL,
-            &err
-    ));
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " mapping source image uv-plane buffer for writing." << "\n";
-        std::exit(err);
-    }
-
-    // Copies image data to the ION buffer from the host
-    for (uint32_t i = 0; i < src_uv_plane_desc.image_height / 2; ++i)
-    {
-        std::memcpy(
-                image_ptr                           + i * row_pitch,
-                src_tp10_image_info.uv_plane.data() + i * src_uv_plane_desc.image_width * 4 / 3,
-                src_uv_plane_desc.image_width * 4 / 3
-        );
-    }
+    const size_t src_ion_row_pitch = wrapper.get_ion_image_row_pitch(src_tp10_format, src_tp10_desc);
+    load_tp10_image_data(src_image_filename, *src_tp10_ion_mem, src_ion_row_pitch,
+                         wrapper.get_ion_yuv_image_padded_height(src_tp10_desc));
 
-    err = clEnqueueUnmapMemObject(command_queue, src_uv_plane, image_ptr, 0, NULL, NULL);
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " unmapping source image uv-plane data buffer." << "\n";
-        std::exit(err);
-    }
+    cl_command_queue command_queue = wrapper.get_command_queue();
+    const size_t     origin[]      = {0, 0, 0};
 
     /*
      * Step 4: Set up other kernel arguments
      */
 
-    cl_sampler sampler = clCreateSampler(
+    cl_sampler_handle sampler(clCreateSampler(
             context,
             CL_FALSE,
             CL_ADDRESS_CLAMP_TO_EDGE,
             CL_FILTER_NEAREST,
             &err
-    );
+    ));
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateSampler." << "\n";
@@ -535,12 +462,12 @@ int main(int argc, char** argv)
 
     std::array<kernel_exec_params_t, copy_kernels_size> kernel_execution_params{
             /*                   kernel,          source,         destination,  work_size[0],                              work_size[1] */
-            kernel_exec_params_t{copy_kernels[0], src_tp10_image, out_y_plane,  src_tp10_desc.image_width / 3,             src_tp10_desc.image_height,                comp_t::Y_ONLY},
-            kernel_exec_params_t{copy_kernels[1], src_tp10_image, out_uv_plane, src_tp10_desc.image_width / 6,             src_tp10_desc.image_height / 2,            comp_t::UV_ONLY},
-            kernel_exec_params_t{copy_kernels[2], src_tp10_image, out_y_plane,  src_tp10_desc.image_width / 6,             src_tp10_desc.image_height / 2,            comp_t::Y_ONLY},
-            kernel_exec_params_t{copy_kernels[3], src_tp10_image, out_uv_plane, work_units(src_tp10_desc.image_width, 12), src_tp10_desc.image_height / 2,            comp_t::UV_ONLY},
-            kernel_exec_params_t{copy_kernels[4], src_tp10_image, out_y_plane,  work_units(src_tp10_desc.image_width, 12), src_tp10_desc.image_height,                comp_t::Y_ONLY},
-            kernel_exec_params_t{copy_kernels[5], src_tp10_image, out_uv_plane, work_units(src_tp10_desc.image_width, 12), work_units(src_tp10_desc.image_height, 4), comp_t::UV_ONLY},
+            kernel_exec_params_t{copy_kernels[0], src_tp10_image.get(), out_y_plane.get(),  src_tp10_desc.image_width / 3,             src_tp10_desc.image_height,                comp_t::Y_ONLY},
+            kernel_exec_params_t{copy_kernels[1], src_tp10_image.get(), out_uv_plane.get(), src_tp10_desc.image_width / 6,             src_tp10_desc.image_height / 2,            comp_t::UV_ONLY},
+            kernel_exec_params_t{copy_kernels[2], src_tp10_image.get(), out_y_plane.get(),  src_tp10_desc.image_width / 6,             src_tp10_desc.image_height / 2,            comp_t::Y_ONLY},
+            kernel_exec_params_t{copy_kernels[3], src_tp10_image.get(), out_uv_plane.get(), work_units(src_tp10_desc.image_width, 12), src_tp10_desc.image_height / 2,            comp_t::UV_ONLY},
+            kernel_exec_params_t{copy_kernels[4], src_tp10_image.get(), out_y_plane.get(),  work_units(src_tp10_desc.image_width, 12), src_tp10_desc.image_height,                comp_t::Y_ONLY},
+            kernel_exec_params_t{copy_kernels[5], src_tp10_image.get(), out_uv_plane.get(), work_units(src_tp10_desc.image_width, 12), work_units(src_tp10_desc.image_height, 4), comp_t::UV_ONLY},
     };
 
     for (size_t i = 0; i < kernel_execution_params.size(); ++i)
@@ -565,7 +492,7 @@ int main(int argc, char** argv)
             std::exit(err);
         }
 
-        err = clSetKernelArg(copy_kernel, 2, sizeof(sampler), &sampler);
+        err = clSetKernelArg(copy_kernel, 2, sizeof(cl_sampler), sampler.address());
         if (err != CL_SUCCESS)
         {
             std::cerr << "On iteration " << i << ":\n";
@@ -574,23 +501,7 @@ int main(int argc, char** argv)
         }
 
         const size_t work_size[] = {kernel_execution_params[i].width, kernel_execution_params[i].height};
-        err = clEnqueueNDRangeKernel(
-                command_queue,
-                copy_kernel,
-                2,
-                NULL,
-                work_size,
-                NULL,
-                0,
-                NULL,
-                NULL
-        );
-        if (err != CL_SUCCESS)
-        {
-            std::cerr << "On iteration " << i << ":\n";
-            std::cerr << "\tError " << err << " with clEnqueueNDRangeKernel for copy kernel." << "\n";
-            std::exit(err);
-        }
+        wrapper.enqueue_kernel(copy_kernel, 2, work_size, NULL);
 
         size_t comparison_map_region[] = {0, 0, 1};
         cl_mem comparison_plane;
@@ -603,7 +514,7 @@ int main(int argc, char** argv)
             {
                 comparison_map_region[0] = src_tp10_desc.image_width;
                 comparison_map_region[1] = src_tp10_desc.image_height;
-                comparison_plane         = src_y_plane;
+                comparison_plane         = src_y_plane.get();
                 comparison_width         = src_tp10_desc.image_width * 4 / 3;
                 comparison_height        = src_tp10_desc.image_height;
                 break;
@@ -612,7 +523,7 @@ int main(int argc, char** argv)
             {
                 comparison_map_region[0] = src_tp10_desc.image_width / 2;
                 comparison_map_region[1] = src_tp10_desc.image_height / 2;
-                comparison_plane         = src_uv_plane;
+                comparison_plane         = src_uv_plane.get();
                 comparison_width         = src_tp10_desc.image_width * 4 / 3;
                 comparison_height        = src_tp10_desc.image_height / 2;
                 break;
@@ -711,14 +622,5 @@ int main(int argc, char** argv)
 
     clFinish(command_queue); // Finish up the unmaps above.
 
-    // Clean up cl resources that aren't automatically handled by cl_wrapper
-    clReleaseSampler(sampler);
-    clReleaseMemObject(src_uv_plane);
-    clReleaseMemObject(src_y_plane);
-    clReleaseMemObject(src_tp10_image);
-    clReleaseMemObject(out_uv_plane);
-    clReleaseMemObject(out_y_plane);
-    clReleaseMemObject(out_tp10_image);
-
     return 0;
 }
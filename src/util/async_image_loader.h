@@ -0,0 +1,204 @@
+//--------------------------------------------------------------------------------------
+// File: async_image_loader.h
+// Desc:
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+#ifndef SDK_EXAMPLES_ASYNC_IMAGE_LOADER_H
+#define SDK_EXAMPLES_ASYNC_IMAGE_LOADER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * \brief Loads a list of image files on a small pool of background threads,
+ *        so that file I/O and parsing overlap with the caller's GPU work.
+ *
+ * Images are handed out by next() in the order of the file list. At most
+ * queue_capacity images are loaded ahead of the one the caller is waiting
+ * for; when that many are waiting to be taken the loading threads block, so
+ * memory use stays bounded however slow the consumer is.
+ *
+ * next() swaps the caller's previous image into the queue in exchange for the
+ * new one, and files are loaded into those recycled images. With loaders
+ * that reuse storage, such as load_nv12_image_data(filename, image), a
+ * steady stream of same-sized frames then allocates no memory.
+ *
+ * @param ImageType - Template param. The decoded image type, e.g. nv12_image_t
+ *                    or bayer_mipi10_image_t.
+ */
+template <typename ImageType>
+class async_image_loader {
+public:
+    /**
+     * \brief Starts loading the first images.
+     *
+     * @param LoadFunction - Template param. Any callable taking a filename and
+     *                       an ImageType & to load into.
+     * @param filenames - The files to load, in the order they are wanted.
+     * @param load - The function that loads one file. It is called
+     *               concurrently from several threads, each with its own image.
+     * @param num_threads - The number of loading threads.
+     * @param queue_capacity - The maximum number of images loaded ahead.
+     */
+    template <typename LoadFunction>
+    async_image_loader(const std::vector<std::string> &filenames, LoadFunction load, size_t num_threads = 2,
+                       size_t queue_capacity = 4)
+        : m_filenames(filenames)
+        , m_load(std::move(load))
+        , m_capacity(queue_capacity == 0 ? 1 : queue_capacity)
+        , m_slots(m_capacity)
+        , m_ready(m_capacity, false)
+        , m_next_to_load(0)
+        , m_next_to_return(0)
+        , m_stopping(false)
+        , m_wait_seconds(0)
+    {
+        for (size_t i = 0; i < (num_threads == 0 ? 1 : num_threads); ++i)
+        {
+            m_threads.emplace_back(&async_image_loader::load_images, this);
+        }
+    }
+
+    /**
+     * \brief As above, for a plain loading function. This picks the right
+     *        overload of e.g. load_nv12_image_data without a cast.
+     */
+    async_image_loader(const std::vector<std::string> &filenames, void (*load)(const std::string &, ImageType &),
+                       size_t num_threads = 2, size_t queue_capacity = 4)
+        : async_image_loader(filenames, std::function<void(const std::string &, ImageType &)>(load), num_threads,
+                             queue_capacity)
+    {
+    }
+
+    async_image_loader(const async_image_loader &) = delete;
+
+    async_image_loader &operator=(const async_image_loader &) = delete;
+
+    /**
+     * \brief Stops loading and waits for the loading threads. Images that were
+     *        loaded but not taken are discarded.
+     */
+    ~async_image_loader()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_can_load.notify_all();
+        for (auto &thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    /**
+     * \brief Takes the next image in file order, waiting for it to be loaded if necessary.
+     *
+     * @param image [in,out] - Receives the image. Its previous contents are
+     *                         given back to the loader to load into.
+     * @param filename [out] - If not NULL, set to the file the image was loaded from.
+     * @return false once every image has been taken.
+     */
+    bool next(ImageType &image, std::string *filename = NULL)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_next_to_return >= m_filenames.size())
+        {
+            return false;
+        }
+
+        const size_t slot       = m_next_to_return % m_capacity;
+        const auto   wait_start = std::chrono::steady_clock::now();
+        m_loaded.wait(lock, [&]() { return m_ready[slot]; });
+        m_wait_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - wait_start).count();
+
+        std::swap(image, m_slots[slot]);
+        if (filename)
+        {
+            *filename = m_filenames[m_next_to_return];
+        }
+        m_ready[slot] = false;
+        ++m_next_to_return;
+        lock.unlock();
+
+        m_can_load.notify_all();
+        return true;
+    }
+
+    /**
+     * \brief Gets the number of files in the list.
+     * @return
+     */
+    size_t size() const
+    {
+        return m_filenames.size();
+    }
+
+    /**
+     * \brief Gets the total time next() spent waiting for images to be loaded,
+     *        i.e. the loading time that was not hidden behind the caller's work.
+     * @return
+     */
+    double wait_seconds() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_wait_seconds;
+    }
+
+private:
+    void load_images()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            // Backpressure: don't run more than m_capacity images ahead of the consumer
+            m_can_load.wait(lock, [&]()
+            {
+                return m_stopping || m_next_to_load >= m_filenames.size()
+                       || m_next_to_load < m_next_to_return + m_capacity;
+            });
+            if (m_stopping || m_next_to_load >= m_filenames.size())
+            {
+                return;
+            }
+
+            // Until it is marked ready, nothing else touches this slot
+            const size_t index = m_next_to_load++;
+            const size_t slot  = index % m_capacity;
+            lock.unlock();
+            m_load(m_filenames[index], m_slots[slot]);
+            lock.lock();
+
+            m_ready[slot] = true;
+            m_loaded.notify_all();
+        }
+    }
+
+    std::vector<std::string>  m_filenames;
+    std::function<void(const std::string &, ImageType &)> m_load;
+    size_t                    m_capacity;
+    std::vector<ImageType>    m_slots;
+    std::vector<bool>         m_ready;
+    size_t                    m_next_to_load;
+    size_t                    m_next_to_return;
+    bool                      m_stopping;
+    double                    m_wait_seconds;
+    mutable std::mutex        m_mutex;
+    std::condition_variable   m_can_load;
+    std::condition_variable   m_loaded;
+    std::vector<std::thread>  m_threads;
+};
+
+#endif //SDK_EXAMPLES_ASYNC_IMAGE_LOADER_H
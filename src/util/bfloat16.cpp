@@ -0,0 +1,63 @@
+//--------------------------------------------------------------------------------------
+// File: bfloat16.cpp
+// Desc:
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+#include "bfloat16.h"
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Internal method for converting the bits of a float to a bfloat16, written
+ * without branches so that loops over it vectorize.
+ */
+static cl_bfloat16 to_bfloat16_from_bits(uint32_t bits)
+{
+    // Adding just under half of the dropped range, plus the lowest kept bit,
+    // rounds ties to even. A carry out of the mantissa correctly increments
+    // the exponent, up to infinity.
+    const uint32_t rounded = (bits + 0x7FFF + ((bits >> 16) & 1)) >> 16;
+    // NaNs are made quiet, so that rounding can't turn them into infinity
+    const uint32_t nan     = (bits >> 16) | 0x0040;
+    return static_cast<cl_bfloat16>((bits & 0x7FFFFFFF) > 0x7F800000 ? nan : rounded);
+}
+
+cl_bfloat16 to_bfloat16(cl_float f)
+{
+    uint32_t bits = 0;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return to_bfloat16_from_bits(bits);
+}
+
+cl_float bfloat16_to_float(cl_bfloat16 b)
+{
+    const uint32_t bits = static_cast<uint32_t>(b) << 16;
+    cl_float       f    = 0;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+void to_bfloat16_n(const cl_float *src, cl_bfloat16 *dst, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint32_t bits = 0;
+        std::memcpy(&bits, src + i, sizeof(bits));
+        dst[i] = to_bfloat16_from_bits(bits);
+    }
+}
+
+void bfloat16_to_float_n(const cl_bfloat16 *src, cl_float *dst, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        const uint32_t bits = static_cast<uint32_t>(src[i]) << 16;
+        std::memcpy(dst + i, &bits, sizeof(bits));
+    }
+}
@@ -0,0 +1,66 @@
+//--------------------------------------------------------------------------------------
+// File: bfloat16.h
+// Desc:
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+#ifndef SDK_EXAMPLES_BFLOAT16_H
+#define SDK_EXAMPLES_BFLOAT16_H
+
+#include <cstddef>
+
+#include <CL/cl.h>
+
+/**
+ * \brief A 16-bit bfloat16 value: the top half of a 32-bit float, with its
+ *        sign, its full 8-bit exponent and 7 bits of mantissa. It takes as
+ *        little memory as a half float but has the range of a float, so it
+ *        doesn't overflow where a half would. OpenCL C has no bfloat16 type,
+ *        so kernels see these as ushort.
+ */
+typedef cl_ushort cl_bfloat16;
+
+/**
+ * \brief Converts a 32-bit float to a bfloat16, rounding to nearest even.
+ *        NaNs stay NaNs, keeping their sign.
+ *
+ * @param f [in] - The 32-bit float to convert
+ * @return the nearest bfloat16
+ */
+cl_bfloat16 to_bfloat16(cl_float f);
+
+/**
+ * \brief Converts a bfloat16 to a 32-bit float. This is always exact.
+ *
+ * @param b [in] - The bfloat16 to convert
+ * @return the equivalent 32-bit float
+ */
+cl_float bfloat16_to_float(cl_bfloat16 b);
+
+/**
+ * \brief Converts n 32-bit floats to bfloat16, giving exactly the same
+ *        results as to_bfloat16. The loop has no branches, so the compiler
+ *        vectorizes it.
+ *
+ * @param src [in] - The floats to convert
+ * @param dst [out] - Where to write the n bfloat16 values
+ * @param n [in] - The number of values to convert
+ */
+void to_bfloat16_n(const cl_float *src, cl_bfloat16 *dst, size_t n);
+
+/**
+ * \brief Converts n bfloat16 values to 32-bit floats, giving exactly the same
+ *        results as bfloat16_to_float.
+ *
+ * @param src [in] - The bfloat16 values to convert
+ * @param dst [out] - Where to write the n floats
+ * @param n [in] - The number of values to convert
+ */
+void bfloat16_to_float_n(const cl_bfloat16 *src, cl_float *dst, size_t n);
+
+#endif //SDK_EXAMPLES_BFLOAT16_H
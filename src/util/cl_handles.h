@@ -0,0 +1,126 @@
+//--------------------------------------------------------------------------------------
+// File: cl_handles.h
+// Desc:
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+#ifndef SDK_EXAMPLES_CL_HANDLES_H
+#define SDK_EXAMPLES_CL_HANDLES_H
+
+#include <cstddef>
+
+#include <CL/cl.h>
+
+/**
+ * \brief Owns a reference to an OpenCL object, and releases it when destroyed.
+ *
+ * Handles can be moved but not copied, so each reference has exactly one owner.
+ * Use them for objects the caller makes itself, e.g. with clCreateBuffer or
+ * clCreateImage, so that a pipeline can free an intermediate as soon as it is
+ * done with it instead of when it exits. Objects from a cl_wrapper, such as
+ * programs and kernels, are owned by the wrapper and must not be put in one.
+ */
+template <typename T, cl_int (CL_API_CALL *release_object)(T)>
+class cl_handle {
+public:
+    cl_handle() :
+        m_object(NULL)
+    {
+    }
+
+    /**
+     * \brief Takes ownership of a reference, e.g. the result of clCreateBuffer.
+     *
+     * @param object [in] - May be NULL
+     */
+    explicit cl_handle(T object) :
+        m_object(object)
+    {
+    }
+
+    ~cl_handle()
+    {
+        reset();
+    }
+
+    cl_handle(const cl_handle &)            = delete;
+    cl_handle &operator=(const cl_handle &) = delete;
+
+    cl_handle(cl_handle &&other) :
+        m_object(other.m_object)
+    {
+        other.m_object = NULL;
+    }
+
+    cl_handle &operator=(cl_handle &&other)
+    {
+        if (this != &other)
+        {
+            reset(other.m_object);
+            other.m_object = NULL;
+        }
+        return *this;
+    }
+
+    /**
+     * \brief Gets the object, which stays owned by the handle.
+     * @return
+     */
+    T get() const
+    {
+        return m_object;
+    }
+
+    /**
+     * \brief Gets a pointer to the object, e.g. for clSetKernelArg or an event wait list.
+     * @return
+     */
+    const T *address() const
+    {
+        return &m_object;
+    }
+
+    /**
+     * \brief Releases the object now, if there is one, and takes ownership of another.
+     *
+     * @param object [in] - May be NULL
+     */
+    void reset(T object = NULL)
+    {
+        if (m_object)
+        {
+            release_object(m_object);
+        }
+        m_object = object;
+    }
+
+    /**
+     * \brief Gives up ownership of the object without releasing it.
+     * @return the object, which the caller must now release
+     */
+    T release()
+    {
+        T object = m_object;
+        m_object = NULL;
+        return object;
+    }
+
+    explicit operator bool() const
+    {
+        return m_object != NULL;
+    }
+
+private:
+    T m_object;
+};
+
+typedef cl_handle<cl_mem, clReleaseMemObject> cl_mem_handle;
+typedef cl_handle<cl_event, clReleaseEvent> cl_event_handle;
+typedef cl_handle<cl_sampler, clReleaseSampler> cl_sampler_handle;
+
+#endif //SDK_EXAMPLES_CL_HANDLES_H
@@ -17,11 +17,126 @@
 #include <sys/mman.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cstring>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 
-cl_wrapper::cl_wrapper()
+/**
+ * Internal method for the per-user directory program binaries are cached in when CL_PROGRAM_CACHE_DIR is not
+ * set: $XDG_CACHE_HOME/cl_program_cache, or else $HOME/.cache/cl_program_cache. Android shells usually have
+ * neither, so there /data/local/tmp, which belongs to the shell user, is used. Elsewhere, without a home
+ * directory nothing is cached.
+ */
+static std::string get_default_program_cache_dir()
+{
+    const char *xdg_cache_home = std::getenv("XDG_CACHE_HOME");
+    if (xdg_cache_home && xdg_cache_home[0] == '/')
+    {
+        return std::string(xdg_cache_home) + "/cl_program_cache";
+    }
+    const char *home = std::getenv("HOME");
+    if (home && home[0] == '/' && home[1] != '\0')
+    {
+        return std::string(home) + "/.cache/cl_program_cache";
+    }
+#ifdef __ANDROID__
+    return "/data/local/tmp/cl_program_cache";
+#else
+    return std::string();
+#endif
+}
+
+// The trace timeline the wrapper's commands are shown on
+static const char *COMMAND_QUEUE_TRACK = "OpenCL command queue";
+
+// Pending profiled commands are recorded in batches, so that a long run doesn't keep every event alive
+static const size_t MAX_PENDING_PROFILED_COMMANDS = 1024;
+
+/**
+ * Internal method for the profiling requested by the CL_PROFILING environment variable.
+ */
+static profiling_format_t get_env_profiling_format()
+{
+    const char *profiling = std::getenv("CL_PROFILING");
+    if (!profiling || std::strcmp(profiling, "") == 0 || std::strcmp(profiling, "0") == 0)
+    {
+        return profiling_format_t::NONE;
+    }
+    if (std::strcmp(profiling, "json") == 0)
+    {
+        return profiling_format_t::JSON;
+    }
+    if (std::strcmp(profiling, "table") != 0 && std::strcmp(profiling, "1") != 0)
+    {
+        std::cerr << "Unknown CL_PROFILING value \"" << profiling << "\", expected \"table\" or \"json\". "
+                  << "Using \"table\".\n";
+    }
+    return profiling_format_t::TABLE;
+}
+
+/**
+ * Internal method for a perf or priority hint given by an environment variable as "high", "normal" or "low".
+ */
+static cl_uint get_env_hint(const char *variable, cl_uint high, cl_uint normal, cl_uint low)
+{
+    const char *hint = std::getenv(variable);
+    if (!hint || std::strcmp(hint, "") == 0)
+    {
+        return 0;
+    }
+    if (std::strcmp(hint, "high") == 0)
+    {
+        return high;
+    }
+    if (std::strcmp(hint, "normal") == 0)
+    {
+        return normal;
+    }
+    if (std::strcmp(hint, "low") == 0)
+    {
+        return low;
+    }
+    std::cerr << "Unknown " << variable << " value \"" << hint << "\", expected \"high\", \"normal\" or \"low\". "
+              << "Leaving it unset.\n";
+    return 0;
+}
+
+cl_wrapper_config_t cl_wrapper::get_env_config()
+{
+    cl_wrapper_config_t config;
+    config.perf_hint     = get_env_hint("CL_PERF_HINT", CL_PERF_HINT_HIGH_QCOM, CL_PERF_HINT_NORMAL_QCOM,
+                                        CL_PERF_HINT_LOW_QCOM);
+    config.priority_hint = get_env_hint("CL_PRIORITY_HINT", CL_PRIORITY_HINT_HIGH_QCOM,
+                                        CL_PRIORITY_HINT_NORMAL_QCOM, CL_PRIORITY_HINT_LOW_QCOM);
+    config.profiling     = get_env_profiling_format();
+    return config;
+}
+
+/**
+ * Internal method for the environment's configuration with the profiling format replaced.
+ */
+static cl_wrapper_config_t get_env_config_with_profiling(profiling_format_t profiling)
+{
+    cl_wrapper_config_t config = cl_wrapper::get_env_config();
+    config.profiling           = profiling;
+    return config;
+}
+
+cl_wrapper::cl_wrapper() :
+    cl_wrapper(get_env_config())
+{
+}
+
+cl_wrapper::cl_wrapper(profiling_format_t profiling) :
+    cl_wrapper(get_env_config_with_profiling(profiling))
+{
+}
+
+cl_wrapper::cl_wrapper(const cl_wrapper_config_t &config) :
+    m_config(config)
 {
     cl_platform_id platform;
     cl_int err;
@@ -39,21 +154,60 @@ cl_wrapper::cl_wrapper()
         std::exit(err);
     }
 
-    m_context = clCreateContext(NULL, 1, &m_device, NULL, NULL, &err);
+    query_device_capabilities();
+
+    std::vector<cl_context_properties> context_properties;
+    if (m_config.perf_hint != 0)
+    {
+        if (!m_device_caps.has_extension("cl_qcom_perf_hint"))
+        {
+            std::cerr << "A perf hint was given, but the device doesn't support cl_qcom_perf_hint.\n";
+            std::exit(EXIT_FAILURE);
+        }
+        context_properties.push_back(CL_CONTEXT_PERF_HINT_QCOM);
+        context_properties.push_back(m_config.perf_hint);
+    }
+    if (m_config.priority_hint != CL_PRIORITY_HINT_NONE_QCOM)
+    {
+        if (!m_device_caps.has_extension("cl_qcom_priority_hint"))
+        {
+            std::cerr << "A priority hint was given, but the device doesn't support cl_qcom_priority_hint.\n";
+            std::exit(EXIT_FAILURE);
+        }
+        context_properties.push_back(CL_CONTEXT_PRIORITY_HINT_QCOM);
+        context_properties.push_back(m_config.priority_hint);
+    }
+    context_properties.push_back(0);
+
+    m_context = clCreateContext(context_properties.size() > 1 ? context_properties.data() : NULL, 1, &m_device,
+                                NULL, NULL, &err);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateContext." << "\n";
         std::exit(err);
     }
 
-    m_cmd_queue = clCreateCommandQueue(m_context, m_device, 0, &err);
+    m_cmd_queue = clCreateCommandQueue(m_context, m_device,
+                                       events_enabled() ? CL_QUEUE_PROFILING_ENABLE : 0, &err);
     if (err != CL_SUCCESS)
     {
         std::cerr << "Error " << err << " with clCreateCommandQueue." << "\n";
         std::exit(err);
     }
 
+    if (m_config.cache_programs)
+    {
+        const char *cache_dir       = std::getenv("CL_PROGRAM_CACHE_DIR");
+        const char *cache_max_bytes = std::getenv("CL_PROGRAM_CACHE_MAX_BYTES");
+        set_program_cache(cache_dir ? std::string(cache_dir) : get_default_program_cache_dir(),
+                          cache_max_bytes ? std::strtoull(cache_max_bytes, NULL, 10)
+                                          : program_binary_cache::DEFAULT_MAX_BYTES);
+    }
+
     // ION stuff
+    m_ion_pool_stats          = ion_pool_stats_t();
+    m_ion_pool_max_idle_bytes = DEFAULT_ION_POOL_MAX_IDLE_BYTES;
+    m_ion_release_count       = 0;
 #if USES_LIBION
     m_ion_device_fd = ion_open();
     if (m_ion_device_fd < 0)
@@ -73,23 +227,45 @@ cl_wrapper::cl_wrapper()
 
 cl_wrapper::~cl_wrapper()
 {
-    // ION stuff
-    for (auto &pair: m_ion_host_ptrs)
+    // Profiling stuff
+    if (events_enabled())
+    {
+        clFinish(m_cmd_queue);
+        flush_profiling();
+    }
+    if (profiling_enabled())
     {
-        if (munmap(pair.first, pair.second) < 0)
+        const char   *output_path = std::getenv("CL_PROFILING_OUTPUT");
+        std::ofstream output_file;
+        if (output_path)
+        {
+            output_file.open(output_path);
+            if (!output_file)
+            {
+                std::cerr << "Couldn't open " << output_path << " for the profiling output, writing it to stderr.\n";
+            }
+        }
+        std::ostream &output = output_file.is_open() ? static_cast<std::ostream &>(output_file) : std::cerr;
+        if (m_config.profiling == profiling_format_t::JSON)
+        {
+            m_kernel_timings.write_json(output);
+        }
+        else if (!m_kernel_timings.empty())
         {
-            std::cerr << "Error " << errno << " munmap-ing ion alloc: " << strerror(errno) << "\n";
-            std::exit(errno);
+            m_kernel_timings.write_table(output);
         }
-        pair.first = nullptr;
     }
 
-    for (const auto fd : m_file_descs)
+    // ION stuff
+    for (const auto &live : m_live_ion_buffers)
+    {
+        free_ion(live.second);
+    }
+    for (const auto &size_class : m_idle_ion_buffers)
     {
-        if (close(fd) < 0)
+        for (const auto &allocation : size_class.second)
         {
-            std::cerr << "Error " << errno << " closing ion allocation fd: " << strerror(errno) << "\n";
-            std::exit(errno);
+            free_ion(allocation);
         }
     }
 
@@ -100,15 +276,6 @@ cl_wrapper::~cl_wrapper()
         std::exit(EXIT_FAILURE);
     }
 #else
-    for (const auto &handle_data : m_handle_data)
-    {
-        if (ioctl(m_ion_device_fd, ION_IOC_FREE, &handle_data) < 0)
-        {
-            std::cerr << "Error " << errno << " freeing ion alloc with ioctl: " << strerror(errno) << "\n";
-            std::exit(errno);
-        }
-    }
-
     if (close(m_ion_device_fd) < 0)
     {
         std::cerr << "Error " << errno << " closing ion device fd: " << strerror(errno) << "\n";
@@ -129,19 +296,297 @@ cl_wrapper::~cl_wrapper()
     clReleaseContext(m_context);
 }
 
-cl_kernel cl_wrapper::make_kernel(const std::string &kernel_name, cl_program program)
+/**
+ * Internal method for making a kernel the wrapper releases. The caller holds m_kernel_mutex.
+ */
+cl_kernel cl_wrapper::create_kernel(const std::string &kernel_name, cl_program program)
 {
+    TRACE_FUNCTION();
     cl_int err;
     cl_kernel kernel = clCreateKernel(program, kernel_name.c_str(), &err);
     if (err != CL_SUCCESS)
     {
-        std::cerr << "Error " << err << " with clCreateKernel." << "\n";
+        std::cerr << "Error " << err << " with clCreateKernel for " << kernel_name << "." << "\n";
         std::exit(err);
     }
     m_kernels.push_back(kernel);
+    m_kernel_names[kernel] = kernel_name;
+    return kernel;
+}
+
+cl_kernel cl_wrapper::make_kernel(const std::string &kernel_name, cl_program program)
+{
+    std::lock_guard<std::mutex> lock(m_kernel_mutex);
+    return create_kernel(kernel_name, program);
+}
+
+cl_kernel cl_wrapper::get_kernel(const std::string &kernel_name, cl_program program)
+{
+    std::lock_guard<std::mutex> lock(m_kernel_mutex);
+    cl_kernel &kernel = m_kernel_registry[std::make_pair(program, kernel_name)];
+    if (!kernel)
+    {
+        kernel = create_kernel(kernel_name, program);
+    }
     return kernel;
 }
 
+cl_kernel cl_wrapper::get_thread_kernel(const std::string &kernel_name, cl_program program)
+{
+    std::lock_guard<std::mutex> lock(m_kernel_mutex);
+    cl_kernel &kernel = m_thread_kernels[std::make_tuple(program, kernel_name, std::this_thread::get_id())];
+    if (!kernel)
+    {
+        kernel = create_kernel(kernel_name, program);
+    }
+    return kernel;
+}
+
+void cl_wrapper::release_thread_kernels()
+{
+    std::lock_guard<std::mutex> lock(m_kernel_mutex);
+    const std::thread::id this_thread = std::this_thread::get_id();
+    for (auto it = m_thread_kernels.begin(); it != m_thread_kernels.end(); )
+    {
+        if (std::get<2>(it->first) != this_thread)
+        {
+            ++it;
+            continue;
+        }
+        m_kernels.erase(std::find(m_kernels.begin(), m_kernels.end(), it->second));
+        m_kernel_names.erase(it->second);
+        clReleaseKernel(it->second);
+        it = m_thread_kernels.erase(it);
+    }
+}
+
+bool cl_wrapper::profiling_enabled() const
+{
+    return m_config.profiling != profiling_format_t::NONE;
+}
+
+/**
+ * Internal method for whether commands need events and a profiled queue, to profile or trace them.
+ */
+bool cl_wrapper::events_enabled() const
+{
+    return profiling_enabled() || trace_enabled();
+}
+
+/**
+ * Internal method for the event argument of an enqueue: the given event when profiling or tracing, or else NULL.
+ */
+cl_event *cl_wrapper::profiling_event(cl_event *event) const
+{
+    return events_enabled() ? event : NULL;
+}
+
+/**
+ * Internal method for the name of a kernel, as given when the wrapper made it
+ * or else as reported by the driver.
+ */
+std::string cl_wrapper::get_kernel_name(cl_kernel kernel)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_kernel_mutex);
+        const auto it = m_kernel_names.find(kernel);
+        if (it != m_kernel_names.end())
+        {
+            return it->second;
+        }
+    }
+
+    size_t size = 0;
+    cl_int err  = clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, 0, NULL, &size);
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clGetKernelInfo for CL_KERNEL_FUNCTION_NAME.\n";
+        std::exit(err);
+    }
+    std::vector<char> name(size + 1, '\0');
+    err = clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, size, name.data(), NULL);
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clGetKernelInfo for CL_KERNEL_FUNCTION_NAME.\n";
+        std::exit(err);
+    }
+    return std::string(name.data());
+}
+
+/**
+ * Internal method for holding on to a profiled command's event until it's recorded.
+ * Takes over the caller's reference to the event.
+ */
+void cl_wrapper::record_profiled_command(const std::string &name, cl_event event, size_t bytes_moved,
+                                         double host_enqueue_us)
+{
+    bool flush = false;
+    {
+        std::lock_guard<std::mutex> lock(m_profiling_mutex);
+        m_pending_commands.push_back(pending_command_t{name, event, bytes_moved, host_enqueue_us});
+        flush = m_pending_commands.size() > MAX_PENDING_PROFILED_COMMANDS;
+    }
+    if (flush)
+    {
+        flush_profiling();
+    }
+}
+
+/**
+ * Internal method for waiting on the pending profiled commands and recording their times and trace spans.
+ */
+void cl_wrapper::flush_profiling()
+{
+    std::vector<pending_command_t> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_profiling_mutex);
+        pending.swap(m_pending_commands);
+    }
+    for (const auto &command : pending)
+    {
+        cl_int err = clWaitForEvents(1, &command.event);
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error " << err << " with clWaitForEvents for " << command.name << ".\n";
+            std::exit(err);
+        }
+        const bool recorded = (!profiling_enabled()
+                               || m_kernel_timings.record_event(command.name, command.event, command.bytes_moved))
+                              && (!trace_enabled()
+                                  || trace_device_event(command.name, command.event, command.host_enqueue_us,
+                                                        command.bytes_moved, COMMAND_QUEUE_TRACK));
+        if (!recorded)
+        {
+            std::cerr << "Couldn't get the profiling info of " << command.name << ", is the queue profiled?\n";
+        }
+        clReleaseEvent(command.event);
+    }
+}
+
+void cl_wrapper::record_profiling_event(const std::string &name, cl_event event, size_t bytes_moved)
+{
+    if (!events_enabled())
+    {
+        return;
+    }
+    cl_int err = clRetainEvent(event);
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clRetainEvent for " << name << ".\n";
+        std::exit(err);
+    }
+    record_profiled_command(name, event, bytes_moved, trace_enabled() ? trace_now_us() : 0);
+}
+
+const kernel_timing_registry &cl_wrapper::get_kernel_timings()
+{
+    flush_profiling();
+    return m_kernel_timings;
+}
+
+void cl_wrapper::enqueue_kernel(cl_kernel kernel, cl_uint work_dim, const size_t *global_work_size,
+                                const size_t *local_work_size, size_t bytes_moved)
+{
+    TRACE_SCOPE("clEnqueueNDRangeKernel");
+    const double enqueue_us = trace_enabled() ? trace_now_us() : 0;
+    cl_event     event      = NULL;
+    cl_int   err   = clEnqueueNDRangeKernel(m_cmd_queue, kernel, work_dim, NULL, global_work_size, local_work_size,
+                                            0, NULL, profiling_event(&event));
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clEnqueueNDRangeKernel for " << get_kernel_name(kernel) << ".\n";
+        std::exit(err);
+    }
+    if (event)
+    {
+        record_profiled_command(get_kernel_name(kernel), event, bytes_moved, enqueue_us);
+    }
+}
+
+void cl_wrapper::enqueue_read_buffer(cl_mem buffer, cl_bool blocking, size_t offset, size_t size, void *ptr)
+{
+    TRACE_SCOPE("clEnqueueReadBuffer");
+    const double enqueue_us = trace_enabled() ? trace_now_us() : 0;
+    cl_event     event      = NULL;
+    cl_int   err   = clEnqueueReadBuffer(m_cmd_queue, buffer, blocking, offset, size, ptr, 0, NULL,
+                                         profiling_event(&event));
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clEnqueueReadBuffer.\n";
+        std::exit(err);
+    }
+    if (event)
+    {
+        record_profiled_command("clEnqueueReadBuffer", event, size, enqueue_us);
+    }
+}
+
+void cl_wrapper::enqueue_write_buffer(cl_mem buffer, cl_bool blocking, size_t offset, size_t size, const void *ptr)
+{
+    TRACE_SCOPE("clEnqueueWriteBuffer");
+    const double enqueue_us = trace_enabled() ? trace_now_us() : 0;
+    cl_event     event      = NULL;
+    cl_int   err   = clEnqueueWriteBuffer(m_cmd_queue, buffer, blocking, offset, size, ptr, 0, NULL,
+                                          profiling_event(&event));
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clEnqueueWriteBuffer.\n";
+        std::exit(err);
+    }
+    if (event)
+    {
+        record_profiled_command("clEnqueueWriteBuffer", event, size, enqueue_us);
+    }
+}
+
+void *cl_wrapper::enqueue_map_buffer(cl_mem buffer, cl_map_flags map_flags, size_t offset, size_t size)
+{
+    TRACE_SCOPE("clEnqueueMapBuffer");
+    const double enqueue_us = trace_enabled() ? trace_now_us() : 0;
+    cl_event     event      = NULL;
+    cl_int       err        = CL_SUCCESS;
+    void        *ptr        = clEnqueueMapBuffer(m_cmd_queue, buffer, CL_BLOCKING, map_flags, offset, size, 0, NULL,
+                                        profiling_event(&event), &err);
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clEnqueueMapBuffer.\n";
+        std::exit(err);
+    }
+    if (event)
+    {
+        record_profiled_command("clEnqueueMapBuffer", event, 0, enqueue_us);
+    }
+    return ptr;
+}
+
+void cl_wrapper::enqueue_unmap_mem_object(cl_mem mem, void *mapped_ptr)
+{
+    TRACE_SCOPE("clEnqueueUnmapMemObject");
+    const double enqueue_us = trace_enabled() ? trace_now_us() : 0;
+    cl_event     event      = NULL;
+    cl_int   err   = clEnqueueUnmapMemObject(m_cmd_queue, mem, mapped_ptr, 0, NULL, profiling_event(&event));
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clEnqueueUnmapMemObject.\n";
+        std::exit(err);
+    }
+    if (event)
+    {
+        record_profiled_command("clEnqueueUnmapMemObject", event, 0, enqueue_us);
+    }
+}
+
+void cl_wrapper::finish()
+{
+    TRACE_SCOPE("clFinish");
+    cl_int err = clFinish(m_cmd_queue);
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clFinish.\n";
+        std::exit(err);
+    }
+}
+
 cl_context cl_wrapper::get_context() const
 {
     return m_context;
@@ -152,98 +597,355 @@ cl_command_queue cl_wrapper::get_command_queue() const
     return m_cmd_queue;
 }
 
-cl_program cl_wrapper::make_program(const char **program_source, cl_uint program_source_len)
+std::string cl_wrapper::get_device_info_string(cl_device_info param) const
 {
-    cl_int err = 0;
-    cl_program program = clCreateProgramWithSource(m_context, program_source_len, program_source, NULL, &err);
+    size_t size = 0;
+    cl_int err  = clGetDeviceInfo(m_device, param, 0, NULL, &size);
     if (err != CL_SUCCESS)
     {
-        std::cerr << "Error " << err << " with clCreateProgramWithSource." << "\n";
+        std::cerr << "Error " << err << " with clGetDeviceInfo for parameter 0x" << std::hex << param << std::dec << ".\n";
         std::exit(err);
     }
+    std::vector<char> value(size + 1, '\0');
+    err = clGetDeviceInfo(m_device, param, size, value.data(), NULL);
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clGetDeviceInfo for parameter 0x" << std::hex << param << std::dec << ".\n";
+        std::exit(err);
+    }
+    return std::string(value.data());
+}
+
+/**
+ * Internal method for a device property that not every device reports, e.g. a
+ * Qualcomm-specific one. Leaves value as 0 if the query fails.
+ */
+template <typename T>
+static void get_optional_device_info(cl_device_id device, cl_device_info param, T &value)
+{
+    value = 0;
+    if (clGetDeviceInfo(device, param, sizeof(value), &value, NULL) != CL_SUCCESS)
+    {
+        value = 0;
+    }
+}
 
-    err = clBuildProgram(program, 0, NULL, NULL, NULL, NULL);
+template <typename T>
+static void get_device_info(cl_device_id device, cl_device_info param, T &value)
+{
+    const cl_int err = clGetDeviceInfo(device, param, sizeof(value), &value, NULL);
     if (err != CL_SUCCESS)
     {
-        std::cerr << "Error " << err << " with clBuildProgram.\n";
-        static const size_t LOG_SIZE = 2048;
-        char log[LOG_SIZE];
-        log[0] = 0;
-        err = clGetProgramBuildInfo(program, m_device, CL_PROGRAM_BUILD_LOG, LOG_SIZE, log, NULL);
-        if (err == CL_INVALID_VALUE)
-        {
-            std::cerr << "There was a build error, but there is insufficient space allocated to show the build logs.\n";
-        }
-        else
-        {
-            std::cerr << "Build error:\n" << log << "\n";
-        }
-        std::exit(EXIT_FAILURE);
+        std::cerr << "Error " << err << " with clGetDeviceInfo for parameter 0x" << std::hex << param << std::dec << ".\n";
+        std::exit(err);
     }
+}
 
-    m_programs.push_back(program);
+void cl_wrapper::query_device_capabilities()
+{
+    m_device_caps.name           = get_device_info_string(CL_DEVICE_NAME);
+    m_device_caps.driver_version = get_device_info_string(CL_DRIVER_VERSION);
+    get_device_info(m_device, CL_DEVICE_MAX_WORK_GROUP_SIZE, m_device_caps.max_work_group_size);
+    get_device_info(m_device, CL_DEVICE_LOCAL_MEM_SIZE, m_device_caps.local_mem_size);
+    get_device_info(m_device, CL_DEVICE_IMAGE2D_MAX_WIDTH, m_device_caps.image2d_max_width);
+    get_device_info(m_device, CL_DEVICE_IMAGE2D_MAX_HEIGHT, m_device_caps.image2d_max_height);
+    get_device_info(m_device, CL_DEVICE_IMAGE_MAX_BUFFER_SIZE, m_device_caps.image_max_buffer_size);
 
-    return program;
+    get_optional_device_info(m_device, CL_DEVICE_PAGE_SIZE_QCOM, m_device_caps.page_size);
+    get_optional_device_info(m_device, CL_DEVICE_EXT_MEM_PADDING_IN_BYTES_QCOM, m_device_caps.ext_mem_padding);
+    get_optional_device_info(m_device, CL_DEVICE_HOF_MAX_NUM_PHASES_QCOM, m_device_caps.hof_max_num_phases);
+    get_optional_device_info(m_device, CL_DEVICE_HOF_MAX_FILTER_SIZE_X_QCOM, m_device_caps.hof_max_filter_size_x);
+    get_optional_device_info(m_device, CL_DEVICE_HOF_MAX_FILTER_SIZE_Y_QCOM, m_device_caps.hof_max_filter_size_y);
+    get_optional_device_info(m_device, CL_DEVICE_BLOCK_MATCHING_MAX_REGION_SIZE_X_QCOM,
+                             m_device_caps.block_matching_max_region_size_x);
+    get_optional_device_info(m_device, CL_DEVICE_BLOCK_MATCHING_MAX_REGION_SIZE_Y_QCOM,
+                             m_device_caps.block_matching_max_region_size_y);
+
+    // The extensions are separated by spaces
+    std::istringstream extensions(get_device_info_string(CL_DEVICE_EXTENSIONS));
+    std::string        extension;
+    while (extensions >> extension)
+    {
+        m_device_caps.extensions.insert(extension);
+    }
 }
 
-cl_mem_ion_host_ptr
-cl_wrapper::make_ion_buffer_for_yuv_image(const cl_image_format &img_format, const cl_image_desc &img_desc)
+const device_capabilities_t &cl_wrapper::get_device_capabilities() const
 {
-    const size_t effective_img_height = ((img_desc.image_height + 31) / 32) * 32; // Round up to the nearest multiple of 32
-    const size_t img_row_pitch        = get_ion_image_row_pitch(img_format, img_desc);
+    return m_device_caps;
+}
 
-    cl_int err;
-    size_t padding_in_bytes = 0;
+cl_wrapper_config_t cl_wrapper::get_config() const
+{
+    return m_config;
+}
 
-    err = clGetDeviceInfo(m_device, CL_DEVICE_EXT_MEM_PADDING_IN_BYTES_QCOM, sizeof(padding_in_bytes), &padding_in_bytes, NULL);
+void cl_wrapper::set_perf_hint(cl_perf_hint perf_hint)
+{
+    if (!m_device_caps.has_extension("cl_qcom_perf_hint"))
+    {
+        std::cerr << "The device doesn't support cl_qcom_perf_hint, so its perf hint can't be set.\n";
+        std::exit(EXIT_FAILURE);
+    }
+    cl_int err = clSetPerfHintQCOM(m_context, perf_hint);
     if (err != CL_SUCCESS)
     {
-        std::cerr << "Error " << err << " with clGetDeviceInfo for padding." << "\n";
+        std::cerr << "Error " << err << " with clSetPerfHintQCOM.\n";
         std::exit(err);
     }
+    m_config.perf_hint = perf_hint;
+}
 
-    const size_t y_plane_bytes  = img_row_pitch * effective_img_height;
-    const size_t uv_plane_bytes = img_row_pitch * effective_img_height / 2;
-    const size_t total_bytes    = y_plane_bytes + uv_plane_bytes + padding_in_bytes;
+void cl_wrapper::set_program_cache(const std::string &directory, size_t max_bytes)
+{
+    m_program_cache = program_binary_cache(directory, max_bytes);
+}
 
-    return make_ion_buffer(total_bytes);
+program_binary_cache &cl_wrapper::get_program_cache()
+{
+    return m_program_cache;
+}
+
+cl_program cl_wrapper::load_cached_program(const program_cache_key_t &key)
+{
+    TRACE_FUNCTION();
+    std::vector<unsigned char> binary;
+    if (!m_program_cache.load(key, binary))
+    {
+        return NULL;
+    }
+
+    const size_t         binary_size   = binary.size();
+    const unsigned char *binary_data   = binary.data();
+    cl_int               binary_status = CL_SUCCESS;
+    cl_int               err           = CL_SUCCESS;
+    cl_program program = clCreateProgramWithBinary(m_context, 1, &m_device, &binary_size, &binary_data, &binary_status,
+                                                   &err);
+    if (err == CL_SUCCESS && binary_status == CL_SUCCESS)
+    {
+        err = clBuildProgram(program, 1, &m_device, key.options.c_str(), NULL, NULL);
+        if (err == CL_SUCCESS)
+        {
+            return program;
+        }
+    }
+
+    // A stale or corrupt binary: forget it and build from source instead
+    if (program)
+    {
+        clReleaseProgram(program);
+    }
+    m_program_cache.remove(key);
+    return NULL;
+}
+
+void cl_wrapper::cache_program_binary(const program_cache_key_t &key, cl_program program)
+{
+    size_t binary_size = 0;
+    cl_int err = clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(binary_size), &binary_size, NULL);
+    if (err != CL_SUCCESS || binary_size == 0)
+    {
+        return; // Not every driver can give back a binary, and the cache is only an optimization
+    }
+
+    std::vector<unsigned char> binary(binary_size);
+    unsigned char             *binary_data = binary.data();
+    err = clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(binary_data), &binary_data, NULL);
+    if (err == CL_SUCCESS)
+    {
+        m_program_cache.store(key, binary);
+    }
+}
+
+cl_program cl_wrapper::make_program(const char **program_source, cl_uint program_source_len)
+{
+    return make_program(program_source, program_source_len, "");
+}
+
+cl_program cl_wrapper::make_program(const char **program_source, cl_uint program_source_len,
+                                    const std::string &build_options, const program_defines_t &defines)
+{
+    TRACE_FUNCTION();
+    program_cache_key_t key;
+    key.options = build_options;
+    for (const auto &define : defines)
+    {
+        key.options += " -D " + define.first + (define.second.empty() ? "" : "=" + define.second);
+    }
+    for (cl_uint i = 0; i < program_source_len; ++i)
+    {
+        key.source += program_source[i];
+    }
+
+    const auto variant = m_program_variants.find(std::make_pair(key.source, key.options));
+    if (variant != m_program_variants.end())
+    {
+        return variant->second;
+    }
+
+    cl_program program = NULL;
+    if (m_program_cache.enabled())
+    {
+        key.device_name    = m_device_caps.name;
+        key.driver_version = m_device_caps.driver_version;
+        program            = load_cached_program(key);
+    }
+
+    if (!program)
+    {
+        TRACE_SCOPE("clBuildProgram");
+        cl_int err = 0;
+        program = clCreateProgramWithSource(m_context, program_source_len, program_source, NULL, &err);
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error " << err << " with clCreateProgramWithSource." << "\n";
+            std::exit(err);
+        }
+
+        err = clBuildProgram(program, 0, NULL, key.options.c_str(), NULL, NULL);
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error " << err << " with clBuildProgram";
+            if (!key.options.empty())
+            {
+                std::cerr << " and options \"" << key.options << "\"";
+            }
+            std::cerr << ".\n";
+            static const size_t LOG_SIZE = 2048;
+            char log[LOG_SIZE];
+            log[0] = 0;
+            err = clGetProgramBuildInfo(program, m_device, CL_PROGRAM_BUILD_LOG, LOG_SIZE, log, NULL);
+            if (err == CL_INVALID_VALUE)
+            {
+                std::cerr << "There was a build error, but there is insufficient space allocated to show the build logs.\n";
+            }
+            else
+            {
+                std::cerr << "Build error:\n" << log << "\n";
+            }
+            std::exit(EXIT_FAILURE);
+        }
+
+        if (m_program_cache.enabled())
+        {
+            cache_program_binary(key, program);
+        }
+    }
+
+    m_programs.push_back(program);
+    m_program_variants[std::make_pair(key.source, key.options)] = program;
+
+    return program;
 }
 
-static std::string init_extension_string(cl_device_id device)
+/**
+ * \brief Internal method for checking that an ion buffer for a YUV image is given a YUV 4:2:0 format,
+ *        since a single-plane layout would leave no room for the UV plane.
+ */
+static void check_yuv_layout(const ion_image_layout_t &layout, const cl_image_format &img_format)
+{
+    if (layout.num_planes != 2)
+    {
+        std::cerr << "Channel order 0x" << std::hex << img_format.image_channel_order << std::dec
+                  << " is not a two-plane YUV 4:2:0 order, so it can't be used for a YUV image ion buffer.\n";
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+ion_allocation
+cl_wrapper::make_ion_buffer_for_yuv_image(const cl_image_format &img_format, const cl_image_desc &img_desc)
 {
-    static const size_t BUF_SIZE = 1024;
-    char                extensions_buf[BUF_SIZE];
-    std::memset(extensions_buf, 0, sizeof(extensions_buf));
-    //会吧本device支持的所有的extensions，以空格为分割符，放在extensions_buf里面
-    clGetDeviceInfo(device, CL_DEVICE_EXTENSIONS, sizeof(extensions_buf), extensions_buf, NULL);    
-    return std::string(extensions_buf);
+    const ion_image_layout_t layout = get_ion_image_layout(img_format, img_desc);
+    check_yuv_layout(layout, img_format);
+    return make_ion_buffer(layout.total_bytes);
 }
 
 bool cl_wrapper::check_extension_support(const std::string &desired_extension) const
 {
-    static const std::string extensions = init_extension_string(m_device);
-    if (extensions.size() == 0)
+    if (m_device_caps.extensions.empty())
     {
         std::cerr << "Couldn't identify available OpenCL extensions\n";
         std::exit(EXIT_FAILURE);
     }
 
-    return extensions.find(desired_extension) != std::string::npos;
+    return m_device_caps.has_extension(desired_extension);
 }
 
-size_t cl_wrapper::get_ion_image_row_pitch(const cl_image_format &img_format, const cl_image_desc &img_desc) const
+/**
+ * \brief Internal method for telling whether a channel order is one of the two-plane YUV 4:2:0 orders,
+ *        i.e. NV12, P010 or TP10 in their linear, tiled, compressed or 4R forms.
+ */
+static bool is_yuv_420_order(cl_channel_order order)
 {
-    size_t img_row_pitch = 0;
+    switch (order)
+    {
+        case CL_QCOM_NV12:
+        case CL_QCOM_TILED_NV12:
+        case CL_QCOM_COMPRESSED_NV12:
+        case CL_QCOM_COMPRESSED_NV12_4R:
+        case CL_QCOM_P010:
+        case CL_QCOM_TILED_P010:
+        case CL_QCOM_COMPRESSED_P010:
+        case CL_QCOM_TP10:
+        case CL_QCOM_TILED_TP10:
+        case CL_QCOM_COMPRESSED_TP10:
+            return true;
+        default:
+            return false;
+    }
+}
+
+ion_image_layout_t cl_wrapper::get_ion_image_layout(const cl_image_format &img_format, const cl_image_desc &img_desc) const
+{
+    std::lock_guard<std::mutex> lock(m_image_layout_mutex);
+    ion_image_layout_t &layout = m_image_layouts[std::make_tuple(img_format.image_channel_order,
+                                                                 img_format.image_channel_data_type,
+                                                                 img_desc.image_width, img_desc.image_height)];
+    if (layout.row_pitch != 0)
+    {
+        return layout;
+    }
+
     cl_int err = clGetDeviceImageInfoQCOM(m_device, img_desc.image_width, img_desc.image_height, &img_format,
-                                          CL_IMAGE_ROW_PITCH, sizeof(img_row_pitch), &img_row_pitch, NULL);
+                                          CL_IMAGE_ROW_PITCH, sizeof(layout.row_pitch), &layout.row_pitch, NULL);
     if (err != CL_SUCCESS) {
         std::cerr << "Error " << err << " with clGetDeviceImageInfoQCOM for CL_IMAGE_ROW_PITCH." << "\n";
         std::exit(err);
     }
-    return img_row_pitch;
+
+    if (is_yuv_420_order(img_format.image_channel_order))
+    {
+        // The UV plane has half as many rows, and follows the Y plane's padded rows
+        layout.padded_height   = get_ion_yuv_image_padded_height(img_desc);
+        layout.num_planes      = 2;
+        layout.plane_offset[0] = 0;
+        layout.plane_offset[1] = layout.row_pitch * layout.padded_height;
+        layout.total_bytes     = layout.plane_offset[1] + layout.row_pitch * layout.padded_height / 2;
+    }
+    else
+    {
+        layout.padded_height   = img_desc.image_height;
+        layout.num_planes      = 1;
+        layout.plane_offset[0] = 0;
+        layout.plane_offset[1] = 0;
+        layout.total_bytes     = layout.row_pitch * layout.padded_height;
+    }
+    layout.total_bytes += m_device_caps.ext_mem_padding;
+
+    return layout;
 }
 
-cl_mem_ion_host_ptr
+size_t cl_wrapper::get_ion_image_row_pitch(const cl_image_format &img_format, const cl_image_desc &img_desc) const
+{
+    return get_ion_image_layout(img_format, img_desc).row_pitch;
+}
+
+size_t cl_wrapper::get_ion_yuv_image_padded_height(const cl_image_desc &img_desc) const
+{
+    return ((img_desc.image_height + 31) / 32) * 32; // Round up to the nearest multiple of 32
+}
+
+ion_allocation
 cl_wrapper::make_ion_buffer_for_compressed_image(cl_image_format img_format, const cl_image_desc &img_desc)
 {
     const bool valid_compressed_nv12 = img_format.image_channel_order        == CL_QCOM_COMPRESSED_NV12
@@ -274,27 +976,17 @@ cl_wrapper::make_ion_buffer_for_compressed_image(cl_image_format img_format, con
     return make_ion_buffer(total_bytes);
 }
 
-cl_mem_ion_host_ptr cl_wrapper::make_ion_buffer(size_t size)
+ion_allocation cl_wrapper::make_ion_buffer(size_t size)
 {
     return make_ion_buffer_internal(size, 0, CL_MEM_HOST_UNCACHED_QCOM);
 }
 
-cl_mem_ion_host_ptr
+ion_allocation
 cl_wrapper::make_ion_buffer_for_nonplanar_image(const cl_image_format &img_format, const cl_image_desc &img_desc)
 {
-    cl_int err;
-    size_t padding_in_bytes = 0;
-
     (void) img_format; // Unused, for now
 
-    err = clGetDeviceInfo(m_device, CL_DEVICE_EXT_MEM_PADDING_IN_BYTES_QCOM, sizeof(padding_in_bytes), &padding_in_bytes, NULL);
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error " << err << " with clGetDeviceInfo for padding." << "\n";
-        std::exit(err);
-    }
-
-    const size_t total_bytes = img_desc.image_row_pitch * img_desc.image_height + padding_in_bytes;
+    const size_t total_bytes = img_desc.image_row_pitch * img_desc.image_height + m_device_caps.ext_mem_padding;
     return make_ion_buffer(total_bytes);
 }
 
@@ -312,26 +1004,80 @@ size_t cl_wrapper::get_max_workgroup_size(cl_kernel kernel) const
     return result;
 }
 
-cl_mem_ion_host_ptr cl_wrapper::make_iocoherent_ion_buffer(size_t size)
+ion_allocation cl_wrapper::make_iocoherent_ion_buffer(size_t size)
 {
     return make_ion_buffer_internal(size, ION_FLAG_CACHED, CL_MEM_HOST_IOCOHERENT_QCOM);
 }
 
-cl_mem_ion_host_ptr cl_wrapper::make_ion_buffer_internal(size_t size, unsigned int ion_allocation_flags, cl_uint host_cache_policy)
+/**
+ * Internal method for the size class of an ion buffer: a whole number of pages,
+ * and beyond 8 pages a multiple of an eighth of the next power of two.
+ */
+static size_t get_ion_size_class(size_t size, size_t page_size)
 {
-    cl_int  err;
-    cl_uint device_page_size;
+    const size_t pages = std::max<size_t>((size + page_size - 1) / page_size, 1);
+    size_t       step  = 1;
+    while (pages > 8 * step)
+    {
+        step *= 2;
+    }
+    return (pages + step - 1) / step * step * page_size;
+}
 
-    err = clGetDeviceInfo(m_device, CL_DEVICE_PAGE_SIZE_QCOM, sizeof(device_page_size), &device_page_size, NULL);
-    if (err != CL_SUCCESS)
+ion_allocation cl_wrapper::make_ion_buffer_internal(size_t size, unsigned int ion_allocation_flags, cl_uint host_cache_policy)
+{
+    TRACE_SCOPE("make_ion_buffer");
+    std::lock_guard<std::mutex> lock(m_ion_mutex);
+
+    if (m_device_caps.page_size == 0)
     {
-        std::cerr << "Error " << err << " with clGetDeviceInfo for page size." << "\n";
-        std::exit(err);
+        std::cerr << "The device doesn't report CL_DEVICE_PAGE_SIZE_QCOM, so it can't use ion buffers.\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    const size_t      size_class = get_ion_size_class(size, m_device_caps.page_size);
+    auto             &idle       = m_idle_ion_buffers[std::make_pair(host_cache_policy, size_class)];
+    ion_allocation_t  allocation;
+    if (!idle.empty())
+    {
+        allocation = idle.back();
+        idle.pop_back();
+        m_ion_pool_stats.idle_bytes -= allocation.size;
+        ++m_ion_pool_stats.reuses;
+    }
+    else
+    {
+        allocation = allocate_ion(size_class, ion_allocation_flags, host_cache_policy);
+        ++m_ion_pool_stats.allocations;
     }
+    m_live_ion_buffers[allocation.host_ptr] = allocation;
+    m_ion_pool_stats.live_bytes += allocation.size;
+    m_ion_pool_stats.peak_bytes  = std::max(m_ion_pool_stats.peak_bytes,
+                                            m_ion_pool_stats.live_bytes + m_ion_pool_stats.idle_bytes);
+
+    cl_mem_ion_host_ptr ion_mem;
+    ion_mem.ext_host_ptr.allocation_type   = CL_MEM_ION_HOST_PTR_QCOM;
+    ion_mem.ext_host_ptr.host_cache_policy = host_cache_policy;
+    ion_mem.ion_filedesc                   = allocation.fd;
+    ion_mem.ion_hostptr                    = allocation.host_ptr;
+
+    return ion_allocation(this, ion_mem);
+}
+
+/**
+ * Internal method for allocating and mapping ion memory. The caller holds m_ion_mutex.
+ */
+cl_wrapper::ion_allocation_t cl_wrapper::allocate_ion(size_t size, unsigned int ion_allocation_flags, cl_uint host_cache_policy)
+{
+    TRACE_FUNCTION();
+    ion_allocation_t allocation;
+    allocation.size              = size;
+    allocation.host_cache_policy = host_cache_policy;
+    allocation.released          = 0;
 
 #if USES_LIBION
     int fd = 0;
-    err = ion_alloc_fd(m_ion_device_fd, size, device_page_size, ION_HEAP(ION_SYSTEM_HEAP_ID), ion_allocation_flags, &fd);
+    const int err = ion_alloc_fd(m_ion_device_fd, size, m_device_caps.page_size, ION_HEAP(ION_SYSTEM_HEAP_ID), ion_allocation_flags, &fd);
     if (err == -1)
     {
         std::cerr << "Error allocating ion memory\n";
@@ -346,18 +1092,12 @@ cl_mem_ion_host_ptr cl_wrapper::make_ion_buffer_internal(size_t size, unsigned i
         std::exit(errno);
     }
 
-    cl_mem_ion_host_ptr ion_mem;
-    ion_mem.ext_host_ptr.allocation_type   = CL_MEM_ION_HOST_PTR_QCOM;
-    ion_mem.ext_host_ptr.host_cache_policy = host_cache_policy;
-    ion_mem.ion_filedesc                   = fd;
-    ion_mem.ion_hostptr                    = host_addr;
-
-    m_ion_host_ptrs.push_back(std::make_pair(ion_mem.ion_hostptr, size));
-    m_file_descs.push_back(fd);
+    allocation.fd       = fd;
+    allocation.host_ptr = host_addr;
 #else // USES_LIBION
     ion_allocation_data allocation_data;
     allocation_data.len          = size;
-    allocation_data.align        = device_page_size;
+    allocation_data.align        = m_device_caps.page_size;
     allocation_data.heap_id_mask = ION_HEAP(ION_IOMMU_HEAP_ID);
     allocation_data.flags        = ion_allocation_flags;
     if (ioctl(m_ion_device_fd, ION_IOC_ALLOC, &allocation_data))
@@ -386,39 +1126,189 @@ cl_mem_ion_host_ptr cl_wrapper::make_ion_buffer_internal(size_t size, unsigned i
         std::exit(errno);
     }
 
-    cl_mem_ion_host_ptr ion_mem;
-    ion_mem.ext_host_ptr.allocation_type   = CL_MEM_ION_HOST_PTR_QCOM;
-    ion_mem.ext_host_ptr.host_cache_policy = host_cache_policy;
-    ion_mem.ion_filedesc                   = fd_data.fd;
-    ion_mem.ion_hostptr                    = host_addr;
-
-    m_ion_host_ptrs.push_back(std::make_pair(ion_mem.ion_hostptr, allocation_data.len));
-    m_file_descs.push_back(fd_data.fd);
-    m_handle_data.push_back(handle_data);
+    allocation.size        = allocation_data.len;
+    allocation.fd          = fd_data.fd;
+    allocation.host_ptr    = host_addr;
+    allocation.handle_data = handle_data;
 #endif // USES_LIBION
 
-    return ion_mem;
+    return allocation;
 }
 
-cl_mem_ion_host_ptr
+void cl_wrapper::free_ion(const ion_allocation_t &allocation)
+{
+    TRACE_FUNCTION();
+    if (munmap(allocation.host_ptr, allocation.size) < 0)
+    {
+        std::cerr << "Error " << errno << " munmap-ing ion alloc: " << strerror(errno) << "\n";
+        std::exit(errno);
+    }
+
+    if (close(allocation.fd) < 0)
+    {
+        std::cerr << "Error " << errno << " closing ion allocation fd: " << strerror(errno) << "\n";
+        std::exit(errno);
+    }
+
+#if !USES_LIBION
+    if (ioctl(m_ion_device_fd, ION_IOC_FREE, &allocation.handle_data) < 0)
+    {
+        std::cerr << "Error " << errno << " freeing ion alloc with ioctl: " << strerror(errno) << "\n";
+        std::exit(errno);
+    }
+#endif
+}
+
+/**
+ * Internal method for giving an ion buffer back to the pool, called by its ion_allocation.
+ */
+void cl_wrapper::release_ion_buffer(const cl_mem_ion_host_ptr &ion_mem)
+{
+    std::lock_guard<std::mutex> lock(m_ion_mutex);
+
+    const auto live = m_live_ion_buffers.find(ion_mem.ion_hostptr);
+    if (live == m_live_ion_buffers.end())
+    {
+        std::cerr << "Error releasing an ion buffer that was not made by this wrapper or was already released.\n";
+        std::exit(EXIT_FAILURE);
+    }
+    ion_allocation_t allocation = live->second;
+    m_live_ion_buffers.erase(live);
+    m_ion_pool_stats.live_bytes -= allocation.size;
+
+    allocation.released = ++m_ion_release_count;
+    m_idle_ion_buffers[std::make_pair(allocation.host_cache_policy, allocation.size)].push_back(allocation);
+    m_ion_pool_stats.idle_bytes += allocation.size;
+    trim_ion_pool_locked(m_ion_pool_max_idle_bytes);
+}
+
+void cl_wrapper::set_ion_pool_max_idle_bytes(size_t max_idle_bytes)
+{
+    std::lock_guard<std::mutex> lock(m_ion_mutex);
+    m_ion_pool_max_idle_bytes = max_idle_bytes;
+    trim_ion_pool_locked(m_ion_pool_max_idle_bytes);
+}
+
+void cl_wrapper::trim_ion_pool(size_t max_idle_bytes)
+{
+    std::lock_guard<std::mutex> lock(m_ion_mutex);
+    trim_ion_pool_locked(max_idle_bytes);
+}
+
+/**
+ * Internal method for trimming the pool. The caller holds m_ion_mutex.
+ */
+void cl_wrapper::trim_ion_pool_locked(size_t max_idle_bytes)
+{
+    while (m_ion_pool_stats.idle_bytes > max_idle_bytes)
+    {
+        // Each size class is in release order, so the oldest buffer is at the front of one of them
+        std::vector<ion_allocation_t> *oldest = NULL;
+        for (auto &size_class : m_idle_ion_buffers)
+        {
+            if (!size_class.second.empty()
+                && (!oldest || size_class.second.front().released < oldest->front().released))
+            {
+                oldest = &size_class.second;
+            }
+        }
+        free_ion(oldest->front());
+        m_ion_pool_stats.idle_bytes -= oldest->front().size;
+        ++m_ion_pool_stats.frees;
+        oldest->erase(oldest->begin());
+    }
+}
+
+ion_pool_stats_t cl_wrapper::get_ion_pool_stats() const
+{
+    std::lock_guard<std::mutex> lock(m_ion_mutex);
+    return m_ion_pool_stats;
+}
+
+ion_allocation
 cl_wrapper::make_iocoherent_ion_buffer_for_yuv_image(const cl_image_format &img_format, const cl_image_desc &img_desc) {
-    const size_t effective_img_height = ((img_desc.image_height + 31) / 32) * 32; // Round up to the nearest multiple of 32
-    const size_t img_row_pitch        = get_ion_image_row_pitch(img_format, img_desc);
+    const ion_image_layout_t layout = get_ion_image_layout(img_format, img_desc);
+    check_yuv_layout(layout, img_format);
+    return make_iocoherent_ion_buffer(layout.total_bytes);
+}
 
-    cl_int err;
-    size_t padding_in_bytes = 0;
+ion_allocation::ion_allocation() :
+    m_wrapper(NULL),
+    m_ion_mem()
+{
+}
 
-    err = clGetDeviceInfo(m_device, CL_DEVICE_EXT_MEM_PADDING_IN_BYTES_QCOM, sizeof(padding_in_bytes), &padding_in_bytes, NULL);
-    if (err != CL_SUCCESS)
+ion_allocation::ion_allocation(cl_wrapper *wrapper, const cl_mem_ion_host_ptr &ion_mem) :
+    m_wrapper(wrapper),
+    m_ion_mem(ion_mem)
+{
+}
+
+ion_allocation::~ion_allocation()
+{
+    reset();
+}
+
+ion_allocation::ion_allocation(ion_allocation &&other) :
+    m_wrapper(other.m_wrapper),
+    m_ion_mem(other.m_ion_mem)
+{
+    other.m_wrapper = NULL;
+}
+
+ion_allocation &ion_allocation::operator=(ion_allocation &&other)
+{
+    if (this != &other)
     {
-        std::cerr << "Error " << err << " with clGetDeviceInfo for padding." << "\n";
-        std::exit(err);
+        reset();
+        m_wrapper       = other.m_wrapper;
+        m_ion_mem       = other.m_ion_mem;
+        other.m_wrapper = NULL;
     }
+    return *this;
+}
+
+cl_mem_ion_host_ptr *ion_allocation::get()
+{
+    return &m_ion_mem;
+}
 
-    const size_t y_plane_bytes  = img_row_pitch * effective_img_height;
-    const size_t uv_plane_bytes = img_row_pitch * effective_img_height / 2;
-    const size_t total_bytes    = y_plane_bytes + uv_plane_bytes + padding_in_bytes;
+const cl_mem_ion_host_ptr *ion_allocation::get() const
+{
+    return &m_ion_mem;
+}
 
-    return make_iocoherent_ion_buffer(total_bytes);
+cl_mem_ion_host_ptr &ion_allocation::operator*()
+{
+    return m_ion_mem;
+}
+
+const cl_mem_ion_host_ptr &ion_allocation::operator*() const
+{
+    return m_ion_mem;
 }
 
+cl_mem_ion_host_ptr *ion_allocation::operator->()
+{
+    return &m_ion_mem;
+}
+
+const cl_mem_ion_host_ptr *ion_allocation::operator->() const
+{
+    return &m_ion_mem;
+}
+
+void ion_allocation::reset()
+{
+    if (m_wrapper)
+    {
+        m_wrapper->release_ion_buffer(m_ion_mem);
+        m_wrapper = NULL;
+        m_ion_mem = cl_mem_ion_host_ptr();
+    }
+}
+
+ion_allocation::operator bool() const
+{
+    return m_wrapper != NULL;
+}
@@ -11,7 +11,12 @@
 
 #ifndef SDK_EXAMPLES_CL_WRAPPER_H
 #define SDK_EXAMPLES_CL_WRAPPER_H
+#include <map>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <vector>
 #include <utility>
 
@@ -31,8 +36,168 @@
 #endif /* USES_LIBION */
 #endif /* USES_ANDROID_CMAKE */
 
+#include "kernel_timings.h"
+#include "program_cache.h"
+#include "trace.h"
 #include "util.h"
 
+/**
+ * \brief Preprocessor macros for make_program, by name. Each is passed to the
+ *        compiler as -D <name>=<value>, or -D <name> if the value is empty.
+ */
+typedef std::map<std::string, std::string> program_defines_t;
+
+/**
+ * \brief Whether a cl_wrapper profiles the commands enqueued through it, and
+ *        how it reports their timings when it is destroyed.
+ */
+enum class profiling_format_t
+{
+    NONE,  // The queue is made without CL_QUEUE_PROFILING_ENABLE
+    TABLE, // Profiled, with a text table of the timings
+    JSON,  // Profiled, with the timings as JSON
+};
+
+/**
+ * \brief How a cl_wrapper sets up its context and command queue. A config
+ *        made without arguments leaves every setting at its default.
+ */
+struct cl_wrapper_config_t
+{
+    // CL_CONTEXT_PERF_HINT_QCOM, or 0 to leave the driver's default (high)
+    cl_perf_hint       perf_hint      = 0;
+    // CL_CONTEXT_PRIORITY_HINT_QCOM, or CL_PRIORITY_HINT_NONE_QCOM for the default
+    cl_priority_hint   priority_hint  = CL_PRIORITY_HINT_NONE_QCOM;
+    profiling_format_t profiling      = profiling_format_t::NONE;
+    // Whether make_program caches binaries as described at set_program_cache. If false,
+    // the cache directory isn't created, and set_program_cache can still enable it later.
+    bool               cache_programs = true;
+};
+
+/**
+ * \brief Properties of a cl_wrapper's device, queried once when the wrapper is
+ *        made. Qualcomm-specific properties that the device doesn't report are 0.
+ */
+struct device_capabilities_t
+{
+    std::string           name;
+    std::string           driver_version;
+    cl_uint               page_size;                   // CL_DEVICE_PAGE_SIZE_QCOM, the alignment of ion allocations
+    size_t                ext_mem_padding;             // CL_DEVICE_EXT_MEM_PADDING_IN_BYTES_QCOM, needed after ion images
+    size_t                max_work_group_size;
+    cl_ulong              local_mem_size;
+    size_t                image2d_max_width;
+    size_t                image2d_max_height;
+    size_t                image_max_buffer_size;       // In pixels, for 1D image buffers
+    cl_uint               hof_max_num_phases;          // Limits of the qcom_convolve_imagef and box filter hardware
+    cl_uint               hof_max_filter_size_x;
+    cl_uint               hof_max_filter_size_y;
+    cl_uint               block_matching_max_region_size_x;
+    cl_uint               block_matching_max_region_size_y;
+    std::set<std::string> extensions;
+
+    /**
+     * \brief Checks for an extension by its exact name.
+     *
+     * @param extension
+     * @return true if the device supports extension, otherwise false
+     */
+    bool has_extension(const std::string &extension) const
+    {
+        return extensions.count(extension) != 0;
+    }
+};
+
+/**
+ * \brief Where the planes of an image are in an ion buffer made for it, e.g.
+ *        by make_ion_buffer_for_yuv_image.
+ */
+struct ion_image_layout_t
+{
+    size_t   row_pitch;       // Bytes per row, the same for every plane
+    size_t   padded_height;   // Rows of the first plane; for YUV 4:2:0 orders the height rounded up to 32
+    uint32_t num_planes;      // 2 for the YUV 4:2:0 orders (NV12, P010, TP10 and their tiled/compressed forms), otherwise 1
+    size_t   plane_offset[2]; // Byte offset of each plane in the buffer
+    size_t   total_bytes;     // The size of the buffer, including the padding the device needs after images
+};
+
+/**
+ * \brief Counts of the ion buffers made and recycled by a cl_wrapper.
+ */
+struct ion_pool_stats_t
+{
+    size_t allocations; // Buffers allocated from ion
+    size_t reuses;      // Buffers taken from the pool instead
+    size_t frees;       // Buffers freed by trimming the pool
+    size_t live_bytes;  // Bytes in buffers not yet released
+    size_t idle_bytes;  // Bytes in released buffers kept in the pool
+    size_t peak_bytes;  // The most live_bytes + idle_bytes so far
+};
+
+class cl_wrapper;
+
+/**
+ * \brief Owns an ion buffer made by a cl_wrapper, and gives it back to the
+ *        wrapper's pool when destroyed or reset, so that a long-running
+ *        pipeline holds only the buffers it is using. Any cl_mem using the
+ *        buffer must be released first, and the wrapper must outlive it.
+ *
+ * If the released buffers in the pool then take more than the high-water mark
+ * set by set_ion_pool_max_idle_bytes, the least recently released are unmapped
+ * and freed. With a high-water mark of 0 that happens as soon as it's released.
+ *
+ * It can be moved but not copied. Pass get() as the host_ptr of clCreateBuffer
+ * or clCreateImage with CL_MEM_EXT_HOST_PTR_QCOM, pass *allocation to the
+ * loaders and savers in util.h, and reach the host mapping through ->ion_hostptr.
+ */
+class ion_allocation {
+public:
+    /**
+     * \brief Makes an empty allocation, e.g. to move one into later.
+     */
+    ion_allocation();
+
+    ~ion_allocation();
+
+    ion_allocation(const ion_allocation &)            = delete;
+    ion_allocation &operator=(const ion_allocation &) = delete;
+
+    ion_allocation(ion_allocation &&other);
+
+    ion_allocation &operator=(ion_allocation &&other);
+
+    /**
+     * \brief Gets the buffer's description for OpenCL.
+     * @return
+     */
+    cl_mem_ion_host_ptr       *get();
+    const cl_mem_ion_host_ptr *get() const;
+
+    cl_mem_ion_host_ptr       &operator*();
+    const cl_mem_ion_host_ptr &operator*() const;
+
+    cl_mem_ion_host_ptr       *operator->();
+    const cl_mem_ion_host_ptr *operator->() const;
+
+    /**
+     * \brief Gives the buffer back to the wrapper now, leaving the allocation empty.
+     */
+    void                       reset();
+
+    /**
+     * \brief Checks whether the allocation owns a buffer.
+     */
+    explicit operator bool() const;
+
+private:
+    friend class cl_wrapper;
+
+    ion_allocation(cl_wrapper *wrapper, const cl_mem_ion_host_ptr &ion_mem);
+
+    cl_wrapper          *m_wrapper;
+    cl_mem_ion_host_ptr  m_ion_mem;
+};
+
 /**
  * \brief A wrapper around OpenCL setup/teardown code.
  *
@@ -41,12 +206,45 @@
 class cl_wrapper {
 public:
     /**
-     * \brief Sets up OpenCL.
+     * \brief Sets up OpenCL as configured by the environment, see get_env_config.
      */
     cl_wrapper();
 
     /**
-     * \brief Frees associated OpenCL objects, including the results of make_kernel, make_program, and make_ion_buffer.
+     * \brief Sets up OpenCL as configured, regardless of the environment.
+     *
+     * The hints are set as properties of the context, and the wrapper exits if
+     * the device lacks the cl_qcom_perf_hint or cl_qcom_priority_hint extension
+     * for a hint that's given.
+     *
+     * When profiling, the command queue is made with CL_QUEUE_PROFILING_ENABLE,
+     * the enqueue_* methods record the device-side times of their commands,
+     * and the destructor writes a summary to the file named by the
+     * CL_PROFILING_OUTPUT environment variable, or else to stderr.
+     *
+     * @param config [in]
+     */
+    explicit cl_wrapper(const cl_wrapper_config_t &config);
+
+    /**
+     * \brief Sets up OpenCL with the given profiling, regardless of CL_PROFILING.
+     *        The hints are still taken from the environment, as by cl_wrapper().
+     *
+     * @param profiling [in]
+     */
+    explicit cl_wrapper(profiling_format_t profiling);
+
+    /**
+     * \brief Gets the configuration given by the environment: CL_PERF_HINT and
+     *        CL_PRIORITY_HINT may be "high", "normal" or "low", and CL_PROFILING
+     *        may be "table" or "json". Anything unset is left at its default.
+     * @return
+     */
+    static cl_wrapper_config_t get_env_config();
+
+    /**
+     * \brief Frees associated OpenCL objects, including the results of make_kernel, make_program, and
+     *        make_ion_buffer. Any ion_allocation from the wrapper must have been destroyed first.
      */
     ~cl_wrapper();
 
@@ -62,18 +260,84 @@ public:
     */
     cl_command_queue    get_command_queue() const;
 
+    /**
+     * \brief Gets the properties of the device, without querying the driver.
+     * @return
+     */
+    const device_capabilities_t &get_device_capabilities() const;
+
+    /**
+     * \brief Gets the configuration the wrapper was made with, with the perf
+     *        hint as last set by set_perf_hint.
+     * @return
+     */
+    cl_wrapper_config_t get_config() const;
+
+    /**
+     * \brief Changes the performance level requested for the context with
+     *        clSetPerfHintQCOM. Unlike the priority hint, this can be done at
+     *        any time, e.g. to save power while a pipeline is idle.
+     *
+     * @param perf_hint [in] - CL_PERF_HINT_HIGH_QCOM, CL_PERF_HINT_NORMAL_QCOM or CL_PERF_HINT_LOW_QCOM
+     */
+    void set_perf_hint(cl_perf_hint perf_hint);
+
     /**
      * \brief Makes a cl_kernel from the given program.
      *
+     * Every call makes a new kernel object, so that e.g. the same kernel can be
+     * enqueued for two planes with different arguments. To reuse a kernel,
+     * e.g. when a pipeline is set up repeatedly, use get_kernel.
+     *
      * @param kernel_name
      * @param program
      * @return
      */
     cl_kernel           make_kernel(const std::string &kernel_name, cl_program program);
 
+    /**
+     * \brief Gets the kernel of the given name in program, making it on the
+     *        first call. Later calls with the same program and name return the
+     *        same cl_kernel, with whatever arguments were last set on it.
+     *
+     * @param kernel_name
+     * @param program
+     * @return
+     */
+    cl_kernel           get_kernel(const std::string &kernel_name, cl_program program);
+
+    /**
+     * \brief Gets the calling thread's own copy of the kernel of the given name
+     *        in program, making it on the thread's first call.
+     *
+     * clSetKernelArg is not thread-safe for a single kernel, so threads driving
+     * the same pipeline concurrently each set the arguments of their own copy.
+     * Copies are made with clCreateKernel, as clCloneKernel needs OpenCL 2.1,
+     * so a thread's copy starts with no arguments set.
+     *
+     * This may be called from any thread. The copies live until
+     * release_thread_kernels is called on their thread or the wrapper is
+     * destroyed.
+     *
+     * @param kernel_name
+     * @param program
+     * @return
+     */
+    cl_kernel           get_thread_kernel(const std::string &kernel_name, cl_program program);
+
+    /**
+     * \brief Releases the copies get_thread_kernel made for the calling thread,
+     *        e.g. before a worker thread exits.
+     */
+    void                release_thread_kernels();
+
     /**
      * Makes a cl_program (whose lifetime is managed by cl_wrapper) from the given source code strings.
      *
+     * The built binary is kept in the program cache, and later runs load it
+     * with clCreateProgramWithBinary instead of compiling the source. If the
+     * cached binary is rejected the source is built as usual.
+     *
      * @param program_source - The source code strings.
      * @param program_source_len - The length of program_source
      * @return
@@ -81,13 +345,54 @@ public:
     cl_program          make_program(const char **program_source, cl_uint program_source_len);
 
     /**
-     * \brief Makes an uncached ion buffer that can be used for a YUV 4:2:0 image.
+     * Makes a cl_program as above, built with the given options and macros.
+     *
+     * Macros let a kernel be specialized, e.g. for a fixed size given as a
+     * constant the compiler can unroll loops over, instead of as an argument.
+     * Each variant is built once: making a program again from the same source,
+     * options and macros returns the same cl_program. Variants are also kept
+     * in the program cache, so a fixed-size workload pays for its build only
+     * on its first run.
+     *
+     * @param program_source - The source code strings.
+     * @param program_source_len - The length of program_source
+     * @param build_options - Options for clBuildProgram, e.g. "-cl-fast-relaxed-math".
+     * @param defines - Macros to define.
+     * @return
+     */
+    cl_program          make_program(const char **program_source, cl_uint program_source_len,
+                                     const std::string &build_options,
+                                     const program_defines_t &defines = program_defines_t());
+
+    /**
+     * \brief Changes where make_program caches program binaries. By default this is
+     *        the directory named by the CL_PROGRAM_CACHE_DIR environment variable,
+     *        limited to CL_PROGRAM_CACHE_MAX_BYTES bytes, or else the per-user
+     *        $XDG_CACHE_HOME/cl_program_cache or $HOME/.cache/cl_program_cache,
+     *        limited to 64 MiB. The directory must belong to the user and not be
+     *        writable by others, or nothing is cached.
+     *
+     * @param directory [in] - The cache directory. If empty, nothing is cached.
+     * @param max_bytes [in] - The limit on the size of the cache, beyond which the
+     *                         least recently used binaries are deleted.
+     */
+    void                set_program_cache(const std::string &directory, size_t max_bytes);
+
+    /**
+     * \brief Gets the program cache, e.g. for its statistics.
+     * @return
+     */
+    program_binary_cache &get_program_cache();
+
+    /**
+     * \brief Makes an uncached ion buffer that can be used for a YUV 4:2:0 image, i.e. NV12, P010 or TP10
+     *        in any of their linear, tiled or compressed forms. Exits for any other channel order.
      *
      * @param img_format [in] - The image format
      * @param img_desc [in] - The image description
      * @return
      */
-    cl_mem_ion_host_ptr make_ion_buffer_for_yuv_image(const cl_image_format &img_format, const cl_image_desc &img_desc);
+    ion_allocation      make_ion_buffer_for_yuv_image(const cl_image_format &img_format, const cl_image_desc &img_desc);
 
     /**
      * \brief Makes an uncached ion buffer that can be used for a nonplanar image, e.g. CL_R or CL_RGB
@@ -96,7 +401,7 @@ public:
      * @param img_desc [in]
      * @return
      */
-    cl_mem_ion_host_ptr make_ion_buffer_for_nonplanar_image(const cl_image_format &img_format, const cl_image_desc &img_desc);
+    ion_allocation      make_ion_buffer_for_nonplanar_image(const cl_image_format &img_format, const cl_image_desc &img_desc);
 
     /**
      * \brief Makes an uncached ion buffer that can be used for a compressed image.
@@ -105,15 +410,21 @@ public:
      * @param img_desc [in] - The image description
      * @return
      */
-    cl_mem_ion_host_ptr make_ion_buffer_for_compressed_image(cl_image_format img_format, const cl_image_desc &img_desc);
+    ion_allocation      make_ion_buffer_for_compressed_image(cl_image_format img_format, const cl_image_desc &img_desc);
 
     /**
      * \brief Makes an uncached ion buffer of the specified size.
      *
+     * Like all ion buffers made by the wrapper, the size is rounded up to a
+     * size class: a whole number of pages, and beyond 8 pages one of four
+     * sizes per power of two, so at most 25% larger. A buffer whose
+     * ion_allocation was destroyed or reset earlier is reused if one of the
+     * same class and cache policy is in the pool. Reused buffers are not cleared.
+     *
      * @param size [in] - Desired buffer size
      * @return
      */
-    cl_mem_ion_host_ptr make_ion_buffer(size_t size);
+    ion_allocation      make_ion_buffer(size_t size);
 
     /**
      * \brief Makes an ion buffer of the specified size, using the IO-coherent
@@ -122,26 +433,128 @@ public:
      * @param size [in] - Desired buffer size
      * @return
      */
-    cl_mem_ion_host_ptr make_iocoherent_ion_buffer(size_t size);
+    ion_allocation      make_iocoherent_ion_buffer(size_t size);
 
     /**
-     * \brief Makes an ion buffer that can be used for a YUV 4:2:0 image, using
-     *        the IO-coherent cache policy.
+     * \brief Makes an ion buffer that can be used for a YUV 4:2:0 image, i.e. NV12, P010 or TP10 in any
+     *        of their linear, tiled or compressed forms, using the IO-coherent cache policy. Exits for any
+     *        other channel order.
      *
      * @param img_format [in] - The image format
      * @param img_desc [in] - The image description
      * @return
      */
-    cl_mem_ion_host_ptr make_iocoherent_ion_buffer_for_yuv_image(const cl_image_format &img_format, const cl_image_desc &img_desc);
+    ion_allocation      make_iocoherent_ion_buffer_for_yuv_image(const cl_image_format &img_format, const cl_image_desc &img_desc);
+
+    /**
+     * \brief Sets the high-water mark for released buffers kept in the pool,
+     *        DEFAULT_ION_POOL_MAX_IDLE_BYTES unless changed, and trims the pool
+     *        down to it. With 0, released buffers are freed at once.
+     *
+     * @param max_idle_bytes [in]
+     */
+    void                set_ion_pool_max_idle_bytes(size_t max_idle_bytes);
+
+    /**
+     * \brief Frees the least recently released buffers in the pool until the
+     *        rest take at most max_idle_bytes, e.g. 0 between workloads.
+     *
+     * @param max_idle_bytes [in]
+     */
+    void                trim_ion_pool(size_t max_idle_bytes);
+
+    /**
+     * \brief Gets the counts of ion buffers made and recycled.
+     * @return
+     */
+    ion_pool_stats_t    get_ion_pool_stats() const;
+
+    static const size_t DEFAULT_ION_POOL_MAX_IDLE_BYTES = 64 * 1024 * 1024;
+
+    /**
+     * \brief Enqueues an NDRange kernel on the wrapper's queue, and records its
+     *        time under the kernel's name if profiling.
+     *
+     * @param kernel [in]
+     * @param work_dim [in]
+     * @param global_work_size [in]
+     * @param local_work_size [in] - May be NULL
+     * @param bytes_moved [in] - The bytes the kernel reads and writes, to report its bandwidth, or 0
+     */
+    void                enqueue_kernel(cl_kernel kernel, cl_uint work_dim, const size_t *global_work_size,
+                                       const size_t *local_work_size, size_t bytes_moved = 0);
+
+    /**
+     * \brief Enqueues a read of a buffer into host memory, recorded as clEnqueueReadBuffer if profiling.
+     */
+    void                enqueue_read_buffer(cl_mem buffer, cl_bool blocking, size_t offset, size_t size, void *ptr);
+
+    /**
+     * \brief Enqueues a write of host memory into a buffer, recorded as clEnqueueWriteBuffer if profiling.
+     */
+    void                enqueue_write_buffer(cl_mem buffer, cl_bool blocking, size_t offset, size_t size,
+                                             const void *ptr);
+
+    /**
+     * \brief Maps a buffer, blocking until it is mapped. Recorded as clEnqueueMapBuffer if profiling.
+     * @return the mapped pointer
+     */
+    void               *enqueue_map_buffer(cl_mem buffer, cl_map_flags map_flags, size_t offset, size_t size);
+
+    /**
+     * \brief Enqueues unmapping a buffer or image, recorded as clEnqueueUnmapMemObject if profiling.
+     */
+    void                enqueue_unmap_mem_object(cl_mem mem, void *mapped_ptr);
+
+    /**
+     * \brief Waits for every command on the wrapper's queue to finish.
+     */
+    void                finish();
+
+    /**
+     * \brief Records the time of a command enqueued without the enqueue_*
+     *        methods, e.g. a clEnqueueCopyImage. Does nothing unless profiling
+     *        or tracing. The wrapper retains the event, so the caller may release it.
+     *        The command is traced as if it was enqueued when this is called.
+     *
+     * @param name [in] - The name to aggregate the command's times under
+     * @param event [in] - The command's event
+     * @param bytes_moved [in] - The bytes the command reads and writes, or 0
+     */
+    void                record_profiling_event(const std::string &name, cl_event event, size_t bytes_moved = 0);
+
+    /**
+     * \brief Gets whether the wrapper is profiling.
+     * @return
+     */
+    bool                profiling_enabled() const;
+
+    /**
+     * \brief Waits for the profiled commands still running, records them, and
+     *        gets the timings so far.
+     * @return
+     */
+    const kernel_timing_registry &get_kernel_timings();
 
     /**
-     * \brief Checks if the wrapped device supports the desired extension via clGetDeviceInfo
+     * \brief Checks if the wrapped device supports the desired extension, by its exact name
      *
      * @param desired_extension
      * @return true if the desired_extension is supported, otherwise false
      */
     bool                check_extension_support(const std::string &desired_extension) const;
 
+    /**
+     * \brief Gets the layout of the given image in an ion buffer. The row pitch
+     *        is queried from the driver for the first image of each format and
+     *        size only, so setting up the same shapes every frame is cheap.
+     *
+     * @param img_format [in] - The image format
+     * @param img_desc [in] - The image description; only the width and height are used
+     * @return the layout
+     */
+    ion_image_layout_t  get_ion_image_layout(const cl_image_format &img_format, const cl_image_desc &img_desc) const;
+
     /**
      * \brief Gets the required row pitch for the given image. Must be considered when accessing the underlying ion buffer.
      *
@@ -151,6 +564,15 @@ public:
      */
     size_t              get_ion_image_row_pitch(const cl_image_format &img_format, const cl_image_desc &img_desc) const;
 
+    /**
+     * \brief Gets the number of rows of the Y plane in an ion buffer from make_ion_buffer_for_yuv_image or
+     *        make_iocoherent_ion_buffer_for_yuv_image. The UV plane starts this many row pitches into the buffer.
+     *
+     * @param img_desc [in] - The image description
+     * @return the padded image height
+     */
+    size_t              get_ion_yuv_image_padded_height(const cl_image_desc &img_desc) const;
+
     /**
      * \brief Gets the max workgroup size for the specified kernel.
      *
@@ -160,25 +582,88 @@ public:
     size_t              get_max_workgroup_size(cl_kernel kernel) const;
 
 private:
+    friend class ion_allocation;
 
-    cl_mem_ion_host_ptr
+    struct ion_allocation_t
+    {
+        void     *host_ptr;
+        size_t    size;
+        int       fd;
+        cl_uint   host_cache_policy;
+        uint64_t  released; // When it went into the pool, for trimming the oldest first
+#if !USES_LIBION
+        ion_handle_data handle_data;
+#endif
+    };
+
+    ion_allocation
     make_ion_buffer_internal(size_t size, unsigned int ion_allocation_flags, cl_uint host_cache_policy);
 
+    ion_allocation_t allocate_ion(size_t size, unsigned int ion_allocation_flags, cl_uint host_cache_policy);
+
+    void free_ion(const ion_allocation_t &allocation);
+
+    void release_ion_buffer(const cl_mem_ion_host_ptr &ion_mem);
+
+    void trim_ion_pool_locked(size_t max_idle_bytes);
+
+    cl_program load_cached_program(const program_cache_key_t &key);
+
+    void cache_program_binary(const program_cache_key_t &key, cl_program program);
+
+    std::string get_device_info_string(cl_device_info param) const;
+
+    void query_device_capabilities();
+
+    cl_kernel create_kernel(const std::string &kernel_name, cl_program program);
+
+    bool events_enabled() const;
+
+    cl_event *profiling_event(cl_event *event) const;
+
+    void record_profiled_command(const std::string &name, cl_event event, size_t bytes_moved, double host_enqueue_us);
+
+    void flush_profiling();
+
+    std::string get_kernel_name(cl_kernel kernel);
+
     // Data members
     cl_device_id m_device;
+    device_capabilities_t m_device_caps;
+    cl_wrapper_config_t m_config; // With the current perf hint
     cl_context m_context;
     cl_command_queue m_cmd_queue;
     std::vector<cl_program> m_programs;
+    std::map<std::pair<std::string, std::string>, cl_program> m_program_variants; // By source and options
     std::vector<cl_kernel> m_kernels;
+    std::map<std::pair<cl_program, std::string>, cl_kernel> m_kernel_registry;
+    std::map<std::tuple<cl_program, std::string, std::thread::id>, cl_kernel> m_thread_kernels;
+    std::map<cl_kernel, std::string> m_kernel_names;
+    std::mutex m_kernel_mutex; // Guards m_kernels, m_kernel_names, m_kernel_registry and m_thread_kernels
+    // By channel order, channel data type, width and height
+    mutable std::map<std::tuple<cl_channel_order, cl_channel_type, size_t, size_t>, ion_image_layout_t> m_image_layouts;
+    mutable std::mutex m_image_layout_mutex;
+    program_binary_cache m_program_cache;
+
+    // Profiling stuff
+    struct pending_command_t
+    {
+        std::string name;
+        cl_event    event;
+        size_t      bytes_moved;
+        double      host_enqueue_us; // For tracing
+    };
+    std::vector<pending_command_t> m_pending_commands; // Recorded once they complete
+    kernel_timing_registry m_kernel_timings;
+    std::mutex m_profiling_mutex; // Guards m_pending_commands
 
     // ION stuff
-#if USES_LIBION
-    // Pass
-#else
-    std::vector<ion_handle_data> m_handle_data;
-#endif
-    std::vector<int> m_file_descs;
-    std::vector<std::pair<void*, size_t>> m_ion_host_ptrs;
+    std::map<void *, ion_allocation_t> m_live_ion_buffers; // By host pointer
+    std::map<std::pair<cl_uint, size_t>, std::vector<ion_allocation_t>> m_idle_ion_buffers; // By cache policy and size class
+    ion_pool_stats_t m_ion_pool_stats;
+    size_t m_ion_pool_max_idle_bytes;
+    uint64_t m_ion_release_count;
+    mutable std::mutex m_ion_mutex; // Guards the ION members above
     int m_ion_device_fd;
 };
 
@@ -10,10 +10,50 @@
 //--------------------------------------------------------------------------------------
 
 #include "half_float.h"
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstring>
 #include <limits>
+#include <vector>
 
-cl_half to_half(float f)
+// The batch conversions use F16C on x86, chosen at runtime, and NEON on 64-bit ARM
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define HALF_FLOAT_X86_F16C 1
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define HALF_FLOAT_NEON 1
+#include <arm_neon.h>
+#endif
+
+static std::atomic<half_rounding_t>        g_half_rounding(half_rounding_t::TO_NEAREST_EVEN);
+static std::atomic<half_to_float_method_t> g_half_to_float_method(half_to_float_method_t::TABLE);
+
+void set_half_rounding(half_rounding_t rounding)
+{
+    g_half_rounding = rounding;
+}
+
+half_rounding_t get_half_rounding()
+{
+    return g_half_rounding;
+}
+
+void set_half_to_float_method(half_to_float_method_t method)
+{
+    g_half_to_float_method = method;
+}
+
+half_to_float_method_t get_half_to_float_method()
+{
+    return g_half_to_float_method;
+}
+
+/**
+ * Internal method for converting to a half with half_rounding_t::TOWARD_ZERO.
+ */
+static cl_half to_half_toward_zero(float f)
 {
     static const struct
     {
@@ -79,7 +119,10 @@ cl_half to_half(float f)
     return half;
 }
 
-cl_float to_float(cl_half f)
+/**
+ * Internal method for converting to a float with half_to_float_method_t::COMPUTED.
+ */
+static cl_float to_float_computed(cl_half f)
 {
     static const struct {
         uint16_t sign_mask                   = 0x8000;
@@ -136,3 +179,353 @@ cl_float to_float(cl_half f)
 
     return res.f;
 }
+
+/**
+ * Internal method equivalent to to_half_toward_zero, written without branches
+ * so that loops over it vectorize.
+ */
+static cl_half to_half_toward_zero_from_bits(uint32_t bits)
+{
+    const uint32_t abs_bits = bits & 0x7FFFFFFF;
+    const uint32_t sign     = (bits >> 16) & 0x8000;
+    const uint32_t exponent = abs_bits >> 23;
+
+    // Normal halves: rebias the exponent and truncate the mantissa
+    const uint32_t normal = (abs_bits - ((127 - 15) << 23)) >> 13;
+
+    // Subnormal halves: shift the mantissa, with its implicit leading 1, into place
+    const uint32_t shift     = std::min<uint32_t>(113 - std::min<uint32_t>(exponent, 113), 31);
+    const uint32_t subnormal = (((abs_bits & 0x007FFFFF) | 0x00800000) >> shift) >> 13;
+
+    uint32_t half = abs_bits < 0x38800000 ? subnormal : normal;
+    half          = abs_bits > 0x477FE000 ? 0x7FFF : half;     // too large to represent, as in to_half
+    half          = abs_bits == 0x7F800000 ? 0x7C00 : half;    // infinity
+    return static_cast<cl_half>(abs_bits > 0x7F800000 ? 0x7FFF : sign | half);
+}
+
+/**
+ * Internal method for converting to a half with half_rounding_t::TO_NEAREST_EVEN,
+ * written without branches so that loops over it vectorize.
+ */
+static cl_half to_half_nearest_even_from_bits(uint32_t bits)
+{
+    const uint32_t abs_bits = bits & 0x7FFFFFFF;
+    const uint32_t sign     = (bits >> 16) & 0x8000;
+    const uint32_t exponent = abs_bits >> 23;
+
+    // Normal halves: rebias the exponent and round the mantissa. Adding just
+    // under half of the dropped range, plus the lowest kept bit, rounds ties
+    // to even. A carry out of the mantissa correctly increments the exponent,
+    // up to infinity.
+    const uint32_t normal = (abs_bits - ((127 - 15) << 23) + 0x0FFF + ((abs_bits >> 13) & 1)) >> 13;
+
+    // Subnormal halves: shift the mantissa, with its implicit leading 1, into
+    // place and round on the bits shifted out
+    const uint32_t mantissa  = (abs_bits & 0x007FFFFF) | 0x00800000;
+    const uint32_t shift     = std::min<uint32_t>(126 - std::min<uint32_t>(exponent, 112), 31);
+    const uint32_t truncated = mantissa >> shift;
+    const uint32_t remainder = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway   = 1u << (shift - 1);
+    const uint32_t round_up  = (remainder > halfway) | ((remainder == halfway) & truncated);
+    const uint32_t subnormal = truncated + round_up;
+
+    uint32_t half = abs_bits < 0x38800000 ? subnormal : normal;
+    half          = abs_bits >= 0x47800000 ? 0x7C00 : half;    // too large to represent, or infinity
+    // NaNs keep the top of their payload and become quiet
+    half          = abs_bits > 0x7F800000 ? 0x7E00 | ((abs_bits >> 13) & 0x03FF) : half;
+    return static_cast<cl_half>(sign | half);
+}
+
+/**
+ * Internal method equivalent to to_float_computed, written without branches so
+ * that loops over it vectorize.
+ */
+static uint32_t to_float_bits(cl_half h)
+{
+    const uint32_t sign     = static_cast<uint32_t>(h & 0x8000) << 16;
+    const uint32_t exponent = (h >> 10) & 0x1F;
+    const uint32_t frac     = h & 0x03FF;
+
+    const uint32_t normal = sign | ((exponent + 127 - 15) << 23) | (frac << 13);
+
+    // Subnormal halves are exactly representable as frac * 2^-24
+    const float    subnormal_value = static_cast<float>(frac) * 5.96046448e-8f;
+    uint32_t       subnormal       = 0;
+    std::memcpy(&subnormal, &subnormal_value, sizeof(subnormal));
+    subnormal |= sign;
+
+    const uint32_t inf_or_nan = frac == 0 ? sign | 0x7F800000 : 0x7FC00000;
+    return exponent == 0 ? subnormal : (exponent == 0x1F ? inf_or_nan : normal);
+}
+
+/**
+ * Internal method for getting the table of every half's float value, built on first use.
+ */
+static const cl_float *get_to_float_table()
+{
+    static const std::vector<cl_float> table = []()
+    {
+        std::vector<cl_float> values(1 << 16);
+        for (uint32_t h = 0; h < values.size(); ++h)
+        {
+            const uint32_t bits = to_float_bits(static_cast<cl_half>(h));
+            std::memcpy(&values[h], &bits, sizeof(bits));
+        }
+        return values;
+    }();
+    return table.data();
+}
+
+// to_half_constexpr must match to_half with its default rounding; these are
+// the bit patterns to_half gives. half_conversion_benchmark --verify compares
+// the two over every float.
+static_assert(to_half_constexpr(1.f) == 0x3C00, "to_half_constexpr(1)");
+static_assert(to_half_constexpr(-2.f) == 0xC000, "to_half_constexpr(-2)");
+static_assert(to_half_constexpr(1.f / 16.f) == 0x2C00, "to_half_constexpr(1/16)");
+static_assert(to_half_constexpr(0.1f) == 0x2E66, "to_half_constexpr(0.1)");
+static_assert(to_half_constexpr(1.f / 3.f) == 0x3555, "to_half_constexpr(1/3)");
+static_assert(to_half_constexpr(1.f + 1.f / 2048.f) == 0x3C00, "to_half_constexpr ties to even, down");
+static_assert(to_half_constexpr(1.f + 3.f / 2048.f) == 0x3C02, "to_half_constexpr ties to even, up");
+static_assert(to_half_constexpr(65504.f) == 0x7BFF, "to_half_constexpr of the largest half");
+static_assert(to_half_constexpr(65519.f) == 0x7BFF, "to_half_constexpr just below overflow");
+static_assert(to_half_constexpr(65520.f) == 0x7C00, "to_half_constexpr overflows to infinity");
+static_assert(to_half_constexpr(-std::numeric_limits<float>::infinity()) == 0xFC00, "to_half_constexpr(-inf)");
+static_assert(to_half_constexpr(std::numeric_limits<float>::quiet_NaN()) == 0x7E00, "to_half_constexpr(NaN)");
+static_assert(to_half_constexpr(1.f / 16384.f) == 0x0400, "to_half_constexpr of the smallest normal half");
+static_assert(to_half_constexpr(1.f / 16777216.f) == 0x0001, "to_half_constexpr of the smallest subnormal half");
+static_assert(to_half_constexpr(1.f / 33554432.f) == 0x0000, "to_half_constexpr subnormal tie to even, down");
+static_assert(to_half_constexpr(3.f / 33554432.f) == 0x0002, "to_half_constexpr subnormal tie to even, up");
+static_assert(to_half_constexpr(std::numeric_limits<float>::denorm_min()) == 0x0000, "to_half_constexpr underflow");
+
+cl_half to_half(float f)
+{
+    if (g_half_rounding == half_rounding_t::TOWARD_ZERO)
+    {
+        return to_half_toward_zero(f);
+    }
+    uint32_t bits = 0;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return to_half_nearest_even_from_bits(bits);
+}
+
+cl_float to_float(cl_half f)
+{
+    if (g_half_to_float_method == half_to_float_method_t::TABLE)
+    {
+        return get_to_float_table()[f];
+    }
+    return to_float_computed(f);
+}
+
+static void to_half_n_toward_zero_portable(const float *src, cl_half *dst, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint32_t bits = 0;
+        std::memcpy(&bits, src + i, sizeof(bits));
+        dst[i] = to_half_toward_zero_from_bits(bits);
+    }
+}
+
+static void to_half_n_nearest_even_portable(const float *src, cl_half *dst, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint32_t bits = 0;
+        std::memcpy(&bits, src + i, sizeof(bits));
+        dst[i] = to_half_nearest_even_from_bits(bits);
+    }
+}
+
+static void to_float_n_portable(const cl_half *src, cl_float *dst, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        const uint32_t bits = to_float_bits(src[i]);
+        std::memcpy(dst + i, &bits, sizeof(bits));
+    }
+}
+
+static void to_float_n_table(const cl_half *src, cl_float *dst, size_t n)
+{
+    const cl_float *table = get_to_float_table();
+    for (size_t i = 0; i < n; ++i)
+    {
+        dst[i] = table[src[i]];
+    }
+}
+
+#if HALF_FLOAT_X86_F16C
+
+/**
+ * Internal method for detecting the F16C instructions, and the AVX register
+ * state they need, at runtime.
+ */
+static bool has_f16c()
+{
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    return __builtin_cpu_supports("avx") && __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_F16C) != 0;
+}
+
+/**
+ * Internal method for converting with F16C, truncating like to_half_toward_zero.
+ * Groups of 8 that hold values it treats specially, i.e. NaNs or values too
+ * large for a half, are converted by to_half_n_toward_zero_portable instead.
+ */
+__attribute__((target("avx,f16c")))
+static void to_half_n_toward_zero_f16c(const float *src, cl_half *dst, size_t n)
+{
+    const __m256 abs_mask   = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    const __m256 max_normal = _mm256_set1_ps(65504.f);
+    size_t       i          = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m256 value = _mm256_loadu_ps(src + i);
+        // Not less than or equal is also true for NaNs
+        const __m256 special = _mm256_cmp_ps(_mm256_and_ps(value, abs_mask), max_normal, _CMP_NLE_UQ);
+        if (_mm256_movemask_ps(special) != 0)
+        {
+            to_half_n_toward_zero_portable(src + i, dst + i, 8);
+            continue;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm256_cvtps_ph(value, _MM_FROUND_TO_ZERO));
+    }
+    to_half_n_toward_zero_portable(src + i, dst + i, n - i);
+}
+
+/**
+ * Internal method for converting with F16C, rounding to nearest even. The
+ * hardware conversion is exactly IEEE 754, so no value needs special care.
+ */
+__attribute__((target("avx,f16c")))
+static void to_half_n_nearest_even_f16c(const float *src, cl_half *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m256 value = _mm256_loadu_ps(src + i);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm256_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT));
+    }
+    to_half_n_nearest_even_portable(src + i, dst + i, n - i);
+}
+
+/**
+ * Internal method for converting with F16C. Like to_float, every NaN becomes
+ * the positive quiet NaN.
+ */
+__attribute__((target("avx,f16c")))
+static void to_float_n_f16c(const cl_half *src, cl_float *dst, size_t n)
+{
+    const __m256 quiet_nan = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FC00000));
+    size_t       i         = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m256 value = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+        const __m256 is_nan = _mm256_cmp_ps(value, value, _CMP_UNORD_Q);
+        _mm256_storeu_ps(dst + i, _mm256_blendv_ps(value, quiet_nan, is_nan));
+    }
+    to_float_n_portable(src + i, dst + i, n - i);
+}
+
+#endif // HALF_FLOAT_X86_F16C
+
+#if HALF_FLOAT_NEON
+
+/**
+ * Internal method for converting with NEON, which rounds to nearest even in
+ * the default floating-point mode. There is no NEON counterpart for rounding
+ * toward zero.
+ */
+static void to_half_n_nearest_even_neon(const float *src, cl_half *dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        vst1_u16(dst + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i))));
+    }
+    to_half_n_nearest_even_portable(src + i, dst + i, n - i);
+}
+
+/**
+ * Internal method for converting with NEON. Like to_float, every NaN becomes
+ * the positive quiet NaN.
+ */
+static void to_float_n_neon(const cl_half *src, cl_float *dst, size_t n)
+{
+    const float32x4_t quiet_nan = vreinterpretq_f32_u32(vdupq_n_u32(0x7FC00000));
+    size_t            i         = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const float32x4_t value = vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + i)));
+        vst1q_f32(dst + i, vbslq_f32(vceqq_f32(value, value), value, quiet_nan));
+    }
+    to_float_n_portable(src + i, dst + i, n - i);
+}
+
+#endif // HALF_FLOAT_NEON
+
+typedef void (*to_half_n_function)(const float *, cl_half *, size_t);
+typedef void (*to_float_n_function)(const cl_half *, cl_float *, size_t);
+
+/**
+ * \brief The fastest batch conversions this CPU supports.
+ */
+struct half_conversions_t
+{
+    to_half_n_function  to_half_toward_zero;
+    to_half_n_function  to_half_nearest_even;
+    to_float_n_function to_float; // NULL if there is no hardware conversion
+};
+
+static half_conversions_t select_half_conversions()
+{
+    half_conversions_t conversions = {to_half_n_toward_zero_portable, to_half_n_nearest_even_portable, NULL};
+#if HALF_FLOAT_X86_F16C
+    if (has_f16c())
+    {
+        conversions.to_half_toward_zero  = to_half_n_toward_zero_f16c;
+        conversions.to_half_nearest_even = to_half_n_nearest_even_f16c;
+        conversions.to_float             = to_float_n_f16c;
+    }
+#elif HALF_FLOAT_NEON
+    conversions.to_half_nearest_even = to_half_n_nearest_even_neon;
+    conversions.to_float             = to_float_n_neon;
+#endif
+    return conversions;
+}
+
+static const half_conversions_t &get_half_conversions()
+{
+    static const half_conversions_t conversions = select_half_conversions();
+    return conversions;
+}
+
+void to_half_n(const float *src, cl_half *dst, size_t n)
+{
+    const half_conversions_t &conversions = get_half_conversions();
+    if (g_half_rounding == half_rounding_t::TOWARD_ZERO)
+    {
+        conversions.to_half_toward_zero(src, dst, n);
+    }
+    else
+    {
+        conversions.to_half_nearest_even(src, dst, n);
+    }
+}
+
+void to_float_n(const cl_half *src, cl_float *dst, size_t n)
+{
+    const half_conversions_t &conversions = get_half_conversions();
+    if (conversions.to_float)
+    {
+        conversions.to_float(src, dst, n);
+    }
+    else if (g_half_to_float_method == half_to_float_method_t::TABLE)
+    {
+        to_float_n_table(src, dst, n);
+    }
+    else
+    {
+        to_float_n_portable(src, dst, n);
+    }
+}
@@ -14,9 +14,59 @@
 
 #include <CL/cl.h>
 
+/**
+ * \brief How to_half and to_half_n round floats that a half can't represent exactly.
+ */
+enum class half_rounding_t
+{
+    // IEEE 754 round to nearest, ties to even, like convert_half and vstore_half
+    // on the device. Values beyond the range of a half become infinity and NaN
+    // payloads are kept as far as they fit. This is the default.
+    TO_NEAREST_EVEN,
+    // Truncate the mantissa. Values beyond the range of a half become 0x7FFF and
+    // every NaN becomes 0x7FFF. This is what this SDK originally did.
+    TOWARD_ZERO,
+};
+
+/**
+ * \brief How to_float computes its results, which are the same either way. So
+ *        does to_float_n on CPUs without a hardware conversion.
+ */
+enum class half_to_float_method_t
+{
+    // Look the result up in a 65536-entry table, built on first use. This is the default.
+    TABLE,
+    // Compute the result from the bits of the half.
+    COMPUTED,
+};
+
+/**
+ * \brief Selects the rounding of to_half and to_half_n for the whole process.
+ * @param rounding
+ */
+void set_half_rounding(half_rounding_t rounding);
+
+/**
+ * \brief Gets the rounding of to_half and to_half_n.
+ * @return
+ */
+half_rounding_t get_half_rounding();
+
+/**
+ * \brief Selects how to_float computes its results, for the whole process.
+ * @param method
+ */
+void set_half_to_float_method(half_to_float_method_t method);
+
+/**
+ * \brief Gets how to_float computes its results.
+ * @return
+ */
+half_to_float_method_t get_half_to_float_method();
+
 /**
  * \brief Given a 32-bit float, converts it (potentially with some error due to loss of precision)
- * to a 16-bit half float for use with OpenCL.
+ * to a 16-bit half float for use with OpenCL, rounding as selected with set_half_rounding.
  *
  * @param f [in] - The 32-bit float to convert
  * @return the equivalent 16-bit half float
@@ -31,4 +81,82 @@ cl_half to_half(float f);
  */
 cl_float to_float(cl_half f);
 
+/**
+ * \brief Converts n 32-bit floats to 16-bit half floats, giving exactly the
+ *        same results as to_half. Uses F16C instructions on x86 CPUs that
+ *        have them, detected at runtime, NEON on 64-bit ARM when rounding to
+ *        nearest, and vectorized code elsewhere.
+ *
+ * @param src [in] - The floats to convert
+ * @param dst [out] - Where to write the n half floats
+ * @param n [in] - The number of values to convert
+ */
+void to_half_n(const float *src, cl_half *dst, size_t n);
+
+/**
+ * \brief Converts n 16-bit half floats to 32-bit floats, giving exactly the
+ *        same results as to_float. Uses F16C instructions on x86 CPUs that
+ *        have them, detected at runtime, NEON on 64-bit ARM, and vectorized
+ *        code elsewhere.
+ *
+ * @param src [in] - The half floats to convert
+ * @param dst [out] - Where to write the n floats
+ * @param n [in] - The number of values to convert
+ */
+void to_float_n(const cl_half *src, cl_float *dst, size_t n);
+
+/*
+ * Internal helpers for to_half_constexpr, each a single return statement as
+ * C++11 constexpr functions must be.
+ */
+
+constexpr float half_constexpr_pow2(int e)
+{
+    return e == 0 ? 1.f : (e > 0 ? 2.f * half_constexpr_pow2(e - 1) : 0.5f * half_constexpr_pow2(e + 1));
+}
+
+// The exponent of the half nearest to a, given 0 <= a < 65520: floor(log2(a)), but at least -14
+constexpr int half_constexpr_exponent(float a, int e = 15)
+{
+    return e == -14 || a >= half_constexpr_pow2(e) ? e : half_constexpr_exponent(a, e - 1);
+}
+
+// q is the scaled magnitude truncated to 11 significant bits and frac the part
+// that was dropped. Rounding up from 2047 carries into the exponent.
+constexpr cl_half half_constexpr_round(int e, cl_uint q, float frac)
+{
+    return static_cast<cl_half>(((e + 15) << 10) + q + (frac > 0.5f || (frac == 0.5f && (q & 1) != 0)) - 1024);
+}
+
+// Scaling by a power of two is exact, so scaled holds a's significand with 10
+// bits after the binary point of a half with exponent e
+constexpr cl_half half_constexpr_scaled(int e, float scaled)
+{
+    return half_constexpr_round(e, static_cast<cl_uint>(scaled), scaled - static_cast<float>(static_cast<cl_uint>(scaled)));
+}
+
+constexpr cl_half half_constexpr_magnitude(float a)
+{
+    return a >= 65520.f ? static_cast<cl_half>(0x7C00)
+                        : half_constexpr_scaled(half_constexpr_exponent(a),
+                                                a * half_constexpr_pow2(10 - half_constexpr_exponent(a)));
+}
+
+/**
+ * \brief Converts a 32-bit float to a 16-bit half float at compile time, so
+ *        that tables of half floats, such as convolution weights, need no
+ *        static initialization. Rounds to nearest even, giving the same
+ *        results as to_half with its default rounding, except that a
+ *        constant expression can't see the sign of zero or the payload of a
+ *        NaN: -0.f gives +0 and every NaN gives 0x7E00.
+ *
+ * @param f [in] - The 32-bit float to convert
+ * @return the equivalent 16-bit half float
+ */
+constexpr cl_half to_half_constexpr(float f)
+{
+    return f != f ? static_cast<cl_half>(0x7E00)
+                  : (f < 0 ? static_cast<cl_half>(0x8000 | half_constexpr_magnitude(-f)) : half_constexpr_magnitude(f));
+}
+
 #endif //SDK_EXAMPLES_HALF_FLOAT_H
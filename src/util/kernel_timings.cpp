@@ -0,0 +1,164 @@
+//--------------------------------------------------------------------------------------
+// File: kernel_timings.cpp
+// Desc:
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+#include "kernel_timings.h"
+#include "util.h"
+
+#include <algorithm>
+#include <iomanip>
+
+const size_t kernel_timing_registry::MAX_SAMPLES;
+
+kernel_timing_registry::kernel_timing_registry() :
+    m_random()
+{
+}
+
+void kernel_timing_registry::record(const std::string &name, cl_ulong queued, cl_ulong submit, cl_ulong start,
+                                    cl_ulong end, size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_samples.find(name);
+    if (it == m_samples.end())
+    {
+        it = m_samples.insert(std::make_pair(name, samples_t{std::vector<double>(), 0, 0, 0, 0, 0, 0})).first;
+    }
+    samples_t   &samples = it->second;
+    const double run_us  = end >= start ? (end - start) / 1e3 : 0;
+    samples.min_us         = samples.count == 0 ? run_us : std::min(samples.min_us, run_us);
+    samples.run_us_sum    += run_us;
+    samples.queued_us_sum += submit >= queued ? (submit - queued) / 1e3 : 0;
+    samples.submit_us_sum += start >= submit ? (start - submit) / 1e3 : 0;
+    samples.bytes         += bytes;
+    ++samples.count;
+    add_reservoir_sample(samples.run_us, MAX_SAMPLES, samples.count, run_us, m_random);
+}
+
+bool kernel_timing_registry::record_event(const std::string &name, cl_event event, size_t bytes)
+{
+    cl_ulong times[4] = {0, 0, 0, 0};
+    static const cl_profiling_info params[4] = {
+        CL_PROFILING_COMMAND_QUEUED, CL_PROFILING_COMMAND_SUBMIT, CL_PROFILING_COMMAND_START, CL_PROFILING_COMMAND_END
+    };
+    for (int i = 0; i < 4; ++i)
+    {
+        if (clGetEventProfilingInfo(event, params[i], sizeof(times[i]), &times[i], NULL) != CL_SUCCESS)
+        {
+            return false;
+        }
+    }
+    record(name, times[0], times[1], times[2], times[3], bytes);
+    return true;
+}
+
+std::vector<kernel_timing_t> kernel_timing_registry::summarize() const
+{
+    std::vector<kernel_timing_t> result;
+    std::lock_guard<std::mutex>  lock(m_mutex);
+    for (const auto &entry : m_samples)
+    {
+        std::vector<double> sorted(entry.second.run_us);
+        std::sort(sorted.begin(), sorted.end());
+
+        kernel_timing_t timing;
+        timing.name         = entry.first;
+        timing.count        = entry.second.count;
+        timing.min_us       = entry.second.min_us;
+        timing.total_us     = entry.second.run_us_sum;
+        timing.mean_us      = timing.total_us / timing.count;
+        timing.p50_us       = nearest_rank_percentile(sorted, 0.5);
+        timing.p99_us       = nearest_rank_percentile(sorted, 0.99);
+        timing.mean_queued_us = entry.second.queued_us_sum / timing.count;
+        timing.mean_submit_us = entry.second.submit_us_sum / timing.count;
+        timing.bytes          = entry.second.bytes;
+        result.push_back(timing);
+    }
+    std::sort(result.begin(), result.end(), [](const kernel_timing_t &a, const kernel_timing_t &b)
+    {
+        return a.total_us > b.total_us;
+    });
+    return result;
+}
+
+void kernel_timing_registry::write_table(std::ostream &out) const
+{
+    const std::vector<kernel_timing_t> timings = summarize();
+    size_t name_width = 4;
+    for (const auto &timing : timings)
+    {
+        name_width = std::max(name_width, timing.name.size());
+    }
+
+    const std::ios::fmtflags flags     = out.flags();
+    const std::streamsize    precision = out.precision();
+    out << std::left << std::setw(name_width) << "name" << std::right
+        << std::setw(8)  << "count"
+        << std::setw(12) << "total us"
+        << std::setw(10) << "min us"
+        << std::setw(10) << "mean us"
+        << std::setw(10) << "p50 us"
+        << std::setw(10) << "p99 us"
+        << std::setw(11) << "queued us"
+        << std::setw(11) << "submit us"
+        << std::setw(10) << "GB/s" << "\n";
+    out << std::fixed << std::setprecision(1);
+    for (const auto &timing : timings)
+    {
+        out << std::left << std::setw(name_width) << timing.name << std::right
+            << std::setw(8)  << timing.count
+            << std::setw(12) << timing.total_us
+            << std::setw(10) << timing.min_us
+            << std::setw(10) << timing.mean_us
+            << std::setw(10) << timing.p50_us
+            << std::setw(10) << timing.p99_us
+            << std::setw(11) << timing.mean_queued_us
+            << std::setw(11) << timing.mean_submit_us;
+        if (timing.bytes != 0 && timing.total_us > 0)
+        {
+            out << std::setw(10) << std::setprecision(2) << timing.bytes / (timing.total_us * 1e3)
+                << std::setprecision(1);
+        }
+        else
+        {
+            out << std::setw(10) << "-";
+        }
+        out << "\n";
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void kernel_timing_registry::write_json(std::ostream &out) const
+{
+    const std::vector<kernel_timing_t> timings = summarize();
+    out << "{\"kernels\": [";
+    for (size_t i = 0; i < timings.size(); ++i)
+    {
+        const kernel_timing_t &timing = timings[i];
+        out << (i == 0 ? "\n" : ",\n")
+            << "  {\"name\": \"" << json_escape(timing.name) << "\""
+            << ", \"count\": " << timing.count
+            << ", \"total_us\": " << timing.total_us
+            << ", \"min_us\": " << timing.min_us
+            << ", \"mean_us\": " << timing.mean_us
+            << ", \"p50_us\": " << timing.p50_us
+            << ", \"p99_us\": " << timing.p99_us
+            << ", \"mean_queued_us\": " << timing.mean_queued_us
+            << ", \"mean_submit_us\": " << timing.mean_submit_us
+            << ", \"bytes\": " << timing.bytes << "}";
+    }
+    out << "\n]}\n";
+}
+
+bool kernel_timing_registry::empty() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_samples.empty();
+}
@@ -0,0 +1,122 @@
+//--------------------------------------------------------------------------------------
+// File: kernel_timings.h
+// Desc:
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+#ifndef SDK_EXAMPLES_KERNEL_TIMINGS_H
+#define SDK_EXAMPLES_KERNEL_TIMINGS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <CL/cl.h>
+
+/**
+ * \brief The aggregated device-side times of one kernel or command, in microseconds.
+ */
+struct kernel_timing_t
+{
+    std::string name;
+    size_t      count;
+    double      min_us;       // Of the execution times, from CL_PROFILING_COMMAND_START to _END
+    double      mean_us;
+    double      p50_us;
+    double      p99_us;
+    double      total_us;
+    double      mean_queued_us; // From CL_PROFILING_COMMAND_QUEUED to _SUBMIT: time waiting in the host queue
+    double      mean_submit_us; // From CL_PROFILING_COMMAND_SUBMIT to _START: time waiting on the device
+    uint64_t    bytes;        // Bytes moved by all the runs, as given when they were recorded
+};
+
+/**
+ * \brief Collects the profiling times of commands by name, e.g. the kernel
+ *        name or "clEnqueueReadBuffer", and summarizes them.
+ *
+ * The count, total, minimum and means cover every run. Percentiles come from
+ * up to MAX_SAMPLES run times per name, picked uniformly at random from all
+ * the runs once there are more, so that a long run can't exhaust memory.
+ * Recording is thread-safe.
+ */
+class kernel_timing_registry {
+public:
+    static const size_t MAX_SAMPLES = 1 << 16;
+
+    kernel_timing_registry();
+
+    /**
+     * \brief Records one run of a command, with times as given by clGetEventProfilingInfo.
+     *
+     * @param name [in] - The kernel or command name
+     * @param queued [in] - CL_PROFILING_COMMAND_QUEUED, in nanoseconds
+     * @param submit [in] - CL_PROFILING_COMMAND_SUBMIT
+     * @param start [in] - CL_PROFILING_COMMAND_START
+     * @param end [in] - CL_PROFILING_COMMAND_END
+     * @param bytes [in] - The number of bytes the command read and wrote, or 0 if unknown
+     */
+    void record(const std::string &name, cl_ulong queued, cl_ulong submit, cl_ulong start, cl_ulong end,
+                size_t bytes);
+
+    /**
+     * \brief Records a completed, profiled event, reading its times from the driver.
+     *
+     * @param name [in]
+     * @param event [in] - An event from a queue made with CL_QUEUE_PROFILING_ENABLE
+     * @param bytes [in]
+     * @return false if the event's times couldn't be read, in which case nothing is recorded.
+     */
+    bool record_event(const std::string &name, cl_event event, size_t bytes);
+
+    /**
+     * \brief Gets the timings of every command recorded so far, sorted by
+     *        decreasing total time.
+     * @return
+     */
+    std::vector<kernel_timing_t> summarize() const;
+
+    /**
+     * \brief Writes the summary as an aligned text table, including the
+     *        bandwidth of commands that moved bytes.
+     */
+    void write_table(std::ostream &out) const;
+
+    /**
+     * \brief Writes the summary as JSON: {"kernels": [{"name": ..., "count": ..., ...}, ...]}.
+     */
+    void write_json(std::ostream &out) const;
+
+    /**
+     * \brief Gets whether nothing has been recorded.
+     * @return
+     */
+    bool empty() const;
+
+private:
+    struct samples_t
+    {
+        std::vector<double> run_us;  // At most MAX_SAMPLES of the run times
+        size_t              count;
+        double              run_us_sum;
+        double              min_us;
+        double              queued_us_sum;
+        double              submit_us_sum;
+        uint64_t            bytes;
+    };
+
+    mutable std::mutex               m_mutex;
+    std::map<std::string, samples_t> m_samples;
+    std::minstd_rand                 m_random; // Picks which samples to replace past MAX_SAMPLES
+};
+
+#endif //SDK_EXAMPLES_KERNEL_TIMINGS_H
@@ -0,0 +1,114 @@
+//--------------------------------------------------------------------------------------
+// File: mapped_file.cpp
+// Desc:
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+mapped_file::mapped_file(const std::string &filename)
+    : m_filename(filename)
+    , m_data(nullptr)
+    , m_size(0)
+{
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "Can't open " << filename << " for reading\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0)
+    {
+        close(fd);
+        std::cerr << "Error " << errno << " getting size of " << filename << ": " << strerror(errno) << "\n";
+        std::exit(errno);
+    }
+    m_size = static_cast<size_t>(file_stat.st_size);
+
+    // mmap refuses zero-length mappings, so an empty file simply has no data.
+    if (m_size > 0)
+    {
+        void *addr = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == addr)
+        {
+            close(fd);
+            std::cerr << "Error " << errno << " mmapping " << filename << ": " << strerror(errno) << "\n";
+            std::exit(errno);
+        }
+        m_data = static_cast<unsigned char *>(addr);
+    }
+
+    // The mapping keeps its own reference to the file.
+    close(fd);
+}
+
+mapped_file::mapped_file(mapped_file &&other)
+    : m_filename(std::move(other.m_filename))
+    , m_data(other.m_data)
+    , m_size(other.m_size)
+{
+    other.m_data = nullptr;
+    other.m_size = 0;
+}
+
+mapped_file &mapped_file::operator=(mapped_file &&other)
+{
+    if (this != &other)
+    {
+        release();
+        m_filename   = std::move(other.m_filename);
+        m_data       = other.m_data;
+        m_size       = other.m_size;
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+    return *this;
+}
+
+mapped_file::~mapped_file()
+{
+    release();
+}
+
+void mapped_file::release()
+{
+    if (m_data && munmap(m_data, m_size) < 0)
+    {
+        std::cerr << "Error " << errno << " munmap-ing " << m_filename << ": " << strerror(errno) << "\n";
+        std::exit(errno);
+    }
+    m_data = nullptr;
+    m_size = 0;
+}
+
+const unsigned char *mapped_file::data() const
+{
+    return m_data;
+}
+
+size_t mapped_file::size() const
+{
+    return m_size;
+}
+
+const std::string &mapped_file::filename() const
+{
+    return m_filename;
+}
@@ -0,0 +1,72 @@
+//--------------------------------------------------------------------------------------
+// File: mapped_file.h
+// Desc:
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+#ifndef SDK_EXAMPLES_MAPPED_FILE_H
+#define SDK_EXAMPLES_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * \brief A read-only memory mapping of an entire file.
+ *
+ * The mapping is released when the object is destroyed. Instances may be moved
+ * but not copied.
+ */
+class mapped_file {
+public:
+    /**
+     * \brief Maps the named file. Exits the program if it can't be opened or mapped.
+     *
+     * @param filename
+     */
+    explicit mapped_file(const std::string &filename);
+
+    mapped_file(mapped_file &&other);
+
+    mapped_file &operator=(mapped_file &&other);
+
+    mapped_file(const mapped_file &) = delete;
+
+    mapped_file &operator=(const mapped_file &) = delete;
+
+    /**
+     * \brief Unmaps the file.
+     */
+    ~mapped_file();
+
+    /**
+     * \brief Gets a pointer to the first byte of the file, or NULL for an empty file.
+     * @return
+     */
+    const unsigned char *data() const;
+
+    /**
+     * \brief Gets the size of the file in bytes.
+     * @return
+     */
+    size_t               size() const;
+
+    /**
+     * \brief Gets the name of the mapped file, for use in error messages.
+     * @return
+     */
+    const std::string   &filename() const;
+
+private:
+    void release();
+
+    std::string    m_filename;
+    unsigned char *m_data;
+    size_t         m_size;
+};
+
+#endif //SDK_EXAMPLES_MAPPED_FILE_H
@@ -0,0 +1,232 @@
+//--------------------------------------------------------------------------------------
+// File: priority_scheduler.cpp
+// Desc:
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+#include "priority_scheduler.h"
+#include "util.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+const size_t priority_scheduler::MAX_SAMPLES;
+
+cl_wrapper_config_t priority_scheduler::make_config(cl_priority_hint priority_hint)
+{
+    cl_wrapper_config_t config = cl_wrapper::get_env_config();
+    config.priority_hint       = priority_hint;
+    return config;
+}
+
+priority_scheduler::priority_scheduler(size_t max_background_pending) :
+    m_latency_wrapper(make_config(CL_PRIORITY_HINT_HIGH_QCOM)),
+    m_background_wrapper(make_config(CL_PRIORITY_HINT_LOW_QCOM)),
+    m_max_background_pending(std::max<size_t>(max_background_pending, 1)),
+    m_latency_jobs(),
+    m_background_jobs(),
+    m_stopping(false),
+    m_random()
+{
+    m_latency_worker    = std::thread(&priority_scheduler::run_worker, this, job_class_t::LATENCY);
+    m_background_worker = std::thread(&priority_scheduler::run_worker, this, job_class_t::BACKGROUND);
+}
+
+priority_scheduler::~priority_scheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_state_changed.notify_all();
+    m_latency_worker.join();
+    m_background_worker.join();
+}
+
+cl_wrapper &priority_scheduler::get_wrapper(job_class_t job_class)
+{
+    return job_class == job_class_t::LATENCY ? m_latency_wrapper : m_background_wrapper;
+}
+
+ion_allocation priority_scheduler::make_shared_ion_buffer(size_t size)
+{
+    return m_latency_wrapper.make_ion_buffer(size);
+}
+
+cl_mem_handle priority_scheduler::make_buffer(job_class_t job_class, cl_mem_flags flags, ion_allocation &ion_mem,
+                                              size_t size)
+{
+    cl_int        err = CL_SUCCESS;
+    cl_mem_handle buffer(clCreateBuffer(get_wrapper(job_class).get_context(),
+                                        flags | CL_MEM_USE_HOST_PTR | CL_MEM_EXT_HOST_PTR_QCOM, size, ion_mem.get(),
+                                        &err));
+    if (err != CL_SUCCESS)
+    {
+        std::cerr << "Error " << err << " with clCreateBuffer for shared ion memory.\n";
+        std::exit(err);
+    }
+    return buffer;
+}
+
+priority_scheduler::job_queue_t &priority_scheduler::get_queue(job_class_t job_class)
+{
+    return job_class == job_class_t::LATENCY ? m_latency_jobs : m_background_jobs;
+}
+
+const priority_scheduler::job_queue_t &priority_scheduler::get_queue(job_class_t job_class) const
+{
+    return job_class == job_class_t::LATENCY ? m_latency_jobs : m_background_jobs;
+}
+
+/**
+ * Internal method for admission control: latency jobs start right away, and
+ * background jobs only while no latency job is waiting or running. The caller holds m_mutex.
+ */
+bool priority_scheduler::can_start_locked(job_class_t job_class) const
+{
+    return job_class == job_class_t::LATENCY || (m_latency_jobs.pending.empty() && !m_latency_jobs.running);
+}
+
+std::future<void> priority_scheduler::submit(job_class_t job_class, const job_t &job)
+{
+    std::promise<void> done;
+    std::future<void>  result = done.get_future();
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        job_queue_t                 &queue = get_queue(job_class);
+        if (job_class == job_class_t::BACKGROUND && queue.pending.size() >= m_max_background_pending)
+        {
+            ++queue.blocked;
+            m_state_changed.wait(lock, [&]()
+            {
+                return queue.pending.size() < m_max_background_pending;
+            });
+        }
+        ++queue.submitted;
+        queue.pending.push_back(pending_job_t{job, std::move(done), job_clock_t::now()});
+    }
+    m_state_changed.notify_all();
+    return result;
+}
+
+void priority_scheduler::wait_idle()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_state_changed.wait(lock, [&]()
+    {
+        return m_latency_jobs.pending.empty() && !m_latency_jobs.running
+               && m_background_jobs.pending.empty() && !m_background_jobs.running;
+    });
+}
+
+/**
+ * Internal method for a worker thread, which runs a class's jobs until the scheduler stops and none are left.
+ */
+void priority_scheduler::run_worker(job_class_t job_class)
+{
+    job_queue_t &queue   = get_queue(job_class);
+    cl_wrapper  &wrapper = get_wrapper(job_class);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_state_changed.wait(lock, [&]()
+        {
+            return (!queue.pending.empty() && can_start_locked(job_class)) || (m_stopping && queue.pending.empty());
+        });
+        if (queue.pending.empty())
+        {
+            return;
+        }
+
+        pending_job_t job = std::move(queue.pending.front());
+        queue.pending.pop_front();
+        queue.running = true;
+        const job_clock_t::time_point start = job_clock_t::now();
+        const double queue_us = std::chrono::duration<double, std::micro>(start - job.queued).count();
+        queue.queue_us_sum   += queue_us;
+        queue.max_queue_us    = std::max(queue.max_queue_us, queue_us);
+        add_reservoir_sample(queue.queue_us, MAX_SAMPLES, ++queue.started, queue_us, m_random);
+        lock.unlock();
+        m_state_changed.notify_all(); // There's room for another background submission
+
+        job.job(wrapper);
+        wrapper.finish();
+        const double run_us = std::chrono::duration<double, std::micro>(job_clock_t::now() - start).count();
+
+        lock.lock();
+        queue.running     = false;
+        queue.run_us_sum += run_us;
+        add_reservoir_sample(queue.run_us, MAX_SAMPLES, ++queue.completed, run_us, m_random);
+        lock.unlock();
+        m_state_changed.notify_all(); // Background jobs may start once latency jobs are done
+        job.done.set_value();
+        lock.lock();
+    }
+}
+
+job_class_stats_t priority_scheduler::get_stats(job_class_t job_class) const
+{
+    std::vector<double> queue_us;
+    std::vector<double> run_us;
+    job_class_stats_t   stats;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const job_queue_t          &queue = get_queue(job_class);
+        queue_us                          = queue.queue_us;
+        run_us                            = queue.run_us;
+        stats.submitted                   = queue.submitted;
+        stats.completed                   = queue.completed;
+        stats.blocked                     = queue.blocked;
+        stats.mean_queue_us               = queue.started == 0 ? 0 : queue.queue_us_sum / queue.started;
+        stats.max_queue_us                = queue.max_queue_us;
+        stats.mean_run_us                 = queue.completed == 0 ? 0 : queue.run_us_sum / queue.completed;
+    }
+    std::sort(queue_us.begin(), queue_us.end());
+    std::sort(run_us.begin(), run_us.end());
+
+    stats.p50_queue_us = nearest_rank_percentile(queue_us, 0.5);
+    stats.p99_queue_us = nearest_rank_percentile(queue_us, 0.99);
+    stats.p99_run_us   = nearest_rank_percentile(run_us, 0.99);
+    return stats;
+}
+
+void priority_scheduler::write_stats(std::ostream &out) const
+{
+    const std::ios::fmtflags flags     = out.flags();
+    const std::streamsize    precision = out.precision();
+    out << std::left << std::setw(12) << "class" << std::right
+        << std::setw(11) << "submitted"
+        << std::setw(11) << "completed"
+        << std::setw(9)  << "blocked"
+        << std::setw(14) << "mean queue us"
+        << std::setw(13) << "p50 queue us"
+        << std::setw(13) << "p99 queue us"
+        << std::setw(13) << "max queue us"
+        << std::setw(12) << "mean run us"
+        << std::setw(11) << "p99 run us" << "\n";
+    out << std::fixed << std::setprecision(1);
+    for (const job_class_t job_class : {job_class_t::LATENCY, job_class_t::BACKGROUND})
+    {
+        const job_class_stats_t stats = get_stats(job_class);
+        out << std::left << std::setw(12) << (job_class == job_class_t::LATENCY ? "latency" : "background")
+            << std::right
+            << std::setw(11) << stats.submitted
+            << std::setw(11) << stats.completed
+            << std::setw(9)  << stats.blocked
+            << std::setw(14) << stats.mean_queue_us
+            << std::setw(13) << stats.p50_queue_us
+            << std::setw(13) << stats.p99_queue_us
+            << std::setw(13) << stats.max_queue_us
+            << std::setw(12) << stats.mean_run_us
+            << std::setw(11) << stats.p99_run_us << "\n";
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
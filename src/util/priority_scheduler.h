@@ -0,0 +1,213 @@
+//--------------------------------------------------------------------------------------
+// File: priority_scheduler.h
+// Desc:
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+#ifndef SDK_EXAMPLES_PRIORITY_SCHEDULER_H
+#define SDK_EXAMPLES_PRIORITY_SCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <ostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "cl_handles.h"
+#include "cl_wrapper.h"
+
+/**
+ * \brief The class of a job given to a priority_scheduler.
+ */
+enum class job_class_t
+{
+    LATENCY,    // Latency-critical work, e.g. a preview frame
+    BACKGROUND, // Batch work that can wait, e.g. analysis
+};
+
+/**
+ * \brief The times jobs of one class have waited and run, in microseconds.
+ */
+struct job_class_stats_t
+{
+    size_t submitted;
+    size_t completed;
+    size_t blocked;        // Submissions that waited for room, by admission control
+    double mean_queue_us;  // From the job being queued, after any wait for admission, to it starting to run
+    double p50_queue_us;
+    double p99_queue_us;
+    double max_queue_us;
+    double mean_run_us;    // From the job starting to its commands finishing on the device
+    double p99_run_us;
+};
+
+/**
+ * \brief Runs latency-critical and background jobs on the GPU at once, without
+ *        letting the background work delay the latency-critical work.
+ *
+ * Each class has its own cl_wrapper, so its own context and in-order command
+ * queue: the latency class with CL_PRIORITY_HINT_HIGH_QCOM and the background
+ * class with CL_PRIORITY_HINT_LOW_QCOM, so the driver submits latency work to
+ * the GPU first. Each class has a worker thread that runs its jobs one at a
+ * time, in the order they were submitted, and waits for each job's commands to
+ * finish before starting the next.
+ *
+ * Admission control keeps the background class from building up a backlog in
+ * the driver that latency work would queue behind: a background job only
+ * starts while no latency job is waiting or running, and submitting a
+ * background job blocks while max_background_pending of them are waiting.
+ *
+ * cl_mem objects can't be shared between contexts, but ion memory can: make
+ * it with make_shared_ion_buffer and wrap it for each class with make_buffer.
+ * The ion_allocation must outlive those buffers, and the scheduler must outlive it.
+ * The classes run concurrently, so a job must only read shared memory another
+ * class writes after waiting on the future of the job that writes it.
+ *
+ * The counts, means and maximum in the stats cover every job. Percentiles come
+ * from up to MAX_SAMPLES times per class, picked uniformly at random from all
+ * the jobs once there are more, so a long-running app's stats use bounded memory.
+ */
+class priority_scheduler {
+public:
+    typedef std::function<void(cl_wrapper &wrapper)> job_t;
+
+    static const size_t DEFAULT_MAX_BACKGROUND_PENDING = 4;
+    static const size_t MAX_SAMPLES                    = 1 << 16;
+
+    /**
+     * \brief Makes the contexts and starts the worker threads. Exits if the
+     *        device lacks the cl_qcom_priority_hint extension.
+     *
+     * @param max_background_pending [in] - The number of background jobs that may wait to run
+     *                                      before submitting another blocks. At least 1.
+     */
+    explicit priority_scheduler(size_t max_background_pending = DEFAULT_MAX_BACKGROUND_PENDING);
+
+    /**
+     * \brief Runs the jobs still waiting, then stops the worker threads.
+     */
+    ~priority_scheduler();
+
+    priority_scheduler(const priority_scheduler &)            = delete;
+    priority_scheduler &operator=(const priority_scheduler &) = delete;
+
+    /**
+     * \brief Gets the wrapper whose context and queue a class's jobs run on,
+     *        e.g. to make its programs and kernels.
+     *
+     * @param job_class [in]
+     * @return
+     */
+    cl_wrapper &get_wrapper(job_class_t job_class);
+
+    /**
+     * \brief Makes an ion buffer that both classes can use through make_buffer.
+     *
+     * @param size [in]
+     * @return
+     */
+    ion_allocation make_shared_ion_buffer(size_t size);
+
+    /**
+     * \brief Makes a buffer in one class's context over shared ion memory.
+     *
+     * @param job_class [in]
+     * @param flags [in] - e.g. CL_MEM_READ_ONLY. CL_MEM_USE_HOST_PTR and CL_MEM_EXT_HOST_PTR_QCOM are added.
+     * @param ion_mem [in] - From make_shared_ion_buffer
+     * @param size [in] - At most the size the ion buffer was made with
+     * @return
+     */
+    cl_mem_handle make_buffer(job_class_t job_class, cl_mem_flags flags, ion_allocation &ion_mem, size_t size);
+
+    /**
+     * \brief Queues a job to run on its class's worker thread. The job enqueues
+     *        commands on the wrapper's queue, and is complete once they finish.
+     *        Submitting a background job blocks while max_background_pending
+     *        background jobs are waiting. Can be called from any thread.
+     *
+     * @param job_class [in]
+     * @param job [in]
+     * @return A future that's ready once the job's commands have finished.
+     */
+    std::future<void> submit(job_class_t job_class, const job_t &job);
+
+    /**
+     * \brief Waits until every job submitted so far has finished.
+     */
+    void wait_idle();
+
+    /**
+     * \brief Gets the queueing and run times of a class's completed jobs so far.
+     *
+     * @param job_class [in]
+     * @return
+     */
+    job_class_stats_t get_stats(job_class_t job_class) const;
+
+    /**
+     * \brief Writes the stats of both classes as a text table.
+     *
+     * @param out [in]
+     */
+    void write_stats(std::ostream &out) const;
+
+private:
+    typedef std::chrono::steady_clock job_clock_t;
+
+    struct pending_job_t
+    {
+        job_t                   job;
+        std::promise<void>      done;
+        job_clock_t::time_point queued; // After any wait for admission
+    };
+
+    struct job_queue_t
+    {
+        std::deque<pending_job_t> pending;
+        bool                      running;
+        size_t                    submitted;
+        size_t                    blocked;
+        size_t                    started;
+        size_t                    completed;
+        double                    queue_us_sum;
+        double                    max_queue_us;
+        double                    run_us_sum;
+        std::vector<double>       queue_us; // At most MAX_SAMPLES of the queueing times
+        std::vector<double>       run_us;   // At most MAX_SAMPLES of the run times
+    };
+
+    static cl_wrapper_config_t make_config(cl_priority_hint priority_hint);
+
+    job_queue_t &get_queue(job_class_t job_class);
+
+    const job_queue_t &get_queue(job_class_t job_class) const;
+
+    bool can_start_locked(job_class_t job_class) const;
+
+    void run_worker(job_class_t job_class);
+
+    cl_wrapper              m_latency_wrapper;
+    cl_wrapper              m_background_wrapper;
+    const size_t            m_max_background_pending;
+    job_queue_t             m_latency_jobs;
+    job_queue_t             m_background_jobs;
+    bool                    m_stopping;
+    std::minstd_rand        m_random;       // Picks which samples to replace past MAX_SAMPLES
+    mutable std::mutex      m_mutex;        // Guards the job queues, m_stopping and m_random
+    std::condition_variable m_state_changed; // Signalled whenever a job is queued, starts or finishes
+    std::thread             m_latency_worker;
+    std::thread             m_background_worker;
+};
+
+#endif //SDK_EXAMPLES_PRIORITY_SCHEDULER_H
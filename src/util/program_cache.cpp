@@ -0,0 +1,415 @@
+//--------------------------------------------------------------------------------------
+// File: program_cache.cpp
+// Desc:
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+#include "program_cache.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+static const char     PROGRAM_CACHE_MAGIC[4]   = {'Q', 'C', 'P', 'B'};
+static const uint32_t PROGRAM_CACHE_VERSION    = 1;
+static const char    *PROGRAM_CACHE_EXTENSION  = ".clbin";
+
+/**
+ * Internal method for hashing bytes with 64-bit FNV-1a, starting from basis.
+ */
+static uint64_t hash_bytes(const std::string &bytes, uint64_t basis)
+{
+    uint64_t hash = basis;
+    for (const char c : bytes)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static uint64_t hash_key(const program_cache_key_t &key)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (const std::string *field : {&key.source, &key.options, &key.device_name, &key.driver_version})
+    {
+        hash = hash_bytes(*field, hash);
+        hash = hash_bytes(std::string(1, '\0'), hash); // So that moving text between fields changes the hash
+    }
+    return hash;
+}
+
+/**
+ * Internal method for an independent hash of the source, recorded in entries
+ * to catch collisions of hash_key.
+ */
+static uint64_t hash_source(const std::string &source)
+{
+    return hash_bytes(source, 0x84222325CBF29CE4ull);
+}
+
+static void append_le(std::vector<unsigned char> &out, uint64_t val, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        out.push_back(static_cast<unsigned char>(val >> (i * 8)));
+    }
+}
+
+static void append_string(std::vector<unsigned char> &out, const std::string &str)
+{
+    append_le(out, str.size(), 4);
+    out.insert(out.end(), str.begin(), str.end());
+}
+
+/**
+ * \brief Reads the fields of an entry in order, failing once any read runs past the end.
+ */
+class entry_reader {
+public:
+    explicit entry_reader(const std::vector<unsigned char> &data)
+        : m_data(data)
+        , m_pos(0)
+        , m_ok(true)
+    {
+    }
+
+    uint64_t read_le(size_t bytes)
+    {
+        uint64_t val = 0;
+        if (!check(bytes))
+        {
+            return 0;
+        }
+        for (size_t i = 0; i < bytes; ++i)
+        {
+            val |= static_cast<uint64_t>(m_data[m_pos + i]) << (i * 8);
+        }
+        m_pos += bytes;
+        return val;
+    }
+
+    std::string read_string()
+    {
+        const size_t size = static_cast<size_t>(read_le(4));
+        if (!check(size))
+        {
+            return std::string();
+        }
+        std::string str(m_data.begin() + m_pos, m_data.begin() + m_pos + size);
+        m_pos += size;
+        return str;
+    }
+
+    bool read_rest(std::vector<unsigned char> &out, uint64_t size)
+    {
+        if (!check(size) || m_pos + size != m_data.size())
+        {
+            return false;
+        }
+        out.assign(m_data.begin() + m_pos, m_data.end());
+        return true;
+    }
+
+    bool ok() const
+    {
+        return m_ok;
+    }
+
+private:
+    bool check(uint64_t bytes)
+    {
+        m_ok = m_ok && bytes <= m_data.size() - m_pos;
+        return m_ok;
+    }
+
+    const std::vector<unsigned char> &m_data;
+    size_t                            m_pos;
+    bool                              m_ok;
+};
+
+/**
+ * Internal method for creating a directory and any missing parents, readable only by the user.
+ */
+static void make_directories(const std::string &path)
+{
+    for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1))
+    {
+        mkdir(path.substr(0, slash).c_str(), 0700); // Failures show up as misses and failed stores
+        if (slash == std::string::npos)
+        {
+            break;
+        }
+    }
+}
+
+/**
+ * Internal method for checking that a cache directory can only be changed by the user, so that no one
+ * else can plant a binary in it. A directory that doesn't exist passes; it can't hold entries.
+ */
+static bool is_private_directory(const std::string &path)
+{
+    struct stat dir_stat;
+    if (stat(path.c_str(), &dir_stat) != 0)
+    {
+        return true;
+    }
+    if (!S_ISDIR(dir_stat.st_mode))
+    {
+        std::cerr << "Not caching program binaries: " << path << " is not a directory.\n";
+        return false;
+    }
+    if (dir_stat.st_uid != geteuid())
+    {
+        std::cerr << "Not caching program binaries: " << path << " belongs to user " << dir_stat.st_uid
+                  << ", not " << geteuid() << ".\n";
+        return false;
+    }
+    if ((dir_stat.st_mode & (S_IWGRP | S_IWOTH)) != 0)
+    {
+        std::cerr << "Not caching program binaries: " << path << " can be written by other users.\n";
+        return false;
+    }
+    return true;
+}
+
+static bool has_extension(const std::string &name, const std::string &extension)
+{
+    return name.size() > extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+program_binary_cache::program_binary_cache()
+    : program_binary_cache("", DEFAULT_MAX_BYTES)
+{
+}
+
+program_binary_cache::program_binary_cache(const std::string &directory, size_t max_bytes)
+    : m_directory(directory)
+    , m_max_bytes(max_bytes)
+    , m_hits(0)
+    , m_misses(0)
+    , m_stores(0)
+    , m_evictions(0)
+{
+    if (enabled())
+    {
+        make_directories(m_directory);
+        if (!is_private_directory(m_directory))
+        {
+            m_directory.clear();
+        }
+    }
+}
+
+program_binary_cache::program_binary_cache(const program_binary_cache &other)
+    : m_directory(other.m_directory)
+    , m_max_bytes(other.m_max_bytes)
+    , m_hits(other.m_hits.load())
+    , m_misses(other.m_misses.load())
+    , m_stores(other.m_stores.load())
+    , m_evictions(other.m_evictions.load())
+{
+}
+
+program_binary_cache &program_binary_cache::operator=(const program_binary_cache &other)
+{
+    m_directory = other.m_directory;
+    m_max_bytes = other.m_max_bytes;
+    m_hits      = other.m_hits.load();
+    m_misses    = other.m_misses.load();
+    m_stores    = other.m_stores.load();
+    m_evictions = other.m_evictions.load();
+    return *this;
+}
+
+bool program_binary_cache::enabled() const
+{
+    return !m_directory.empty();
+}
+
+const std::string &program_binary_cache::directory() const
+{
+    return m_directory;
+}
+
+std::string program_binary_cache::entry_path(const program_cache_key_t &key) const
+{
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash_key(key)));
+    return m_directory + "/" + name + PROGRAM_CACHE_EXTENSION;
+}
+
+bool program_binary_cache::load(const program_cache_key_t &key, std::vector<unsigned char> &binary)
+{
+    if (!enabled())
+    {
+        return false;
+    }
+
+    const std::string path = entry_path(key);
+    std::ifstream     fin(path, std::ios::binary);
+    const std::vector<unsigned char> data((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    entry_reader      reader(data);
+
+    const bool magic_ok = data.size() >= sizeof(PROGRAM_CACHE_MAGIC)
+                          && std::equal(PROGRAM_CACHE_MAGIC, PROGRAM_CACHE_MAGIC + sizeof(PROGRAM_CACHE_MAGIC),
+                                        data.begin());
+    reader.read_le(sizeof(PROGRAM_CACHE_MAGIC));
+    const bool matches = magic_ok
+                         && reader.read_le(4) == PROGRAM_CACHE_VERSION
+                         && reader.read_string() == key.options
+                         && reader.read_string() == key.device_name
+                         && reader.read_string() == key.driver_version
+                         && reader.read_le(8) == key.source.size()
+                         && reader.read_le(8) == hash_source(key.source)
+                         && reader.ok();
+    if (!matches || !reader.read_rest(binary, reader.read_le(8)) || binary.empty())
+    {
+        ++m_misses;
+        return false;
+    }
+
+    utimensat(AT_FDCWD, path.c_str(), NULL, 0); // Marks the entry as recently used
+    ++m_hits;
+    return true;
+}
+
+void program_binary_cache::store(const program_cache_key_t &key, const std::vector<unsigned char> &binary)
+{
+    if (!enabled() || binary.empty() || binary.size() > m_max_bytes)
+    {
+        return;
+    }
+
+    std::vector<unsigned char> data(PROGRAM_CACHE_MAGIC, PROGRAM_CACHE_MAGIC + sizeof(PROGRAM_CACHE_MAGIC));
+    append_le(data, PROGRAM_CACHE_VERSION, 4);
+    append_string(data, key.options);
+    append_string(data, key.device_name);
+    append_string(data, key.driver_version);
+    append_le(data, key.source.size(), 8);
+    append_le(data, hash_source(key.source), 8);
+    append_le(data, binary.size(), 8);
+    data.insert(data.end(), binary.begin(), binary.end());
+
+    // Readers in other processes see either the old entry or the whole new one
+    const std::string path      = entry_path(key);
+    const std::string temp_path = path + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream fout(temp_path, std::ios::binary);
+        fout.write(reinterpret_cast<const char *>(data.data()), data.size());
+        if (!fout)
+        {
+            fout.close();
+            std::remove(temp_path.c_str());
+            return;
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temp_path.c_str());
+        return;
+    }
+    ++m_stores;
+
+    evict();
+}
+
+void program_binary_cache::remove(const program_cache_key_t &key)
+{
+    if (enabled())
+    {
+        std::remove(entry_path(key).c_str());
+    }
+}
+
+void program_binary_cache::evict()
+{
+    struct entry_t
+    {
+        std::string     path;
+        struct timespec used;
+        size_t          size;
+    };
+
+    DIR *dir = opendir(m_directory.c_str());
+    if (!dir)
+    {
+        return;
+    }
+    std::vector<entry_t> entries;
+    size_t               total_bytes = 0;
+    while (const struct dirent *entry = readdir(dir))
+    {
+        const std::string name(entry->d_name);
+        struct stat       entry_stat;
+        const std::string path = m_directory + "/" + name;
+        if (has_extension(name, PROGRAM_CACHE_EXTENSION) && stat(path.c_str(), &entry_stat) == 0)
+        {
+            entries.push_back({path, entry_stat.st_mtim, static_cast<size_t>(entry_stat.st_size)});
+            total_bytes += entries.back().size;
+        }
+    }
+    closedir(dir);
+
+    std::sort(entries.begin(), entries.end(), [](const entry_t &a, const entry_t &b)
+    {
+        return a.used.tv_sec != b.used.tv_sec ? a.used.tv_sec < b.used.tv_sec : a.used.tv_nsec < b.used.tv_nsec;
+    });
+    for (size_t i = 0; i < entries.size() && total_bytes > m_max_bytes; ++i)
+    {
+        if (std::remove(entries[i].path.c_str()) == 0)
+        {
+            total_bytes -= entries[i].size;
+            ++m_evictions;
+        }
+    }
+}
+
+void program_binary_cache::clear()
+{
+    DIR *dir = enabled() ? opendir(m_directory.c_str()) : NULL;
+    if (!dir)
+    {
+        return;
+    }
+    while (const struct dirent *entry = readdir(dir))
+    {
+        const std::string name(entry->d_name);
+        if (has_extension(name, PROGRAM_CACHE_EXTENSION))
+        {
+            std::remove((m_directory + "/" + name).c_str());
+        }
+    }
+    closedir(dir);
+}
+
+size_t program_binary_cache::hits() const
+{
+    return m_hits;
+}
+
+size_t program_binary_cache::misses() const
+{
+    return m_misses;
+}
+
+size_t program_binary_cache::stores() const
+{
+    return m_stores;
+}
+
+size_t program_binary_cache::evictions() const
+{
+    return m_evictions;
+}
@@ -0,0 +1,143 @@
+//--------------------------------------------------------------------------------------
+// File: program_cache.h
+// Desc:
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+#ifndef SDK_EXAMPLES_PROGRAM_CACHE_H
+#define SDK_EXAMPLES_PROGRAM_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Everything that determines a built program binary. A binary is only
+ *        reused for a key equal in every field.
+ */
+struct program_cache_key_t
+{
+    std::string source;
+    std::string options;
+    std::string device_name;
+    std::string driver_version;
+};
+
+/**
+ * \brief A directory of program binaries, as given by CL_PROGRAM_BINARIES,
+ *        that persists between runs.
+ *
+ * Each entry is a file named after a hash of its key. The file also records
+ * the key's options, device name and driver version and the source's length
+ * and a second hash, so a hash collision or a file from another driver is a
+ * miss rather than a wrong binary.
+ *
+ * Loading an entry marks it as recently used. When storing an entry takes the
+ * directory over its size limit, the least recently used entries are deleted.
+ * Entries are written to a temporary file and renamed into place, so several
+ * processes may share a directory.
+ *
+ * Directories the cache creates are private to the user (mode 0700). A
+ * directory that belongs to another user, or that other users can write to,
+ * disables the cache, since anyone who can plant a binary there could run
+ * their own code in the program.
+ *
+ * The cache never fails the program: any entry it can't read is a miss, and
+ * failing to write one only costs the next run a source build.
+ */
+class program_binary_cache {
+public:
+    static const size_t DEFAULT_MAX_BYTES = 64 * 1024 * 1024;
+
+    /**
+     * \brief Makes a disabled cache, for which every load misses and stores do nothing.
+     */
+    program_binary_cache();
+
+    /**
+     * \brief Makes a cache in the given directory, which is created if necessary.
+     *        If the directory is not owned by the user, or can be written by
+     *        others, a warning is printed and the cache is disabled.
+     *
+     * @param directory - The directory to keep entries in. If empty, the cache is disabled.
+     * @param max_bytes - The limit on the total size of the entries.
+     */
+    program_binary_cache(const std::string &directory, size_t max_bytes);
+
+    program_binary_cache(const program_binary_cache &other);
+
+    program_binary_cache &operator=(const program_binary_cache &other);
+
+    /**
+     * \brief Gets whether the cache has a directory.
+     * @return
+     */
+    bool               enabled() const;
+
+    /**
+     * \brief Gets the directory entries are kept in.
+     * @return
+     */
+    const std::string &directory() const;
+
+    /**
+     * \brief Loads the binary stored for key, and marks it as recently used.
+     *
+     * @param key [in]
+     * @param binary [out] - Receives the binary.
+     * @return true if there was an entry for key.
+     */
+    bool               load(const program_cache_key_t &key, std::vector<unsigned char> &binary);
+
+    /**
+     * \brief Stores a binary for key, replacing any previous one, and then
+     *        evicts the least recently used entries over the size limit.
+     *
+     * @param key [in]
+     * @param binary [in]
+     */
+    void               store(const program_cache_key_t &key, const std::vector<unsigned char> &binary);
+
+    /**
+     * \brief Deletes the entry for key, e.g. because the driver rejected its binary.
+     *
+     * @param key [in]
+     */
+    void               remove(const program_cache_key_t &key);
+
+    /**
+     * \brief Deletes every entry in the directory.
+     */
+    void               clear();
+
+    /**
+     * \brief Gets the number of successful loads, failed loads, stores and
+     *        evictions since the cache was made. The counts may be read while
+     *        other threads use the cache.
+     */
+    size_t             hits() const;
+    size_t             misses() const;
+    size_t             stores() const;
+    size_t             evictions() const;
+
+private:
+    std::string entry_path(const program_cache_key_t &key) const;
+
+    void evict();
+
+    std::string         m_directory;
+    size_t              m_max_bytes;
+    std::atomic<size_t> m_hits;
+    std::atomic<size_t> m_misses;
+    std::atomic<size_t> m_stores;
+    std::atomic<size_t> m_evictions;
+};
+
+#endif //SDK_EXAMPLES_PROGRAM_CACHE_H
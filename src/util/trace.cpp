@@ -0,0 +1,196 @@
+//--------------------------------------------------------------------------------------
+// File: trace.cpp
+// Desc:
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+#include "trace.h"
+#include "util.h"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Past this many spans, more are dropped, so that a long run can't exhaust memory
+static const size_t MAX_TRACE_EVENTS = 1 << 22;
+
+struct trace_event_t
+{
+    std::string name;
+    const char *category;
+    double      start_us;
+    double      duration_us;
+    int         tid;
+    uint64_t    bytes_moved;
+};
+
+/**
+ * \brief Holds the spans of the whole process, and writes them when the process exits.
+ */
+class trace_recorder {
+public:
+    trace_recorder() :
+        m_start(std::chrono::steady_clock::now()),
+        m_dropped(0)
+    {
+    }
+
+    ~trace_recorder()
+    {
+        write();
+    }
+
+    double now_us() const
+    {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+    void record_host(const char *name, double start_us, double end_us)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto thread = std::this_thread::get_id();
+        auto       it     = m_host_tids.find(thread);
+        if (it == m_host_tids.end())
+        {
+            it = m_host_tids.insert(std::make_pair(thread, next_tid_locked("host thread " +
+                                                                           std::to_string(m_host_tids.size() + 1))))
+                            .first;
+        }
+        add_locked(trace_event_t{name, "host", start_us, end_us - start_us, it->second, 0});
+    }
+
+    void record_device(const std::string &name, const char *track, double start_us, double end_us, size_t bytes_moved)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_device_tids.find(track);
+        if (it == m_device_tids.end())
+        {
+            it = m_device_tids.insert(std::make_pair(std::string(track), next_tid_locked(track))).first;
+        }
+        add_locked(trace_event_t{name, "device", start_us, end_us - start_us, it->second, bytes_moved});
+    }
+
+    void write()
+    {
+        const char *path = std::getenv("CL_TRACE_OUTPUT");
+        if (!path)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::ofstream out(path);
+        if (!out)
+        {
+            std::cerr << "Can't open " << path << " for writing the trace.\n";
+            return;
+        }
+
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        out << "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"OpenCL SDK\"}}";
+        for (const auto &track : m_track_names)
+        {
+            out << ",\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << track.first
+                << ", \"args\": {\"name\": \"" << json_escape(track.second) << "\"}}";
+        }
+        for (const auto &event : m_events)
+        {
+            out << ",\n  {\"name\": \"" << json_escape(event.name) << "\", \"cat\": \"" << event.category
+                << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << event.tid
+                << ", \"ts\": " << event.start_us << ", \"dur\": " << event.duration_us;
+            if (event.bytes_moved != 0)
+            {
+                out << ", \"args\": {\"bytes\": " << event.bytes_moved << "}";
+            }
+            out << "}";
+        }
+        out << "\n]}\n";
+
+        if (m_dropped != 0)
+        {
+            std::cerr << "The trace is missing " << m_dropped << " spans past the first " << MAX_TRACE_EVENTS << ".\n";
+        }
+    }
+
+private:
+    int next_tid_locked(const std::string &track_name)
+    {
+        const int tid = static_cast<int>(m_track_names.size()) + 1;
+        m_track_names[tid] = track_name;
+        return tid;
+    }
+
+    void add_locked(const trace_event_t &event)
+    {
+        if (m_events.size() < MAX_TRACE_EVENTS)
+        {
+            m_events.push_back(event);
+        }
+        else
+        {
+            ++m_dropped;
+        }
+    }
+
+    const std::chrono::steady_clock::time_point m_start;
+    std::mutex                                  m_mutex;
+    std::vector<trace_event_t>                  m_events;
+    std::map<std::thread::id, int>              m_host_tids;
+    std::map<std::string, int>                  m_device_tids;
+    std::map<int, std::string>                  m_track_names;
+    size_t                                      m_dropped;
+};
+
+/**
+ * Internal method for the recorder, made on first use so that spans recorded
+ * during static initialization are kept, and destroyed, writing the trace,
+ * after main returns or std::exit is called.
+ */
+static trace_recorder &get_trace_recorder()
+{
+    static trace_recorder recorder;
+    return recorder;
+}
+
+double trace_now_us()
+{
+    return get_trace_recorder().now_us();
+}
+
+void trace_host_span(const char *name, double start_us, double end_us)
+{
+    get_trace_recorder().record_host(name, start_us, end_us);
+}
+
+bool trace_device_event(const std::string &name, cl_event event, double host_enqueue_us, size_t bytes_moved,
+                        const char *track)
+{
+    cl_ulong queued = 0;
+    cl_ulong start  = 0;
+    cl_ulong end    = 0;
+    if (clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_QUEUED, sizeof(queued), &queued, NULL) != CL_SUCCESS
+        || clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(start), &start, NULL) != CL_SUCCESS
+        || clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL) != CL_SUCCESS)
+    {
+        return false;
+    }
+    const double start_us = host_enqueue_us + (start >= queued ? (start - queued) / 1e3 : 0);
+    const double end_us   = start_us + (end >= start ? (end - start) / 1e3 : 0);
+    get_trace_recorder().record_device(name, track, start_us, end_us, bytes_moved);
+    return true;
+}
+
+void write_trace()
+{
+    get_trace_recorder().write();
+}
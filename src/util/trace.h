@@ -0,0 +1,132 @@
+//--------------------------------------------------------------------------------------
+// File: trace.h
+// Desc:
+//
+// Author:      QUALCOMM
+//
+//               Copyright (c) 2018 QUALCOMM Technologies, Inc.
+//                         All Rights Reserved.
+//                      QUALCOMM Proprietary/GTDR
+//--------------------------------------------------------------------------------------
+
+#ifndef SDK_EXAMPLES_TRACE_H
+#define SDK_EXAMPLES_TRACE_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+
+#include <CL/cl.h>
+
+/*
+ * Tracing records spans of host time, e.g. loading a file, and of device time,
+ * i.e. profiled OpenCL commands, and writes them as Chrome trace-event JSON that
+ * Perfetto and chrome://tracing can show as a timeline.
+ *
+ * Spans are only recorded if the CL_TRACE_OUTPUT environment variable names the
+ * file to write them to, which happens when the program exits. Build with
+ * SDK_TRACING=0 to compile the spans out entirely.
+ */
+#ifndef SDK_TRACING
+#define SDK_TRACING 1
+#endif
+
+#define TRACE_CONCAT_INTERNAL(a, b) a##b
+#define TRACE_CONCAT(a, b)          TRACE_CONCAT_INTERNAL(a, b)
+
+#if SDK_TRACING
+/**
+ * \brief Records a host span named by the given string literal, from here to the end of the enclosing scope.
+ */
+#define TRACE_SCOPE(name) trace_scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name)
+#endif
+
+/**
+ * \brief Records a host span named after the enclosing function, for the rest of it.
+ */
+#define TRACE_FUNCTION() TRACE_SCOPE(__func__)
+
+/**
+ * \brief Gets whether spans are being recorded, i.e. whether tracing is compiled
+ *        in and CL_TRACE_OUTPUT is set. Checked once, so it's cheap to call often.
+ * @return
+ */
+inline bool trace_enabled()
+{
+#if SDK_TRACING
+    static const bool enabled = std::getenv("CL_TRACE_OUTPUT") != NULL;
+    return enabled;
+#else
+    return false;
+#endif
+}
+
+/**
+ * \brief Gets the current time on the host timeline, in microseconds since tracing started.
+ * @return
+ */
+double trace_now_us();
+
+/**
+ * \brief Records a span on the calling thread's host track.
+ *
+ * @param name [in]
+ * @param start_us [in] - From trace_now_us
+ * @param end_us [in] - From trace_now_us
+ */
+void trace_host_span(const char *name, double start_us, double end_us);
+
+/**
+ * \brief Records the device-side span of a completed command from a profiled queue.
+ *
+ * Device timestamps aren't on the host's clock, so the command is placed on the
+ * host timeline by taking CL_PROFILING_COMMAND_QUEUED to be host_enqueue_us.
+ *
+ * @param name [in] - The kernel or command name
+ * @param event [in] - The command's event
+ * @param host_enqueue_us [in] - The trace_now_us time just before the command was enqueued
+ * @param bytes_moved [in] - The bytes the command read and wrote, shown with the span if not 0
+ * @param track [in] - The name of the timeline to put the span on, one per command queue
+ * @return false if the event's times couldn't be read, in which case nothing is recorded.
+ */
+bool trace_device_event(const std::string &name, cl_event event, double host_enqueue_us, size_t bytes_moved,
+                        const char *track);
+
+/**
+ * \brief Writes the spans recorded so far to the CL_TRACE_OUTPUT file. This is
+ *        done automatically when the program exits, so is only needed to see a
+ *        trace of a program that doesn't.
+ */
+void write_trace();
+
+/**
+ * \brief Records a host span over its lifetime. Use TRACE_SCOPE rather than this directly,
+ *        so that it can be compiled out.
+ */
+class trace_scope {
+public:
+    explicit trace_scope(const char *name) :
+        m_name(trace_enabled() ? name : NULL),
+        m_start_us(m_name ? trace_now_us() : 0)
+    {
+    }
+
+    ~trace_scope()
+    {
+        if (m_name)
+        {
+            trace_host_span(m_name, m_start_us, trace_now_us());
+        }
+    }
+
+    trace_scope(const trace_scope &)            = delete;
+    trace_scope &operator=(const trace_scope &) = delete;
+
+private:
+    const char *m_name;
+    double      m_start_us;
+};
+
+#endif //SDK_EXAMPLES_TRACE_H
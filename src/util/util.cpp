@@ -11,13 +11,21 @@
 
 #include "util/util.h"
 #include "half_float.h"
+#include "trace.h"
 
 #include "CL/cl.h"
 
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <locale.h>
+#include <thread>
+#include <type_traits>
 #include <CL/cl_ext_qcom.h>
 
 /************************
@@ -44,283 +52,2533 @@ static void write_le(std::ostream &out, UIntType val);
 template <typename UIntType>
 static UIntType read_le(std::istream &in);
 
+/**
+ * \brief Reads the pixel data of a compressed image data file into pitched memory.
+ *
+ * @param in - The stream to read from, positioned after the image data header.
+ * @param layout - The layout of the decompressed image.
+ * @param dst - Where to put the decompressed planes.
+ * @param filename - The name of the file, for error messages.
+ */
+static void read_compressed_planes(std::istream &in, const image_layout_t &layout, const pitched_planes_t &dst,
+                                   const std::string &filename);
+
 template <typename UIntType>
 static void write_le(std::ostream &out, UIntType val)
 {
     unsigned char byte = 0;
     for (uint32_t i = 0; i < sizeof(UIntType); ++i)
     {
-        byte = (val & (0xFF << (i * 8))) >> (i * 8);
-        out.put(*reinterpret_cast<char *>(&byte));
+        byte = static_cast<unsigned char>(val >> (i * 8));
+        out.put(*reinterpret_cast<char *>(&byte));
+    }
+}
+
+//读取一个type数据
+template <typename UIntType>
+static UIntType read_le(std::istream &in)
+{
+    UIntType val = 0;
+    unsigned char byte = 0;
+    for (uint32_t i = 0; i < sizeof(UIntType); ++i)
+    {
+        in.get(*reinterpret_cast<char *>(&byte));
+        val |= static_cast<UIntType>(byte) << (i * 8);     //小端内存模式，低位的放在前面
+    }
+    return val;
+}
+
+// Set in the data type of the header if the pixel data is compressed, see README.md
+static const uint32_t IMAGE_DATA_COMPRESSED_FLAG = 0x80000000u;
+
+/**
+ * Internal method for reading the header of an image data file.
+ * @return true if the pixel data is compressed.
+ */
+static bool read_and_check_header(std::istream &in, uint32_t &width, uint32_t &height, uint32_t desired_data_type,
+                                  uint32_t desired_order, const std::string &data_type_name,
+                                  const std::string &order_name)
+{
+    width              = read_le<uint32_t>(in);
+    height             = read_le<uint32_t>(in);
+    uint32_t data_type = read_le<uint32_t>(in);
+    uint32_t order     = read_le<uint32_t>(in);
+    if (order != desired_order || (data_type & ~IMAGE_DATA_COMPRESSED_FLAG) != desired_data_type)
+    {
+        std::cerr << "Expected " << order_name << " and " << data_type_name << " channel order and data types\n";
+        std::exit(EXIT_FAILURE);
+    }
+    return (data_type & IMAGE_DATA_COMPRESSED_FLAG) != 0;
+}
+
+static const size_t IMAGE_HEADER_BYTES = 4 * sizeof(uint32_t);
+
+/**
+ * \brief Decodes a little-endian 32-bit value from memory, e.g. a mapped file.
+ */
+static uint32_t load_le32(const unsigned char *bytes)
+{
+    return static_cast<uint32_t>(bytes[0])
+           | (static_cast<uint32_t>(bytes[1]) << 8)
+           | (static_cast<uint32_t>(bytes[2]) << 16)
+           | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+/**
+ * \brief Decodes a little-endian 64-bit value from memory, e.g. a mapped file.
+ */
+static uint64_t load_le64(const unsigned char *bytes)
+{
+    return static_cast<uint64_t>(load_le32(bytes)) | (static_cast<uint64_t>(load_le32(bytes + 4)) << 32);
+}
+
+// Macros are great for stringification
+#define GET_HEADER(strm, w, h, desired_dt, desired_ord) \
+    read_and_check_header(strm, w, h, desired_dt, desired_ord, #desired_dt, #desired_ord)
+
+/**
+ * \brief Returns true if the host stores multi-byte integers least significant byte first.
+ */
+static bool is_little_endian_host()
+{
+    const uint16_t probe      = 1;
+    unsigned char  first_byte = 0;
+    std::memcpy(&first_byte, &probe, sizeof(first_byte));
+    return first_byte == 1;
+}
+
+/**
+ * Internal method for reversing the byte order of every channel in a buffer.
+ * The loops are kept trivially simple so the compiler can vectorize them.
+ *
+ * @param data - The buffer to swap in place.
+ * @param len - The length of the buffer in bytes.
+ * @param channel_bytes - The size of each channel in bytes: 1, 2 or 4.
+ */
+static void byte_swap_plane(unsigned char *data, size_t len, uint32_t channel_bytes)
+{
+    switch (channel_bytes)
+    {
+        case 1:
+            break;
+        case 2:
+        {
+            for (size_t i = 0; i + 1 < len; i += 2)
+            {
+                std::swap(data[i], data[i + 1]);
+            }
+            break;
+        }
+        case 4:
+        {
+            for (size_t i = 0; i + 3 < len; i += 4)
+            {
+                std::swap(data[i], data[i + 3]);
+                std::swap(data[i + 1], data[i + 2]);
+            }
+            break;
+        }
+        default:
+        {
+            std::cerr << "Error, can't swap " << channel_bytes << " bytes at a time.\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/**
+ * Internal method for reading a plane of image data from a stream.
+ * If no re-ordering of bytes is desired, e.g. for a packed format, just set
+ * "channel_bytes" to 1.
+ *
+ * The whole plane is read with a single call. On big-endian hosts the channels
+ * are then swapped in place to host byte order.
+ *
+ * @param in - A stream to read from. Must have data in little-endian byte order.
+ * @param channel_bytes - The number of consecutive bytes to read for each color channel
+ * @param plane - An appropriately sized buffer to hold the output
+ */
+static void read_plane(std::istream &in, uint32_t channel_bytes, std::vector<unsigned char> &plane)
+{
+    if (channel_bytes != 1 && channel_bytes != 2 && channel_bytes != 4)
+    {
+        std::cerr << "Error, can't read " << channel_bytes << " bytes at a time.\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    in.read(reinterpret_cast<char *>(plane.data()), plane.size());
+    if (static_cast<size_t>(in.gcount()) != plane.size())
+    {
+        std::cerr << "Error, expected " << plane.size() << " bytes of image data but only got " << in.gcount() << ".\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (!is_little_endian_host())
+    {
+        byte_swap_plane(plane.data(), plane.size(), channel_bytes);
+    }
+}
+
+/**
+ * Internal method for writing a plane of image data to a stream.
+ * If no re-ordering of bytes is desired, e.g. for a packed format, just set
+ * "channel_bytes" to 1.
+ *
+ * On little-endian hosts the plane is written with a single call. Otherwise it
+ * is swapped to little-endian byte order one block at a time.
+ *
+ * @param out - A stream to write to.
+ * @param channel_bytes - The number of consecutive bytes to read for each color channel
+ * @param plane - The data to write.
+ * @param plane_len - The length of the data in bytes.
+ */
+static void write_plane(std::ostream &out, uint32_t channel_bytes, const unsigned char *plane, size_t plane_len)
+{
+    if (channel_bytes != 1 && channel_bytes != 2 && channel_bytes != 4)
+    {
+        std::cerr << "Error, can't write " << channel_bytes << " bytes at a time.\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (is_little_endian_host() || channel_bytes == 1)
+    {
+        out.write(reinterpret_cast<const char *>(plane), plane_len);
+        return;
+    }
+
+    static const size_t        BLOCK_SIZE = 1 << 16;
+    std::vector<unsigned char> block(std::min(BLOCK_SIZE, plane_len));
+    for (size_t offset = 0; offset < plane_len; offset += block.size())
+    {
+        const size_t len = std::min(block.size(), plane_len - offset);
+        std::memcpy(block.data(), plane + offset, len);
+        byte_swap_plane(block.data(), len, channel_bytes);
+        out.write(reinterpret_cast<const char *>(block.data()), len);
+    }
+}
+
+/**
+ * Internal method for reading the planes of an image data file into buffers,
+ * decompressing them if the header said so. Compressed planes are resized to
+ * exactly fit the image.
+ */
+static void read_planes(std::istream &in, bool compressed, const std::string &filename, uint32_t width,
+                        uint32_t height, uint32_t data_type, uint32_t order, std::vector<unsigned char> &plane0,
+                        std::vector<unsigned char> *plane1 = NULL)
+{
+    const image_layout_t layout = get_image_layout(width, height, data_type, order);
+    if (!compressed)
+    {
+        read_plane(in, layout.channel_bytes, plane0);
+        if (plane1)
+        {
+            read_plane(in, layout.channel_bytes, *plane1);
+        }
+        return;
+    }
+
+    std::vector<unsigned char> *planes[2] = {&plane0, plane1};
+    pitched_planes_t            dst       = {{NULL, NULL}, {0, 0}};
+    for (uint32_t plane = 0; plane < layout.num_planes; ++plane)
+    {
+        planes[plane]->resize(layout.plane_bytes(plane));
+        dst.data[plane]      = planes[plane]->data();
+        dst.row_pitch[plane] = layout.row_bytes[plane];
+    }
+    read_compressed_planes(in, layout, dst, filename);
+}
+
+static void save_yuv_file_internal(const std::string &filename, const yuv_image_t &image, uint32_t data_type, uint32_t order)
+{
+    TRACE_FUNCTION();
+    const image_layout_t layout = get_image_layout(image.y_width, image.y_height, data_type, order);
+    if (image.y_plane.size() != layout.plane_bytes(0) || image.uv_plane.size() != layout.plane_bytes(1))
+    {
+        std::cerr << "Can't save " << filename << ": a " << image.y_width << "x" << image.y_height
+                  << " image needs planes of " << layout.plane_bytes(0) << " and " << layout.plane_bytes(1)
+                  << " bytes, but has " << image.y_plane.size() << " and " << image.uv_plane.size() << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::ofstream fout(filename, std::ios::binary);
+    if (!fout)
+    {
+        std::cerr << "Can't open " << filename << " for writing.\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    write_image_data_header(fout, image.y_width, image.y_height, data_type, order);
+
+    write_plane(fout, layout.channel_bytes, image.y_plane.data(), image.y_plane.size());
+    write_plane(fout, layout.channel_bytes, image.uv_plane.data(), image.uv_plane.size());
+}
+
+static void
+save_nonplanar_internal(const std::string &filename, const nonplanar_image_t &image, uint32_t data_type, uint32_t order,
+                        uint32_t channel_bytes)
+{
+    TRACE_FUNCTION();
+    std::ofstream fout(filename, std::ios::binary);
+    if (!fout)
+    {
+        std::cerr << "Can't open " << filename << " for writing.\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    write_image_data_header(fout, image.width, image.height, data_type, order);
+
+    write_plane(fout, channel_bytes, image.pixels.data(), image.pixels.size());
+}
+
+nv12_image_t load_nv12_image_data(const std::string &filename)
+{
+    nv12_image_t result;
+    load_nv12_image_data(filename, result);
+    return result;
+}
+
+void load_nv12_image_data(const std::string &filename, nv12_image_t &image)
+{
+    TRACE_FUNCTION();
+    std::ifstream fin(filename, std::ios::binary);
+    if (!fin)
+    {
+        std::cerr << "Can't open " << filename << " for reading\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    const bool compressed = GET_HEADER(fin, image.y_width, image.y_height, CL_UNORM_INT8, CL_QCOM_NV12);
+
+    const image_layout_t layout = get_image_layout(image.y_width, image.y_height, CL_UNORM_INT8, CL_QCOM_NV12);
+    image.y_plane.resize(layout.plane_bytes(0));
+    image.uv_plane.resize(layout.plane_bytes(1));
+    read_planes(fin, compressed, filename, image.y_width, image.y_height, CL_UNORM_INT8, CL_QCOM_NV12,
+                image.y_plane, &image.uv_plane);
+}
+
+tp10_image_t load_tp10_image_data(const std::string &filename)
+{
+    TRACE_FUNCTION();
+    std::ifstream fin(filename, std::ios::binary);
+    if (!fin)
+    {
+        std::cerr << "Can't open " << filename << " for reading\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    tp10_image_t result;
+    const bool compressed = GET_HEADER(fin, result.y_width, result.y_height, CL_QCOM_UNORM_INT10, CL_QCOM_TP10);
+
+    // Each row is padded to a whole 32-bit word, so widths that aren't a multiple of 3 take more than w * 4 / 3
+    const image_layout_t layout = get_image_layout(result.y_width, result.y_height, CL_QCOM_UNORM_INT10,
+                                                   CL_QCOM_TP10);
+    result.y_plane.resize(layout.plane_bytes(0));
+    result.uv_plane.resize(layout.plane_bytes(1));
+    read_planes(fin, compressed, filename, result.y_width, result.y_height, CL_QCOM_UNORM_INT10, CL_QCOM_TP10,
+                result.y_plane, &result.uv_plane);
+
+    return result;
+}
+
+p010_image_t load_p010_image_data(const std::string &filename)
+{
+    TRACE_FUNCTION();
+    std::ifstream fin(filename, std::ios::binary);
+    if (!fin)
+    {
+        std::cerr << "Can't open " << filename << " for reading\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    p010_image_t result;
+    const bool compressed = GET_HEADER(fin, result.y_width, result.y_height, CL_QCOM_UNORM_INT10, CL_QCOM_P010);
+
+    const image_layout_t layout = get_image_layout(result.y_width, result.y_height, CL_QCOM_UNORM_INT10,
+                                                   CL_QCOM_P010);
+    result.y_plane.resize(layout.plane_bytes(0));
+    result.uv_plane.resize(layout.plane_bytes(1));
+    read_planes(fin, compressed, filename, result.y_width, result.y_height, CL_QCOM_UNORM_INT10, CL_QCOM_P010,
+                result.y_plane, &result.uv_plane);
+
+    return result;
+}
+
+void save_nv12_image_data(const std::string &filename, const nv12_image_t &image)
+{
+    save_yuv_file_internal(filename, image, CL_UNORM_INT8, CL_QCOM_NV12);
+}
+
+void save_tp10_image_data(const std::string &filename, const tp10_image_t &image)
+{
+    save_yuv_file_internal(filename, image, CL_QCOM_UNORM_INT10, CL_QCOM_TP10);
+}
+
+void save_p010_image_data(const std::string &filename, const p010_image_t &image)
+{
+    save_yuv_file_internal(filename, image, CL_QCOM_UNORM_INT10, CL_QCOM_P010);
+}
+
+image_layout_t get_image_layout(uint32_t width, uint32_t height, cl_channel_type data_type, cl_channel_order order)
+{
+    image_layout_t layout;
+    layout.width         = width;
+    layout.height        = height;
+    layout.num_planes    = 1;
+    layout.num_rows[0]   = height;
+    layout.num_rows[1]   = 0;
+    layout.row_bytes[1]  = 0;
+
+    if (order == CL_QCOM_NV12 && data_type == CL_UNORM_INT8)
+    {
+        layout.num_planes    = 2;
+        layout.channel_bytes = 1;
+        layout.row_bytes[0]  = width;
+    }
+    else if (order == CL_QCOM_TP10 && data_type == CL_QCOM_UNORM_INT10)
+    {
+        // Three 10-bit values are packed into each 32-bit word
+        layout.num_planes    = 2;
+        layout.channel_bytes = 4;
+        layout.row_bytes[0]  = (width + 2) / 3 * 4;
+    }
+    else if (order == CL_QCOM_P010 && data_type == CL_QCOM_UNORM_INT10)
+    {
+        layout.num_planes    = 2;
+        layout.channel_bytes = 2;
+        layout.row_bytes[0]  = width * 2;
+    }
+    else if (order == CL_QCOM_BAYER && data_type == CL_QCOM_UNORM_MIPI10)
+    {
+        layout.channel_bytes = 1;
+        layout.row_bytes[0]  = width / 4 * 5;
+    }
+    else if (order == CL_QCOM_BAYER && data_type == CL_QCOM_UNORM_INT10)
+    {
+        layout.channel_bytes = 2;
+        layout.row_bytes[0]  = width * 2;
+    }
+    else if (order == CL_RGBA && data_type == CL_UNORM_INT8)
+    {
+        layout.channel_bytes = 1;
+        layout.row_bytes[0]  = width * 4;
+    }
+    else if (order == CL_R && data_type == CL_UNORM_INT16)
+    {
+        layout.channel_bytes = 2;
+        layout.row_bytes[0]  = width * 2;
+    }
+    else if (order == CL_R && data_type == CL_FLOAT)
+    {
+        layout.channel_bytes = 4;
+        layout.row_bytes[0]  = width * 4;
+    }
+    else
+    {
+        std::cerr << "Unsupported image data file format: order 0x" << std::hex << order
+                  << ", data type 0x" << data_type << std::dec << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (layout.num_planes == 2)
+    {
+        layout.row_bytes[1] = layout.row_bytes[0];
+        layout.num_rows[1]  = height / 2;
+    }
+
+    return layout;
+}
+
+/**
+ * Internal method for checking the data type and channel order in the header
+ * of an image data file. Exits if they aren't the desired ones.
+ */
+static void check_image_format(const std::string &filename, uint32_t data_type, uint32_t order,
+                               uint32_t desired_data_type, uint32_t desired_order)
+{
+    if (order != desired_order || data_type != desired_data_type)
+    {
+        std::cerr << "Expected channel order 0x" << std::hex << desired_order
+                  << " and data type 0x" << desired_data_type
+                  << " in " << filename << ", but found order 0x" << order
+                  << " and data type 0x" << data_type << std::dec << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Internal method for validating the header of an image data file that is
+ * accessed in place rather than loaded, e.g. mapped or streamed. Exits if the
+ * format isn't the desired one or the file holds too little pixel data.
+ *
+ * @param data_bytes - The size of the file after the header.
+ * @return The layout of the pixel data.
+ */
+static image_layout_t get_checked_image_layout(const std::string &filename, uint32_t width, uint32_t height,
+                                               uint32_t data_type, uint32_t order, uint32_t desired_data_type,
+                                               uint32_t desired_order, size_t data_bytes)
+{
+    if (data_type & IMAGE_DATA_COMPRESSED_FLAG)
+    {
+        std::cerr << filename << " is compressed, so it can only be loaded with the load_* functions\n";
+        std::exit(EXIT_FAILURE);
+    }
+    check_image_format(filename, data_type, order, desired_data_type, desired_order);
+
+    const image_layout_t layout = get_image_layout(width, height, data_type, order);
+
+    size_t expected_bytes = 0;
+    for (uint32_t plane = 0; plane < layout.num_planes; ++plane)
+    {
+        expected_bytes += layout.plane_bytes(plane);
+    }
+    if (data_bytes < expected_bytes)
+    {
+        std::cerr << "Error, expected " << expected_bytes << " bytes of image data in " << filename
+                  << " but only got " << data_bytes << ".\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    return layout;
+}
+
+mapped_image_view::mapped_image_view(const std::string &filename, cl_channel_type desired_data_type,
+                                     cl_channel_order desired_order)
+    : m_file(filename)
+{
+    if (m_file.size() < IMAGE_HEADER_BYTES)
+    {
+        std::cerr << filename << " is too small to hold an image data header\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    const unsigned char *header    = m_file.data();
+    const uint32_t       width     = load_le32(header);
+    const uint32_t       height    = load_le32(header + 4);
+    const uint32_t       data_type = load_le32(header + 8);
+    const uint32_t       order     = load_le32(header + 12);
+    m_layout = get_checked_image_layout(filename, width, height, data_type, order, desired_data_type, desired_order,
+                                        m_file.size() - IMAGE_HEADER_BYTES);
+}
+
+uint32_t mapped_image_view::width() const
+{
+    return m_layout.width;
+}
+
+uint32_t mapped_image_view::height() const
+{
+    return m_layout.height;
+}
+
+const image_layout_t &mapped_image_view::layout() const
+{
+    return m_layout;
+}
+
+const unsigned char *mapped_image_view::plane_data(uint32_t plane) const
+{
+    const unsigned char *data = m_file.data() + IMAGE_HEADER_BYTES;
+    return plane == 0 ? data : data + m_layout.plane_bytes(0);
+}
+
+size_t mapped_image_view::plane_size(uint32_t plane) const
+{
+    return plane < m_layout.num_planes ? m_layout.plane_bytes(plane) : 0;
+}
+
+image_band_reader::image_band_reader(const std::string &filename, cl_channel_type desired_data_type,
+                                     cl_channel_order desired_order, uint32_t band_rows)
+    : m_filename(filename)
+    , m_in(filename, std::ios::binary)
+    , m_band_rows(band_rows)
+    , m_next_band(0)
+{
+    if (!m_in)
+    {
+        std::cerr << "Can't open " << filename << " for reading\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    m_in.seekg(0, std::ios::end);
+    const size_t file_size = static_cast<size_t>(m_in.tellg());
+    m_in.seekg(0, std::ios::beg);
+    if (file_size < IMAGE_HEADER_BYTES)
+    {
+        std::cerr << filename << " is too small to hold an image data header\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    const uint32_t width     = read_le<uint32_t>(m_in);
+    const uint32_t height    = read_le<uint32_t>(m_in);
+    const uint32_t data_type = read_le<uint32_t>(m_in);
+    const uint32_t order     = read_le<uint32_t>(m_in);
+    m_layout = get_checked_image_layout(filename, width, height, data_type, order, desired_data_type, desired_order,
+                                        file_size - IMAGE_HEADER_BYTES);
+
+    if (band_rows == 0 || (m_layout.num_planes == 2 && band_rows % 2 != 0))
+    {
+        std::cerr << "Band height " << band_rows << " is invalid for " << filename
+                  << ", it must be positive" << (m_layout.num_planes == 2 ? " and even" : "") << ".\n";
+        std::exit(EXIT_FAILURE);
+    }
+    m_num_bands = (height + band_rows - 1) / band_rows;
+
+    if (m_num_bands > 0)
+    {
+        m_prefetch = std::async(std::launch::async, &image_band_reader::read_band, this, 0, std::ref(m_prefetched));
+    }
+}
+
+image_band_reader::~image_band_reader()
+{
+    if (m_prefetch.valid())
+    {
+        m_prefetch.wait();
+    }
+}
+
+uint32_t image_band_reader::width() const
+{
+    return m_layout.width;
+}
+
+uint32_t image_band_reader::height() const
+{
+    return m_layout.height;
+}
+
+const image_layout_t &image_band_reader::layout() const
+{
+    return m_layout;
+}
+
+uint32_t image_band_reader::band_rows() const
+{
+    return m_band_rows;
+}
+
+uint32_t image_band_reader::num_bands() const
+{
+    return m_num_bands;
+}
+
+bool image_band_reader::next_band(image_band_t &band)
+{
+    if (m_next_band >= m_num_bands)
+    {
+        return false;
+    }
+
+    m_prefetch.get();
+    std::swap(band.first_row, m_prefetched.first_row);
+    std::swap(band.num_rows, m_prefetched.num_rows);
+    band.planes[0].swap(m_prefetched.planes[0]);
+    band.planes[1].swap(m_prefetched.planes[1]);
+
+    ++m_next_band;
+    if (m_next_band < m_num_bands)
+    {
+        m_prefetch = std::async(std::launch::async, &image_band_reader::read_band, this, m_next_band,
+                                std::ref(m_prefetched));
+    }
+
+    return true;
+}
+
+void image_band_reader::read_band(uint32_t index, image_band_t &band)
+{
+    TRACE_FUNCTION();
+    // Plane 1 of a YUV 4:2:0 image has one row for every two rows of plane 0
+    const uint32_t first_row[2] = {index * m_band_rows, index * m_band_rows / 2};
+    const uint32_t max_rows[2]  = {m_band_rows, m_band_rows / 2};
+
+    band.first_row   = first_row[0];
+    band.num_rows[1] = 0;
+    band.planes[1].clear();
+
+    size_t plane_offset = IMAGE_HEADER_BYTES;
+    for (uint32_t plane = 0; plane < m_layout.num_planes; ++plane)
+    {
+        band.num_rows[plane] = std::min(max_rows[plane], m_layout.num_rows[plane] - first_row[plane]);
+        band.planes[plane].resize(band.num_rows[plane] * m_layout.row_bytes[plane]);
+
+        m_in.seekg(plane_offset + first_row[plane] * m_layout.row_bytes[plane]);
+        read_plane(m_in, m_layout.channel_bytes, band.planes[plane]);
+        plane_offset += m_layout.plane_bytes(plane);
+    }
+}
+
+void copy_band_plane(const image_band_t &band, uint32_t plane, unsigned char *dst, size_t dst_row_pitch)
+{
+    if (band.num_rows[plane] == 0)
+    {
+        return;
+    }
+
+    const size_t row_bytes = band.planes[plane].size() / band.num_rows[plane];
+    for (uint32_t row = 0; row < band.num_rows[plane]; ++row)
+    {
+        std::memcpy(dst + row * dst_row_pitch, band.planes[plane].data() + row * row_bytes, row_bytes);
+    }
+}
+
+void write_image_data_header(std::ostream &out, uint32_t width, uint32_t height, cl_channel_type data_type,
+                             cl_channel_order order)
+{
+    write_le<uint32_t>(out, width);
+    write_le<uint32_t>(out, height);
+    write_le<uint32_t>(out, data_type);
+    write_le<uint32_t>(out, order);
+}
+
+static const unsigned char FRAME_CONTAINER_MAGIC[4]     = {'Q', 'F', 'R', 'M'};
+static const uint32_t      FRAME_CONTAINER_VERSION      = 1;
+static const size_t        FRAME_CONTAINER_COUNT_POS    = IMAGE_HEADER_BYTES + 8;
+static const size_t        FRAME_CONTAINER_INDEX_POS    = IMAGE_HEADER_BYTES + 16;
+static const size_t        FRAME_CONTAINER_HEADER_BYTES = IMAGE_HEADER_BYTES + 24;
+
+frame_container::frame_container(const std::string &filename)
+    : m_file(filename)
+{
+    if (m_file.size() < FRAME_CONTAINER_HEADER_BYTES
+        || std::memcmp(m_file.data() + IMAGE_HEADER_BYTES, FRAME_CONTAINER_MAGIC, sizeof(FRAME_CONTAINER_MAGIC)) != 0)
+    {
+        std::cerr << filename << " is not a frame container\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    const unsigned char *header  = m_file.data();
+    const uint32_t       version = load_le32(header + IMAGE_HEADER_BYTES + 4);
+    if (version != FRAME_CONTAINER_VERSION)
+    {
+        std::cerr << "Unsupported frame container version " << version << " in " << filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    m_data_type  = load_le32(header + 8);
+    m_order      = load_le32(header + 12);
+    m_layout     = get_image_layout(load_le32(header), load_le32(header + 4), m_data_type, m_order);
+    m_num_frames = load_le32(header + FRAME_CONTAINER_COUNT_POS);
+    if (m_layout.num_planes != 2)
+    {
+        std::cerr << "Frame containers only hold YUV 4:2:0 frames, but " << filename << " holds order 0x"
+                  << std::hex << m_order << std::dec << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    const uint64_t index_offset = load_le64(header + FRAME_CONTAINER_INDEX_POS);
+    if (index_offset > m_file.size() || (m_file.size() - index_offset) / sizeof(uint64_t) < m_num_frames)
+    {
+        std::cerr << "The frame index of " << filename << " is truncated\n";
+        std::exit(EXIT_FAILURE);
+    }
+    m_index = header + index_offset;
+
+    const size_t frame_bytes = m_layout.plane_bytes(0) + m_layout.plane_bytes(1);
+    for (size_t i = 0; i < m_num_frames; ++i)
+    {
+        const uint64_t offset = load_le64(m_index + i * sizeof(uint64_t));
+        if (offset > m_file.size() || m_file.size() - offset < frame_bytes)
+        {
+            std::cerr << "Frame " << i << " of " << filename << " is truncated\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+}
+
+uint32_t frame_container::width() const
+{
+    return m_layout.width;
+}
+
+uint32_t frame_container::height() const
+{
+    return m_layout.height;
+}
+
+cl_channel_type frame_container::data_type() const
+{
+    return m_data_type;
+}
+
+cl_channel_order frame_container::order() const
+{
+    return m_order;
+}
+
+const image_layout_t &frame_container::layout() const
+{
+    return m_layout;
+}
+
+size_t frame_container::num_frames() const
+{
+    return m_num_frames;
+}
+
+const unsigned char *frame_container::frame_data(size_t index, uint32_t plane) const
+{
+    if (index >= m_num_frames)
+    {
+        std::cerr << "Frame " << index << " is out of range, " << m_file.filename() << " holds " << m_num_frames
+                  << " frames\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    const unsigned char *frame = m_file.data() + load_le64(m_index + index * sizeof(uint64_t));
+    return plane == 0 ? frame : frame + m_layout.plane_bytes(0);
+}
+
+/**
+ * Internal method for copying one frame out of a frame container.
+ */
+template <typename ImageType>
+static ImageType load_yuv_frame(const frame_container &container, size_t index, uint32_t data_type, uint32_t order)
+{
+    TRACE_FUNCTION();
+    if (container.order() != order || container.data_type() != data_type)
+    {
+        std::cerr << "Expected channel order 0x" << std::hex << order << " and data type 0x" << data_type
+                  << " in frame container, but found order 0x" << container.order()
+                  << " and data type 0x" << container.data_type() << std::dec << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    const image_layout_t &layout = container.layout();
+    ImageType             result;
+    result.y_width  = layout.width;
+    result.y_height = layout.height;
+    result.y_plane.assign(container.frame_data(index, 0), container.frame_data(index, 0) + layout.plane_bytes(0));
+    result.uv_plane.assign(container.frame_data(index, 1), container.frame_data(index, 1) + layout.plane_bytes(1));
+    if (!is_little_endian_host())
+    {
+        byte_swap_plane(result.y_plane.data(), result.y_plane.size(), layout.channel_bytes);
+        byte_swap_plane(result.uv_plane.data(), result.uv_plane.size(), layout.channel_bytes);
+    }
+
+    return result;
+}
+
+nv12_image_t load_nv12_frame(const frame_container &container, size_t index)
+{
+    return load_yuv_frame<nv12_image_t>(container, index, CL_UNORM_INT8, CL_QCOM_NV12);
+}
+
+tp10_image_t load_tp10_frame(const frame_container &container, size_t index)
+{
+    return load_yuv_frame<tp10_image_t>(container, index, CL_QCOM_UNORM_INT10, CL_QCOM_TP10);
+}
+
+p010_image_t load_p010_frame(const frame_container &container, size_t index)
+{
+    return load_yuv_frame<p010_image_t>(container, index, CL_QCOM_UNORM_INT10, CL_QCOM_P010);
+}
+
+frame_container_writer::frame_container_writer(const std::string &filename, uint32_t width, uint32_t height,
+                                               cl_channel_type data_type, cl_channel_order order)
+    : m_filename(filename)
+    , m_layout(get_image_layout(width, height, data_type, order))
+{
+    if (m_layout.num_planes != 2)
+    {
+        std::cerr << "Frame containers only hold YUV 4:2:0 frames, not order 0x" << std::hex << order << std::dec
+                  << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    const bool exists = std::ifstream(filename, std::ios::binary).peek() != std::char_traits<char>::eof();
+    if (!exists)
+    {
+        std::ofstream fout(filename, std::ios::binary | std::ios::trunc);
+        write_image_data_header(fout, width, height, data_type, order);
+        fout.write(reinterpret_cast<const char *>(FRAME_CONTAINER_MAGIC), sizeof(FRAME_CONTAINER_MAGIC));
+        write_le<uint32_t>(fout, FRAME_CONTAINER_VERSION);
+        write_le<uint32_t>(fout, 0); // frame count
+        write_le<uint32_t>(fout, 0); // reserved
+        write_le<uint64_t>(fout, FRAME_CONTAINER_HEADER_BYTES); // empty index
+        if (!fout)
+        {
+            std::cerr << "Can't open " << filename << " for writing.\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    m_file.open(filename, std::ios::binary | std::ios::in | std::ios::out);
+    if (!m_file)
+    {
+        std::cerr << "Can't open " << filename << " for writing.\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (exists)
+    {
+        const uint32_t file_width     = read_le<uint32_t>(m_file);
+        const uint32_t file_height    = read_le<uint32_t>(m_file);
+        const uint32_t file_data_type = read_le<uint32_t>(m_file);
+        const uint32_t file_order     = read_le<uint32_t>(m_file);
+        unsigned char  magic[sizeof(FRAME_CONTAINER_MAGIC)];
+        m_file.read(reinterpret_cast<char *>(magic), sizeof(magic));
+        const uint32_t version        = read_le<uint32_t>(m_file);
+        const uint32_t num_frames     = read_le<uint32_t>(m_file);
+        read_le<uint32_t>(m_file); // reserved
+        const uint64_t index_offset   = read_le<uint64_t>(m_file);
+        if (!m_file || std::memcmp(magic, FRAME_CONTAINER_MAGIC, sizeof(magic)) != 0
+            || version != FRAME_CONTAINER_VERSION)
+        {
+            std::cerr << filename << " exists but is not a frame container\n";
+            std::exit(EXIT_FAILURE);
+        }
+        if (file_width != width || file_height != height || file_data_type != data_type || file_order != order)
+        {
+            std::cerr << "Can't append " << width << "x" << height << " frames to " << filename << ", which holds "
+                      << file_width << "x" << file_height << " frames of another size or format\n";
+            std::exit(EXIT_FAILURE);
+        }
+
+        m_file.seekg(index_offset);
+        m_offsets.resize(num_frames);
+        for (auto &offset : m_offsets)
+        {
+            offset = read_le<uint64_t>(m_file);
+        }
+        if (!m_file)
+        {
+            std::cerr << "The frame index of " << filename << " is truncated\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    m_file.seekp(0, std::ios::end);
+}
+
+frame_container_writer::~frame_container_writer()
+{
+    close();
+}
+
+void frame_container_writer::append_frame(const yuv_image_t &frame)
+{
+    TRACE_FUNCTION();
+    if (!m_file.is_open())
+    {
+        std::cerr << "Can't append to " << m_filename << " after it was closed\n";
+        std::exit(EXIT_FAILURE);
+    }
+    if (frame.y_width != m_layout.width || frame.y_height != m_layout.height)
+    {
+        std::cerr << "Frame of size " << frame.y_width << "x" << frame.y_height << " doesn't match the "
+                  << m_layout.width << "x" << m_layout.height << " frames of " << m_filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+    // The planes are sized as the load_* functions make them, from get_image_layout
+    if (frame.y_plane.size() != m_layout.plane_bytes(0) || frame.uv_plane.size() != m_layout.plane_bytes(1))
+    {
+        std::cerr << "Frame planes of " << frame.y_plane.size() << " and " << frame.uv_plane.size()
+                  << " bytes don't match the " << m_layout.plane_bytes(0) << " and " << m_layout.plane_bytes(1)
+                  << " byte planes of the " << m_layout.width << "x" << m_layout.height << " frames of "
+                  << m_filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    m_offsets.push_back(static_cast<uint64_t>(m_file.tellp()));
+    write_plane(m_file, m_layout.channel_bytes, frame.y_plane.data(), frame.y_plane.size());
+    write_plane(m_file, m_layout.channel_bytes, frame.uv_plane.data(), frame.uv_plane.size());
+}
+
+size_t frame_container_writer::num_frames() const
+{
+    return m_offsets.size();
+}
+
+void frame_container_writer::close()
+{
+    if (!m_file.is_open())
+    {
+        return;
+    }
+
+    // The new index goes after the new frames; only then is the header pointed at it
+    m_file.seekp(0, std::ios::end);
+    const uint64_t index_offset = static_cast<uint64_t>(m_file.tellp());
+    for (const auto offset : m_offsets)
+    {
+        write_le<uint64_t>(m_file, offset);
+    }
+    m_file.flush();
+
+    m_file.seekp(FRAME_CONTAINER_COUNT_POS);
+    write_le<uint32_t>(m_file, static_cast<uint32_t>(m_offsets.size()));
+    m_file.seekp(FRAME_CONTAINER_INDEX_POS);
+    write_le<uint64_t>(m_file, index_offset);
+    m_file.flush();
+
+    if (!m_file)
+    {
+        std::cerr << "Error writing " << m_filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+    m_file.close();
+}
+
+pitched_planes_t get_ion_yuv_planes(const cl_mem_ion_host_ptr &ion_mem, size_t row_pitch, size_t padded_height)
+{
+    pitched_planes_t planes;
+    planes.data[0]      = static_cast<unsigned char *>(ion_mem.ion_hostptr);
+    planes.data[1]      = planes.data[0] + row_pitch * padded_height;
+    planes.row_pitch[0] = row_pitch;
+    planes.row_pitch[1] = row_pitch;
+    return planes;
+}
+
+/**
+ * Internal method for checking that pitched memory can hold the rows of an image.
+ */
+static void check_row_pitches(const image_layout_t &layout, const pitched_planes_t &planes, const std::string &filename)
+{
+    for (uint32_t plane = 0; plane < layout.num_planes; ++plane)
+    {
+        if (planes.row_pitch[plane] < layout.row_bytes[plane])
+        {
+            std::cerr << "Row pitch " << planes.row_pitch[plane] << " of plane " << plane << " is too small for the "
+                      << layout.row_bytes[plane] << "-byte rows of " << filename << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/**
+ * Internal method for checking that a YUV image fits in an ION buffer of the given padded height.
+ */
+static void check_padded_height(uint32_t height, size_t padded_height, const std::string &filename)
+{
+    if (padded_height < height)
+    {
+        std::cerr << "Padded height " << padded_height << " is less than the height " << height << " of "
+                  << filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Internal method for opening an image data file and reading its header.
+ * Leaves the stream at the start of the pixel data.
+ *
+ * @param compressed [out] - Set if the pixel data is compressed.
+ */
+static image_layout_t open_image_data(std::ifstream &fin, const std::string &filename, uint32_t desired_data_type,
+                                      uint32_t desired_order, bool &compressed)
+{
+    fin.open(filename, std::ios::binary);
+    if (!fin)
+    {
+        std::cerr << "Can't open " << filename << " for reading\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    const uint32_t width     = read_le<uint32_t>(fin);
+    const uint32_t height    = read_le<uint32_t>(fin);
+    const uint32_t data_type = read_le<uint32_t>(fin);
+    const uint32_t order     = read_le<uint32_t>(fin);
+    if (!fin)
+    {
+        std::cerr << filename << " is too small to hold an image data header\n";
+        std::exit(EXIT_FAILURE);
+    }
+    compressed = (data_type & IMAGE_DATA_COMPRESSED_FLAG) != 0;
+    check_image_format(filename, data_type & ~IMAGE_DATA_COMPRESSED_FLAG, order, desired_data_type, desired_order);
+
+    return get_image_layout(width, height, data_type & ~IMAGE_DATA_COMPRESSED_FLAG, order);
+}
+
+/**
+ * Internal method for reading the planes of an image data file into pitched
+ * memory. Rows are read, or decompressed, straight into their final position.
+ */
+static void read_pitched_planes(std::istream &in, const image_layout_t &layout, bool compressed,
+                                const pitched_planes_t &dst, const std::string &filename)
+{
+    if (compressed)
+    {
+        read_compressed_planes(in, layout, dst, filename);
+        return;
+    }
+
+    check_row_pitches(layout, dst, filename);
+
+    for (uint32_t plane = 0; plane < layout.num_planes; ++plane)
+    {
+        const size_t row_bytes = layout.row_bytes[plane];
+        const size_t row_pitch = dst.row_pitch[plane];
+        // Unpadded rows are contiguous, so the whole plane can be read at once
+        const uint32_t num_reads  = row_pitch == row_bytes ? 1 : layout.num_rows[plane];
+        const size_t   read_bytes = row_pitch == row_bytes ? layout.plane_bytes(plane) : row_bytes;
+        for (uint32_t i = 0; i < num_reads; ++i)
+        {
+            unsigned char *row = dst.data[plane] + i * row_pitch;
+            in.read(reinterpret_cast<char *>(row), read_bytes);
+            if (static_cast<size_t>(in.gcount()) != read_bytes)
+            {
+                std::cerr << "Error, " << filename << " is truncated in row " << i << " of plane " << plane << ".\n";
+                std::exit(EXIT_FAILURE);
+            }
+            if (!is_little_endian_host())
+            {
+                byte_swap_plane(row, read_bytes, layout.channel_bytes);
+            }
+        }
+    }
+}
+
+/**
+ * Internal method for loading a YUV image data file into an ION buffer.
+ */
+static void load_yuv_image_data_to_ion(const std::string &filename, uint32_t data_type, uint32_t order,
+                                       const cl_mem_ion_host_ptr &ion_mem, size_t row_pitch, size_t padded_height)
+{
+    TRACE_FUNCTION();
+    std::ifstream        fin;
+    bool                 compressed = false;
+    const image_layout_t layout     = open_image_data(fin, filename, data_type, order, compressed);
+    check_padded_height(layout.height, padded_height, filename);
+    read_pitched_planes(fin, layout, compressed, get_ion_yuv_planes(ion_mem, row_pitch, padded_height), filename);
+}
+
+image_layout_t read_image_data_layout(const std::string &filename, cl_channel_type desired_data_type,
+                                      cl_channel_order desired_order)
+{
+    std::ifstream fin;
+    bool          compressed = false;
+    return open_image_data(fin, filename, desired_data_type, desired_order, compressed);
+}
+
+image_layout_t load_image_data(const std::string &filename, cl_channel_type desired_data_type,
+                               cl_channel_order desired_order, const pitched_planes_t &dst)
+{
+    TRACE_FUNCTION();
+    std::ifstream        fin;
+    bool                 compressed = false;
+    const image_layout_t layout     = open_image_data(fin, filename, desired_data_type, desired_order, compressed);
+    read_pitched_planes(fin, layout, compressed, dst, filename);
+    return layout;
+}
+
+void save_image_data(const std::string &filename, uint32_t width, uint32_t height, cl_channel_type data_type,
+                     cl_channel_order order, const pitched_planes_t &src)
+{
+    TRACE_FUNCTION();
+    const image_layout_t layout = get_image_layout(width, height, data_type, order);
+    check_row_pitches(layout, src, filename);
+
+    std::ofstream fout(filename, std::ios::binary);
+    if (!fout)
+    {
+        std::cerr << "Can't open " << filename << " for writing.\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    write_image_data_header(fout, width, height, data_type, order);
+    for (uint32_t plane = 0; plane < layout.num_planes; ++plane)
+    {
+        const size_t row_bytes = layout.row_bytes[plane];
+        const size_t row_pitch = src.row_pitch[plane];
+        if (row_pitch == row_bytes)
+        {
+            write_plane(fout, layout.channel_bytes, src.data[plane], layout.plane_bytes(plane));
+            continue;
+        }
+        for (uint32_t i = 0; i < layout.num_rows[plane]; ++i)
+        {
+            write_plane(fout, layout.channel_bytes, src.data[plane] + i * row_pitch, row_bytes);
+        }
+    }
+}
+
+void load_nv12_image_data(const std::string &filename, const cl_mem_ion_host_ptr &ion_mem, size_t row_pitch,
+                          size_t padded_height)
+{
+    load_yuv_image_data_to_ion(filename, CL_UNORM_INT8, CL_QCOM_NV12, ion_mem, row_pitch, padded_height);
+}
+
+void save_nv12_image_data(const std::string &filename, uint32_t width, uint32_t height,
+                          const cl_mem_ion_host_ptr &ion_mem, size_t row_pitch, size_t padded_height)
+{
+    check_padded_height(height, padded_height, filename);
+    save_image_data(filename, width, height, CL_UNORM_INT8, CL_QCOM_NV12,
+                    get_ion_yuv_planes(ion_mem, row_pitch, padded_height));
+}
+
+void load_tp10_image_data(const std::string &filename, const cl_mem_ion_host_ptr &ion_mem, size_t row_pitch,
+                          size_t padded_height)
+{
+    load_yuv_image_data_to_ion(filename, CL_QCOM_UNORM_INT10, CL_QCOM_TP10, ion_mem, row_pitch, padded_height);
+}
+
+void save_tp10_image_data(const std::string &filename, uint32_t width, uint32_t height,
+                          const cl_mem_ion_host_ptr &ion_mem, size_t row_pitch, size_t padded_height)
+{
+    check_padded_height(height, padded_height, filename);
+    save_image_data(filename, width, height, CL_QCOM_UNORM_INT10, CL_QCOM_TP10,
+                    get_ion_yuv_planes(ion_mem, row_pitch, padded_height));
+}
+
+void load_p010_image_data(const std::string &filename, const cl_mem_ion_host_ptr &ion_mem, size_t row_pitch,
+                          size_t padded_height)
+{
+    load_yuv_image_data_to_ion(filename, CL_QCOM_UNORM_INT10, CL_QCOM_P010, ion_mem, row_pitch, padded_height);
+}
+
+void save_p010_image_data(const std::string &filename, uint32_t width, uint32_t height,
+                          const cl_mem_ion_host_ptr &ion_mem, size_t row_pitch, size_t padded_height)
+{
+    check_padded_height(height, padded_height, filename);
+    save_image_data(filename, width, height, CL_QCOM_UNORM_INT10, CL_QCOM_P010,
+                    get_ion_yuv_planes(ion_mem, row_pitch, padded_height));
+}
+
+/*************************
+ * Compressed image data *
+ *************************/
+
+// Compressed pixel data starts with four little-endian 32-bit values: this
+// version, the sample packing, the rows per group and the number of groups
+static const uint32_t IMAGE_CODEC_VERSION = 1;
+
+// Planes are split into groups of this many rows, which are coded independently
+static const uint32_t IMAGE_CODEC_GROUP_ROWS = 32;
+
+// Residuals are bit-packed in blocks of this many samples, all of the same width
+static const uint32_t IMAGE_CODEC_BLOCK_SAMPLES = 32;
+
+// Each group starts with its mode, sample shift and vertical and horizontal prediction distances
+static const size_t IMAGE_CODEC_GROUP_HEADER_BYTES = 4;
+
+// unpack_block reads whole 32-bit words, i.e. up to 3 bytes past the end of a block
+static const size_t IMAGE_CODEC_READ_PADDING = 4;
+
+/**
+ * \brief How the bytes of a row are split into samples of at most 16 bits.
+ */
+enum image_codec_packing_t
+{
+    PACKING_BYTES  = 0, // one sample per byte
+    PACKING_UINT16 = 1, // one sample per 16-bit channel
+    PACKING_TP10   = 2, // three 10-bit samples per 32-bit word
+    PACKING_MIPI10 = 3, // four 10-bit samples per 5 bytes
+};
+
+enum image_codec_group_mode_t
+{
+    GROUP_STORED    = 0, // the rows exactly as in an uncompressed file
+    GROUP_PREDICTED = 1, // bit-packed prediction residuals
+};
+
+static uint32_t get_packing(uint32_t data_type, uint32_t order, const image_layout_t &layout)
+{
+    if (data_type == CL_QCOM_UNORM_INT10 && order == CL_QCOM_TP10)
+    {
+        return PACKING_TP10;
+    }
+    if (data_type == CL_QCOM_UNORM_MIPI10)
+    {
+        return PACKING_MIPI10;
+    }
+    return layout.channel_bytes == 2 ? PACKING_UINT16 : PACKING_BYTES;
+}
+
+static uint32_t get_packing_bits(uint32_t packing)
+{
+    switch (packing)
+    {
+        case PACKING_BYTES:  return 8;
+        case PACKING_UINT16: return 16;
+        default:             return 10;
+    }
+}
+
+static size_t get_packing_unit_bytes(uint32_t packing)
+{
+    switch (packing)
+    {
+        case PACKING_BYTES:  return 1;
+        case PACKING_UINT16: return 2;
+        case PACKING_TP10:   return 4;
+        default:             return 5;
+    }
+}
+
+static size_t get_samples_per_row(uint32_t packing, size_t row_bytes)
+{
+    switch (packing)
+    {
+        case PACKING_BYTES:  return row_bytes;
+        case PACKING_UINT16: return row_bytes / 2;
+        case PACKING_TP10:   return row_bytes / 4 * 3;
+        default:             return row_bytes / 5 * 4;
+    }
+}
+
+/**
+ * Internal method for splitting a row of pixel data, in host byte order, into samples.
+ * @return false if the row can't be represented by its samples, i.e. if the
+ *         padding bits of a TP10 word are set.
+ */
+static bool unpack_samples(uint32_t packing, const unsigned char *row, size_t row_bytes, uint16_t *samples)
+{
+    switch (packing)
+    {
+        case PACKING_BYTES:
+        {
+            for (size_t i = 0; i < row_bytes; ++i)
+            {
+                samples[i] = row[i];
+            }
+            return true;
+        }
+        case PACKING_UINT16:
+        {
+            std::memcpy(samples, row, row_bytes);
+            return true;
+        }
+        case PACKING_TP10:
+        {
+            uint32_t padding = 0;
+            for (size_t i = 0; i < row_bytes / 4; ++i)
+            {
+                uint32_t word = 0;
+                std::memcpy(&word, row + i * 4, sizeof(word));
+                samples[i * 3]     = static_cast<uint16_t>(word & 0x3FF);
+                samples[i * 3 + 1] = static_cast<uint16_t>((word >> 10) & 0x3FF);
+                samples[i * 3 + 2] = static_cast<uint16_t>((word >> 20) & 0x3FF);
+                padding |= word >> 30;
+            }
+            return padding == 0;
+        }
+        default:
+        {
+            for (size_t i = 0; i < row_bytes / 5; ++i)
+            {
+                const unsigned char *group = row + i * 5;
+                for (uint32_t j = 0; j < 4; ++j)
+                {
+                    samples[i * 4 + j] = static_cast<uint16_t>((group[j] << 2) | ((group[4] >> (j * 2)) & 3));
+                }
+            }
+            return true;
+        }
+    }
+}
+
+/**
+ * Internal method for reassembling a row of pixel data, in host byte order,
+ * from samples that were shifted right by the given number of bits.
+ */
+static void pack_samples(uint32_t packing, const uint16_t *samples, uint32_t shift, unsigned char *row,
+                         size_t row_bytes)
+{
+    switch (packing)
+    {
+        case PACKING_BYTES:
+        {
+            for (size_t i = 0; i < row_bytes; ++i)
+            {
+                row[i] = static_cast<unsigned char>(samples[i] << shift);
+            }
+            break;
+        }
+        case PACKING_UINT16:
+        {
+            for (size_t i = 0; i < row_bytes / 2; ++i)
+            {
+                const uint16_t sample = static_cast<uint16_t>(samples[i] << shift);
+                std::memcpy(row + i * 2, &sample, sizeof(sample));
+            }
+            break;
+        }
+        case PACKING_TP10:
+        {
+            for (size_t i = 0; i < row_bytes / 4; ++i)
+            {
+                const uint32_t word = (static_cast<uint32_t>(samples[i * 3]) << shift)
+                                      | (static_cast<uint32_t>(samples[i * 3 + 1]) << (shift + 10))
+                                      | (static_cast<uint32_t>(samples[i * 3 + 2]) << (shift + 20));
+                std::memcpy(row + i * 4, &word, sizeof(word));
+            }
+            break;
+        }
+        default:
+        {
+            for (size_t i = 0; i < row_bytes / 5; ++i)
+            {
+                const uint32_t s0    = static_cast<uint32_t>(samples[i * 4]) << shift;
+                const uint32_t s1    = static_cast<uint32_t>(samples[i * 4 + 1]) << shift;
+                const uint32_t s2    = static_cast<uint32_t>(samples[i * 4 + 2]) << shift;
+                const uint32_t s3    = static_cast<uint32_t>(samples[i * 4 + 3]) << shift;
+                unsigned char *group = row + i * 5;
+                group[0] = static_cast<unsigned char>(s0 >> 2);
+                group[1] = static_cast<unsigned char>(s1 >> 2);
+                group[2] = static_cast<unsigned char>(s2 >> 2);
+                group[3] = static_cast<unsigned char>(s3 >> 2);
+                group[4] = static_cast<unsigned char>((s0 & 3) | ((s1 & 3) << 2) | ((s2 & 3) << 4) | ((s3 & 3) << 6));
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * Internal method for choosing which earlier sample predicts each sample of a
+ * plane: the one v_step rows above, or in the first rows of a group, the one
+ * h_step samples to the left. Both are the nearest sample of the same color
+ * channel, e.g. Bayer rows and columns alternate between two colors.
+ */
+static void get_prediction_steps(uint32_t order, uint32_t packing, const image_layout_t &layout, uint32_t plane,
+                                 uint32_t &v_step, uint32_t &h_step)
+{
+    const bool   bayer             = order == CL_QCOM_BAYER;
+    const size_t samples_per_pixel = std::max<size_t>(
+        1, get_samples_per_row(packing, layout.row_bytes[plane]) / std::max<uint32_t>(1, layout.width));
+    v_step = bayer ? 2 : 1;
+    h_step = static_cast<uint32_t>(samples_per_pixel * (bayer || plane == 1 ? 2 : 1));
+}
+
+/**
+ * Internal method for finding the plane and first row of a group of rows.
+ */
+static void locate_group(const image_layout_t &layout, uint32_t group_rows, size_t index, uint32_t &plane,
+                         uint32_t &first_row)
+{
+    const size_t plane0_groups = work_units(layout.num_rows[0], group_rows);
+    plane     = index < plane0_groups ? 0 : 1;
+    first_row = static_cast<uint32_t>((index - plane * plane0_groups) * group_rows);
+}
+
+/**
+ * Internal method for appending a block of residuals to a compressed group,
+ * each stored in the given number of bits, least significant bit first.
+ */
+static void pack_block(const uint16_t *residuals, uint32_t bits, std::vector<unsigned char> &out)
+{
+    uint64_t acc      = 0;
+    uint32_t acc_bits = 0;
+    for (uint32_t i = 0; i < IMAGE_CODEC_BLOCK_SAMPLES; ++i)
+    {
+        acc |= static_cast<uint64_t>(residuals[i]) << acc_bits;
+        acc_bits += bits;
+        for (; acc_bits >= 8; acc_bits -= 8, acc >>= 8)
+        {
+            out.push_back(static_cast<unsigned char>(acc));
+        }
+    }
+}
+
+/**
+ * Internal method for unpacking a block written by pack_block. The width is a
+ * template parameter so that the loop is fully unrolled and vectorized.
+ */
+template <uint32_t Bits>
+static void unpack_block(const unsigned char *in, uint16_t *residuals)
+{
+    for (uint32_t i = 0; i < IMAGE_CODEC_BLOCK_SAMPLES; ++i)
+    {
+        const uint32_t bit = i * Bits;
+        residuals[i] = static_cast<uint16_t>((load_le32(in + bit / 8) >> (bit % 8)) & ((1u << Bits) - 1));
+    }
+}
+
+typedef void (*unpack_block_function)(const unsigned char *, uint16_t *);
+
+static const unpack_block_function UNPACK_BLOCK[] = {
+    unpack_block<0>,  unpack_block<1>,  unpack_block<2>,  unpack_block<3>,  unpack_block<4>,  unpack_block<5>,
+    unpack_block<6>,  unpack_block<7>,  unpack_block<8>,  unpack_block<9>,  unpack_block<10>, unpack_block<11>,
+    unpack_block<12>, unpack_block<13>, unpack_block<14>, unpack_block<15>, unpack_block<16>,
+};
+
+/**
+ * Internal method for compressing a group of rows of one plane.
+ *
+ * Each sample is predicted from an earlier one as described for
+ * get_prediction_steps, and the difference is zigzag-coded so that small
+ * differences of either sign become small residuals. Low bits that are zero
+ * in every sample, e.g. the padding of P010, are dropped first. If this
+ * doesn't make the group smaller, it is stored as is.
+ */
+static void encode_group(uint32_t packing, uint32_t channel_bytes, const unsigned char *src, size_t src_pitch,
+                         size_t row_bytes, uint32_t num_rows, uint32_t v_step, uint32_t h_step,
+                         std::vector<unsigned char> &out)
+{
+    const size_t          samples_per_row = get_samples_per_row(packing, row_bytes);
+    std::vector<uint16_t> samples(samples_per_row * num_rows);
+    bool                  representable = true;
+    uint32_t              all_bits      = 0;
+    for (uint32_t row = 0; row < num_rows; ++row)
+    {
+        representable &= unpack_samples(packing, src + row * src_pitch, row_bytes, &samples[row * samples_per_row]);
+    }
+    for (const auto sample : samples)
+    {
+        all_bits |= sample;
+    }
+
+    const uint32_t bits  = get_packing_bits(packing);
+    uint32_t       shift = 0;
+    while (shift + 1 < bits && ((all_bits >> shift) & 1) == 0)
+    {
+        ++shift;
+    }
+    const uint32_t mask = (1u << (bits - shift)) - 1;
+
+    out.clear();
+    out.push_back(GROUP_PREDICTED);
+    out.push_back(static_cast<unsigned char>(shift));
+    out.push_back(static_cast<unsigned char>(v_step));
+    out.push_back(static_cast<unsigned char>(h_step));
+
+    const size_t          num_blocks = work_units(samples_per_row, IMAGE_CODEC_BLOCK_SAMPLES);
+    std::vector<uint16_t> residuals(num_blocks * IMAGE_CODEC_BLOCK_SAMPLES, 0);
+    for (uint32_t row = 0; row < num_rows && representable; ++row)
+    {
+        const uint16_t *cur = &samples[row * samples_per_row];
+        const uint16_t *up  = row >= v_step ? cur - v_step * samples_per_row : NULL;
+        for (size_t i = 0; i < samples_per_row; ++i)
+        {
+            const uint32_t pred = up ? up[i] >> shift : (i >= h_step ? cur[i - h_step] >> shift : 0);
+            const uint32_t diff = ((cur[i] >> shift) - pred) & mask;
+            residuals[i] = static_cast<uint16_t>(diff <= mask / 2 ? diff * 2 : (mask - diff) * 2 + 1);
+        }
+        for (size_t block = 0; block < num_blocks; ++block)
+        {
+            const uint16_t *block_residuals = &residuals[block * IMAGE_CODEC_BLOCK_SAMPLES];
+            uint32_t        max_residual    = 0;
+            for (uint32_t i = 0; i < IMAGE_CODEC_BLOCK_SAMPLES; ++i)
+            {
+                max_residual |= block_residuals[i];
+            }
+            uint32_t width = 0;
+            for (; max_residual >> width; ++width) {}
+            out.push_back(static_cast<unsigned char>(width));
+            pack_block(block_residuals, width, out);
+        }
+    }
+
+    if (representable && out.size() < IMAGE_CODEC_GROUP_HEADER_BYTES + row_bytes * num_rows)
+    {
+        return;
+    }
+
+    out.assign(IMAGE_CODEC_GROUP_HEADER_BYTES, 0);
+    out[0] = GROUP_STORED;
+    for (uint32_t row = 0; row < num_rows; ++row)
+    {
+        out.insert(out.end(), src + row * src_pitch, src + row * src_pitch + row_bytes);
+    }
+    if (!is_little_endian_host())
+    {
+        byte_swap_plane(out.data() + IMAGE_CODEC_GROUP_HEADER_BYTES, row_bytes * num_rows, channel_bytes);
+    }
+}
+
+/**
+ * Internal method for decompressing a group written by encode_group.
+ *
+ * @param in - The compressed group, followed by at least IMAGE_CODEC_READ_PADDING readable bytes.
+ * @return false if the group is corrupt.
+ */
+static bool decode_group(const unsigned char *in, size_t in_bytes, uint32_t packing, uint32_t channel_bytes,
+                         unsigned char *dst, size_t dst_pitch, size_t row_bytes, uint32_t num_rows)
+{
+    if (in_bytes < IMAGE_CODEC_GROUP_HEADER_BYTES)
+    {
+        return false;
+    }
+    const uint32_t       mode   = in[0];
+    const uint32_t       shift  = in[1];
+    const uint32_t       v_step = in[2];
+    const uint32_t       h_step = in[3];
+    const unsigned char *end    = in + in_bytes;
+    in += IMAGE_CODEC_GROUP_HEADER_BYTES;
+
+    if (mode == GROUP_STORED)
+    {
+        if (static_cast<size_t>(end - in) != row_bytes * num_rows)
+        {
+            return false;
+        }
+        for (uint32_t row = 0; row < num_rows; ++row)
+        {
+            std::memcpy(dst + row * dst_pitch, in + row * row_bytes, row_bytes);
+            if (!is_little_endian_host())
+            {
+                byte_swap_plane(dst + row * dst_pitch, row_bytes, channel_bytes);
+            }
+        }
+        return true;
+    }
+
+    const uint32_t bits = get_packing_bits(packing);
+    if (mode != GROUP_PREDICTED || shift >= bits || v_step == 0 || h_step == 0)
+    {
+        return false;
+    }
+    const uint32_t value_bits = bits - shift;
+    const uint32_t mask       = (1u << value_bits) - 1;
+
+    // Only the rows that are still to be predicted from are kept
+    const size_t          samples_per_row = get_samples_per_row(packing, row_bytes);
+    const size_t          num_blocks      = work_units(samples_per_row, IMAGE_CODEC_BLOCK_SAMPLES);
+    std::vector<uint16_t> residuals(num_blocks * IMAGE_CODEC_BLOCK_SAMPLES);
+    std::vector<uint16_t> samples((v_step + 1) * samples_per_row);
+    for (uint32_t row = 0; row < num_rows; ++row)
+    {
+        for (size_t block = 0; block < num_blocks; ++block)
+        {
+            const uint32_t width = in < end ? *in++ : bits + 1;
+            if (width > value_bits || static_cast<size_t>(end - in) < width * IMAGE_CODEC_BLOCK_SAMPLES / 8)
+            {
+                return false;
+            }
+            UNPACK_BLOCK[width](in, &residuals[block * IMAGE_CODEC_BLOCK_SAMPLES]);
+            in += width * IMAGE_CODEC_BLOCK_SAMPLES / 8;
+        }
+
+        uint16_t *cur = &samples[(row % (v_step + 1)) * samples_per_row];
+        if (row >= v_step)
+        {
+            const uint16_t *up = &samples[((row - v_step) % (v_step + 1)) * samples_per_row];
+            for (size_t i = 0; i < samples_per_row; ++i)
+            {
+                const uint32_t diff = (residuals[i] >> 1) ^ (0u - (residuals[i] & 1u));
+                cur[i] = static_cast<uint16_t>((up[i] + diff) & mask);
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < samples_per_row; ++i)
+            {
+                const uint32_t diff = (residuals[i] >> 1) ^ (0u - (residuals[i] & 1u));
+                const uint32_t pred = i >= h_step ? cur[i - h_step] : 0;
+                cur[i] = static_cast<uint16_t>((pred + diff) & mask);
+            }
+        }
+        pack_samples(packing, cur, shift, dst + row * dst_pitch, row_bytes);
+    }
+    return in == end;
+}
+
+/**
+ * Internal method for the number of bytes left to read in a stream, or SIZE_MAX if it can't seek.
+ */
+static size_t get_remaining_bytes(std::istream &in)
+{
+    const std::istream::pos_type here = in.tellg();
+    if (here == std::istream::pos_type(-1) || !in.seekg(0, std::ios::end))
+    {
+        in.clear();
+        return SIZE_MAX;
+    }
+    const std::istream::pos_type end = in.tellg();
+    in.seekg(here);
+    return end > here ? static_cast<size_t>(end - here) : 0;
+}
+
+static void read_compressed_planes(std::istream &in, const image_layout_t &layout, const pitched_planes_t &dst,
+                                   const std::string &filename)
+{
+    check_row_pitches(layout, dst, filename);
+
+    const uint32_t version    = read_le<uint32_t>(in);
+    const uint32_t packing    = read_le<uint32_t>(in);
+    const uint32_t group_rows = read_le<uint32_t>(in);
+    const uint32_t num_groups = read_le<uint32_t>(in);
+    if (!in || version != IMAGE_CODEC_VERSION)
+    {
+        std::cerr << "Unsupported compressed image data in " << filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    bool valid = packing <= PACKING_MIPI10 && group_rows > 0
+                 && num_groups == work_units(layout.num_rows[0], group_rows) + work_units(layout.num_rows[1], group_rows);
+    for (uint32_t plane = 0; valid && plane < layout.num_planes; ++plane)
+    {
+        valid = layout.row_bytes[plane] % get_packing_unit_bytes(packing) == 0;
+    }
+
+    // Check the header against the file before sizing anything by it, so a corrupt one can't force a huge allocation
+    const size_t remaining = get_remaining_bytes(in);
+    valid = valid && num_groups <= remaining / sizeof(uint32_t);
+    if (!valid)
+    {
+        std::cerr << "The compressed image data header of " << filename << " is corrupt\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::vector<size_t> offsets(num_groups + 1, 0);
+    for (uint32_t i = 0; i < num_groups; ++i)
+    {
+        offsets[i + 1] = offsets[i] + read_le<uint32_t>(in);
+    }
+    if (!in || offsets.back() > remaining - num_groups * sizeof(uint32_t))
+    {
+        std::cerr << "The compressed image data header of " << filename << " is corrupt\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::vector<unsigned char> payload(offsets.back() + IMAGE_CODEC_READ_PADDING, 0);
+    in.read(reinterpret_cast<char *>(payload.data()), offsets.back());
+    if (static_cast<size_t>(in.gcount()) != offsets.back())
+    {
+        std::cerr << "Error, expected " << offsets.back() << " bytes of compressed image data in " << filename
+                  << " but only got " << in.gcount() << ".\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::atomic<bool> corrupt(false);
+    parallel_for(num_groups, [&](size_t i)
+    {
+        uint32_t plane     = 0;
+        uint32_t first_row = 0;
+        locate_group(layout, group_rows, i, plane, first_row);
+        const uint32_t num_rows = std::min(group_rows, layout.num_rows[plane] - first_row);
+        if (!decode_group(payload.data() + offsets[i], offsets[i + 1] - offsets[i], packing, layout.channel_bytes,
+                          dst.data[plane] + first_row * dst.row_pitch[plane], dst.row_pitch[plane],
+                          layout.row_bytes[plane], num_rows))
+        {
+            corrupt = true;
+        }
+    });
+    if (corrupt)
+    {
+        std::cerr << "The compressed image data in " << filename << " is corrupt\n";
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+void save_compressed_image_data(const std::string &filename, uint32_t width, uint32_t height,
+                                cl_channel_type data_type, cl_channel_order order, const pitched_planes_t &src)
+{
+    TRACE_FUNCTION();
+    const image_layout_t layout = get_image_layout(width, height, data_type, order);
+    check_row_pitches(layout, src, filename);
+
+    const uint32_t packing    = get_packing(data_type, order, layout);
+    const size_t   num_groups = work_units(layout.num_rows[0], IMAGE_CODEC_GROUP_ROWS)
+                                + work_units(layout.num_rows[1], IMAGE_CODEC_GROUP_ROWS);
+    std::vector<std::vector<unsigned char>> groups(num_groups);
+    parallel_for(num_groups, [&](size_t i)
+    {
+        uint32_t plane     = 0;
+        uint32_t first_row = 0;
+        uint32_t v_step    = 0;
+        uint32_t h_step    = 0;
+        locate_group(layout, IMAGE_CODEC_GROUP_ROWS, i, plane, first_row);
+        get_prediction_steps(order, packing, layout, plane, v_step, h_step);
+        encode_group(packing, layout.channel_bytes, src.data[plane] + first_row * src.row_pitch[plane],
+                     src.row_pitch[plane], layout.row_bytes[plane],
+                     std::min(IMAGE_CODEC_GROUP_ROWS, layout.num_rows[plane] - first_row), v_step, h_step, groups[i]);
+    });
+
+    std::ofstream fout(filename, std::ios::binary);
+    if (!fout)
+    {
+        std::cerr << "Can't open " << filename << " for writing.\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    write_image_data_header(fout, width, height, data_type | IMAGE_DATA_COMPRESSED_FLAG, order);
+    write_le<uint32_t>(fout, IMAGE_CODEC_VERSION);
+    write_le<uint32_t>(fout, packing);
+    write_le<uint32_t>(fout, IMAGE_CODEC_GROUP_ROWS);
+    write_le<uint32_t>(fout, static_cast<uint32_t>(num_groups));
+    for (const auto &group : groups)
+    {
+        write_le<uint32_t>(fout, static_cast<uint32_t>(group.size()));
+    }
+    for (const auto &group : groups)
+    {
+        fout.write(reinterpret_cast<const char *>(group.data()), group.size());
+    }
+}
+
+size_t work_units(size_t x, size_t r)
+{
+    return (x + r - 1) / r;
+}
+
+void parallel_for(size_t count, const std::function<void(size_t)> &body)
+{
+    const size_t num_threads = std::min<size_t>(count, std::max(1u, std::thread::hardware_concurrency()));
+    if (num_threads <= 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            body(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    const auto worker = [&]()
+    {
+        for (size_t i = next++; i < count; i = next++)
+        {
+            body(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < num_threads; ++i)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+std::string json_escape(const std::string &str)
+{
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+
+    std::string result;
+    result.reserve(str.size());
+    for (const char c : str)
+    {
+        const unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\')
+        {
+            result += '\\';
+            result += c;
+        }
+        else if (byte < 0x20)
+        {
+            result += "\\u00";
+            result += HEX_DIGITS[byte >> 4];
+            result += HEX_DIGITS[byte & 0xf];
+        }
+        else
+        {
+            result += c;
+        }
+    }
+    return result;
+}
+
+double nearest_rank_percentile(const std::vector<double> &sorted, double fraction)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    const size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+    return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+void add_reservoir_sample(std::vector<double> &samples, size_t max_samples, size_t count, double sample,
+                          std::minstd_rand &random)
+{
+    if (samples.size() < max_samples)
+    {
+        samples.push_back(sample);
+        return;
+    }
+
+    // The count-th sample replaces a kept one with probability max_samples / count
+    const size_t slot = std::uniform_int_distribution<size_t>(0, count - 1)(random);
+    if (slot < max_samples)
+    {
+        samples[slot] = sample;
+    }
+}
+
+static const unsigned char MATRIX_BINARY_MAGIC[4]    = {'Q', 'M', 'A', 'T'};
+static const uint32_t      MATRIX_BINARY_VERSION      = 1;
+static const size_t        MATRIX_BINARY_HEADER_BYTES = 8 * sizeof(uint32_t);
+
+/**
+ * \brief Checks whether the file starts with the binary matrix magic number.
+ *        Text matrices always start with a digit or whitespace, so can't match.
+ */
+static bool is_binary_matrix_file(const std::string &filename)
+{
+    std::ifstream fin(filename, std::ios::binary);
+    if (!fin)
+    {
+        std::cerr << "Can't open " << filename << " for reading\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    unsigned char magic[sizeof(MATRIX_BINARY_MAGIC)];
+    fin.read(reinterpret_cast<char *>(magic), sizeof(magic));
+    return fin.gcount() == sizeof(magic) && std::memcmp(magic, MATRIX_BINARY_MAGIC, sizeof(magic)) == 0;
+}
+
+static uint16_t load_le16(const unsigned char *bytes)
+{
+    return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+static cl_float float_from_bits(uint32_t bits)
+{
+    cl_float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+template <typename ElementType>
+static void copy_elements(const ElementType *src, ElementType *dst, size_t n)
+{
+    std::copy(src, src + n, dst);
+}
+
+/**
+ * Internal method for loading a binary matrix from a mapped file. The stored
+ * elements may be floats or half floats; from_floats and from_halves convert
+ * a run of either one into the element type of MatrixType, e.g. to_half_n.
+ * element_data_type is the data type of MatrixType's elements, CL_FLOAT or
+ * CL_HALF_FLOAT; for any other element type, such as bfloat16, pass 0.
+ *
+ * When no conversion is needed and the host is little-endian each row is
+ * copied straight out of the mapping. Otherwise whole rows are converted at
+ * once, straight out of the mapping if the host is little-endian.
+ */
+template <typename MatrixType, typename FromFloats, typename FromHalves>
+static MatrixType load_binary_matrix(const std::string &filename, cl_uint element_data_type, FromFloats from_floats,
+                                     FromHalves from_halves)
+{
+    typedef typename std::remove_reference<decltype(MatrixType().elements[0])>::type element_t;
+
+    const mapped_file file(filename);
+    if (file.size() < MATRIX_BINARY_HEADER_BYTES)
+    {
+        std::cerr << filename << " is too small to hold a binary matrix header\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    const unsigned char *header     = file.data();
+    const uint32_t       version    = load_le32(header + 4);
+    const uint32_t       width      = load_le32(header + 8);
+    const uint32_t       height     = load_le32(header + 12);
+    const uint32_t       data_type  = load_le32(header + 16);
+    const uint32_t       row_stride = load_le32(header + 20);
+    if (version != MATRIX_BINARY_VERSION)
+    {
+        std::cerr << "Unsupported binary matrix version " << version << " in " << filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+    if (data_type != CL_FLOAT && data_type != CL_HALF_FLOAT)
+    {
+        std::cerr << "Expected CL_FLOAT or CL_HALF_FLOAT elements in " << filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+    if (row_stride < width)
+    {
+        std::cerr << "Row stride " << row_stride << " is less than width " << width << " in " << filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    const size_t element_bytes = data_type == CL_FLOAT ? sizeof(cl_float) : sizeof(cl_half);
+    const size_t row_bytes     = static_cast<size_t>(row_stride) * element_bytes;
+    const size_t data_bytes    = height == 0 ? 0 : (height - 1) * row_bytes + width * element_bytes;
+    if (file.size() - MATRIX_BINARY_HEADER_BYTES < data_bytes)
+    {
+        std::cerr << "Error, expected " << data_bytes << " bytes of matrix data in " << filename
+                  << " but only got " << file.size() - MATRIX_BINARY_HEADER_BYTES << ".\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    MatrixType res;
+    res.width  = static_cast<int>(width);
+    res.height = static_cast<int>(height);
+    res.elements.resize(static_cast<size_t>(width) * height);
+
+    const bool            same_type = data_type == element_data_type;
+    std::vector<cl_float> swapped_floats(is_little_endian_host() ? 0 : width);
+    std::vector<cl_half>  swapped_halves(is_little_endian_host() ? 0 : width);
+    for (size_t row = 0; row < height; ++row)
+    {
+        const unsigned char *src = file.data() + MATRIX_BINARY_HEADER_BYTES + row * row_bytes;
+        element_t           *dst = res.elements.data() + row * width;
+        if (same_type && is_little_endian_host())
+        {
+            std::memcpy(dst, src, width * element_bytes);
+        }
+        else if (data_type == CL_FLOAT)
+        {
+            const cl_float *floats = reinterpret_cast<const cl_float *>(src);
+            if (!is_little_endian_host())
+            {
+                for (size_t col = 0; col < width; ++col)
+                {
+                    swapped_floats[col] = float_from_bits(load_le32(src + col * element_bytes));
+                }
+                floats = swapped_floats.data();
+            }
+            from_floats(floats, dst, width);
+        }
+        else
+        {
+            const cl_half *halves = reinterpret_cast<const cl_half *>(src);
+            if (!is_little_endian_host())
+            {
+                for (size_t col = 0; col < width; ++col)
+                {
+                    swapped_halves[col] = static_cast<cl_half>(load_le16(src + col * element_bytes));
+                }
+                halves = swapped_halves.data();
+            }
+            from_halves(halves, dst, width);
+        }
+    }
+
+    return res;
+}
+
+static bool is_space(char c)
+{
+    // '\t', '\n', '\v', '\f' and '\r' are consecutive
+    return c == ' ' || static_cast<unsigned char>(c - '\t') <= '\r' - '\t';
+}
+
+static bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/**
+ * \brief Parses a decimal integer, skipping leading whitespace, and advances pos past it.
+ */
+static bool parse_int(const char *text, size_t len, size_t &pos, int &value)
+{
+    while (pos < len && is_space(text[pos]))
+    {
+        ++pos;
+    }
+
+    const bool negative = pos < len && text[pos] == '-';
+    if (pos < len && (text[pos] == '-' || text[pos] == '+'))
+    {
+        ++pos;
+    }
+
+    const size_t start = pos;
+    long long    result = 0;
+    while (pos < len && is_digit(text[pos]) && result <= INT32_MAX)
+    {
+        result = result * 10 + (text[pos] - '0');
+        ++pos;
+    }
+    value = static_cast<int>(negative ? -result : result);
+    return pos > start && result <= INT32_MAX;
+}
+
+/**
+ * \brief Computes the float nearest to mantissa * 10^exponent, if that can be
+ *        done cheaply and provably correctly.
+ *
+ * The value is computed in double precision with one multiply or divide by a
+ * power of ten. With at most 15 significant digits and a decimal exponent
+ * within +/-22 both operands are exact, so the double is correctly rounded.
+ * Otherwise it is within a few units in its last place of the exact value,
+ * and a double has 29 more bits than a float, so rounding it to float gives
+ * the correctly rounded float unless it lies that close to a point halfway
+ * between two floats.
+ *
+ * @return false for values near a halfway point, subnormals that aren't
+ *         exact, overflow and inputs out of range, which the caller must
+ *         handle some other way.
+ */
+static bool decimal_to_float(uint64_t mantissa, int exponent, cl_float &value)
+{
+    static const double   POWERS_OF_TEN[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22, 1e23,
+        1e24, 1e25, 1e26, 1e27, 1e28, 1e29, 1e30, 1e31, 1e32, 1e33, 1e34, 1e35,
+        1e36, 1e37, 1e38, 1e39, 1e40, 1e41, 1e42, 1e43, 1e44, 1e45, 1e46, 1e47,
+        1e48, 1e49, 1e50, 1e51, 1e52, 1e53, 1e54, 1e55, 1e56, 1e57, 1e58, 1e59,
+        1e60, 1e61, 1e62, 1e63, 1e64
+    };
+    static const int      MAX_EXACT_EXPONENT = 22;
+    static const uint64_t MAX_EXACT_MANTISSA = 999999999999999ull;
+    static const int      MAX_EXPONENT       = 64;
+    static const uint64_t HALFWAY            = 1ull << 28;
+    static const uint64_t MAX_ERROR          = 8;
+
+    if (mantissa == 0)
+    {
+        value = 0.f;
+        return true;
+    }
+    if (exponent < -MAX_EXPONENT || exponent > MAX_EXPONENT)
+    {
+        return false;
+    }
+
+    const bool   exact = mantissa <= MAX_EXACT_MANTISSA && exponent >= -MAX_EXACT_EXPONENT
+                         && exponent <= MAX_EXACT_EXPONENT;
+    const double m     = static_cast<double>(mantissa);
+    const double d     = exponent < 0 ? m / POWERS_OF_TEN[-exponent] : m * POWERS_OF_TEN[exponent];
+    const float  f     = static_cast<float>(d);
+    bool near_halfway  = false;
+    if (d >= FLT_MIN)
+    {
+        // A double halfway between two normal floats has exactly the top bit set of the 29 bits floats lack
+        uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        const uint64_t low = bits & ((1ull << 29) - 1);
+        near_halfway       = exact ? low == HALFWAY : low + MAX_ERROR >= HALFWAY && low <= HALFWAY + MAX_ERROR;
+    }
+    else if (!exact)
+    {
+        return false;
+    }
+    else if (static_cast<double>(f) != d)
+    {
+        const float neighbor = std::nextafter(f, static_cast<double>(f) < d ? HUGE_VALF : -HUGE_VALF);
+        near_halfway         = d == (static_cast<double>(f) + static_cast<double>(neighbor)) / 2;
+    }
+
+    value = f;
+    return !near_halfway && !std::isinf(f);
+}
+
+/**
+ * \brief Internal method for strtof in the "C" locale, so that '.' is the
+ *        decimal point even if the program has called setlocale.
+ */
+static cl_float strtof_c_locale(const char *str, char **end)
+{
+    static const locale_t c_locale = newlocale(LC_ALL_MASK, "C", static_cast<locale_t>(0));
+    return strtof_l(str, end, c_locale);
+}
+
+/**
+ * \brief Parses the whitespace-delimited floating point token that starts at
+ *        text[pos], without using the locale, and advances pos past it.
+ *
+ * The digits are read straight from the text, so the end of the token is
+ * only searched for separately when it can't be converted on the fast path.
+ *
+ * Most tokens are converted by decimal_to_float. The rest, e.g. values near
+ * a tie or long mantissas, are handed to strtof in the "C" locale, so every
+ * result is identical to reading the token with operator>> whatever
+ * setlocale says.
+ */
+static bool parse_float_token(const char *text, size_t len, size_t &pos, cl_float &value)
+{
+    // As many digits as always fit in a uint64_t
+    static const int MAX_DIGITS = 19;
+
+    const size_t start    = pos;
+    const bool   negative = text[pos] == '-';
+    if (text[pos] == '-' || text[pos] == '+')
+    {
+        ++pos;
     }
-}
 
-//读取一个type数据
-template <typename UIntType>
-static UIntType read_le(std::istream &in)
-{
-    UIntType val = 0;
-    unsigned char byte = 0;
-    for (uint32_t i = 0; i < sizeof(UIntType); ++i)
+    uint64_t mantissa   = 0;
+    int      num_digits = 0;
+    int      exponent   = 0;
+    bool     any_digits = false;
+    bool     exact      = true;
+    for (; pos < len && is_digit(text[pos]); ++pos)
     {
-        in.get(*reinterpret_cast<char *>(&byte));
-        val |= byte << (i * 8);     //小端内存模式，低位的放在前面
+        any_digits = true;
+        if (mantissa == 0 && text[pos] == '0')
+        {
+            continue;
+        }
+        if (++num_digits > MAX_DIGITS)
+        {
+            exact = false;
+            break;
+        }
+        mantissa = mantissa * 10 + (text[pos] - '0');
+    }
+    if (exact && pos < len && text[pos] == '.')
+    {
+        for (++pos; pos < len && is_digit(text[pos]); ++pos)
+        {
+            any_digits = true;
+            --exponent;
+            if (mantissa == 0 && text[pos] == '0')
+            {
+                continue;
+            }
+            if (++num_digits > MAX_DIGITS)
+            {
+                exact = false;
+                break;
+            }
+            mantissa = mantissa * 10 + (text[pos] - '0');
+        }
+    }
+    if (exact && any_digits && pos < len && (text[pos] == 'e' || text[pos] == 'E'))
+    {
+        ++pos;
+        const bool exp_negative = pos < len && text[pos] == '-';
+        if (pos < len && (text[pos] == '-' || text[pos] == '+'))
+        {
+            ++pos;
+        }
+        int        exp_value = 0;
+        const bool has_digit = pos < len && is_digit(text[pos]);
+        for (; pos < len && is_digit(text[pos]) && exp_value < 1000; ++pos)
+        {
+            exp_value = exp_value * 10 + (text[pos] - '0');
+        }
+        exact     = has_digit && exp_value < 1000;
+        exponent += exp_negative ? -exp_value : exp_value;
     }
-    return val;
-}
 
-static void read_and_check_header(std::istream &in, uint32_t &width, uint32_t &height, uint32_t desired_data_type,
-                                  uint32_t desired_order, const std::string &data_type_name,
-                                  const std::string &order_name)
-{
-    width              = read_le<uint32_t>(in);
-    height             = read_le<uint32_t>(in);
-    uint32_t data_type = read_le<uint32_t>(in);
-    uint32_t order     = read_le<uint32_t>(in);
-    if (order != desired_order || data_type != desired_data_type)
+    cl_float   magnitude    = 0;
+    const bool at_token_end = pos == len || is_space(text[pos]);
+    if (exact && any_digits && at_token_end && decimal_to_float(mantissa, exponent, magnitude))
     {
-        std::cerr << "Expected " << order_name << " and " << data_type_name << " channel order and data types\n";
-        std::exit(EXIT_FAILURE);
+        value = negative ? -magnitude : magnitude;
+        return true;
+    }
+
+    while (pos < len && !is_space(text[pos]))
+    {
+        ++pos;
     }
+    const std::string buf(text + start, pos - start);
+    char             *end = NULL;
+    value                 = strtof_c_locale(buf.c_str(), &end);
+    return end == buf.c_str() + buf.size();
 }
 
-// Macros are great for stringification
-#define GET_HEADER(strm, w, h, desired_dt, desired_ord) \
-    read_and_check_header(strm, w, h, desired_dt, desired_ord, #desired_dt, #desired_ord)
+static const size_t MAX_FORMATTED_FLOAT_LEN = 32;
 
 /**
- * Internal method for reading a plane of image data from a stream.
- * If no re-ordering of bytes is desired, e.g. for a packed format, just set
- * "channel_bytes" to 1.
+ * \brief Rounds |value| (finite and non-zero) to the given number of
+ *        significant decimal digits.
  *
- * @param in - A stream to read from. Must have data in little-endian byte order.
- * @param channel_bytes - The number of consecutive bytes to read for each color channel
- * @param num_channels - The number of color channels per pixel
- * @param plane - An appropriately sized buffer to hold the output
+ * The value is scaled by a power of ten in double precision, which is accurate
+ * to well under 1e-6 of a unit in the last digit. Only when the scaled value is
+ * closer than that to a rounding boundary is printf asked for the digits.
+ *
+ * @param value
+ * @param precision - Number of significant digits, 1 to 9
+ * @param exp10 [out] - Decimal exponent of the leading digit
+ * @return The digits as an integer in [10^(precision-1), 10^precision)
  */
-static void read_plane(std::istream &in, uint32_t channel_bytes, uint32_t num_channels, std::vector<unsigned char> &plane)
+static uint32_t round_to_digits(cl_float value, int precision, int &exp10)
 {
-    for (size_t i = 0; i < plane.size() / (channel_bytes * num_channels); ++i)
+    static const uint32_t POWERS_OF_TEN[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+                                             1000000000};
+
+    const double magnitude = std::fabs(static_cast<double>(value));
+    exp10                  = static_cast<int>(std::floor(std::log10(magnitude)));
+    double scaled          = magnitude * std::pow(10.0, precision - 1 - exp10);
+    if (scaled < POWERS_OF_TEN[precision - 1])
+    {
+        --exp10;
+        scaled = magnitude * std::pow(10.0, precision - 1 - exp10);
+    }
+    else if (scaled >= POWERS_OF_TEN[precision])
+    {
+        ++exp10;
+        scaled = magnitude * std::pow(10.0, precision - 1 - exp10);
+    }
+
+    const double whole = std::floor(scaled);
+    if (std::fabs(scaled - whole - 0.5) < 1e-6)
     {
-        for (size_t j = 0; j < num_channels; ++j)   //先后读取各个通道
+        // [-]d.ddde[+-]xx
+        char sci[MAX_FORMATTED_FLOAT_LEN];
+        std::snprintf(sci, sizeof(sci), "%.*e", precision - 1, std::fabs(value));
+        uint32_t digits = sci[0] - '0';
+        for (int i = 1; i < precision; ++i)
         {
-            switch (channel_bytes)      //读取一个通道的数据
-            {
-                case 1:
-                {
-                    const uint8_t val = read_le<uint8_t>(in);
-                    std::memcpy(plane.data() + i * num_channels * channel_bytes + j * channel_bytes, &val, sizeof(val));
-                    break;
-                }
-                case 2:
-                {
-                    const uint16_t val = read_le<uint16_t>(in);
-                    std::memcpy(plane.data() + i * num_channels * channel_bytes + j * channel_bytes, &val, sizeof(val));
-                    break;
-                }
-                case 4:
-                {
-                    const uint32_t val = read_le<uint32_t>(in);
-                    std::memcpy(plane.data() + i * num_channels * channel_bytes + j * channel_bytes, &val, sizeof(val));
-                    break;
-                }
-                default:
-                {
-                    std::cerr << "Error, can't read " << channel_bytes << " bytes at a time.\n";
-                    std::exit(EXIT_FAILURE);
-                }
-            }
+            digits = digits * 10 + (sci[i + 1] - '0');
         }
+        exp10 = std::atoi(sci + precision + (precision > 1 ? 2 : 1));
+        return digits;
     }
+
+    uint32_t digits = static_cast<uint32_t>(whole) + (scaled - whole > 0.5 ? 1 : 0);
+    if (digits == POWERS_OF_TEN[precision])
+    {
+        digits /= 10;
+        ++exp10;
+    }
+    return digits;
 }
 
 /**
- * Internal method for writing a plane of image data to a stream.
- * If no re-ordering of bytes is desired, e.g. for a packed format, just set
- * "channel_bytes" to 1.
+ * \brief Writes value to out in the style of printf's %g, using the fewest
+ *        significant digits (at most 9) that read back as the same float.
+ *        Values that need no more than 6 digits come out exactly as %g, i.e.
+ *        operator<< with the default precision, would print them.
  *
- * @param out - A stream to write to.
- * @param channel_bytes - The number of consecutive bytes to read for each color channel
- * @param num_channels - The number of color channels per pixel
- * @param plane - An appropriately sized buffer to read the data from.
+ * For normal floats any decimal of 6 or fewer digits survives a round trip
+ * through float, so rounding to 6 digits already yields the shortest such
+ * representation, padded with zeros. The search therefore only has to try 6
+ * to 9 digits. Subnormals start from 6 digits too, even though fewer might
+ * round-trip, so that those %g already prints exactly keep its output.
+ *
+ * @param value
+ * @param out - Buffer of at least MAX_FORMATTED_FLOAT_LEN chars. Not null-terminated.
+ * @return The number of chars written.
  */
-static void write_plane(std::ostream &out, uint32_t channel_bytes, uint32_t num_channels, const std::vector<unsigned char> &plane)
+static size_t format_shortest_float(cl_float value, char *out)
 {
-    for (size_t i = 0; i < plane.size() / (channel_bytes * num_channels); ++i)
+    static const int MAX_DIGITS = 9;
+
+    if (!std::isfinite(value) || value == 0)
+    {
+        return std::snprintf(out, MAX_FORMATTED_FLOAT_LEN, "%g", value);
+    }
+
+    const cl_float magnitude = std::fabs(value);
+    uint32_t       digits    = 0;
+    int            exp10     = 0;
+    int            precision = 6;
+    for (; precision <= MAX_DIGITS; ++precision)
     {
-        for (size_t j = 0; j < num_channels; ++j)
+        digits                = round_to_digits(value, precision, exp10);
+        cl_float   round_trip = 0;
+        const bool decided    = decimal_to_float(digits, exp10 - precision + 1, round_trip);
+        if (precision == MAX_DIGITS || (decided && round_trip == magnitude))
+        {
+            break;
+        }
+        if (!decided)
         {
-            switch (channel_bytes)
+            char buf[MAX_FORMATTED_FLOAT_LEN];
+            std::snprintf(buf, sizeof(buf), "%ue%d", digits, exp10 - precision + 1);
+            if (strtof_c_locale(buf, NULL) == magnitude)
             {
-                case 1:
-                {
-                    write_le<uint8_t>(out, plane[i * num_channels * channel_bytes + j * channel_bytes]);
-                    break;
-                }
-                case 2:
-                {
-                    const uint16_t val = *reinterpret_cast<const uint16_t *>(plane.data() + i * num_channels * channel_bytes + j * channel_bytes);
-                    write_le<uint16_t>(out, val);
-                    break;
-                }
-                case 4:
-                {
-                    const uint32_t val = *reinterpret_cast<const uint32_t *>(plane.data() + i * num_channels * channel_bytes + j * channel_bytes);
-                    write_le<uint32_t>(out, val);
-                    break;
-                }
-                default:
-                {
-                    std::cerr << "Error, can't write " << channel_bytes << " bytes at a time.\n";
-                    std::exit(EXIT_FAILURE);
-                }
+                break;
             }
         }
     }
-}
 
-static void save_yuv_file_internal(const std::string &filename, const yuv_image_t &image, uint32_t data_type, uint32_t order,
-                                   uint32_t channel_bytes)
-{
-    std::ofstream fout(filename, std::ios::binary);
-    if (!fout)
+    // Digits as characters, with trailing zeros stripped as %g does
+    char chars[MAX_DIGITS];
+    int  num_digits = precision;
+    for (int i = precision - 1; i >= 0; --i)
     {
-        std::cerr << "Can't open " << filename << " for writing.\n";
-        std::exit(EXIT_FAILURE);
+        chars[i] = static_cast<char>('0' + digits % 10);
+        digits /= 10;
+    }
+    while (num_digits > 1 && chars[num_digits - 1] == '0')
+    {
+        --num_digits;
     }
 
-    write_le<uint32_t>(fout, image.y_width);
-    write_le<uint32_t>(fout, image.y_height);
-    write_le<uint32_t>(fout, data_type);
-    write_le<uint32_t>(fout, order);
+    // Same choice between fixed and scientific notation as %g, with at least the default precision of 6
+    size_t len = 0;
+    if (value < 0)
+    {
+        out[len++] = '-';
+    }
+    if (exp10 < -4 || exp10 >= std::max(precision, 6))
+    {
+        out[len++] = chars[0];
+        if (num_digits > 1)
+        {
+            out[len++] = '.';
+            std::memcpy(out + len, chars + 1, num_digits - 1);
+            len += num_digits - 1;
+        }
+        const int abs_exp10 = std::abs(exp10);
+        out[len++]          = 'e';
+        out[len++]          = exp10 < 0 ? '-' : '+';
+        if (abs_exp10 >= 100)
+        {
+            out[len++] = static_cast<char>('0' + abs_exp10 / 100);
+        }
+        out[len++] = static_cast<char>('0' + abs_exp10 / 10 % 10);
+        out[len++] = static_cast<char>('0' + abs_exp10 % 10);
+    }
+    else if (exp10 < 0)
+    {
+        out[len++] = '0';
+        out[len++] = '.';
+        for (int i = -1; i > exp10; --i)
+        {
+            out[len++] = '0';
+        }
+        std::memcpy(out + len, chars, num_digits);
+        len += num_digits;
+    }
+    else
+    {
+        for (int i = 0; i <= exp10; ++i)
+        {
+            out[len++] = i < num_digits ? chars[i] : '0';
+        }
+        if (num_digits > exp10 + 1)
+        {
+            out[len++] = '.';
+            std::memcpy(out + len, chars + exp10 + 1, num_digits - exp10 - 1);
+            len += num_digits - exp10 - 1;
+        }
+    }
 
-    write_plane(fout, channel_bytes, 1, image.y_plane);
-    write_plane(fout, channel_bytes, 2, image.uv_plane);
+    return len;
 }
 
-static void
-save_nonplanar_internal(const std::string &filename, const nonplanar_image_t &image, uint32_t data_type, uint32_t order,
-                        uint32_t channel_bytes, uint32_t num_channels)
+/**
+ * \brief Counts the whitespace-delimited tokens in text[begin, end). Token
+ *        lengths vary too much for branches to predict, so this has none.
+ */
+static size_t count_tokens(const char *text, size_t begin, size_t end)
 {
-    std::ofstream fout(filename, std::ios::binary);
-    if (!fout)
+    size_t count      = 0;
+    bool   prev_space = true;
+    for (size_t i = begin; i < end; ++i)
     {
-        std::cerr << "Can't open " << filename << " for writing.\n";
-        std::exit(EXIT_FAILURE);
+        const bool space = is_space(text[i]);
+        count           += prev_space & !space;
+        prev_space       = space;
     }
-
-    write_le<uint32_t>(fout, image.width);
-    write_le<uint32_t>(fout, image.height);
-    write_le<uint32_t>(fout, data_type);
-    write_le<uint32_t>(fout, order);
-
-    write_plane(fout, channel_bytes, num_channels, image.pixels);
+    return count;
 }
 
-nv12_image_t load_nv12_image_data(const std::string &filename)
+/**
+ * Internal method for loading a text matrix. The file is mapped and its body
+ * is split into chunks at whitespace, so no token spans two chunks. One
+ * parallel pass counts the tokens in each chunk, which gives every chunk its
+ * first element index, and a second parallel pass parses the tokens into a
+ * small buffer. from_floats converts each full buffer to the element type
+ * and moves it into place, e.g. to_half_n.
+ */
+template <typename MatrixType, typename FromFloats>
+static MatrixType load_text_matrix(const std::string &filename, FromFloats from_floats)
 {
-    std::ifstream fin(filename, std::ios::binary);
-    if (!fin)
+    static const size_t MIN_CHUNK_BYTES = 1 << 20;
+    static const size_t BATCH_SIZE      = 256;
+
+    const mapped_file file(filename);
+    const char       *text = reinterpret_cast<const char *>(file.data());
+    const size_t      len  = file.size();
+
+    MatrixType res;
+    size_t     pos = 0;
+    if (!parse_int(text, len, pos, res.width) || !parse_int(text, len, pos, res.height)
+        || res.width < 0 || res.height < 0)
     {
-        std::cerr << "Can't open " << filename << " for reading\n";
+        std::cerr << "Couldn't read the matrix dimensions from " << filename << "\n";
         std::exit(EXIT_FAILURE);
     }
+    const size_t num_elements = static_cast<size_t>(res.width) * res.height;
+    res.elements.resize(num_elements);
 
-    nv12_image_t result;
-    GET_HEADER(fin, result.y_width, result.y_height, CL_UNORM_INT8, CL_QCOM_NV12);
-
-    const size_t y_plane_len = result.y_width * result.y_height;
-    result.y_plane.resize(y_plane_len);
-    read_plane(fin, 1, 1, result.y_plane);
+    const size_t body_len   = len - pos;
+    const size_t max_chunks = 4 * std::max(1u, std::thread::hardware_concurrency());
+    const size_t num_chunks = std::max<size_t>(1, std::min(max_chunks, body_len / MIN_CHUNK_BYTES));
 
-    result.uv_plane.resize(y_plane_len / 2);
-    read_plane(fin, 1, 2, result.uv_plane);
-
-    return result;
-}
+    std::vector<size_t> chunk_starts(num_chunks + 1);
+    chunk_starts[0]          = pos;
+    chunk_starts[num_chunks] = len;
+    for (size_t i = 1; i < num_chunks; ++i)
+    {
+        size_t boundary = std::max(chunk_starts[i - 1], pos + body_len / num_chunks * i);
+        while (boundary < len && !is_space(text[boundary]))
+        {
+            ++boundary;
+        }
+        chunk_starts[i] = boundary;
+    }
 
-tp10_image_t load_tp10_image_data(const std::string &filename)
-{
-    std::ifstream fin(filename, std::ios::binary);
-    if (!fin)
+    std::vector<size_t> chunk_counts(num_chunks + 1, 0);
+    parallel_for(num_chunks, [&](size_t chunk)
     {
-        std::cerr << "Can't open " << filename << " for reading\n";
+        chunk_counts[chunk + 1] = count_tokens(text, chunk_starts[chunk], chunk_starts[chunk + 1]);
+    });
+    for (size_t i = 1; i <= num_chunks; ++i)
+    {
+        chunk_counts[i] += chunk_counts[i - 1];
+    }
+    if (chunk_counts[num_chunks] < num_elements)
+    {
+        std::cerr << "Expected " << num_elements << " elements in " << filename
+                  << " but only found " << chunk_counts[num_chunks] << "\n";
         std::exit(EXIT_FAILURE);
     }
 
-    tp10_image_t result;
-    GET_HEADER(fin, result.y_width, result.y_height, CL_QCOM_UNORM_INT10, CL_QCOM_TP10);
-
-    const size_t y_plane_len = result.y_width * result.y_height / 3 * 4;
-    result.y_plane.resize(y_plane_len);
-    read_plane(fin, 4, 1, result.y_plane);
-
-    result.uv_plane.resize(y_plane_len / 2);
-    read_plane(fin, 4, 1, result.uv_plane);
-
-    return result;
-}
-
-p010_image_t load_p010_image_data(const std::string &filename)
-{
-    std::ifstream fin(filename, std::ios::binary);
-    if (!fin)
+    std::atomic<bool> parse_failed(false);
+    parallel_for(num_chunks, [&](size_t chunk)
     {
-        std::cerr << "Can't open " << filename << " for reading\n";
+        cl_float     batch[BATCH_SIZE];
+        size_t       batch_len = 0;
+        size_t       idx       = chunk_counts[chunk];
+        size_t       i         = chunk_starts[chunk];
+        const size_t chunk_end = chunk_starts[chunk + 1];
+        while (true)
+        {
+            while (i < chunk_end && is_space(text[i]))
+            {
+                ++i;
+            }
+            if (i == chunk_end || idx + batch_len >= num_elements)
+            {
+                break;
+            }
+            if (!parse_float_token(text, chunk_end, i, batch[batch_len]))
+            {
+                parse_failed = true;
+                break;
+            }
+            if (++batch_len == BATCH_SIZE)
+            {
+                from_floats(batch, &res.elements[idx], batch_len);
+                idx += batch_len;
+                batch_len = 0;
+            }
+        }
+        from_floats(batch, res.elements.data() + idx, batch_len);
+    });
+    if (parse_failed)
+    {
+        std::cerr << "Couldn't parse the matrix elements in " << filename << "\n";
         std::exit(EXIT_FAILURE);
     }
 
-    p010_image_t result;
-    GET_HEADER(fin, result.y_width, result.y_height, CL_QCOM_UNORM_INT10, CL_QCOM_P010);
-
-    const size_t y_plane_len = result.y_width * result.y_height * 2;
-    result.y_plane.resize(y_plane_len);
-    read_plane(fin, 2, 1, result.y_plane);
-
-    result.uv_plane.resize(y_plane_len / 2);
-    read_plane(fin, 2, 2, result.uv_plane);
-
-    return result;
-}
-
-void save_nv12_image_data(const std::string &filename, const nv12_image_t &image)
-{
-    save_yuv_file_internal(filename, image, CL_UNORM_INT8, CL_QCOM_NV12, 1);
+    return res;
 }
 
-void save_tp10_image_data(const std::string &filename, const tp10_image_t &image)
+/**
+ * Internal method for saving a binary matrix with rows of width elements.
+ */
+template <typename ElementType>
+static void save_binary_matrix(const std::string &filename, int width, int height, cl_channel_type data_type,
+                               const std::vector<ElementType> &elements)
 {
-    save_yuv_file_internal(filename, image, CL_QCOM_UNORM_INT10, CL_QCOM_TP10, 4);
-}
+    TRACE_FUNCTION();
+    std::ofstream fout(filename, std::ios::binary);
+    if (!fout)
+    {
+        std::cerr << "Can't open " << filename << " for writing.\n";
+        std::exit(EXIT_FAILURE);
+    }
 
-void save_p010_image_data(const std::string &filename, const p010_image_t &image)
-{
-    save_yuv_file_internal(filename, image, CL_QCOM_UNORM_INT10, CL_QCOM_P010, 2);
-}
+    fout.write(reinterpret_cast<const char *>(MATRIX_BINARY_MAGIC), sizeof(MATRIX_BINARY_MAGIC));
+    write_le<uint32_t>(fout, MATRIX_BINARY_VERSION);
+    write_le<uint32_t>(fout, width);
+    write_le<uint32_t>(fout, height);
+    write_le<uint32_t>(fout, data_type);
+    write_le<uint32_t>(fout, width); // row stride
+    write_le<uint32_t>(fout, 0);     // reserved
+    write_le<uint32_t>(fout, 0);     // reserved
 
-size_t work_units(size_t x, size_t r)
-{
-    return (x + r - 1) / r;
+    write_plane(fout, sizeof(ElementType), reinterpret_cast<const unsigned char *>(elements.data()),
+                elements.size() * sizeof(ElementType));
 }
 
 matrix_t load_matrix(const std::string &filename)
 {
-    std::ifstream fin(filename);
-    if (!fin)
-    {
-        std::cerr << "Can't open " << filename << " for reading\n";
-        std::exit(EXIT_FAILURE);
-    }
-    matrix_t res;
-    fin >> res.width >> res.height;
-    res.elements.reserve(res.width * res.height);
-    for (int i = 0; i < res.width * res.height; ++i)
+    TRACE_FUNCTION();
+    if (is_binary_matrix_file(filename))
     {
-        cl_float num;
-        fin >> num;
-        res.elements.push_back(num);
+        return load_binary_matrix<matrix_t>(filename, CL_FLOAT, copy_elements<cl_float>, to_float_n);
     }
-    return res;
+
+    return load_text_matrix<matrix_t>(filename, copy_elements<cl_float>);
 }
 
 void save_matrix(const std::string &filename, const matrix_t &matrix)
@@ -336,20 +2594,61 @@ void save_matrix(const std::string &filename, const matrix_t &matrix)
 
 void save_matrix(std::ostream &out, const matrix_t &matrix)
 {
+    TRACE_FUNCTION();
+    static const size_t ELEMENTS_PER_BLOCK = 1 << 16;
+
     out << matrix.width << " " << matrix.height << "\n";
-    for (auto i = 0; i < matrix.height; ++i)
+
+    // Blocks of whole rows are formatted in parallel, one wave at a time so the
+    // text of the entire matrix never has to be held in memory at once.
+    const size_t width          = static_cast<size_t>(std::max(matrix.width, 0));
+    const size_t height         = static_cast<size_t>(std::max(matrix.height, 0));
+    const size_t rows_per_block = std::max<size_t>(1, ELEMENTS_PER_BLOCK / std::max<size_t>(width, 1));
+    const size_t num_blocks     = work_units(height, rows_per_block);
+    const size_t wave_size      = 4 * std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<std::string> buffers(std::min(wave_size, num_blocks));
+    for (size_t wave_start = 0; wave_start < num_blocks; wave_start += wave_size)
     {
-        for (auto j = 0; j < matrix.width; ++j)
+        const size_t wave_blocks = std::min(wave_size, num_blocks - wave_start);
+        parallel_for(wave_blocks, [&](size_t i)
+        {
+            std::string &buffer    = buffers[i];
+            const size_t first_row = (wave_start + i) * rows_per_block;
+            const size_t last_row  = std::min(height, first_row + rows_per_block);
+            char         element[MAX_FORMATTED_FLOAT_LEN];
+
+            buffer.clear();
+            buffer.reserve((last_row - first_row) * (width * 12 + 1));
+            for (size_t row = first_row; row < last_row; ++row)
+            {
+                for (size_t col = 0; col < width; ++col)
+                {
+                    const size_t len = format_shortest_float(matrix.elements[row * width + col], element);
+                    buffer.append(element, len);
+                    buffer.push_back(' ');
+                }
+                buffer.push_back('\n');
+            }
+        });
+
+        for (size_t i = 0; i < wave_blocks; ++i)
         {
-            const int idx = i * matrix.width + j;
-            out << matrix.elements[idx] << " ";
+            out.write(buffers[i].data(), buffers[i].size());
         }
-        out << "\n";
     }
 }
 
 bayer_mipi10_image_t load_bayer_mipi_10_image_data(const std::string &filename)
 {
+    bayer_mipi10_image_t result;
+    load_bayer_mipi_10_image_data(filename, result);
+    return result;
+}
+
+void load_bayer_mipi_10_image_data(const std::string &filename, bayer_mipi10_image_t &image)
+{
+    TRACE_FUNCTION();
     std::ifstream fin(filename, std::ios::binary);
     if (!fin)
     {
@@ -357,23 +2656,22 @@ bayer_mipi10_image_t load_bayer_mipi_10_image_data(const std::string &filename)
         std::exit(EXIT_FAILURE);
     }
 
-    bayer_mipi10_image_t result;
-    GET_HEADER(fin, result.width, result.height, CL_QCOM_UNORM_MIPI10, CL_QCOM_BAYER);
-
-    const size_t data_length = (result.width / 4 * 5) * (result.height);
-    result.pixels.resize(data_length);
-    read_plane(fin, 1, 1, result.pixels);
+    const bool compressed = GET_HEADER(fin, image.width, image.height, CL_QCOM_UNORM_MIPI10, CL_QCOM_BAYER);
 
-    return result;
+    const size_t data_length = (image.width / 4 * 5) * (image.height);
+    image.pixels.resize(data_length);
+    read_planes(fin, compressed, filename, image.width, image.height, CL_QCOM_UNORM_MIPI10, CL_QCOM_BAYER,
+                image.pixels);
 }
 
 void save_rgba_image_data(const std::string &filename, const rgba_image_t &image)
 {
-    save_nonplanar_internal(filename, image, CL_UNORM_INT8, CL_RGBA, 1, 4);
+    save_nonplanar_internal(filename, image, CL_UNORM_INT8, CL_RGBA, 1);
 }
 
 bayer_int10_image_t load_bayer_int_10_image_data(const std::string &filename)
 {
+    TRACE_FUNCTION();
     std::ifstream fin(filename, std::ios::binary);
     if (!fin)
     {
@@ -382,11 +2680,12 @@ bayer_int10_image_t load_bayer_int_10_image_data(const std::string &filename)
     }
 
     bayer_int10_image_t result;
-    GET_HEADER(fin, result.width, result.height, CL_QCOM_UNORM_INT10, CL_QCOM_BAYER);
+    const bool compressed = GET_HEADER(fin, result.width, result.height, CL_QCOM_UNORM_INT10, CL_QCOM_BAYER);
 
     const size_t data_length = (result.width * 2) * (result.height);
     result.pixels.resize(data_length);
-    read_plane(fin, 2, 1, result.pixels);
+    read_planes(fin, compressed, filename, result.width, result.height, CL_QCOM_UNORM_INT10, CL_QCOM_BAYER,
+                result.pixels);
 
     return result;
 }
@@ -517,38 +2816,65 @@ bool is_format_supported(const std::vector<cl_image_format> &formats, const cl_i
 }
 
 half_matrix_t load_half_matrix(const std::string &filename) {
-    std::ifstream fin(filename);
+    TRACE_FUNCTION();
+    if (is_binary_matrix_file(filename))
+    {
+        return load_binary_matrix<half_matrix_t>(filename, CL_HALF_FLOAT, to_half_n, copy_elements<cl_half>);
+    }
 
-    if (!fin)
+    return load_text_matrix<half_matrix_t>(filename, to_half_n);
+}
+
+/**
+ * Internal method for rounding half floats to bfloat16, by way of floats.
+ * Every half is exactly a float, so this rounds only once.
+ */
+static void halves_to_bfloat16_n(const cl_half *src, cl_bfloat16 *dst, size_t n)
+{
+    static const size_t BATCH_SIZE = 256;
+    cl_float            batch[BATCH_SIZE];
+    for (size_t i = 0; i < n; i += BATCH_SIZE)
     {
-        std::cerr << "Can't open " << filename << " for reading\n";
-        std::exit(EXIT_FAILURE);
+        const size_t count = std::min(BATCH_SIZE, n - i);
+        to_float_n(src + i, batch, count);
+        to_bfloat16_n(batch, dst + i, count);
     }
+}
 
-    half_matrix_t res;
-    fin >> res.width >> res.height;
-    res.elements.reserve(res.width * res.height);
-    for (int i = 0; i < res.width * res.height; ++i)
+bfloat16_matrix_t load_bfloat16_matrix(const std::string &filename)
+{
+    TRACE_FUNCTION();
+    if (is_binary_matrix_file(filename))
     {
-        cl_float num;
-        fin >> num;
-        res.elements.push_back(to_half(num));
+        return load_binary_matrix<bfloat16_matrix_t>(filename, 0, to_bfloat16_n, halves_to_bfloat16_n);
     }
-    return res;
+
+    return load_text_matrix<bfloat16_matrix_t>(filename, to_bfloat16_n);
+}
+
+void save_matrix_binary(const std::string &filename, const matrix_t &matrix)
+{
+    save_binary_matrix(filename, matrix.width, matrix.height, CL_FLOAT, matrix.elements);
+}
+
+void save_half_matrix_binary(const std::string &filename, const half_matrix_t &matrix)
+{
+    save_binary_matrix(filename, matrix.width, matrix.height, CL_HALF_FLOAT, matrix.elements);
 }
 
 void save_single_channel_image_data(const std::string &filename, const single_channel_int16_image_t &image)
 {
-    save_nonplanar_internal(filename, image, CL_UNORM_INT16, CL_R, 2, 1);
+    save_nonplanar_internal(filename, image, CL_UNORM_INT16, CL_R, 2);
 }
 
 void save_single_channel_image_data(const std::string &filename, const single_channel_float_image_t &image)
 {
-    save_nonplanar_internal(filename, image, CL_FLOAT, CL_R, 4, 1);
+    save_nonplanar_internal(filename, image, CL_FLOAT, CL_R, 4);
 }
 
 single_channel_int16_image_t load_single_channel_image_data(const std::string &filename)
 {
+    TRACE_FUNCTION();
     std::ifstream fin(filename, std::ios::binary);
     if (!fin)
     {
@@ -557,22 +2883,23 @@ single_channel_int16_image_t load_single_channel_image_data(const std::string &f
     }
 
     single_channel_int16_image_t result;
-    GET_HEADER(fin, result.width, result.height, CL_UNORM_INT16, CL_R);
+    const bool compressed = GET_HEADER(fin, result.width, result.height, CL_UNORM_INT16, CL_R);
 
     const size_t data_length = (result.width * 2) * (result.height);
     result.pixels.resize(data_length);
-    read_plane(fin, 2, 1, result.pixels);
+    read_planes(fin, compressed, filename, result.width, result.height, CL_UNORM_INT16, CL_R, result.pixels);
 
     return result;
 }
 
 void save_bayer_mipi_10_image_data(const std::string &filename, const bayer_mipi10_image_t &image)
 {
-    save_nonplanar_internal(filename, image, CL_QCOM_UNORM_MIPI10, CL_QCOM_BAYER, 1, 1);
+    save_nonplanar_internal(filename, image, CL_QCOM_UNORM_MIPI10, CL_QCOM_BAYER, 1);
 }
 
 rgba_image_t load_rgba_image_data(const std::string &filename)
 {
+    TRACE_FUNCTION();
     std::ifstream fin(filename, std::ios::binary);
     if (!fin)
     {
@@ -581,11 +2908,11 @@ rgba_image_t load_rgba_image_data(const std::string &filename)
     }
 
     rgba_image_t result;
-    GET_HEADER(fin, result.width, result.height, CL_UNORM_INT8, CL_RGBA);
+    const bool compressed = GET_HEADER(fin, result.width, result.height, CL_UNORM_INT8, CL_RGBA);
 
     const size_t data_length = result.width * result.height * 4;
     result.pixels.resize(data_length);
-    read_plane(fin, 1, 4, result.pixels);
+    read_planes(fin, compressed, filename, result.width, result.height, CL_UNORM_INT8, CL_RGBA, result.pixels);
 
     return result;
 }
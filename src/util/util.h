@@ -13,10 +13,18 @@
 #define SDK_EXAMPLES_UTIL_H
 
 #include <algorithm>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <random>
 #include <string>
 #include <sstream>
 #include <vector>
 #include <CL/cl.h>
+#include <CL/cl_ext_qcom.h>
+
+#include "bfloat16.h"
+#include "mapped_file.h"
 
 /**
  * \brief yuv_image_t represents the "raw bytes" + width and height of YUV image with two planes.
@@ -48,6 +56,12 @@ struct half_matrix_t
     std::vector<cl_half> elements;
 };
 
+struct bfloat16_matrix_t
+{
+    int width, height;
+    std::vector<cl_bfloat16> elements;
+};
+
 /**
  * \brief nonplanar_image_t represents an image type that in contrast to
  *        yuv_image_t does not separate its pixel data into different planes.
@@ -120,6 +134,15 @@ struct single_channel_float_image_t : public nonplanar_image_t {};
  */
 nv12_image_t load_nv12_image_data(const std::string &filename);
 
+/**
+ * \brief As above, but loads into image, reusing its planes' storage when
+ *        they are already big enough. Useful when loading many frames of one size.
+ *
+ * @param filename
+ * @param image [out]
+ */
+void load_nv12_image_data(const std::string &filename, nv12_image_t &image);
+
 /**
  * \brief Saves 8-bit NV12 image to the given filename
  *
@@ -129,7 +152,9 @@ nv12_image_t load_nv12_image_data(const std::string &filename);
 void save_nv12_image_data(const std::string &filename, const nv12_image_t &image);
 
 /**
- * \brief Loads a TP10 image from image data at filename
+ * \brief Loads a TP10 image from image data at filename. Three pixels are
+ *        packed into each 32-bit word and every row is padded to a whole word,
+ *        so the planes are sized by get_image_layout rather than width * 4 / 3.
  *
  * @param filename
  * @return
@@ -137,7 +162,8 @@ void save_nv12_image_data(const std::string &filename, const nv12_image_t &image
 tp10_image_t load_tp10_image_data(const std::string &filename);
 
 /**
- * \brief Saves TP10 image to the given filename
+ * \brief Saves TP10 image to the given filename. The planes must have the
+ *        sizes get_image_layout gives, as load_tp10_image_data makes them.
  *
  * @param filename
  * @param image
@@ -162,18 +188,28 @@ void save_p010_image_data(const std::string &filename, const p010_image_t &image
 
 /**
  * \brief Loads a matrix from the given file according to the format
- *        described in README.md
+ *        described in README.md. Either the text or the binary format may be
+ *        used; binary files holding half floats are widened to floats.
  * @param filename
  */
 matrix_t load_matrix(const std::string &filename);
 
 /**
  * \brief Loads a matrix of half-floats from the given file according to the
- *        format described in README.md
+ *        format described in README.md. Either the text or the binary format
+ *        may be used.
  * @param filename
  */
 half_matrix_t load_half_matrix(const std::string &filename);
 
+/**
+ * \brief Loads a matrix from the given file according to the format described
+ *        in README.md and rounds its elements to bfloat16. Either the text or
+ *        the binary format may be used.
+ * @param filename
+ */
+bfloat16_matrix_t load_bfloat16_matrix(const std::string &filename);
+
 /**
  * \brief Saves a matrix to the given filename.
  * @param filename
@@ -182,12 +218,30 @@ half_matrix_t load_half_matrix(const std::string &filename);
 void save_matrix(const std::string &filename, const matrix_t &matrix);
 
 /**
- * \brief Serializes the matrix to the given output stream
- * @param filename
+ * \brief Serializes the matrix to the given output stream. Rows are formatted
+ *        in parallel, each element with the fewest digits that read back as
+ *        the same float.
+ * @param out
  * @param matrix
  */
 void save_matrix(std::ostream &out, const matrix_t &matrix);
 
+/**
+ * \brief Saves a matrix to the given filename in the binary format described
+ *        in README.md, with CL_FLOAT elements.
+ * @param filename
+ * @param matrix
+ */
+void save_matrix_binary(const std::string &filename, const matrix_t &matrix);
+
+/**
+ * \brief Saves a matrix of half-floats to the given filename in the binary
+ *        format described in README.md, with CL_HALF_FLOAT elements.
+ * @param filename
+ * @param matrix
+ */
+void save_half_matrix_binary(const std::string &filename, const half_matrix_t &matrix);
+
 /**
  * \brief Loads a Bayer MIPI10 from image data at filename
  * @param filename
@@ -195,6 +249,14 @@ void save_matrix(std::ostream &out, const matrix_t &matrix);
  */
 bayer_mipi10_image_t load_bayer_mipi_10_image_data(const std::string &filename);
 
+/**
+ * \brief As above, but loads into image, reusing its storage when it is
+ *        already big enough.
+ * @param filename
+ * @param image [out]
+ */
+void load_bayer_mipi_10_image_data(const std::string &filename, bayer_mipi10_image_t &image);
+
 /**
  * \brief Saves a Bayer MIPI10 image to the given filename
  * @param filename
@@ -245,6 +307,451 @@ void save_single_channel_image_data(const std::string &filename, const single_ch
  */
 single_channel_int16_image_t load_single_channel_image_data(const std::string &filename);
 
+/**
+ * \brief image_layout_t describes how the pixel data following the 16-byte
+ *        header of an image data file is split into planes and rows. YUV 4:2:0
+ *        formats have a Y plane followed by a UV plane with half as many rows;
+ *        all other formats have a single plane.
+ */
+struct image_layout_t
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t num_planes;
+    uint32_t channel_bytes;    // size of one channel, which determines byte order
+    size_t   row_bytes[2];     // packed bytes per row of each plane
+    uint32_t num_rows[2];      // number of rows in each plane
+
+    size_t plane_bytes(uint32_t plane) const { return row_bytes[plane] * num_rows[plane]; }
+};
+
+/**
+ * \brief Gets the layout of an image data file with the given header values.
+ *        Exits if the format isn't one of those handled by the load_* functions.
+ * @param width
+ * @param height
+ * @param data_type
+ * @param order
+ * @return
+ */
+image_layout_t get_image_layout(uint32_t width, uint32_t height, cl_channel_type data_type, cl_channel_order order);
+
+/**
+ * \brief A read-only, zero-copy view of an image data file.
+ *
+ * In contrast to the load_* functions the file is memory-mapped rather than
+ * read, so plane pointers refer directly to the page cache and resident memory
+ * only holds the pages that are actually touched. The plane data is exactly as
+ * stored in the file, i.e. multi-byte channels are little-endian.
+ */
+class mapped_image_view {
+public:
+    /**
+     * \brief Maps filename and checks that its header matches the desired data
+     *        type and channel order. Exits if it doesn't or if the file is short.
+     * @param filename
+     * @param desired_data_type
+     * @param desired_order
+     */
+    mapped_image_view(const std::string &filename, cl_channel_type desired_data_type, cl_channel_order desired_order);
+
+    uint32_t              width() const;
+
+    uint32_t              height() const;
+
+    const image_layout_t &layout() const;
+
+    /**
+     * \brief Gets a pointer to the start of the given plane (0 for Y or the only plane, 1 for UV).
+     * @param plane
+     * @return
+     */
+    const unsigned char  *plane_data(uint32_t plane) const;
+
+    /**
+     * \brief Gets the size in bytes of the given plane.
+     * @param plane
+     * @return
+     */
+    size_t                plane_size(uint32_t plane) const;
+
+private:
+    mapped_file    m_file;
+    image_layout_t m_layout;
+};
+
+/**
+ * \brief image_band_t holds a horizontal band of rows from an image data file,
+ *        as returned by image_band_reader. For YUV 4:2:0 formats plane 1 holds
+ *        the UV rows that go with the band's Y rows.
+ */
+struct image_band_t
+{
+    uint32_t                   first_row;   // index of the band's first row in plane 0
+    uint32_t                   num_rows[2]; // number of rows of each plane in the band
+    std::vector<unsigned char> planes[2];   // packed rows of each plane, channels in host byte order
+};
+
+/**
+ * \brief Reads an image data file one band of rows at a time, so that images
+ *        larger than the memory budget can be processed.
+ *
+ * At most two bands are held in memory: the one returned by next_band, and
+ * the next one, which is read from disk on a background thread while the
+ * caller processes the current one. Rows keep the packing of the file format
+ * (see get_image_layout), so e.g. TP10 and MIPI10 rows stay packed.
+ */
+class image_band_reader {
+public:
+    /**
+     * \brief Opens filename and checks that its header matches the desired data
+     *        type and channel order. Exits if it doesn't or if the file is short.
+     * @param filename
+     * @param desired_data_type
+     * @param desired_order
+     * @param band_rows - Rows of plane 0 per band. Must be even for YUV 4:2:0 formats.
+     */
+    image_band_reader(const std::string &filename, cl_channel_type desired_data_type, cl_channel_order desired_order,
+                      uint32_t band_rows);
+
+    image_band_reader(const image_band_reader &) = delete;
+
+    image_band_reader &operator=(const image_band_reader &) = delete;
+
+    /**
+     * \brief Waits for any read still in flight.
+     */
+    ~image_band_reader();
+
+    uint32_t              width() const;
+
+    uint32_t              height() const;
+
+    const image_layout_t &layout() const;
+
+    uint32_t              band_rows() const;
+
+    uint32_t              num_bands() const;
+
+    /**
+     * \brief Gets the next band and starts reading the one after it.
+     *
+     * The band's buffers are exchanged with the reader's, so passing the same
+     * image_band_t every time reuses its memory rather than allocating.
+     *
+     * @param band [out]
+     * @return false once all bands have been returned.
+     */
+    bool                  next_band(image_band_t &band);
+
+private:
+    void read_band(uint32_t index, image_band_t &band);
+
+    std::string       m_filename;
+    std::ifstream     m_in;
+    image_layout_t    m_layout;
+    uint32_t          m_band_rows;
+    uint32_t          m_num_bands;
+    uint32_t          m_next_band;
+    image_band_t      m_prefetched;
+    std::future<void> m_prefetch;
+};
+
+/**
+ * \brief Copies the rows of one plane of a band to memory with the given row
+ *        pitch, e.g. a mapped ION buffer.
+ * @param band
+ * @param plane
+ * @param dst
+ * @param dst_row_pitch - Bytes between the starts of consecutive rows in dst.
+ */
+void copy_band_plane(const image_band_t &band, uint32_t plane, unsigned char *dst, size_t dst_row_pitch);
+
+/**
+ * \brief Writes the 16-byte header of an image data file, for writers that
+ *        emit the pixel data themselves, e.g. one band at a time.
+ * @param out
+ * @param width
+ * @param height
+ * @param data_type
+ * @param order
+ */
+void write_image_data_header(std::ostream &out, uint32_t width, uint32_t height, cl_channel_type data_type,
+                             cl_channel_order order);
+
+/**
+ * \brief A read-only, memory-mapped view of a frame container: a file holding
+ *        a sequence of YUV 4:2:0 frames of the same size and format, together
+ *        with an index of where each frame starts. See README.md for the file
+ *        format. Any frame can be reached in constant time.
+ */
+class frame_container {
+public:
+    /**
+     * \brief Maps filename and checks its header and index. Exits if the file
+     *        isn't a valid frame container.
+     * @param filename
+     */
+    explicit frame_container(const std::string &filename);
+
+    uint32_t              width() const;
+
+    uint32_t              height() const;
+
+    cl_channel_type       data_type() const;
+
+    cl_channel_order      order() const;
+
+    const image_layout_t &layout() const;
+
+    size_t                num_frames() const;
+
+    /**
+     * \brief Gets a pointer to the start of the given plane of the given frame
+     *        (0 for Y, 1 for UV). The data is exactly as stored in the file,
+     *        i.e. multi-byte channels are little-endian.
+     * @param index
+     * @param plane
+     * @return
+     */
+    const unsigned char  *frame_data(size_t index, uint32_t plane) const;
+
+private:
+    mapped_file          m_file;
+    image_layout_t       m_layout;
+    cl_channel_type      m_data_type;
+    cl_channel_order     m_order;
+    size_t               m_num_frames;
+    const unsigned char *m_index;
+};
+
+/**
+ * \brief Loads frame index of an 8-bit NV12 frame container. Exits if the
+ *        container holds another format or index is out of range.
+ * @param container
+ * @param index
+ * @return
+ */
+nv12_image_t load_nv12_frame(const frame_container &container, size_t index);
+
+/**
+ * \brief Loads frame index of a TP10 frame container.
+ * @param container
+ * @param index
+ * @return
+ */
+tp10_image_t load_tp10_frame(const frame_container &container, size_t index);
+
+/**
+ * \brief Loads frame index of a P010 frame container.
+ * @param container
+ * @param index
+ * @return
+ */
+p010_image_t load_p010_frame(const frame_container &container, size_t index);
+
+/**
+ * \brief Appends frames to a frame container, creating it if it doesn't exist.
+ *
+ * New frames and a new index are written after everything already in the
+ * file, and the header is only updated to point at them by close(). Until
+ * then readers see the container exactly as it was.
+ */
+class frame_container_writer {
+public:
+    /**
+     * \brief Opens or creates filename. Exits if an existing container holds
+     *        frames of another size or format.
+     * @param filename
+     * @param width
+     * @param height
+     * @param data_type
+     * @param order - Must be a YUV 4:2:0 format, i.e. NV12, TP10 or P010.
+     */
+    frame_container_writer(const std::string &filename, uint32_t width, uint32_t height, cl_channel_type data_type,
+                           cl_channel_order order);
+
+    frame_container_writer(const frame_container_writer &) = delete;
+
+    frame_container_writer &operator=(const frame_container_writer &) = delete;
+
+    /**
+     * \brief Calls close().
+     */
+    ~frame_container_writer();
+
+    /**
+     * \brief Appends a frame. Exits if its size, or the size of its planes as
+     *        the load_* functions make them (see get_image_layout), doesn't match the container.
+     * @param frame
+     */
+    void   append_frame(const yuv_image_t &frame);
+
+    /**
+     * \brief Gets the number of frames, including any that were in the file before.
+     * @return
+     */
+    size_t num_frames() const;
+
+    /**
+     * \brief Writes the index and header and closes the file. Does nothing if
+     *        already closed.
+     */
+    void   close();
+
+private:
+    std::string           m_filename;
+    std::fstream          m_file;
+    image_layout_t        m_layout;
+    std::vector<uint64_t> m_offsets;
+};
+
+/**
+ * \brief pitched_planes_t describes where the planes of an image are held in
+ *        host-accessible memory whose rows may be padded, e.g. an ION buffer
+ *        backing a CL image or a plane mapped with clEnqueueMapImage.
+ */
+struct pitched_planes_t
+{
+    unsigned char *data[2];      // start of each plane
+    size_t         row_pitch[2]; // bytes between the starts of consecutive rows of each plane
+};
+
+/**
+ * \brief Gets the planes of a YUV 4:2:0 image in an ION buffer laid out like
+ *        those from cl_wrapper::make_ion_buffer_for_yuv_image: both planes
+ *        have the same row pitch, and the UV plane follows padded_height rows
+ *        of the Y plane.
+ * @param ion_mem
+ * @param row_pitch - As reported by cl_wrapper::get_ion_image_row_pitch.
+ * @param padded_height - As reported by cl_wrapper::get_ion_yuv_image_padded_height.
+ * @return
+ */
+pitched_planes_t get_ion_yuv_planes(const cl_mem_ion_host_ptr &ion_mem, size_t row_pitch, size_t padded_height);
+
+/**
+ * \brief Reads just the header of an image data file, e.g. to size the memory
+ *        it will be loaded into. Exits if it doesn't match the desired data
+ *        type and channel order.
+ * @param filename
+ * @param desired_data_type
+ * @param desired_order
+ * @return
+ */
+image_layout_t read_image_data_layout(const std::string &filename, cl_channel_type desired_data_type,
+                                      cl_channel_order desired_order);
+
+/**
+ * \brief Reads an image data file straight into pitched memory. Each row is
+ *        read into its final position, so no intermediate copy of the image is
+ *        made. Exits if the file doesn't match the desired data type and
+ *        channel order, or if a row pitch is less than the packed row size.
+ * @param filename
+ * @param desired_data_type
+ * @param desired_order
+ * @param dst - Must be large enough for the image in the file.
+ * @return The layout of the image that was read.
+ */
+image_layout_t load_image_data(const std::string &filename, cl_channel_type desired_data_type,
+                               cl_channel_order desired_order, const pitched_planes_t &dst);
+
+/**
+ * \brief Writes an image data file straight from pitched memory, such as a
+ *        mapped ION image, without first copying it to a packed buffer.
+ * @param filename
+ * @param width
+ * @param height
+ * @param data_type
+ * @param order
+ * @param src
+ */
+void save_image_data(const std::string &filename, uint32_t width, uint32_t height, cl_channel_type data_type,
+                     cl_channel_order order, const pitched_planes_t &src);
+
+/**
+ * \brief As save_image_data, but compresses the pixel data losslessly as
+ *        described in README.md. Every load_* function and load_image_data
+ *        decompress such files transparently, decoding groups of rows in
+ *        parallel; mapped_image_view and image_band_reader don't accept them.
+ * @param filename
+ * @param width
+ * @param height
+ * @param data_type
+ * @param order
+ * @param src
+ */
+void save_compressed_image_data(const std::string &filename, uint32_t width, uint32_t height,
+                                cl_channel_type data_type, cl_channel_order order, const pitched_planes_t &src);
+
+/**
+ * \brief Loads an 8-bit NV12 image from image data at filename straight into
+ *        an ION buffer laid out as described for get_ion_yuv_planes.
+ * @param filename
+ * @param ion_mem
+ * @param row_pitch
+ * @param padded_height
+ */
+void load_nv12_image_data(const std::string &filename, const cl_mem_ion_host_ptr &ion_mem, size_t row_pitch,
+                          size_t padded_height);
+
+/**
+ * \brief Saves an 8-bit NV12 image straight from an ION buffer laid out as
+ *        described for get_ion_yuv_planes.
+ * @param filename
+ * @param width
+ * @param height
+ * @param ion_mem
+ * @param row_pitch
+ * @param padded_height
+ */
+void save_nv12_image_data(const std::string &filename, uint32_t width, uint32_t height,
+                          const cl_mem_ion_host_ptr &ion_mem, size_t row_pitch, size_t padded_height);
+
+/**
+ * \brief Loads a TP10 image straight into an ION buffer. Rows stay packed,
+ *        three 10-bit values to each 32-bit word.
+ * @param filename
+ * @param ion_mem
+ * @param row_pitch
+ * @param padded_height
+ */
+void load_tp10_image_data(const std::string &filename, const cl_mem_ion_host_ptr &ion_mem, size_t row_pitch,
+                          size_t padded_height);
+
+/**
+ * \brief Saves a TP10 image straight from an ION buffer.
+ * @param filename
+ * @param width
+ * @param height
+ * @param ion_mem
+ * @param row_pitch
+ * @param padded_height
+ */
+void save_tp10_image_data(const std::string &filename, uint32_t width, uint32_t height,
+                          const cl_mem_ion_host_ptr &ion_mem, size_t row_pitch, size_t padded_height);
+
+/**
+ * \brief Loads a P010 image straight into an ION buffer.
+ * @param filename
+ * @param ion_mem
+ * @param row_pitch
+ * @param padded_height
+ */
+void load_p010_image_data(const std::string &filename, const cl_mem_ion_host_ptr &ion_mem, size_t row_pitch,
+                          size_t padded_height);
+
+/**
+ * \brief Saves a P010 image straight from an ION buffer.
+ * @param filename
+ * @param width
+ * @param height
+ * @param ion_mem
+ * @param row_pitch
+ * @param padded_height
+ */
+void save_p010_image_data(const std::string &filename, uint32_t width, uint32_t height,
+                          const cl_mem_ion_host_ptr &ion_mem, size_t row_pitch, size_t padded_height);
+
 /**
  * \brief Returns smallest y such that y % r == 0 and y >= x
  * @param x
@@ -253,6 +760,45 @@ single_channel_int16_image_t load_single_channel_image_data(const std::string &f
  */
 size_t work_units(size_t x, size_t r);
 
+/**
+ * \brief Calls body(i) for every i in [0, count), spreading the calls over
+ *        all available cores. Returns once every call has finished. The calls
+ *        may run in any order, so they must not depend on each other.
+ * @param count
+ * @param body
+ */
+void parallel_for(size_t count, const std::function<void(size_t)> &body);
+
+/**
+ * \brief Escapes a string for use inside a JSON string literal: quotes and
+ *        backslashes are preceded by a backslash, and the control characters
+ *        0x00 to 0x1f are written as \u00XX.
+ * @param str
+ * @return the escaped string, without surrounding quotes
+ */
+std::string json_escape(const std::string &str);
+
+/**
+ * \brief Gets the nearest-rank percentile of sorted samples.
+ * @param sorted [in] - Samples in increasing order
+ * @param fraction [in] - e.g. 0.99 for the 99th percentile
+ * @return the percentile, or 0 if there are no samples
+ */
+double nearest_rank_percentile(const std::vector<double> &sorted, double fraction);
+
+/**
+ * \brief Keeps a uniformly random subset of at most max_samples of a stream of
+ *        samples (reservoir sampling), so that percentiles can be estimated
+ *        from a long-running stream in bounded memory.
+ * @param samples [in,out] - The kept samples
+ * @param max_samples [in]
+ * @param count [in] - How many samples the stream has had, including this one
+ * @param sample [in]
+ * @param random [in,out] - Picks which kept sample to replace
+ */
+void add_reservoir_sample(std::vector<double> &samples, size_t max_samples, size_t count, double sample,
+                          std::minstd_rand &random);
+
 /**
  * \brief get supported formats with specific mem flag
  * @param context